@@ -31,6 +31,10 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <map>
+
+#include <boost/cstdint.hpp>
 
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/shared_ptr.hpp>
@@ -71,6 +75,9 @@ typedef unsigned short dimension_type;
 
 /*Some pre-declarations*/
 class BinaryTreeNode;
+class CompactBinaryTree;
+class PackedBinaryWord;
+class LatticeCell;
 class Grid;
 class GridAbstractCell;
 class GridCell;
@@ -80,17 +87,31 @@ class GridTreeSet;
 
 class GridTreeCursor;
 class GridTreeConstIterator;
+class GridTreeOverlappingConstIterator;
+class FrozenGridTreeSet;
+class FrozenGridTreeConstIterator;
+class MortonGridTreeSet;
+
+class GridCellCursor;
+class GridSubsetCursor;
+template<class E> class GridSetExpression;
+template<class E> class GridSetExpressionConstIterator;
+class GridSubsetExpression;
 
 /*Declarations of classes in other files*/
 template<class BS> class ListSet;
 class SetCheckerInterface;
 
 std::ostream& operator<<(std::ostream& output_stream, const BinaryTreeNode & binary_tree );
+std::ostream& operator<<(std::ostream& output_stream, const CompactBinaryTree & binary_tree );
+std::ostream& operator<<(std::ostream& os, const PackedBinaryWord& theWord );
 std::ostream& operator<<(std::ostream& os, const GridCell& theGridCell);
 std::ostream& operator<<(std::ostream& os, const GridOpenCell& theGridOpenCell );
 std::ostream& operator<<(std::ostream& os, const GridTreeCursor& theGridTreeCursor);
 std::ostream& operator<<(std::ostream& os, const GridTreeSubset& theGridTreeSubset);
 std::ostream& operator<<(std::ostream& os, const GridTreeSet& theGridTreeSet);
+std::ostream& operator<<(std::ostream& os, const FrozenGridTreeSet& theFrozenGridTreeSet);
+std::ostream& operator<<(std::ostream& os, const MortonGridTreeSet& theMortonGridTreeSet);
 
 bool subset( const GridCell& theCellOne, const GridCell& theCellTwo, BinaryWord * pPathPrefixOne = NULL,
              BinaryWord * pPathPrefixTwo = NULL, uint * pPrimaryCellHeight = NULL );
@@ -100,14 +121,28 @@ bool subset(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
 bool superset(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
 bool overlap(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
 bool disjoint(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
+bool subset(const GridCell& theCell, const FrozenGridTreeSet& theSet);
+bool overlap(const GridCell& theCell, const FrozenGridTreeSet& theSet);
+bool subset(const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2);
+bool superset(const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2);
+bool overlap(const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2);
+bool disjoint(const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2);
 
 /*! \brief Checks whether the set is a subset of \a otherSet.
  *  \details It is assumed that the grids of the two sets are the same, otherwise an error is raised. */
 //bool subset(const GridTreeSet& theSet1, const GridTreeSet& theSet2);
 
 GridTreeSet join(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
+GridTreeSet move_join(GridTreeSet& theSet1, GridTreeSet& theSet2);
+GridTreeSet join(const std::vector<GridTreeSet>& theSets);
+GridTreeSet join(const std::vector<GridTreeSubset>& theSets);
 GridTreeSet intersection(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
 GridTreeSet difference(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
+GridTreeSet symmetric_difference(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
+GridTreeSet product(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2);
+MortonGridTreeSet join(const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2);
+MortonGridTreeSet intersection(const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2);
+MortonGridTreeSet difference(const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2);
 
 GridTreeSet outer_approximation(const Box& theBox, const Grid& theGrid, const uint numSubdivInDim);
 GridTreeSet outer_approximation(const CompactSetInterface& theSet, const Grid& theGrid, const uint numSubdivInDim);
@@ -137,6 +172,96 @@ class NotAllowedMoveException : public std::logic_error {
 };
 
 
+/*! \brief The memory pool from which all the nodes of the binary trees are allocated.
+ *
+ * The nodes are carved out of large slabs and are recycled through an intrusive free list,
+ * so that splitting and mincing do not go to the system allocator for every node.
+ * A released subtree is not traversed: it is put aside as a whole in O(1), and its nodes
+ * are reclaimed one by one when new nodes are allocated. Thus deleting a tree, clearing
+ * a paving or making a leaf out of a large subtree costs constant time. A node shared
+ * by several parents (see \a BinaryTreeNode::share_equal_subtrees) is only reclaimed
+ * when the last of its references is released.
+ * NOTE: The pool is shared by all the binary trees, since nodes migrate between trees
+ * (see \a BinaryTreeNode::prepend_tree and \a GridTreeSubset). When compiled with OpenMP,
+ * every thread keeps its own free list and released subtrees, so that the parallel set
+ * operations (see \a BinaryTreeNode::PARALLEL_SUBTREE_SIZE) allocate without locking,
+ * and the reference counts are updated atomically. A node may be returned to the pool
+ * by a different thread than the one that allocated it. At the end of a parallel region
+ * the worker threads hand their free nodes and released subtrees over to the shared pool
+ * (see \a drain()), from which any thread takes them before it allocates a new slab.
+ * NOTE: The memory is retained by the pool. The nodes of the released trees are reclaimed
+ * lazily, only when new nodes are allocated, and the slabs are not given back to the system
+ * when their nodes become free, so the \a capacity() of the pool never shrinks by itself.
+ * Call \a trim() after releasing large trees to give the slabs without live nodes back.
+ */
+class BinaryTreeNodePool {
+  private:
+    /*! \brief The head of the list of free (not constructed) nodes. */
+    static void * _pFreeList;
+
+    /*! \brief The roots of the released subtrees, whose nodes are not reclaimed yet. */
+    static std::vector<BinaryTreeNode*> _theReleasedTrees;
+
+#ifdef _OPENMP
+    #pragma omp threadprivate( _pFreeList, _theReleasedTrees )
+#endif
+
+    /*! \brief The number of nodes in all the allocated slabs. */
+    static size_t _theCapacity;
+
+    /*! \brief The slabs obtained from the system, shared by all the threads. */
+    static std::vector<char*> _theSlabs;
+
+    /*! \brief The heads of the free lists drained by the threads, shared by all the threads. */
+    static std::vector<void*> _theDrainedFreeLists;
+
+    /*! \brief The released subtrees drained by the threads, shared by all the threads. */
+    static std::vector<BinaryTreeNode*> _theDrainedTrees;
+
+    /*! \brief Takes one drained free list and all the drained subtrees over, when the
+     *  free list of the calling thread is empty. Returns false if nothing was drained.
+     */
+    static bool take_drained();
+
+    /*! \brief Allocates a new slab and puts its nodes into the free list. */
+    static void allocate_slab();
+
+    /*! \brief The index of the slab of \a pMemory in \a _theSlabs, which must be sorted. */
+    static size_t slab_index( void * pMemory );
+
+  public:
+    /*! \brief The number of nodes allocated in one slab. */
+    static const size_t SLAB_SIZE = 4096;
+
+    /*! \brief Returns the memory for one node. The nodes of the released subtrees are reused first. */
+    static void * allocate();
+
+    /*! \brief Returns the memory of one node, whose sub-nodes are already released, back to the pool. */
+    static void deallocate( void * pMemory );
+
+    /*! \brief Releases one reference to the subtree rooted at \a pNode in O(1). If it was
+     *  the last reference then the nodes of the subtree are reclaimed lazily.
+     */
+    static void release( BinaryTreeNode * pNode );
+
+    /*! \brief Hands the free nodes and the released subtrees of the calling thread over to all the
+     *  threads. It is called by the worker threads at the end of a parallel region, so that the nodes
+     *  they have freed are not stranded in their lists until they run again.
+     */
+    static void drain();
+
+    /*! \brief The total number of nodes the pool has obtained from the system. */
+    static size_t capacity();
+
+    /*! \brief Reclaims the nodes of all the released subtrees, then gives the slabs all nodes of
+     *  which are free back to the system. Returns the number of nodes by which \a capacity() shrinks.
+     *  It takes time linear in the number of free nodes. With OpenMP it must be called outside of
+     *  the parallel regions, and only the slabs whose nodes are all free in the calling thread or
+     *  drained (see \a drain()) go.
+     */
+    static size_t trim();
+};
+
 /*! \brief The binary tree node.
  *
  * This node is to be used in a binary tree designed for subdividing the state
@@ -145,12 +270,41 @@ class NotAllowedMoveException : public std::logic_error {
  *
  * \b Storage: We only store pointers to the left and right subtrees and the tribool
  * value indicating whether this cell is enabled/disabled or we do not know.
+ * The nodes are allocated from the \a BinaryTreeNodePool. The reference count used
+ * by the sharing below fills the padding after the tribool value, so it does not make
+ * the node bigger, and the trees that are never shared only keep it equal to one.
+ *
+ * \b Sharing: After \a share_equal_subtrees() the structurally identical subtrees of
+ * a tree are represented by one reference counted node. Such a tree is modified in
+ * the copy-on-write manner: the non-const \a left_node() and \a right_node() replace
+ * a shared sub-node by a private copy of it, which itself shares the sub-nodes below.
+ * Thus every node reached from the root through the non-const accessors is exclusive
+ * and can be modified, whereas the const accessors give the read-only access.
+ *
+ * \b Counting: When compiled with \a ARIADNE_BINARY_TREE_NODE_CACHES, every node caches
+ * the number of enabled leaves in its subtree, which is computed lazily by \a count_enabled_leaf_nodes.
+ * The cache is invalidated when the node is modified, or when a sub-node is obtained through
+ * the non-const accessors, so the modifications made by descending from the root keep the
+ * counts up to date, and only the invalidated paths are recounted. A GridTreeSubset within
+ * a larger tree descends from the root of the latter before it is modified, see
+ * \a GridTreeSubset::root_node_for_update. The cache takes one more word per node, and the
+ * parallel set operations need it to find the large subtrees, see \a PARALLEL_SUBTREE_SIZE.
+ * Without it the node is as small as possible and the leaves are counted by a traversal.
+ *
+ * \b Hashing: With the same option every node caches the structural (Merkle) hash of its subtree,
+ * which is computed by \a hash only when it is asked for. The equal trees have equal hashes,
+ * so the comparison of two trees whose hashes are known tells the different ones apart in O(1).
+ * The two caches take 16 more bytes per node, i.e. 40 instead of 24 on a 64-bit platform.
  */
 class BinaryTreeNode {
+    friend class BinaryTreeNodePool;
   protected:
     /*! \brief Defines whether the given node of the tree is on/off or we do not know*/
     tribool _isEnabled;
 
+    /*! \brief The number of parent nodes (or owners) referencing this node, one for an exclusive node. */
+    uint _theReferences;
+
     /*! \brief The left and right subnodes of the tree. Note that,
      * \a pLeftNode == \a NULL iff \a pRightNode == \a NULL. The latter
      * is allowed iff \a _isEnabled == \a TRUE or \a _isEnabled == \a FALSE,
@@ -159,6 +313,30 @@ class BinaryTreeNode {
     BinaryTreeNode* _pLeftNode;
     BinaryTreeNode* _pRightNode;
 
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+    /*! \brief The cached number of enabled leaves in the subtree, or \a UNKNOWN_LEAF_COUNT. */
+    mutable size_t _theEnabledLeafCount;
+
+    /*! \brief The cached hash of the subtree, or \a UNKNOWN_HASH. */
+    mutable boost::uint64_t _theHash;
+#endif
+
+    /*! \brief The value of \a _theEnabledLeafCount that marks the invalid cache. */
+    static const size_t UNKNOWN_LEAF_COUNT = static_cast<size_t>(-1);
+
+    /*! \brief The value of \a _theHash that marks the invalid cache, it is never a computed hash. */
+    static const boost::uint64_t UNKNOWN_HASH = 0;
+
+    /*! \brief The table of unique nodes used by \a share_equal_subtrees, the key is made of
+     * the sub-nodes and the value of \a _isEnabled (0 - false, 1 - true, 2 - indeterminate).
+     */
+    typedef std::map< std::pair< std::pair< const BinaryTreeNode*, const BinaryTreeNode* >, int >, BinaryTreeNode* > UniqueNodeTable;
+
+    /*! \brief Returns the unique representative of the subtree rooted to \a pNode,
+     * the reference to \a pNode is passed over to the returned node.
+     */
+    static BinaryTreeNode * share_equal_subtrees( BinaryTreeNode * pNode, UniqueNodeTable & theUniqueNodes );
+
     /*! \brief This method splits the enabled subtrees of the tree rooted to
      * \a pCurrentNode in such a way that the tree depth becomes \a depth.
      * If the initial tree depth is greater than \a depth then nothing is done.
@@ -181,7 +359,48 @@ class BinaryTreeNode {
     /*! \brief This method is used in constructors for the node initialization */
     void init( tribool isEnabled, BinaryTreeNode* pLeftNode, BinaryTreeNode* pRightNode );
 
+    /*! \brief A recursive operation on two aligned trees, such as \a restrict_node */
+    typedef void (*NodeOperation)( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
+
+    /*! \brief Applies \a theOperation to the trees rooted to \a pThisNode and \a pOtherNode.
+     *  If the other tree has at least \a PARALLEL_SUBTREE_SIZE enabled leaves and there are
+     *  several OpenMP threads, then this is done by the team of threads, see \a apply_to_sub_nodes.
+     */
+    static void apply_operation( NodeOperation theOperation, BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
+
+    /*! \brief Applies \a theOperation to the left and to the right sub-nodes of the non-leaf
+     *  nodes \a pThisNode and \a pOtherNode. In a parallel region the left sub-nodes are
+     *  processed by a new task, if the other node has at least \a PARALLEL_SUBTREE_SIZE
+     *  enabled leaves, so that the smaller subtrees are processed sequentially.
+     */
+    static void apply_to_sub_nodes( NodeOperation theOperation, BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
+
+    /*! \brief The recursion of \a add_enabled( BinaryTreeNode*, const BinaryTreeNode* ) */
+    static void add_enabled_node( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot );
+
+    /*! \brief The recursion of \a restrict */
+    static void restrict_node( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
+
+    /*! \brief The recursion of \a remove */
+    static void remove_node( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
+
+    /*! \brief Copies the cached values of \a pNode into this node, which must be equal to \a pNode */
+    void copy_known_caches( const BinaryTreeNode * pNode );
+
+    /*! \brief Moves the sub-nodes of \a pFromNode into the leaf \a pToNode, the former becomes a disabled leaf */
+    static void move_sub_nodes( BinaryTreeNode * pToNode, BinaryTreeNode * pFromNode );
+
+    /*! \brief Enables the disabled leaves and disables the enabled ones in the tree rooted to \a pNode */
+    static void complement( BinaryTreeNode * pNode );
+
   public:
+    /*! \brief The number of enabled leaves of the other tree from which on \a add_enabled,
+     *  \a restrict and \a remove process the left and the right subtrees in parallel.
+     *  The sizes of the subtrees are taken from the cached counts, so without
+     *  \a ARIADNE_BINARY_TREE_NODE_CACHES these operations run sequentially.
+     */
+    static const size_t PARALLEL_SUBTREE_SIZE = 4096;
+
     //@{
     //! \name Constructors
 
@@ -211,8 +430,20 @@ class BinaryTreeNode {
 
     //@}
 
+    /*! \brief The destructor, the sub-trees are released to the \a BinaryTreeNodePool in O(1). */
     ~BinaryTreeNode();
 
+    //@{
+    //! \name Memory management
+
+    /*! \brief Allocates the memory for a node from the \a BinaryTreeNodePool. */
+    static void * operator new( size_t size );
+
+    /*! \brief Returns the memory of a node to the \a BinaryTreeNodePool. */
+    static void operator delete( void * pMemory );
+
+    //@}
+
     //@{
     //! \name Properties
 
@@ -238,11 +469,20 @@ class BinaryTreeNode {
     /*! \brief Returns true if the node is a leaf (pLeftNode == NULL && pRightNode == NULL) otherwise false */
     bool is_leaf() const;
 
-    /*! \brief Return the left sub-node */
-    BinaryTreeNode * left_node() const;
+    /*! \brief Return the left sub-node for reading, it may be shared */
+    const BinaryTreeNode * left_node() const;
+
+    /*! \brief Return the right sub-node for reading, it may be shared */
+    const BinaryTreeNode * right_node() const;
 
-    /*! \brief Return the right sub-node */
-    BinaryTreeNode * right_node() const;
+    /*! \brief Return the left sub-node for modification, if it is shared it is replaced by a private copy first */
+    BinaryTreeNode * left_node();
+
+    /*! \brief Return the right sub-node for modification, if it is shared it is replaced by a private copy first */
+    BinaryTreeNode * right_node();
+
+    /*! \brief Returns true if the node is referenced by more than one parent node */
+    bool is_shared() const;
 
     /*! \brief Returns the depth of the sub-tree rooted to the given node, i.e. the depth of it's deepest node */
     uint depth() const;
@@ -250,10 +490,33 @@ class BinaryTreeNode {
     /*! \brief Allows to compare to binaty tree nodes */
     bool operator==(const BinaryTreeNode & otherNode ) const;
 
+    /*! \brief Compares the trees rooted to the given nodes, the shared subtrees are compared in O(1) */
     static bool is_equal_nodes( const BinaryTreeNode * pFirstNode, const BinaryTreeNode * pSecondNode );
 
     //@}
 
+    //@{
+    //! \name Sharing
+
+    /*! \brief Makes all structurally identical subtrees of the tree rooted to this node share
+     * one reference counted copy (hash consing). The node itself is left in place, the freed
+     * nodes are released to the \a BinaryTreeNodePool. The subtrees are unshared again lazily,
+     * when they are modified (see the non-const \a left_node() and \a right_node()).
+     */
+    void share_equal_subtrees();
+
+    /*! \brief If the node \a pNode is shared then it is substituted by its private shallow copy,
+     * i.e. the copy shares the sub-nodes of \a pNode, and the reference to \a pNode is released.
+     */
+    static void unshare( BinaryTreeNode *& pNode );
+
+    /*! \brief Returns a new exclusive node equal to \a pNode, that shares the sub-nodes of \a pNode.
+     * The tree is copied in O(1), its nodes are copied lazily when one of the trees is modified.
+     */
+    static BinaryTreeNode * shallow_copy( const BinaryTreeNode * pNode );
+
+    //@}
+
     //@{
     //! \name Leaf Operations
 
@@ -345,17 +608,38 @@ class BinaryTreeNode {
      *  tree stays intact. If on the other hand we have a non-leaf node in
      *  \a pToTreeRoot and we are adding to it an enabled node of \a pFromTreeRoot
      *  then we just "substitute" the former one with the latter.
-     *  NOTE: 1. This function is recursive. 2. No pointers are copied between
-     *  \a pToTreeRoot and \a pFromTreeRoot.
+     *  NOTE: 1. This function is recursive and runs in parallel for large trees.
+     *  2. No pointers are copied between \a pToTreeRoot and \a pFromTreeRoot.
      */
-    void add_enabled( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot );
+    static void add_enabled( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot );
 
     /*! \brief Starting in the \a pNode node as at the root, this method counts
      *  the number of enabled leaf nodes in the subtree
-     *  rooted at pNode.
+     *  rooted at pNode. With \a ARIADNE_BINARY_TREE_NODE_CACHES the counts are cached
+     *  in the nodes, thus it takes constant time unless the tree was modified since the last call.
      */
     static size_t count_enabled_leaf_nodes( const BinaryTreeNode* pNode );
 
+    /*! \brief Starting in the \a pNode node as at the root, this method computes the structural
+     *  hash of the subtree rooted at pNode, from the values of its leaves and the shape of the tree.
+     *  The hashes are cached in the nodes as the counts of \a count_enabled_leaf_nodes are,
+     *  otherwise the whole tree is traversed.
+     */
+    static boost::uint64_t hash( const BinaryTreeNode* pNode );
+
+    /*! \brief Marks the cached number of enabled leaves and the cached hash of this node as unknown. */
+    void invalidate_enabled_leaf_count();
+
+    /*! \brief The cached number of enabled leaves, or \a UNKNOWN_LEAF_COUNT, which is always the case
+     *  without \a ARIADNE_BINARY_TREE_NODE_CACHES. The caches are read and
+     *  invalidated atomically, and they are filled in outside of the parallel regions only, since the
+     *  parallel tasks may reach the same shared nodes (see \a apply_to_sub_nodes).
+     */
+    size_t known_enabled_leaf_count() const;
+
+    /*! \brief The cached hash, or \a UNKNOWN_HASH, see \a known_enabled_leaf_count() */
+    boost::uint64_t known_hash() const;
+
     /*! \brief Starting in the \a pRootTreeNode node as at the root, this method finds(creates)
      *  the leaf node defined by the \a path and marks it as enabled. If some prefix of the \a path
      *  references an enabled node then nothing is done.
@@ -371,15 +655,44 @@ class BinaryTreeNode {
 
     /*! \brief This method restricts \a pThisNode to \a pOtherNode.
      * In essence we do the inplace AND on the tree node pThisNode.
-     * Note that, this method is recursive.
+     * Note that, this method is recursive and runs in parallel for large trees.
      */
     static void restrict( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
 
     /*! \brief This method removed enabled nodes of \a pOtherNode from \a pThisNode.
-     * Note that, this method is recursive.
+     * Note that, this method is recursive and runs in parallel for large trees.
      */
     static void remove( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
 
+    /*! \brief As \a add_enabled( BinaryTreeNode*, const BinaryTreeNode* ), but the subtrees of
+     *  \a pFromTreeRoot are moved into the disabled leaves of \a pToTreeRoot instead of being
+     *  copied. The tree rooted to \a pFromTreeRoot is left in an undefined state.
+     */
+    static void move_add_enabled( BinaryTreeNode* pToTreeRoot, BinaryTreeNode* pFromTreeRoot );
+
+    /*! \brief As \a restrict, but the subtrees of \a pOtherNode are moved into the enabled
+     *  leaves of \a pThisNode. The tree rooted to \a pOtherNode is left in an undefined state.
+     */
+    static void move_restrict( BinaryTreeNode * pThisNode, BinaryTreeNode * pOtherNode );
+
+    /*! \brief As \a remove, but the subtrees of \a pOtherNode are moved into the enabled leaves
+     *  of \a pThisNode and complemented there, instead of splitting the leaves and removing from
+     *  them. The tree rooted to \a pOtherNode is left in an undefined state.
+     */
+    static void move_remove( BinaryTreeNode * pThisNode, BinaryTreeNode * pOtherNode );
+
+    /*! \brief As \a add_enabled( BinaryTreeNode*, const BinaryTreeNode* ), and the cells of
+     *  \a pFromTreeRoot that are not enabled in \a pToTreeRoot are also added to \a pNewTreeRoot.
+     *  The latter is a disabled leaf aligned with \a pToTreeRoot, it stays such if nothing is new.
+     */
+    static void add_enabled_and_report_new( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot,
+                                            BinaryTreeNode* pNewTreeRoot );
+
+    /*! \brief Toggles the cells of \a pThisNode that are enabled in \a pOtherNode, i.e. makes
+     *  the inplace exclusive OR of the two trees. Note that, this method is recursive.
+     */
+    static void toggle( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode );
+
     /*! \brief checks if two trees overlap in a set-theory sense.
      * I.e. we assume that pRootNodeOne and pRootNodeTwo correspond to the same (virtual) root
      * and then we see if the enabled leaf node of one tree contain enabled leaf nodes of
@@ -398,6 +711,375 @@ class BinaryTreeNode {
     //@}
 };
 
+/*! \brief The binary tree stored in one contiguous array of 32-bit words.
+ *
+ * This is an alternative node store for the trees built of \a BinaryTreeNode. It represents the same
+ * subdivision of a cell into enabled and disabled sub-cells, but is about three times smaller and the
+ * recursive operations \a restrict, \a remove, \a add_enabled, \a overlap and \a subset run over an
+ * array instead of following pointers to scattered heap nodes.
+ *
+ * \b Storage: Every node is one 32-bit word. The two lowest bits of the word keep the state of the node:
+ * a disabled leaf, an enabled leaf or a non-leaf node. The remaining 30 bits of a non-leaf node keep the
+ * index of its left sub-node, the right sub-node is always stored right after the left one. The root
+ * node has the index zero. When a non-leaf node becomes a leaf, the pairs of its sub-nodes are put into
+ * a free list and are reused by the next splits.
+ * NOTE: The nodes are referred to by their indices, which stay valid until the node is deleted. Note that,
+ * unlike with \a BinaryTreeNode, there are no leaf nodes with an indeterminate value, such leaves are
+ * treated as disabled.
+ */
+class CompactBinaryTree {
+  public:
+    /*! \brief The type of the packed nodes */
+    typedef boost::uint32_t node_type;
+
+    /*! \brief The index of the root node */
+    static const uint ROOT = 0;
+
+  private:
+    /*! \brief The states of the node, kept in the two lowest bits of its word */
+    enum { DISABLED_LEAF = 0, ENABLED_LEAF = 1, NON_LEAF = 2, STATE_MASK = 3, STATE_BITS = 2 };
+
+    /*! \brief The packed nodes of the tree. */
+    std::vector<node_type> _theNodes;
+
+    /*! \brief The index of the first pair of free nodes, zero if there are none. The root node can not
+     *  be free, so the index of the next free pair is kept in the first node of every free pair.
+     */
+    uint _theFreePairs;
+
+    /*! \brief Returns the index of an unused pair of nodes, the nodes are not initialized */
+    uint allocate_pair();
+
+    /*! \brief Puts the sub-nodes of \a node and all their descendants into the free list. */
+    void release_sub_nodes( const uint node );
+
+    /*! \brief Sets the node's word, \a firstChild is only meaningful for NON_LEAF nodes. */
+    void set_node( const uint node, const node_type state, const uint firstChild = 0 );
+
+    /*! \brief The recursive procedures used by the constructors and the conversion to \a BinaryTreeNode */
+    void copy_node( const uint node, const BinaryTreeNode * pNode );
+    void copy_node( const uint node, const CompactBinaryTree & otherTree, const uint otherNode );
+    void copy_to_node( BinaryTreeNode * pNode, const uint node ) const;
+    void tree_to_binary_words( const uint node, BinaryWord & tree, BinaryWord & leaves ) const;
+
+    /*! \brief The recursive procedures for the operations on the two trees,
+     *  \a node is the node of this tree, \a otherNode is the corresponding node of \a otherTree.
+     */
+    void restrict( const uint node, const CompactBinaryTree & otherTree, const uint otherNode );
+    void remove( const uint node, const CompactBinaryTree & otherTree, const uint otherNode );
+    void add_enabled( const uint node, const CompactBinaryTree & otherTree, const uint otherNode );
+    void recombine_node( const uint node );
+    static bool overlap( const CompactBinaryTree & treeOne, const uint nodeOne,
+                         const CompactBinaryTree & treeTwo, const uint nodeTwo );
+    static bool subset( const CompactBinaryTree & treeOne, const uint nodeOne,
+                        const CompactBinaryTree & treeTwo, const uint nodeTwo );
+    static bool is_equal_nodes( const CompactBinaryTree & treeOne, const uint nodeOne,
+                                const CompactBinaryTree & treeTwo, const uint nodeTwo );
+
+  public:
+    //@{
+    //! \name Constructors
+
+    /*! \brief Construct a tree consisting of one leaf node. */
+    explicit CompactBinaryTree( const bool isEnabled = false );
+
+    /*! \brief Construct a tree with the same structure as the tree rooted at \a theTreeNode.
+     *  The nodes are laid out in the depth first order, so the siblings are stored next to each other.
+     */
+    explicit CompactBinaryTree( const BinaryTreeNode & theTreeNode );
+
+    /*! \brief Creates the pointer-based copy of the tree, the caller is responsible for deleting it. */
+    BinaryTreeNode * to_binary_tree() const;
+
+    //@}
+
+    //@{
+    //! \name Properties
+
+    /*! \brief Returns true if the node is a leaf */
+    bool is_leaf( const uint node ) const;
+
+    /*! \brief Returns true if the node is an enabled leaf */
+    bool is_enabled( const uint node ) const;
+
+    /*! \brief Returns true if the node is a disabled leaf */
+    bool is_disabled( const uint node ) const;
+
+    /*! \brief Returns the index of the left sub-node, the node must not be a leaf */
+    uint left_node( const uint node ) const;
+
+    /*! \brief Returns the index of the right sub-node, the node must not be a leaf */
+    uint right_node( const uint node ) const;
+
+    /*! \brief Returns true if some of the leaf nodes in the subtree rooted at \a node are enabled */
+    bool has_enabled( const uint node = ROOT ) const;
+
+    /*! \brief Returns true if all leaf nodes in the subtree rooted at \a node are enabled */
+    bool all_enabled( const uint node = ROOT ) const;
+
+    /*! \brief Counts the enabled leaf nodes in the subtree rooted at \a node */
+    size_t count_enabled_leaf_nodes( const uint node = ROOT ) const;
+
+    /*! \brief The number of nodes in the tree */
+    size_t node_count() const;
+
+    /*! \brief The number of bytes used by the nodes, including the free ones */
+    size_t memory() const;
+
+    /*! \brief Compares the trees structurally, as \a BinaryTreeNode::operator== does */
+    bool operator==( const CompactBinaryTree & otherTree ) const;
+
+    /*! \brief Stores the tree in the form of two arrays, as \a BinaryTreeNode::tree_to_binary_words does */
+    void tree_to_binary_words( BinaryWord & tree, BinaryWord & leaves ) const;
+
+    //@}
+
+    //@{
+    //! \name Leaf Operations
+
+    /*! \brief Makes the node a leaf with the enabled value \a isEnabled, its sub-nodes are freed */
+    void make_leaf( const uint node, const bool isEnabled );
+
+    /*! \brief Marks the leaf node as enabled, otherwise throws \a NotALeafNodeException */
+    void set_enabled( const uint node );
+
+    /*! \brief Marks the leaf node as disabled, otherwise throws \a NotALeafNodeException */
+    void set_disabled( const uint node );
+
+    /*! \brief Splits the leaf node, the sub-nodes inherit the enabled value of the node.
+     *  If the node is not a leaf then nothing is done.
+     */
+    void split( const uint node );
+
+    /*! \brief Removes the pairs of the leaf nodes that have the same parent and the same enabled value */
+    void recombine();
+
+    //@}
+
+    //@{
+    //! \name Operations on two trees rooted at the same cell
+
+    /*! \brief Restricts this tree to \a otherTree, i.e. does the inplace AND, see \a BinaryTreeNode::restrict */
+    void restrict( const CompactBinaryTree & otherTree );
+
+    /*! \brief Removes the enabled nodes of \a otherTree from this tree, see \a BinaryTreeNode::remove */
+    void remove( const CompactBinaryTree & otherTree );
+
+    /*! \brief Adds the enabled nodes of \a otherTree to this tree, see \a BinaryTreeNode::add_enabled */
+    void add_enabled( const CompactBinaryTree & otherTree );
+
+    /*! \brief Checks if the two trees overlap in a set-theory sense, see \a BinaryTreeNode::overlap */
+    static bool overlap( const CompactBinaryTree & treeOne, const CompactBinaryTree & treeTwo );
+
+    /*! \brief Checks if \a treeOne is a subset of \a treeTwo in a set-theory sense, see \a BinaryTreeNode::subset */
+    static bool subset( const CompactBinaryTree & treeOne, const CompactBinaryTree & treeTwo );
+
+    //@}
+};
+
+/*! \brief A binary word packed into 64-bit limbs, used for comparing and sorting cell paths.
+ *
+ * The bits are stored most-significant first and the unused bits of the limbs are kept zero,
+ * so that the limbs of two words compare as unsigned integers in the same way as the words
+ * compare lexicographically. Thus equality, lexicographic comparison and the longest common
+ * prefix are computed a limb (64 bits) at a time, and appending a word or a run of equal bits
+ * shifts whole limbs. Words of up to \a INLINE_LIMBS limbs are stored inside the object, so
+ * that the paths of most cells do not allocate at all.
+ * NOTE: The ordering is the lexicographic one, where a proper prefix precedes the word.
+ * A packed path of a cell is returned by \a GridAbstractCell::packed_word.
+ */
+class PackedBinaryWord {
+  public:
+    /*! \brief The type of a limb of the packed word */
+    typedef boost::uint64_t limb_type;
+
+    /*! \brief The number of bits in one limb */
+    static const uint LIMB_BITS = 64;
+
+    /*! \brief The number of limbs stored inside the object */
+    static const uint INLINE_LIMBS = 2;
+
+  private:
+    /*! \brief The number of bits in the word */
+    size_t _theSize;
+
+    /*! \brief The number of limbs available in \a _pLimbs */
+    size_t _theCapacity;
+
+    /*! \brief The limbs, this points either to \a _theInlineLimbs or to a heap-allocated array */
+    limb_type * _pLimbs;
+
+    /*! \brief The small-buffer storage for short words */
+    limb_type _theInlineLimbs[INLINE_LIMBS];
+
+    /*! \brief The number of limbs needed to store \a numBits bits */
+    static size_t limbs_for( const size_t numBits );
+
+    /*! \brief The number of leading zero bits of a non-zero \a limb */
+    static uint leading_zeros( limb_type limb );
+
+    /*! \brief Makes sure that there are at least \a numLimbs limbs, the new limbs are zeroed */
+    void reserve_limbs( const size_t numLimbs );
+
+  public:
+    /*! \brief The empty word */
+    PackedBinaryWord();
+
+    /*! \brief Packs \a theWord */
+    explicit PackedBinaryWord( const BinaryWord& theWord );
+
+    /*! \brief The copy constructor */
+    PackedBinaryWord( const PackedBinaryWord& otherWord );
+
+    /*! \brief The destructor, releases the heap storage if any */
+    ~PackedBinaryWord();
+
+    /*! \brief The assignment operator */
+    PackedBinaryWord& operator=( const PackedBinaryWord& otherWord );
+
+    /*! \brief The number of bits in the word */
+    size_t size() const;
+
+    /*! \brief Returns true if the word has no bits */
+    bool empty() const;
+
+    /*! \brief The \a i'th bit of the word */
+    bool operator[]( const size_t i ) const;
+
+    /*! \brief Removes all bits from the word, the storage is kept */
+    void clear();
+
+    /*! \brief Appends the bit \a bit */
+    void push_back( const bool bit );
+
+    /*! \brief Removes the last bit, the word must not be empty */
+    void pop_back();
+
+    /*! \brief Appends \a count copies of \a bit, whole limbs are filled at once */
+    void append( const bool bit, const size_t count );
+
+    /*! \brief Appends \a otherWord, the limbs are shifted into place a limb at a time */
+    void append( const PackedBinaryWord& otherWord );
+
+    /*! \brief Appends the bits of \a theWord */
+    void append( const BinaryWord& theWord );
+
+    /*! \brief The length of the longest common prefix of this word and \a otherWord */
+    size_t common_prefix_length( const PackedBinaryWord& otherWord ) const;
+
+    /*! \brief Returns true if this word is a prefix of (or equal to) \a otherWord */
+    bool is_prefix( const PackedBinaryWord& otherWord ) const;
+
+    /*! \brief Compares the words lexicographically, returns a negative number, zero
+     *  or a positive number if this word is less than, equal to or greater than \a otherWord.
+     */
+    int compare( const PackedBinaryWord& otherWord ) const;
+
+    /*! \brief Unpacks the word into a \a BinaryWord */
+    BinaryWord to_binary_word() const;
+
+    bool operator==( const PackedBinaryWord& otherWord ) const;
+    bool operator!=( const PackedBinaryWord& otherWord ) const;
+    bool operator<( const PackedBinaryWord& otherWord ) const;
+};
+
+/*! \brief The exact integer representation of a grid cell in the lattice of its grid.
+ *
+ * A cell at the path length \a n below the primary cell of height \a h has been split
+ * n_k = (n + d - 1 - k)/d times in the k'th of its d dimensions. It is the c_k'th
+ * (counting from zero) of the 2^{n_k} slices of its primary cell in that dimension.
+ * The bits of c_k are the bits of the word at the positions k, k + d, k + 2d, ...,
+ * most significant first, so the cell and its word convert into each other without
+ * loss. The lattice box of the cell is computed from the coordinates in O(d) and the
+ * containment and equality of cells become integer arithmetic on the coordinates.
+ * NOTE: Every n_k is limited to \a MAX_SUBDIVISIONS, see \a is_representable.
+ */
+class LatticeCell {
+  public:
+    /*! \brief The type of an integer coordinate of a cell */
+    typedef boost::uint64_t coordinate_type;
+
+    /*! \brief The maximum number of splits per dimension that can be represented. The coordinates
+     *  have more bits, but only up to 53 of them convert exactly to the Float mantissa of the lattice box.
+     */
+    static const uint MAX_SUBDIVISIONS = 53;
+
+  private:
+    /*! \brief The height of the primary cell */
+    uint _theHeight;
+
+    /*! \brief The length of the path from the primary cell to the cell */
+    uint _thePathLength;
+
+    /*! \brief The integer coordinate of the cell in every dimension */
+    std::vector<coordinate_type> _theCoordinates;
+
+  public:
+    /*! \brief Converts the cell given by the path \a theWord from the primary cell
+     *  of height \a theHeight in the \a dimensions dimensional space.
+     */
+    LatticeCell( const dimension_type dimensions, const uint theHeight, const BinaryWord& theWord );
+
+    /*! \brief Returns true if the path of the length \a pathLength in the
+     *  \a dimensions dimensional space does not exceed \a MAX_SUBDIVISIONS
+     *  splits in any dimension.
+     */
+    static bool is_representable( const dimension_type dimensions, const uint pathLength );
+
+    /*! \brief Returns true if all neighbors of a cell with the path of the length \a pathLength
+     *  are representable. A neighbor can need the primary cell two levels higher, see
+     *  \a neighboring_cell, which adds \a dimensions splits per level to the path.
+     */
+    static bool has_representable_neighbors( const dimension_type dimensions, const uint pathLength );
+
+    /*! \brief The dimension of the cell */
+    dimension_type dimension() const;
+
+    /*! \brief The height of the primary cell to which the cell is rooted */
+    uint height() const;
+
+    /*! \brief The length of the path from the primary cell to the cell */
+    uint path_length() const;
+
+    /*! \brief The number of times the primary cell has been split in the dimension \a dim */
+    uint subdivisions( const dimension_type dim ) const;
+
+    /*! \brief The integer coordinate of the cell in the dimension \a dim */
+    coordinate_type coordinate( const dimension_type dim ) const;
+
+    /*! \brief The path from the primary cell to the cell */
+    BinaryWord word() const;
+
+    /*! \brief The lattice box of the cell, computed in O(d), see \a GridCell::compute_lattice_box */
+    Vector<Interval> lattice_box() const;
+
+    /*! \brief The same cell, rooted to the primary cell of the height \a theHeight >= height().
+     *  The path between the primary cells adds one bit to every coordinate per height level.
+     */
+    LatticeCell rerooted( const uint theHeight ) const;
+
+    /*! \brief Returns true if this cell is a subset of \a otherCell, both cells are rooted to a common primary cell */
+    bool subset( const LatticeCell& otherCell ) const;
+
+    /*! \brief Returns true if the cells are the same, both cells are rooted to a common primary cell */
+    bool operator==( const LatticeCell& otherCell ) const;
+
+    /*! \brief The cell of the same size, shifted by \a theOffsets[k], which is -1, 0 or 1, cells in every
+     *  dimension k. The result is rooted to the lowest primary cell, not lower than height(), containing it.
+     *  NOTE: The path length of the cell has to satisfy \a has_representable_neighbors.
+     */
+    LatticeCell neighboring_cell( const std::vector<int>& theOffsets ) const;
+
+    /*! \brief All 3^d - 1 face, edge and vertex neighbors of the cell, see \a neighboring_cell.
+     *  The offsets are enumerated in the lexicographic order, -1 before 0 before 1.
+     */
+    std::vector<LatticeCell> neighboring_cells() const;
+
+  private:
+    /*! \brief The largest coordinate in the dimension \a dim, i.e. the cell touching the upper border of the primary cell */
+    coordinate_type last_coordinate( const dimension_type dim ) const;
+};
+
 /*! \brief An abstract cell of a grid paving. This class is the base of the GridCell - a regular cell on the Grid
  *  and the GridOpenCell - an open cell on a Grid. Here we only store common data and operations
  *
@@ -436,12 +1118,19 @@ class GridAbstractCell {
      */
     static inline void primary_cell_at_height( const uint theHeight, int & leftBottomCorner, int & rightTopCorner );
 
+    /*! \brief The height of the smallest primary cell such that the interval [\a lower, \a upper] lies in
+     *  the interior of its (one dimensional) lattice interval. It is computed in O(1) from the binary exponents of
+     *  the bounds, because the corners of the primary cells are known in a closed form, see
+     *  \a primary_cell_lattice_box.
+     */
+    static uint smallest_enclosing_primary_cell_height( const Float lower, const Float upper );
+
     /*! \brief This function allows to compare to cells it is used by the operator== and operator< methods of this class
      *  The value of \a comparator should be either \a COMPARE_EQUAL or \a COMPARE_LESS
      *  The function checks that both cells are on the same grid and then aligns their primary cells.
      *  The latter is done by extending the binary word of the cell with the lowest primary cell with
-     *  the corresponding prefix. When the words are aligned, we simply use the == and < operators of
-     *  the \a BinaryWord class.
+     *  the corresponding prefix. The aligned words are packed (see \a PackedBinaryWord) and compared
+     *  a limb at a time, cells rooted to the same primary cell are tested for equality without packing.
      *  NOTE: Since the function is only based on comparison of the Grids, the words defining the cells and the
      *  primary cell heights we can use it in sub-classes for comparing cells of the same types
      */
@@ -465,6 +1154,13 @@ class GridAbstractCell {
     /*! \brief The word describing the path in a binary tree from the primary cell of height (this.height()) to this cell. */
     const BinaryWord& word() const;
 
+    /*! \brief The path from the primary cell of height \a topPCellHeight to this cell, packed into limbs.
+     *  It is required that \a topPCellHeight >= this.height(). The packed paths of cells on the same grid
+     *  taken with the same \a topPCellHeight compare in the same way as the cells themselves, so they
+     *  can be computed once and used as keys when sorting or searching large numbers of cells.
+     */
+    PackedBinaryWord packed_word( const uint topPCellHeight ) const;
+
     /*! \brief The geometric box represented by the cell. */
     const Box& box() const;
 
@@ -489,11 +1185,13 @@ class GridAbstractCell {
      *     The cell size is always double the size of the previous-level cell and one
      *     of the corners stays the same as well. If Li, Ri are the left-, right-corned
      *     coordinates at level i then we have the following recursive definition:
-     *       L0 = 0, R0 = 0
+     *       L0 = 0, R0 = 1
      *       Li = 2*L(i-1) - R(i-1) (if i is odd)
      *       Li = L(i-1)            (if i is even)
      *       Ri = R(i-1)            (if i is odd)
      *       Ri = 2*R(i-1) - L(i-1) (if i is even)
+     *     So that L(2k-1) = L(2k) = -(4^k - 1)/3 and R(2k) = R(2k+1) = (2*4^k + 1)/3, the corners
+     *     of all the heights (up to \a MAX_PRIMARY_CELL_HEIGHT) are precomputed, see \a primary_cell_corners.
      *
      *  WARNING: The returned box must be interpreted relative to some grid.
      *  In other words, we assume some lattice and the relation to the original
@@ -505,9 +1203,17 @@ class GridAbstractCell {
      */
     static Vector<Interval> primary_cell_lattice_box( const uint theHeight, const dimension_type dimensions );
 
+    /*! \brief The highest primary cell whose lattice coordinates fit into an int */
+    static const uint MAX_PRIMARY_CELL_HEIGHT = 31;
+
+    /*! \brief The corners of the primary cell of height \a theHeight, taken from a precomputed table in O(1).
+     *  In every dimension, the lattice interval of the primary cell is [\a leftBottomCorner, \a rightTopCorner].
+     */
+    static void primary_cell_corners( const uint theHeight, int & leftBottomCorner, int & rightTopCorner );
+
     /*! \brief Takes the lattice box \a theLatticeBox related to some (unknown) grid and computes the
      *   smallest primary cell on that grid that will contain this box.
-     *   The method returns the height of that primary cell.
+     *   The method returns the height of that primary cell, it takes O(d) time and does not allocate.
      */
     static uint smallest_enclosing_primary_cell_height( const Vector<Interval>& theLatticeBox );
 
@@ -526,6 +1232,14 @@ class GridAbstractCell {
      * the box dimensions in the original space
      */
     static Box lattice_box_to_space(const Vector<Interval> & theLatticeBox, const Grid& theGrid );
+
+    /*! \brief Splits the lattice box of a cell at the depth \a theDepth (the length of the path
+     *  from the primary cell) into the lattice boxes of its sub cells. On input both \a theLeftLatticeBox
+     *  and \a theRightLatticeBox are the lattice box of the cell, on output they are its left and right
+     *  halves. This allows the tree traversals to carry the lattice box down instead of recomputing it
+     *  from the primary cell with \a GridCell::compute_lattice_box at every node.
+     */
+    static void split_lattice_box( const uint theDepth, Vector<Interval>& theLeftLatticeBox, Vector<Interval>& theRightLatticeBox );
 };
 
 /*! \brief A cell of a grid paving. Note that this class represents the closed cell.
@@ -577,7 +1291,20 @@ class GridCell : public GridAbstractCell {
     /*! \brief Allows to convert the given GridCell into an open grid cell (GridOpenCell)*/
     GridOpenCell interior() const;
 
-    /*! \brief this method computes the box corresponding to this cell in the grid lattice.*/
+    /*! \brief The exact integer coordinates of this cell in the grid lattice, see \a LatticeCell. */
+    LatticeCell lattice_cell() const;
+
+    /*! \brief All 3^d - 1 face, edge and vertex neighbors of this cell, computed in one go from
+     *  the integer coordinates of the cell, see \a LatticeCell::neighboring_cells. Every neighbor is
+     *  rooted to the lowest primary cell, not lower than height(), that contains it.
+     *  NOTE: The word of the cell has to satisfy \a LatticeCell::has_representable_neighbors.
+     */
+    std::vector<GridCell> neighboring_cells() const;
+
+    /*! \brief this method computes the box corresponding to this cell in the grid lattice.
+     *  The box is computed from the integer coordinates of the cell (see \a LatticeCell),
+     *  unless the path is too long for them, then the word is replayed split by split.
+     */
     static Vector<Interval> compute_lattice_box( const uint dimensions, const uint theHeight, const BinaryWord& theWord );
 
     /*! \brief this method computes the box in the original space based on the \a theGrid,
@@ -664,6 +1391,12 @@ class GridOpenCell: public GridAbstractCell {
     static void cover_cell_and_borders( const GridCell& theCell, const GridTreeSet& theSet,
                                         BinaryWord& cellPosition, std::vector<GridOpenCell>& result );
 
+    /*! \brief The same as above, but the neighbors of \a theCell are computed from its integer
+     *  coordinates, see \a LatticeCell::neighboring_cell, unless its path is too long for them.
+     */
+    static void cover_cell_and_borders( const GridCell& theCell, const GridTreeSet& theSet,
+                                        std::vector<GridOpenCell>& result );
+
   public:
     /*! \brief Default constructor. Needed for some containers and iterators. */
     GridOpenCell();
@@ -728,6 +1461,11 @@ class GridOpenCell: public GridAbstractCell {
 /*! \brief This class represents a subpaving of a paving. Note that, the subtree enclosed into
  * this class is just a pointer to the node in the tree of some paving. This class is not
  * responsible for deallocation of that original tree.
+ * WARNING: A subpaving obtained from a paving (e.g. through \a GridTreeCursor) refers to the
+ * root node of the paving's tree. It becomes invalid, as an iterator into a container does,
+ * once the paving gets a new root node: when it is re-rooted to a higher primary cell
+ * (see \a GridTreeSet::up_to_primary_cell, which the adjoining of a set rooted higher does),
+ * assigned, dilated or destroyed.
  */
 class GridTreeSubset : public DrawableInterface {
   protected:
@@ -739,50 +1477,76 @@ class GridTreeSubset : public DrawableInterface {
 
     /*! \brief The pointer to the root node of the subpaving tree.
      * Note that, this is not necessarily the root node of the corresponding paving tree.
+     * It is mutable, because a cursor on the subpaving follows the path to it again before
+     * modification, see \a GridTreeCursor::current_node_for_update.
      */
-    BinaryTreeNode * _pRootTreeNode;
+    mutable BinaryTreeNode * _pRootTreeNode;
 
     /*! \brief The paving cell corresponding to the root node of the SubPaving.*/
     GridCell _theGridCell;
 
-    /*! \brief this function takes the interval width and computes how many binary subdivisions
-     * one has to make in order to have sub-intervals of the width <= \a theMaxWidth
+    /*! \brief The root node of the paving tree that this subpaving is a part of, or NULL
+     * if \a _pRootTreeNode is the root of its tree, or if the latter is not known. It is
+     * not tracked when the paving is re-rooted, see the class documentation.
      */
-    uint compute_number_subdiv( Float theWidth, const Float theMaxWidth) const;
+    BinaryTreeNode * _pPavingRootNode;
 
-    /*! \brief This method checks whether the set defined by \a pCurrentNode is a superset
-     *  of \a theBox, in case when it is known that the cell corresponding to the root of
-     *  pCurrentNode [and defined by \a theGrid, the primary cell (\a theHeight) to which
-     *  this tree is (virtually) rooted via the path theWord] encloses \a theBox.
-     *  This is a recursive procedure and it returns true only if there are no disabled
-     *  cells in \a pCurrentNode that intersect with theBox.
+    /*! \brief The depth of \a _pRootTreeNode below \a _pPavingRootNode, the path between
+     * them is given by the last \a _theDepthInPaving bits of the word of \a _theGridCell.
+     */
+    uint _theDepthInPaving;
+
+    /*! \brief Prepares the root node of the subpaving for modification and returns it. The nodes
+     * of the paving tree may be shared (see \a BinaryTreeNode::share_equal_subtrees), so the path
+     * from \a _pPavingRootNode is followed again through the non-const accessors, which substitute
+     * the shared nodes by their private copies and invalidate the cached counts of the nodes above.
+     */
+    BinaryTreeNode * root_node_for_update();
+
+    /*! \brief Follows the last \a theDepthInPaving bits of \a theWord from \a pPavingRootNode through the
+     * non-const accessors, returns the node reached, see \a root_node_for_update.
+     */
+    static BinaryTreeNode * follow_path_for_update( BinaryTreeNode * pPavingRootNode, const BinaryWord& theWord,
+                                                    const uint theDepthInPaving );
+
+    /*! \brief this function takes the interval width and computes how many binary subdivisions
+     * one has to make in order to have sub-intervals of the width <= \a theMaxWidth
+     */
+    uint compute_number_subdiv( Float theWidth, const Float theMaxWidth) const;
+
+    /*! \brief This method checks whether the set defined by \a pCurrentNode is a superset
+     *  of \a theBox, in case when it is known that the cell corresponding to the root of
+     *  pCurrentNode [given by \a theGrid and its lattice box \a theLatticeBox, the cell
+     *  lies at the depth \a theDepth below its primary cell] encloses \a theBox.
+     *  This is a recursive procedure and it returns true only if there are no disabled
+     *  cells in \a pCurrentNode that intersect with theBox.
      */
     static tribool covers( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                                const uint theHeight, BinaryWord &theWord, const Box& theBox );
+                                const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox );
 
     /*! \brief This method checks whether the set defined by \a pCurrentNode is a subset
-     *  of \a theBox. The set of \a pCurrentNode is defined by \a theGrid, the primary
-     *  cell (\a theHeight) to which this tree is (virtually) rooted via the path theWord.
+     *  of \a theBox. The cell of \a pCurrentNode is given by \a theGrid and its lattice box
+     *  \a theLatticeBox, it lies at the depth \a theDepth below its primary cell.
      *  This is a recursive procedure and it returns true only if all enabled sub-cells of
      *  \a pCurrentNode are sub-sets of \a theBox.
      */
     static tribool subset( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                           const uint theHeight, BinaryWord &theWord, const Box& theBox );
+                           const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox );
 
     /*! \brief This method checks whether \a theBox is disjoint from the set defined by
-     *  \a pCurrentNode, \a theGrid, the primary cell (\a theHeight) to which this
-     *  tree is (virtually) rooted via the path theWord. This is done using the recursive
+     *  \a pCurrentNode, whose cell is given by \a theGrid and the lattice box \a theLatticeBox
+     *  at the depth \a theDepth below its primary cell. This is done using the recursive
      *  procedure by checking the cells of the tree that intersect with the box and going
      *  down to the leaves. When reaching a leaf node that is enabled we conclude that we
      *  have an intersection. If there are no such nodes then there is no intersection,
      *  and the sets are disjoint.
      */
     static tribool disjoint( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                             const uint theHeight, BinaryWord &theWord, const Box& theBox );
+                             const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox );
 
     /*! \brief This method checks whether \a theBox overlaps the set defined by
-     *  \a pCurrentNode, \a theGrid, the primary cell (\a theHeight) to which this
-     *  tree is (virtually) rooted via the path theWord. This is done using the recursive
+     *  \a pCurrentNode, whose cell is given by \a theGrid and the lattice box \a theLatticeBox
+     *  at the depth \a theDepth below its primary cell. This is done using the recursive
      *  procedure by checking the cells of the tree that overlap the box and going
      *  down to the leaves. When reaching a leaf node that is enabled we conclude that we
      *  have an overlap. If there are no such nodes then there is no overlap. Note that this
@@ -790,7 +1554,7 @@ class GridTreeSubset : public DrawableInterface {
      *  are disjoint, and overlaps tests if the interiors are not disjoint.
      */
     static tribool overlaps( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                             const uint theHeight, BinaryWord &theWord, const Box& theBox );
+                             const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox );
     
     /*! Allow to convert the number of subdivisions in each dimension, i.e. \a numSubdivInDim,
      *  starting from the zero cell into the number of subdivisions that have to be done in a
@@ -808,6 +1572,9 @@ class GridTreeSubset : public DrawableInterface {
     /*! \brief A short name for the constant iterator */
     typedef GridTreeConstIterator const_iterator;
 
+    /*! \brief The iterator through the activated cells that overlap a box, see \a cells_overlapping */
+    typedef GridTreeOverlappingConstIterator overlapping_const_iterator;
+
     //@{
     //! \name Constructors
 
@@ -817,10 +1584,20 @@ class GridTreeSubset : public DrawableInterface {
      * \a theHeight defines the height of the primary root cell of the GridTreeSet
      * (Remember that every GridTreeSubset is just a reference to a subtree of a GridTreeSet).
      * \a theWord defines the path to the \a pRootTreeNode node from the primary root cell
-     * of the corresponding GridTreeSet.
+     * of the corresponding GridTreeSet. NOTE: \a pRootTreeNode is taken as the root of its tree, so if
+     * it lies within a larger tree, then the subpaving should only be read, since modifying it does not
+     * invalidate the counts cached above it. Otherwise the constructor below is to be used.
      */
     GridTreeSubset( const Grid& theGrid, const uint theHeight, const BinaryWord& theWord, BinaryTreeNode * pRootTreeNode );
 
+    /*! \brief Constructs the subpaving rooted to \a pRootTreeNode, which lies \a theDepthInPaving levels below
+     * the root \a pPavingRootNode of the paving tree, as for the subpavings of the \a GridTreeCursor.
+     * The path to the node is then followed again from \a pPavingRootNode when the subpaving is modified,
+     * so that the shared nodes are copied and the cached counts of the paving are kept up to date.
+     */
+    GridTreeSubset( const Grid& theGrid, const uint theHeight, const BinaryWord& theWord, BinaryTreeNode * pRootTreeNode,
+                    BinaryTreeNode * pPavingRootNode, const uint theDepthInPaving );
+
     /*! \brief A copy constructor that only copies the pointer to the root of the binary tree and the cell */
     GridTreeSubset( const GridTreeSubset &otherSubset);
 
@@ -839,9 +1616,41 @@ class GridTreeSubset : public DrawableInterface {
     /*! \brief True if the set is empty. */
     bool empty() const;
 
-    /*! \brief The number of activated cells in the set. */
+    /*! \brief The number of activated cells in the set. The counts of enabled cells are
+     *  cached in the tree nodes, so this takes constant time on an unmodified set.
+     */
     size_t size() const;
 
+    /*! \brief The number of activated cells that precede \a theCell in the order of iteration,
+     *  i.e. the index of \a theCell if it is an activated cell. \a theCell must be located
+     *  within the root cell of the set. Takes O(depth) time, see \a size().
+     */
+    size_t rank( const GridCell& theCell ) const;
+
+    /*! \brief The activated cell with the given \a index in the order of iteration,
+     *  where \a index < \a size(). Takes O(depth) time, see \a size().
+     */
+    GridCell select( size_t index ) const;
+
+    /*! \brief The index returned by \a locate for the points that are not in the set */
+    static const size_t NOT_LOCATED = static_cast<size_t>(-1);
+
+    /*! \brief The leaf cell, enabled or not, that contains \a thePoint, which has to be located within
+     *  the root cell. The cells are taken half-open, i.e. without their upper boundaries, so that every
+     *  point of the root cell lies in exactly one leaf cell.
+     */
+    GridCell locate( const Point& thePoint ) const;
+
+    /*! \brief For every point of \a thePoints the index of the activated cell that contains it, see
+     *  \a rank(), or \a NOT_LOCATED. The points are mapped to the integer lattice of the root cell in
+     *  batches, using the precomputed reciprocal widths of the root cell, and then the tree is descended
+     *  by extracting the bits of the integer coordinates. The cells are half-open as in \a locate.
+     */
+    std::vector<size_t> locate( const std::vector<Point>& thePoints ) const;
+
+    /*! \brief For every point of \a thePoints tells if it lies in an activated cell, see \a locate */
+    std::vector<bool> contains( const std::vector<Point>& thePoints ) const;
+
     /*! \brief The dimension of the set. */
     uint dimension() const;
 
@@ -851,6 +1660,12 @@ class GridTreeSubset : public DrawableInterface {
     /*! \brief Returns the const pointer to the root BinaryTreeNode of the SubPaving*/
     const BinaryTreeNode * binary_tree() const;
 
+    /*! \brief Returns the pointer to the root BinaryTreeNode of the SubPaving for modification. The sub-nodes
+     *  reached from it through the non-const accessors of BinaryTreeNode are exclusive, the shared ones
+     *  are copied on the way, see \a BinaryTreeNode::share_equal_subtrees.
+     */
+    BinaryTreeNode * binary_tree_for_update();
+
     /*! Recalculate the depth of the tree rooted at \a _pRootTreeNode */
     uint depth() const;
 
@@ -868,10 +1683,17 @@ class GridTreeSubset : public DrawableInterface {
     /*! \brief Allows to test if the two subpavings are "equal". The method returns true if
      * the grids are equal and the binary trees are equal. Note that, only in case both
      * GridTreeSubset objects are recombines, this method is guaranteed to tell you that
-     * the two GridTreeSubset represent equal sets.
+     * the two GridTreeSubset represent equal sets. If the hashes of the trees are already
+     * cached, see \a hash(), then the different trees are told apart in O(1).
      */
     bool operator==(const GridTreeSubset& anotherGridTreeSubset) const;
 
+    /*! \brief The hash of the root cell and the binary tree, the equal subsets have equal hashes.
+     *  With \a ARIADNE_BINARY_TREE_NODE_CACHES it takes O(1) unless the tree was modified since
+     *  the last call, then only the modified paths are rehashed. It can be used as the key of the results cached by the set content.
+     */
+    boost::uint64_t hash() const;
+
     //@}
 
     //@{
@@ -902,6 +1724,11 @@ class GridTreeSubset : public DrawableInterface {
      */
     void recombine();
 
+    /*! \brief Makes the structurally identical subtrees share their nodes, which saves memory on
+     * pavings with repetitive structure. The modified subtrees are unshared lazily, node by node.
+     */
+    void share_equal_subtrees();
+
     //@}
 
     //@{
@@ -950,6 +1777,21 @@ class GridTreeSubset : public DrawableInterface {
     /*! \brief Tests if a grid set overlaps a box. */
     tribool overlaps( const Box& theBox ) const;
 
+    /*! \brief The iterator pointing at the first activated cell that possibly overlaps \a theBox, i.e. at
+     *  which \a overlaps( const Box& ) is not definitely false. The descent skips the disabled subtrees
+     *  and the subtrees whose cells do not overlap \a theBox, so going through all the cells takes the
+     *  time proportional to their number times the depth of the tree, instead of to the size of the set.
+     */
+    overlapping_const_iterator cells_overlapping( const Box& theBox ) const;
+
+    /*! \brief The end iterator of \a cells_overlapping */
+    overlapping_const_iterator cells_overlapping_end() const;
+
+    /*! \brief Calls \a theVisitor( theCell ) for every activated cell that possibly overlaps \a theBox,
+     *  in the order of iteration, see \a cells_overlapping( const Box& ).
+     */
+    template<class CellVisitor> void cells_overlapping( const Box& theBox, CellVisitor& theVisitor ) const;
+
     //@}
 
     //@{
@@ -1139,6 +1981,11 @@ class GridTreeSet : public GridTreeSubset {
      */
     void up_to_primary_cell( const uint toPCellHeight );
 
+    /*! \brief Roots this set and \a theOtherSet to the higher of their primary cells,
+     *  so that their binary trees become aligned.
+     */
+    void align_with( GridTreeSet& theOtherSet );
+
   public:
     //@{
     //! \name Constructors
@@ -1159,8 +2006,9 @@ class GridTreeSet : public GridTreeSubset {
      */
     GridTreeSet( const GridCell & theGridCell );
 
-    /*! \brief The copy constructor that actually copies all the data,
-     *  including the paving tree. I.e. the new copy of the tree is created.
+    /*! \brief The copy constructor that copies all the data, including the paving tree.
+     *  The copy is done in O(1): the two trees share the nodes below their roots, and the
+     *  shared nodes are copied lazily, on the paths that get modified in either of the sets.
      */
     GridTreeSet( const GridTreeSet & theGridTreeSet );
 
@@ -1196,13 +2044,18 @@ class GridTreeSet : public GridTreeSubset {
      */
     explicit GridTreeSet( const Grid& theGrid, uint theHeight, const BooleanArray& theTree, const BooleanArray& theEnabledCells );
 
+    /*! \brief Creates the set of the cells \a theCells on the grid \a theGrid in one pass over
+     *  the sorted cells, the sibling cells are recombined on the fly, see \a adjoin( const std::vector<GridCell>&, const bool ).
+     */
+    explicit GridTreeSet( const Grid& theGrid, const std::vector<GridCell>& theCells );
+
     //@}
 
     //@{
     //! \name Cloning/Copying/Assignment
 
     /*! \brief The copy assignment operator, which copies all the data
-     *  including the paving tree if necessary.
+     *  including the paving tree in O(1), as the copy constructor.
      */
     GridTreeSet& operator=( const GridTreeSet & theGridTreeSet );
 
@@ -1231,21 +2084,78 @@ class GridTreeSet : public GridTreeSubset {
     /*! \brief Adjoin (make inplace union with) a single cell. */
     void adjoin( const GridCell& theCell );
 
+    /*! \brief Adjoin a batch of cells, for many cells this is much faster than adjoining them one by one.
+     *  The set is re-rooted once to the highest primary cell, the paths of the cells from it are sorted
+     *  and then added to the tree in one pass, following each path only below its common prefix with
+     *  the previous one. If \a recombine_leaves is true, then the sibling cells that become both enabled
+     *  are recombined as soon as the pass leaves their parent, the rest of the tree is not recombined.
+     *  Otherwise the tree is the same as after adjoining the cells one by one.
+     */
+    void adjoin( const std::vector<GridCell>& theCells, const bool recombine_leaves = true );
+
+    /*! \brief Adjoin the cells in the range [\a first, \a last), see \a adjoin( const std::vector<GridCell>&, const bool ) */
+    template<class CellIterator> void adjoin( CellIterator first, CellIterator last, const bool recombine_leaves = true );
+
     /*! \brief Remove a single cell. */
     void remove( const GridCell& theCell );
 
     /*! \brief Adjoin (make inplace union with) another grid paving set. */
     void adjoin( const GridTreeSubset& theOtherSubPaving );
 
+    /*! \brief Adjoin (make inplace union with) another grid paving set and return the cells that it
+     *  has added to this set, i.e. \a theOtherSubPaving minus the former set. This is done in one
+     *  traversal, and this set has changed iff the returned set is not empty. The returned set is rooted
+     *  to the same primary cell as this set and it is not recombined, but if nothing is new then its
+     *  tree is a single disabled leaf, so that checking it for emptiness takes O(1).
+     */
+    GridTreeSet adjoin_and_report_new( const GridTreeSubset& theOtherSubPaving );
+
     /*! \brief Restrict to (make inplace intersection with) another grid paving set. */
     void restrict( const GridTreeSubset& theOtherSubPaving );
 
     /*! \brief Remove cells in another grid paving set. */
     void remove( const GridTreeSubset& theOtherSubPaving );
 
+    /*! \brief Adjoin \a theOtherSet, whose nodes are moved into this set instead of being copied.
+     *  This avoids copying the subtrees that fall into the disabled cells of this set, when
+     *  \a theOtherSet is not needed afterwards. \a theOtherSet is cleared, see \a clear().
+     */
+    void move_adjoin( GridTreeSet& theOtherSet );
+
+    /*! \brief Restrict to \a theOtherSet, whose nodes are moved into this set instead of being
+     *  copied, see \a move_adjoin. \a theOtherSet is cleared.
+     */
+    void move_restrict( GridTreeSet& theOtherSet );
+
+    /*! \brief Remove the cells of \a theOtherSet, whose nodes are moved into this set instead
+     *  of splitting the enabled cells of this set, see \a move_adjoin. \a theOtherSet is cleared.
+     */
+    void move_remove( GridTreeSet& theOtherSet );
+
+    /*! \brief Exchanges the contents of this set and \a theOtherSet in O(1), no nodes are
+     *  copied. This is the way to move a set out of a temporary one, which is to be discarded.
+     */
+    void swap( GridTreeSet& theOtherSet );
+
     /*! \brief Restrict to cells rooted to the primary cell with the height (at most) \a theHeight. */
     void restrict_to_height( const uint theHeight );
 
+    /*! \brief Adjoin all the cells, of the size given by \a numSubdivInDim (see \a mince), that lie within
+     *  \a numCells cells of the set in every direction, i.e. the face, edge and vertex neighbors of the cells,
+     *  taken \a numCells times. The cells of the set smaller than this size count as the whole cells of that
+     *  size containing them, so the result is an outer approximation of the neighborhood of the set.
+     *  The primary cell of the set is extended if the neighborhood does not fit into it.
+     *  Nothing is done if \a numCells is zero.
+     */
+    void dilate( const uint numCells, const uint numSubdivInDim );
+
+    /*! \brief Keep only the cells, of the size given by \a numSubdivInDim (see \a mince), all of whose
+     *  neighbors within \a numCells cells in every direction are in the set. The cells of this size that
+     *  are only partly in the set are removed, so the result is an inner approximation of the set.
+     *  Nothing is done if \a numCells is zero.
+     */
+    void erode( const uint numCells, const uint numSubdivInDim );
+
     //@}
 
     //@{
@@ -1264,6 +2174,24 @@ class GridTreeSet : public GridTreeSubset {
     /*! \brief Join (make union of) two grid paving sets. */
     friend GridTreeSet join( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 );
 
+    /*! \brief Join (make union of) two grid paving sets, moving their nodes into the result,
+     *  see \a move_adjoin. Both sets are cleared.
+     */
+    friend GridTreeSet move_join( GridTreeSet& theSet1, GridTreeSet& theSet2 );
+
+    /*! \brief Join (make union of) all the grid paving sets in \a theSets. The result is rooted to
+     *  the highest of their primary cells, and the trees of all the sets are merged into it by one
+     *  simultaneous traversal, instead of adjoining the sets one by one. The subtrees covered by an
+     *  enabled cell of some set are skipped, and a subtree that comes from only one of the sets is
+     *  copied as a whole. The union of no sets is the empty zero dimensional set.
+     */
+    friend GridTreeSet join( const std::vector<GridTreeSet>& theSets );
+
+    /*! \brief Join (make union of) all the grid paving sets in \a theSets, see
+     *  \a join( const std::vector<GridTreeSet>& ).
+     */
+    friend GridTreeSet join( const std::vector<GridTreeSubset>& theSets );
+
     /*! \brief The intersection of two grid paving sets. Points only lying on the
      *  intersection of the boundaries of the two sets are not included in the result.
      */
@@ -1272,6 +2200,19 @@ class GridTreeSet : public GridTreeSubset {
     /*! \brief The difference of two grid paving sets. (Results in theSet1 minus theSet2) */
     friend GridTreeSet difference( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 );
 
+    /*! \brief The symmetric difference of two grid paving sets, i.e. the cells that are in exactly one
+     *  of them. The result is computed in one traversal of theSet2, toggling its cells in theSet1.
+     */
+    friend GridTreeSet symmetric_difference( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 );
+
+    /*! \brief The cartesian product of two grid paving sets, on the grid whose origin and lengths are those of
+     *  the grid of theSet1 followed by those of the grid of theSet2. Both sets are rooted to the higher of their
+     *  primary cells, whose product is the primary cell of the result. The result is built in one traversal
+     *  that interleaves the splits of the two trees in the order of the dimensions of the product grid, so the
+     *  cost is proportional to the size of the result and no boxes are computed.
+     */
+    friend GridTreeSet product( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 );
+
     //@}
     
     //@{
@@ -1403,8 +2344,9 @@ class GridTreeCursor {
     //there are no elements in the stack
     int _currentStackIndex;
 
-    /* The nodes traversed to the current location. */
-    array<BinaryTreeNode*> _theStack;
+    /* The nodes traversed to the current location. They are read-only, since they may be
+     * shared, and it is mutable, because the path is followed again before modification. */
+    mutable array<const BinaryTreeNode*> _theStack;
 
     /* The subpaving to cursor on */
     const GridTreeSubset * _pSubPaving;
@@ -1412,14 +2354,21 @@ class GridTreeCursor {
     GridCell _theCurrentGridCell;
 
     /*! \brief Push the node into the stack */
-    void push( BinaryTreeNode* pLatestNode );
+    void push( const BinaryTreeNode* pLatestNode );
 
     /*! \brief Pop the node from the stack, return NULL is the stack is empty */
-    BinaryTreeNode* pop( );
+    const BinaryTreeNode* pop( );
 
     /*! \brief Check is the stack contains just one element, i.e. we are at the root */
     bool is_at_the_root() const;
 
+    /*! \brief Prepares the current node for modification and returns it. The path from the root
+     *  to the current node is followed again through the non-const accessors, which substitute the
+     *  shared nodes by their private copies and invalidate the cached counts of the nodes on the path.
+     *  NOTE: The root of the paving tree is assumed to be exclusive.
+     */
+    BinaryTreeNode * current_node_for_update() const;
+
     /*! \brief this method is supposed to update the _theCurrentGridCell value, when the cursos moves
      * if left_or_right == false then we go left, if left_or_right == true then right
      * if left_or_right == indeterminate then we are going one level up.
@@ -1497,7 +2446,7 @@ class GridTreeCursor {
     const GridCell& cell() const;
 
     /*! \brief Allows to test if the two cursors are equal, this is determined by
-     * the fact that they point to the same binary-tree node.
+     * the fact that they point to the same binary-tree node along the same path.
      * NOTE: if _currentStackIndex < 0 for at least one of the cursors then the
      * result is always false.
      */
@@ -1603,763 +2552,2609 @@ class GridTreeConstIterator : public boost::iterator_facade< GridTreeConstIterat
     //@}
 };
 
-/****************************************************************************************************/
-/***************************************Inline functions*********************************************/
-/****************************************************************************************************/
+/*! \brief This class allows to iterate through the enabled leaf nodes of GridTreeSubset whose cells
+ * possibly overlap a box, see \a GridTreeSubset::cells_overlapping. The iterator keeps the path to
+ * the current node together with the lattice boxes of the cells on it, so that every cell box is
+ * computed by halving the box of its parent.
+ */
+class GridTreeOverlappingConstIterator : public boost::iterator_facade< GridTreeOverlappingConstIterator, GridCell const, boost::forward_traversal_tag > {
+  private:
+    /*! \brief The grid of the set, NULL for the end iterator */
+    const Grid * _pGrid;
 
-/****************************************BinaryTreeNode**********************************************/
+    /*! \brief The height of the primary cell of the set */
+    uint _theHeight;
 
-inline void BinaryTreeNode::init( tribool isEnabled, BinaryTreeNode* pLeftNode, BinaryTreeNode* pRightNode ){
-    _isEnabled = isEnabled;
-    _pLeftNode = pLeftNode;
-    _pRightNode = pRightNode;
-}
+    /*! \brief The length of the path from the primary cell to the root cell of the set */
+    uint _theRootDepth;
 
-inline BinaryTreeNode::BinaryTreeNode(const tribool isEnabled){
-    init( isEnabled, NULL, NULL );
-}
+    /*! \brief The box the cells have to overlap */
+    Box _theBox;
 
-inline BinaryTreeNode::BinaryTreeNode(const BinaryTreeNode& theTreeNode){
-    if( (theTreeNode._pLeftNode) != NULL && ( theTreeNode._pRightNode != NULL ) ){
-        init( theTreeNode._isEnabled, new BinaryTreeNode( *theTreeNode._pLeftNode ), new BinaryTreeNode( *theTreeNode._pRightNode ) );
-    }else{
-        //NOTE: We do not allow for nodes where one leaf is NULL and another is not
-        init( theTreeNode._isEnabled, NULL, NULL );
-    }
-}
+    /*! \brief The nodes on the path from the root node to the current node */
+    std::vector<const BinaryTreeNode*> _theNodes;
 
-inline BinaryTreeNode::BinaryTreeNode( const BooleanArray& theTree, const BooleanArray& theEnabledCells ) {
-    //Make default initialization
-    init( false, NULL, NULL ) ;
+    /*! \brief The lattice boxes of the cells of the nodes in \a _theNodes */
+    std::vector< Vector<Interval> > _theLatticeBoxes;
 
-    //If the tree is not empty and there are enabled leafs then do the thing
-    if( ( theTree.size() ) > 0 && ( theEnabledCells.size() > 0 ) ) {
-        uint arr_index = 0, leaf_counter = 0;
-        restore_node( this, arr_index, leaf_counter, theTree, theEnabledCells );
-    } else {
-        //Otherwise settle with one disabled node
-        this->set_disabled();
-    }
-}
+    /*! \brief The path from the primary cell to the current node */
+    BinaryWord _theWord;
 
-inline BinaryTreeNode::~BinaryTreeNode(){
-    if( _pLeftNode != NULL ) {
-        delete _pLeftNode;
-    }
-    if( _pRightNode != NULL ) {
-        delete _pRightNode;
-    }
-}
+    /*! \brief The current cell */
+    GridCell _theCurrentCell;
 
-inline bool BinaryTreeNode::is_enabled() const{
-    return definitely(_isEnabled);
-}
+    friend class boost::iterator_core_access;
 
-inline bool BinaryTreeNode::is_disabled() const{
-    return ! possibly(_isEnabled) ;
-}
+    /*! \brief Returns true if the subtree of the current node can have cells overlapping \a _theBox */
+    bool is_current_node_overlapping() const;
 
-inline bool BinaryTreeNode::is_leaf() const{
-    return (_pLeftNode == NULL) && (_pRightNode == NULL);
-}
+    /*! \brief Moves to the next node in the depth first order that is not in the subtree of the current
+     *  node, returns false and moves to the end state if there is no such node.
+     */
+    bool skip_current_subtree();
 
-inline BinaryTreeNode * BinaryTreeNode::left_node() const {
-    return _pLeftNode;
-}
+    /*! \brief Starting with the current node, moves to the first enabled leaf overlapping \a _theBox */
+    void find_next_cell();
 
-inline BinaryTreeNode * BinaryTreeNode::right_node() const {
-    return _pRightNode;
-}
+    void increment();
 
-inline void BinaryTreeNode::set_enabled() {
-    if ( is_leaf() ) {
-        _isEnabled = true;
-    } else {
-        throw NotALeafNodeException(ARIADNE_PRETTY_FUNCTION);
-    }
-}
+    /*! \brief Returns true if both iterators are at the end, or at the same cell */
+    bool equal( GridTreeOverlappingConstIterator const & theOtherIterator ) const;
 
-inline void BinaryTreeNode::copy_from( const BinaryTreeNode * pOtherNode ){
-    if( pOtherNode != NULL ){
-        _isEnabled = pOtherNode->_isEnabled;
-        if( _pLeftNode != NULL){ delete _pLeftNode; _pLeftNode = NULL; }
-        if( _pRightNode != NULL){ delete _pRightNode; _pRightNode = NULL; }
-        if( pOtherNode->_pLeftNode != NULL ){ _pLeftNode = new BinaryTreeNode( * (pOtherNode->_pLeftNode) ); }
-        if( pOtherNode->_pRightNode != NULL ){ _pRightNode = new BinaryTreeNode( * (pOtherNode->_pRightNode) ); }
-    }
-}
+    GridCell const& dereference() const;
 
-inline void BinaryTreeNode::set_disabled() {
-    if ( is_leaf() ) {
-        _isEnabled = false;
-    } else {
-        throw NotALeafNodeException(ARIADNE_PRETTY_FUNCTION);
-    }
-}
+  public:
+    /*! \brief Constructs the end iterator */
+    GridTreeOverlappingConstIterator();
 
-inline void BinaryTreeNode::set_unknown() {
-    if ( ! is_leaf() ) {
-        _isEnabled = indeterminate;
-    } else {
-        throw IsALeafNodeException(ARIADNE_PRETTY_FUNCTION);
-    }
-}
+    /*! \brief The iterator at the first activated cell of \a theSubset that possibly overlaps \a theBox */
+    GridTreeOverlappingConstIterator( const GridTreeSubset& theSubset, const Box& theBox );
+};
 
-inline void BinaryTreeNode::set_unknown_unchecked() {
-    _isEnabled = indeterminate;
-    _pLeftNode = NULL;
-    _pRightNode = NULL;
-}
+/*! \brief A read-only grid paving set with a succinct representation of the binary tree.
+ *
+ * The tree is kept as two bit vectors. The structure bits hold one bit per node in the depth first
+ * order, as produced by \a BinaryTreeNode::tree_to_binary_words, i.e. one for a non-leaf node and
+ * zero for a leaf. The leaf bits hold the enabled value of every leaf in the same order. A node is
+ * identified by its position in the structure bits: the left sub-node of a non-leaf node \a node is
+ * at \a node + 1 and the right sub-node follows the last node of the left subtree.
+ *
+ * Counting a non-leaf node as +1 and a leaf as -1, the subtree rooted at \a node ends at the first
+ * position at which the sum, taken from \a node, reaches -1. To find this position, and to count
+ * the enabled leaves of a subtree, without visiting all its nodes we keep the rank of every block of
+ * BLOCK_WORDS words of both bit vectors and a range-min tree over the blocks of the structure bits,
+ * which holds the lowest prefix sum of every block and of every range of blocks below a node of it.
+ * Thus the end of a subtree, and so the right sub-node of a node, is found in O(log n) time.
+ * Together the set takes a bit and a half per node plus about a quarter of a bit for the directories.
+ *
+ * NOTE: The leaf nodes with an indeterminate value are stored as disabled.
+ */
+class FrozenGridTreeSet {
+  public:
+    /*! \brief The type of the iterator through the enabled cells of the set */
+    typedef FrozenGridTreeConstIterator const_iterator;
 
-inline void BinaryTreeNode::make_leaf(tribool is_enabled ){
-    _isEnabled = is_enabled;
-    if( _pLeftNode != NULL ) { delete _pLeftNode; _pLeftNode= NULL; }
-    if( _pRightNode != NULL ) { delete _pRightNode; _pRightNode= NULL; }
-}
+    /*! \brief The type of the words the bit vectors are packed into */
+    typedef boost::uint64_t word_type;
 
-inline void BinaryTreeNode::split() {
-    if ( is_leaf() ) {
-        _pLeftNode  = new BinaryTreeNode(_isEnabled);
-        _pRightNode = new BinaryTreeNode(_isEnabled);
-        set_unknown();
-    }
-}
+    /*! \brief The position of the root node */
+    static const size_t ROOT = 0;
 
-inline void BinaryTreeNode::add_enabled( const BinaryWord& path ){
-    add_enabled( this, path, 0 );
-}
+  private:
+    friend class FrozenGridTreeConstIterator;
+    friend class FrozenGridTreeWalker;
 
-inline void BinaryTreeNode::mince(const uint depth) {
-    mince_node(this, depth);
-}
+    /*! \brief The number of bits in a word and the number of words in a directory block. */
+    enum { WORD_BITS = 64, BLOCK_WORDS = 8, BLOCK_BITS = WORD_BITS * BLOCK_WORDS };
 
-inline void BinaryTreeNode::recombine() {
-    recombine_node(this);
-}
+    /*! \brief The root cell of the set, see \a GridTreeSubset::cell() */
+    GridCell _theGridCell;
 
-inline string BinaryTreeNode::node_to_string() const {
-    stringstream tmp_stream;
-    tmp_stream << "BinaryTreeNode( isLeaf = " << is_leaf() << ", isEnabled = " << is_enabled() << ", isDisabled = " << is_disabled() << " )";
-    return tmp_stream.str();
-}
+    /*! \brief The number of nodes, i.e. of the valid structure bits, and the number of leaves. */
+    size_t _theNodeCount;
+    size_t _theLeafCount;
 
-inline BinaryTreeNode& BinaryTreeNode::operator=( const BinaryTreeNode & otherNode ) {
-    //Copy the node value
-    _isEnabled = otherNode._isEnabled;
+    /*! \brief The structure bits and the leaf bits, both padded with zeroes to a whole block. */
+    std::vector<word_type> _theTree;
+    std::vector<word_type> _theLeaves;
 
-    //Deallocate memory for the children, if any
-    if( _pLeftNode != NULL ){ delete _pLeftNode; _pLeftNode = NULL; }
-    if( _pRightNode != NULL ){ delete _pRightNode; _pRightNode = NULL; }
+    /*! \brief The number of ones in front of every block, and in total as the last element */
+    std::vector<boost::uint32_t> _theTreeRanks;
+    std::vector<boost::uint32_t> _theLeafRanks;
 
-    //Copy the children trees from the otherNode
-    if( otherNode._pLeftNode != NULL ) { _pLeftNode = new BinaryTreeNode( * ( otherNode._pLeftNode ) ); }
-    if( otherNode._pRightNode != NULL ) { _pRightNode = new BinaryTreeNode( * ( otherNode._pRightNode ) ); }
+    /*! \brief The range-min tree over the blocks of the structure bits in the heap order: the node 1 is the root,
+     *  the sub-nodes of the node i are 2i and 2i+1, and the second half are the blocks, padded to a power of two.
+     *  Every node holds the lowest sum of the +1/-1 values of the leading structure bits of its blocks.
+     */
+    std::vector<int> _theRangeMinExcess;
 
-    return *this;
-}
+    /*! \brief Packs the bits into words and computes the directories */
+    void build( const BinaryWord & theTree, const BinaryWord & theLeaves );
 
-/********************************************GridTreeCursor***************************************/
+    /*! \brief Packs \a theBits into \a theWords and computes the rank directory \a theRanks */
+    static void pack( const BinaryWord & theBits, std::vector<word_type> & theWords, std::vector<boost::uint32_t> & theRanks );
 
-inline GridTreeCursor::GridTreeCursor(  ) :
-    _currentStackIndex(-1), _pSubPaving(0), _theCurrentGridCell( Grid(), 0, BinaryWord() ) {
-}
+    /*! \brief The number of ones in the word */
+    static uint popcount( word_type theWord );
 
-inline GridTreeCursor::GridTreeCursor(const GridTreeCursor & otherCursor) :
-    _currentStackIndex(otherCursor._currentStackIndex), _theStack(otherCursor._theStack),
-    _pSubPaving(otherCursor._pSubPaving), _theCurrentGridCell(otherCursor._theCurrentGridCell){
-}
+    /*! \brief The number of ones in \a theBits in front of the position \a pos */
+    static size_t rank( const std::vector<word_type> & theBits, const std::vector<boost::uint32_t> & theRanks, const size_t pos );
 
-inline GridTreeCursor& GridTreeCursor::operator=(const GridTreeCursor & otherCursor) {
-    _currentStackIndex = otherCursor._currentStackIndex;
-    _theStack = otherCursor._theStack;
-    _pSubPaving = otherCursor._pSubPaving;
-    _theCurrentGridCell = otherCursor._theCurrentGridCell;
+    /*! \brief Returns the value of the bit at the position \a pos */
+    static bool bit( const std::vector<word_type> & theBits, const size_t pos );
 
-    return *this;
-}
+    /*! \brief Returns the eight bits starting from the position \a pos, which must be a multiple of eight */
+    static uint byte( const std::vector<word_type> & theBits, const size_t pos );
 
-inline GridTreeCursor::GridTreeCursor(const GridTreeSubset * pSubPaving) :
-    _currentStackIndex(-1), _pSubPaving(pSubPaving), _theCurrentGridCell( pSubPaving->cell() ) {
-    //Remember that GridTreeSubset contains GridCell
+    //@{
+    //! \name Tree navigation, the nodes are given by their positions in the structure bits
 
-    //Add the current node to the stack, since we are in it
+    /*! \brief Returns true if the node is a leaf */
+    bool is_leaf( const size_t node ) const;
 
-    //IVAN S ZAPREEV:
-    //NOTE: There is no need in allocating _theStack elements,
-    //it is all done in the push method
-    push(pSubPaving->_pRootTreeNode);
-}
+    /*! \brief Returns true if the node is an enabled leaf */
+    bool is_enabled( const size_t node ) const;
 
-inline GridTreeCursor::~GridTreeCursor() {
-    //IVAN S ZAPREEV:
-    //WARNING: The subpaving should not be deallocated here!
-    //There are no other data feels that we need to deallocate
-    _pSubPaving = NULL;
-}
+    /*! \brief The index of the first leaf of the subtree rooted at \a node, the leaves are counted from zero */
+    size_t leaf_index( const size_t node ) const;
 
-inline void GridTreeCursor::push( BinaryTreeNode* pLatestNode ){
-    //If we are out of free space, increase the array's capacity
-    if( static_cast<uint>(_currentStackIndex +1) == ( _theStack.size()  ) ){
-        _theStack.resize( _theStack.size() + STACK_SIZE_INCREMENT );
-    }
+    /*! \brief The sum of the +1/-1 values of the structure bits of the \a width blocks from the block \a first on */
+    int range_excess( const size_t first, const size_t width ) const;
 
-    //The index for the tree node to be added
-    _currentStackIndex += 1;
+    /*! \brief Starting at the block \a block with the sum \a excess, finds the first block in which the sum
+     *  drops to -1 and sets \a excess to the sum in front of it, in O(log n) steps of the range-min tree.
+     */
+    size_t find_block( size_t block, int & excess ) const;
 
-    //Put the tree node pointer into the stack
-    _theStack[_currentStackIndex] = pLatestNode;
+    /*! \brief The position of the last node of the subtree rooted at \a node. The blocks in between
+     *  are skipped through the range-min tree, so this takes O(log n) time for a tree of n nodes.
+     */
+    size_t subtree_end( const size_t node ) const;
 
-}
+    /*! \brief The position of the left/right sub-node, the node must not be a leaf */
+    size_t left_node( const size_t node ) const;
+    size_t right_node( const size_t node ) const;
 
-inline BinaryTreeNode* GridTreeCursor::pop( ){
-    BinaryTreeNode* pLastNode = NULL;
+    /*! \brief Counts the enabled leaves of the subtree rooted at \a node */
+    size_t count_enabled_leaf_nodes( const size_t node ) const;
 
-    //If there are non-root nodes in the stack
-    if( _currentStackIndex > 0 ){
-        //Return the stack element at _currentStackIndex,
-        //then decrement the current element's index.
-        return _theStack[ _currentStackIndex-- ];
-    }
+    /*! \brief Returns true if some/all of the leaves of the subtree rooted at \a node are enabled */
+    bool has_enabled( const size_t node ) const;
+    bool all_enabled( const size_t node ) const;
 
-    return pLastNode;
-}
+    /*! \brief Follows \a thePath from the root node, stops early if a leaf node is reached */
+    size_t locate_node( const BinaryWord & thePath ) const;
 
-inline bool GridTreeCursor::is_at_the_root() const {
-    //If we are pointing at the zero cell of the array then it
-    //means that we are in the root of the tree
-    return (_currentStackIndex == 0);
-}
+    //@}
+
+    /*! \brief The recursive procedures for the predicates on two aligned subtrees, see \a BinaryTreeNode::subset
+     *  and \a BinaryTreeNode::overlap. On exit \a nodeOne and \a nodeTwo are right after their subtrees.
+     */
+    static bool subset( const FrozenGridTreeSet & theSetOne, size_t & nodeOne,
+                        const FrozenGridTreeSet & theSetTwo, size_t & nodeTwo );
+    static bool overlap( const FrozenGridTreeSet & theSetOne, size_t & nodeOne,
+                         const FrozenGridTreeSet & theSetTwo, size_t & nodeTwo );
+
+    /*! \brief Tests if the sets overlap, where the root cell of \a theSubSet is reached from the root cell of
+     *  \a theSuperSet by \a pathFromSuperToSub, see the helper of \a overlap( GridTreeSubset, GridTreeSubset )
+     */
+    static bool overlap( const FrozenGridTreeSet & theSuperSet, const BinaryWord & pathFromSuperToSub,
+                         const FrozenGridTreeSet & theSubSet );
+
+  public:
+    //@{
+    //! \name Constructors
+
+    /*! \brief Freezes the tree of \a theSet, the set can be dropped afterwards. */
+    explicit FrozenGridTreeSet( const GridTreeSubset & theSet );
+
+    //@}
+
+    //@{
+    //! \name Properties
+
+    /*! \brief True if the set is empty. */
+    bool empty() const;
+
+    /*! \brief The number of activated cells in the set, takes constant time. */
+    size_t size() const;
+
+    /*! \brief The dimension of the set. */
+    uint dimension() const;
+
+    /*! \brief Returns a constant reference to the underlying grid. */
+    const Grid& grid() const;
+
+    /*! \brief Returns the \a GridCell corresponding to the root node, see \a GridTreeSubset::cell() */
+    GridCell cell() const;
+
+    /*! The measure (area, volume) of the set in Euclidean space. */
+    double measure() const;
+
+    /*! \brief Computes a bounding box for a grid set. */
+    Box bounding_box() const;
+
+    /*! \brief The number of nodes in the binary tree */
+    size_t node_count() const;
+
+    /*! \brief The number of bytes used by the bit vectors and the directories */
+    size_t memory() const;
+
+    /*! \brief Returns true if the root cells and the trees are equal, see \a GridTreeSubset::operator== */
+    bool operator==( const FrozenGridTreeSet& anotherFrozenGridTreeSet ) const;
+
+    //@}
+
+    //@{
+    //! \name Geometric Predicates
+
+    /*! \brief Tests if a cell is a subset of a set. */
+    friend bool subset( const GridCell& theCell, const FrozenGridTreeSet& theSet );
+
+    /*! \brief Tests if a cell overlaps (as an open set) a paving set. */
+    friend bool overlap( const GridCell& theCell, const FrozenGridTreeSet& theSet );
+
+    /*! \brief Tests if a grid set \a theSet1 is a subset of \a theSet2. */
+    friend bool subset( const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2 );
+
+    /*! \brief Tests if two grid paving sets overlap (i.e. intersect as open sets.)
+     *  If at least one of the sets is empty, then the result is false.
+     */
+    friend bool overlap( const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2 );
+
+    /*! \brief Tests if a %FrozenGridTreeSet is a subset of another %FrozenGridTreeSet. */
+    tribool subset( const FrozenGridTreeSet& other ) const;
+
+    /*! \brief Tests if a %FrozenGridTreeSet is a superset of another %FrozenGridTreeSet. */
+    tribool superset( const FrozenGridTreeSet& other ) const;
+
+    /*! \brief Tests if (the closure of) a %FrozenGridTreeSet is disjoint from another %FrozenGridTreeSet. */
+    tribool disjoint( const FrozenGridTreeSet& other  ) const;
+
+    /*! \brief Tests if a %FrozenGridTreeSet overlaps another %FrozenGridTreeSet. */
+    tribool overlaps( const FrozenGridTreeSet& other ) const;
+
+    /*! \brief Tests if a grid set is a subset of a box. */
+    tribool subset( const Box& theBox ) const;
+
+    /*! \brief Tests if a grid set is a superset of a box. */
+    tribool superset( const Box& theBox ) const;
+
+    /*! \brief Tests if (the closure of) a grid set is disjoint from a box. */
+    tribool disjoint( const Box& theBox  ) const;
+
+    /*! \brief Tests if a grid set overlaps a box. */
+    tribool overlaps( const Box& theBox ) const;
+
+    //@}
+
+    //@{
+    //! \name Iterators
+
+    /*! \brief A constant iterator through the enabled leaf nodes of the set. */
+    const_iterator begin() const;
+
+    /*! \brief A constant iterator to the end of the enabled leaf nodes of the set. */
+    const_iterator end() const;
+
+    //@}
+};
+
+/*! \brief This class allows to iterate through the enabled leaf nodes of FrozenGridTreeSet.
+ * The nodes are visited in the order they are stored in, so the iterator only keeps the position
+ * of the current node and the path to it. The return objects for this iterator are constant GridCells.
+ */
+class FrozenGridTreeConstIterator : public boost::iterator_facade< FrozenGridTreeConstIterator, GridCell const, boost::forward_traversal_tag > {
+  private:
+    friend class boost::iterator_core_access;
+
+    /*! \brief The set we iterate through */
+    const FrozenGridTreeSet * _pSet;
+
+    /*! \brief The position of the current node, equals the number of nodes for the "end iterator" */
+    size_t _theNode;
+
+    /*! \brief The index of the first leaf at or after the current node */
+    size_t _theLeaf;
+
+    /*! \brief The path from the root node of the set to the current node */
+    BinaryWord _thePath;
+
+    /*! \brief The cell of the current enabled leaf */
+    GridCell _theCurrentGridCell;
+
+    //@{
+    //! \name Iterator Specific
+
+    void increment();
+
+    /*! \brief Returns true if both iterators are in the "end iterator" state or
+     *  they point to the same node of the same set
+     */
+    bool equal( FrozenGridTreeConstIterator const & theOtherIterator) const;
+
+    GridCell const& dereference() const;
+
+    //@}
+
+    /*! \brief Moves from the current leaf to the next node in the depth first order */
+    void skip_leaf();
+
+    /*! \brief Walks the nodes in the depth first order, starting from the current one,
+     *  until an enabled leaf is found or the end of the tree is reached.
+     */
+    void find_next_enabled_leaf();
+
+  public:
+    /*! \brief Default constructor constructs an invalid iterator. */
+    FrozenGridTreeConstIterator();
+
+    /*! \brief Constructs the iterator pointing to the first enabled leaf of \a pSet if
+     *  \a isBegin is true, otherwise constructs the "end iterator".
+     */
+    FrozenGridTreeConstIterator( const FrozenGridTreeSet * pSet, const bool isBegin );
+};
+
+/*! \brief A grid paving set stored as a linear quadtree, i.e. as the sorted array of the Morton
+ *  (Z-order) codes of its enabled cells.
+ *
+ * The path from the primary cell to a cell already interleaves the bits of the cell's coordinates
+ * in the round-robin order of the dimensions (see \a LatticeCell), so it is the Morton code of the
+ * cell. A cell is stored as its path, left-aligned in a 64-bit \a code, and the path length \a depth.
+ * Ordering the cells by the code and then by the depth gives the Z-order, in which a cell precedes
+ * all its sub-cells and every cell spans the contiguous range of codes [ code, last() ]. The enabled
+ * cells are disjoint, so \a join, \a intersection and \a difference are linear merges of the arrays.
+ *
+ * This takes 16 bytes per enabled cell and nothing for the disabled cells and the inner nodes,
+ * which pays off when most cells are at the same depth. The conversion from and to \a GridTreeSet
+ * is lossless: the enabled leaves of the tree are exactly the stored cells.
+ * NOTE: The paths are limited to \a MAX_DEPTH bits, i.e. to 16 subdivisions of every coordinate
+ * in 4-D and to 10 in 6-D, counted from the primary cell. Deeper sets are rejected by an assertion
+ * when they are converted or rooted to a higher primary cell, use \a is_representable to check a
+ * set first and keep the deep sets as \a GridTreeSet. The enabled cells are not recombined by the
+ * set operations, call \a recombine() for the minimal list of cells.
+ */
+class MortonGridTreeSet {
+  public:
+    /*! \brief The type of the left-aligned paths */
+    typedef boost::uint64_t code_type;
+
+    /*! \brief The maximum length of a path from the primary cell */
+    static const uint MAX_DEPTH = 64;
+
+    /*! \brief An enabled cell: the path from the primary cell left-aligned in \a code, the rest
+     *  of the bits being zero, and the length of the path \a depth.
+     */
+    struct Key {
+        code_type code;
+        uint depth;
+
+        /*! \brief The last code covered by the cell */
+        code_type last() const;
+
+        /*! \brief The left (\a isRight == false) or the right sub-cell */
+        Key child( const bool isRight ) const;
+
+        /*! \brief The Z-order, i.e. by the code and then by the depth */
+        bool operator<( const Key& otherKey ) const;
+        bool operator==( const Key& otherKey ) const;
+    };
+
+  private:
+    /*! \brief The grid of the set */
+    Grid _theGrid;
+
+    /*! \brief The height of the primary cell the paths start in */
+    uint _theHeight;
+
+    /*! \brief The enabled cells in the Z-order */
+    std::vector<Key> _theKeys;
+
+    /*! \brief Appends the enabled leaves of the tree rooted at \a pNode, whose cell is \a theKey, to \a theKeys */
+    static void append_keys( const BinaryTreeNode * pNode, const Key& theKey, std::vector<Key>& theKeys );
+
+    /*! \brief Makes \a pNode, whose cell is \a theKey, the root of the tree of the cells [ \a first, \a last ) */
+    static void build_tree( BinaryTreeNode * pNode, const Key& theKey,
+                            std::vector<Key>::const_iterator first, std::vector<Key>::const_iterator last );
+
+    /*! \brief Appends the cells of \a theKey that are not covered by the cells starting at \a pOther to \a theKeys.
+     *  The cells of the other set that end before \a theKey are skipped.
+     */
+    static void subtract( const Key& theKey, std::vector<Key>::const_iterator& pOther,
+                          const std::vector<Key>::const_iterator& otherEnd, std::vector<Key>& theKeys );
+
+    /*! \brief Copies the sets, rooting them to the same primary cell */
+    static void align( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2,
+                       MortonGridTreeSet& theAlignedSet1, MortonGridTreeSet& theAlignedSet2 );
+
+  public:
+    //@{
+    //! \name Constructors
+
+    /*! \brief The empty set on \a theGrid rooted to the primary cell of the height \a theHeight */
+    explicit MortonGridTreeSet( const Grid& theGrid, const uint theHeight = 0 );
+
+    /*! \brief Collects the enabled cells of \a theSet */
+    explicit MortonGridTreeSet( const GridTreeSubset& theSet );
+
+    /*! \brief Builds the binary tree of the set, rooted to its primary cell */
+    GridTreeSet to_grid_tree_set() const;
+
+    /*! \brief True if the paths to all the nodes of \a theSet fit into \a MAX_DEPTH bits */
+    static bool is_representable( const GridTreeSubset& theSet );
+
+    //@}
+
+    //@{
+    //! \name Properties
+
+    /*! \brief True if the set is empty. */
+    bool empty() const;
+
+    /*! \brief The number of enabled cells in the set. */
+    size_t size() const;
+
+    /*! \brief The dimension of the set. */
+    uint dimension() const;
+
+    /*! \brief Returns a constant reference to the underlying grid. */
+    const Grid& grid() const;
+
+    /*! \brief The height of the primary cell to which the set is rooted. */
+    uint height() const;
+
+    /*! \brief The enabled cells in the Z-order */
+    const std::vector<Key>& keys() const;
+
+    /*! \brief The \a i'th enabled cell in the Z-order */
+    GridCell cell( const size_t i ) const;
+
+    /*! \brief The number of bytes used by the cells */
+    size_t memory() const;
+
+    /*! \brief Returns true if the sets have the same grid and cover the same cells. The sets are
+     *  rooted to the same primary cell and recombined before their cells are compared.
+     */
+    bool operator==( const MortonGridTreeSet& anotherMortonGridTreeSet ) const;
+
+    //@}
+
+    //@{
+    //! \name Subdivisions
+
+    /*! \brief Roots the set to the higher primary cell of the height \a toPCellHeight,
+     *  see \a GridTreeSet::up_to_primary_cell. The order of the cells does not change.
+     */
+    void up_to_primary_cell( const uint toPCellHeight );
+
+    /*! \brief Replaces every two sibling cells by their parent cell, until no siblings are left.
+     *  It takes one pass over the cells, since the siblings are adjacent in the Z-order.
+     */
+    void recombine();
+
+    //@}
+
+    //@{
+    //! \name Set operations
+
+    /*! \brief The union of the sets, merges the arrays and drops the cells covered by the other set. */
+    friend MortonGridTreeSet join( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2 );
+
+    /*! \brief The intersection of the sets, keeps the smaller one of every two nested cells. */
+    friend MortonGridTreeSet intersection( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2 );
+
+    /*! \brief The difference of the sets, the cells of \a theSet1 that contain cells of \a theSet2
+     *  are split along the paths to those cells.
+     */
+    friend MortonGridTreeSet difference( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2 );
+
+    //@}
+};
+
+/*! \brief A position in the traversal of the binary tree of a primary cell, relative to a grid cell.
+ *
+ * The traversal starts at the primary cell of the height given to the constructor, which contains
+ * the grid cell. The positions on the path to the grid cell are partly within it, the positions off
+ * the path are outside the cell and the positions reached at the end of the path are within it.
+ * NOTE: The cursor keeps the reference to the word of the cell, the cell has to outlive the cursor.
+ */
+class GridCellCursor {
+  private:
+    /*! \brief The dimension of the grid */
+    dimension_type _theDimension;
+
+    /*! \brief The height of the primary cell at which the traversal starts */
+    uint _theHeight;
+
+    /*! \brief The height of the primary cell to which the grid cell is rooted */
+    uint _theCellHeight;
+
+    /*! \brief The path from the primary cell of height \a _theCellHeight to the grid cell */
+    const BinaryWord * _pWord;
+
+    /*! \brief The number of steps taken along the path to the grid cell */
+    uint _thePosition;
+
+    /*! \brief Is true if the traversal has left the path to the grid cell */
+    bool _isOutside;
+
+    /*! \brief The length of the path from the primary cell of height \a _theHeight to the grid cell */
+    uint path_length() const;
+
+    /*! \brief The step with the index \a position on the path to the grid cell, see \a GridCell::primary_cell_path */
+    bool path_step( const uint position ) const;
+
+  public:
+    /*! \brief The cursor at the primary cell of the height \a theHeight >= theCell.height() */
+    GridCellCursor( const GridCell& theCell, const uint theHeight );
+
+    /*! \brief Returns true within the cell, false outside of it and indeterminate on the path to it */
+    tribool value() const;
+
+    /*! \brief The left (\a isRight == false) or the right half of the current position,
+     *  the halves of the position with a definite value have the same value.
+     */
+    GridCellCursor child( const bool isRight ) const;
+};
+
+/*! \brief A position in the traversal of the binary tree of a primary cell, relative to a GridTreeSubset.
+ *  The positions above the root cell of the subset follow the path to it, see \a GridCellCursor,
+ *  and the positions within it follow the nodes of its binary tree.
+ */
+class GridSubsetCursor {
+  private:
+    /*! \brief The position relative to the root cell of the subset */
+    GridCellCursor _theRootCursor;
+
+    /*! \brief The root node of the subset, or its node at the current position within the root cell */
+    const BinaryTreeNode * _pNode;
+
+  public:
+    /*! \brief The cursor at the primary cell of the height \a theHeight >= theCell.height() for the
+     *  subset with the root cell \a theCell and the binary tree \a pRootTreeNode.
+     */
+    GridSubsetCursor( const GridCell& theCell, const BinaryTreeNode * pRootTreeNode, const uint theHeight );
+
+    /*! \brief Returns true if the subset covers the current position, false if it does not
+     *  overlap it and indeterminate otherwise.
+     */
+    tribool value() const;
+
+    /*! \brief The left (\a isRight == false) or the right half of the current position,
+     *  the halves of the position with a definite value have the same value.
+     */
+    GridSubsetCursor child( const bool isRight ) const;
+};
+
+/*! \brief The simultaneous position of two cursors, combined by the operation \a OP. */
+template<class C1, class C2, class OP>
+class GridBinaryCursor {
+  private:
+    C1 _theCursor1;
+    C2 _theCursor2;
+
+  public:
+    GridBinaryCursor( const C1& theCursor1, const C2& theCursor2 );
+
+    /*! \brief The values of the two cursors combined by \a OP::apply */
+    tribool value() const;
+
+    /*! \brief The same halves of the positions of both cursors */
+    GridBinaryCursor child( const bool isRight ) const;
+};
+
+/*! \brief The operations of the lazy set expressions. They combine the values of the operand
+ *  cursors by the three valued logic, so that the value is indeterminate only if the result
+ *  depends on the sub-positions.
+ */
+struct GridJoinOperation {
+    static tribool apply( const tribool value1, const tribool value2 );
+};
+
+struct GridIntersectionOperation {
+    static tribool apply( const tribool value1, const tribool value2 );
+};
+
+struct GridDifferenceOperation {
+    static tribool apply( const tribool value1, const tribool value2 );
+};
+
+/*! \brief The base class of the lazy set expressions over GridTreeSubset operands.
+ *
+ * The expressions are built by \a lazy, \a join, \a intersection, \a difference and \a complement.
+ * Nothing is computed when they are built: every expression class \a E provides the grid, the height
+ * of the primary cell containing all its operands and the cursor type \a E::cursor_type, that
+ * traverses all the operand trees at once starting from this primary cell. The expression is then
+ * either evaluated into one GridTreeSet in a single traversal, or consumed by \a size, \a empty,
+ * \a subset, \a overlap and the iteration through its cells without building any trees.
+ *
+ * The cells of the expression are the largest cells at which the value of the cursor is definite,
+ * the same cells are the enabled leaves of the evaluated set.
+ * NOTE: The expressions keep the pointers to the binary trees of their operands, the operands
+ * have to outlive the expressions and must not be modified while the expressions are in use.
+ * In the same way the iterators keep the pointers to the expression, so the expression iterated
+ * through has to be stored in a variable.
+ */
+template<class E>
+class GridSetExpression {
+  public:
+    /*! \brief The type of the iterator through the cells of the expression */
+    typedef GridSetExpressionConstIterator<E> const_iterator;
+
+    /*! \brief The expression object of the derived class */
+    const E& expression() const;
+
+    /*! \brief Evaluates the expression into a new set in one traversal of all the operand trees */
+    GridTreeSet evaluate() const;
+
+    /*! \brief The number of cells of the expression, i.e. the size of the evaluated set */
+    size_t size() const;
+
+    /*! \brief Returns true if the expression has no cells, the traversal stops at the first cell */
+    bool empty() const;
+
+    /*! \brief The iterator pointing at the first cell of the expression */
+    const_iterator begin() const;
+
+    /*! \brief The end iterator */
+    const_iterator end() const;
+
+  private:
+    /*! \brief Builds in the disabled leaf \a pNode the cells of the cursor \a theCursor */
+    template<class C> static void evaluate_node( BinaryTreeNode * pNode, const C& theCursor );
+
+    /*! \brief The number of cells of the cursor \a theCursor */
+    template<class C> static size_t count_cells( const C& theCursor );
+
+    /*! \brief Returns true if the cursor \a theCursor has some cells */
+    template<class C> static bool has_cells( const C& theCursor );
+};
+
+/*! \brief The lazy set expression of a single GridTreeSubset. */
+class GridSubsetExpression : public GridSetExpression<GridSubsetExpression> {
+  private:
+    /*! \brief The root node of the binary tree of the subset */
+    const BinaryTreeNode * _pRootTreeNode;
+
+    /*! \brief The root cell of the subset */
+    GridCell _theCell;
+
+  public:
+    typedef GridSubsetCursor cursor_type;
+
+    /*! \brief The expression of the subset \a theSet, the set has to outlive it */
+    explicit GridSubsetExpression( const GridTreeSubset& theSet );
+
+    const Grid& grid() const;
+
+    uint height() const;
+
+    /*! \brief The cursor at the primary cell of the height \a theHeight >= height() */
+    cursor_type cursor( const uint theHeight ) const;
+};
+
+/*! \brief The lazy set expression combining two expressions by the operation \a OP. */
+template<class E1, class E2, class OP>
+class GridBinaryExpression : public GridSetExpression< GridBinaryExpression<E1, E2, OP> > {
+  private:
+    E1 _theExpression1;
+    E2 _theExpression2;
+
+  public:
+    typedef GridBinaryCursor<typename E1::cursor_type, typename E2::cursor_type, OP> cursor_type;
+
+    /*! \brief The expressions have to be defined on the same grid */
+    GridBinaryExpression( const E1& theExpression1, const E2& theExpression2 );
+
+    const Grid& grid() const;
+
+    uint height() const;
+
+    /*! \brief The cursor at the primary cell of the height \a theHeight >= height() */
+    cursor_type cursor( const uint theHeight ) const;
+};
+
+/*! \brief The lazy set expression of the complement of an expression within a grid cell. */
+template<class E>
+class GridComplementExpression : public GridSetExpression< GridComplementExpression<E> > {
+  private:
+    E _theExpression;
+    GridCell _theCell;
+
+  public:
+    typedef GridBinaryCursor<GridCellCursor, typename E::cursor_type, GridDifferenceOperation> cursor_type;
+
+    /*! \brief The cell has to be defined on the grid of the expression */
+    GridComplementExpression( const E& theExpression, const GridCell& theCell );
+
+    const Grid& grid() const;
+
+    uint height() const;
+
+    /*! \brief The cursor at the primary cell of the height \a theHeight >= height() */
+    cursor_type cursor( const uint theHeight ) const;
+};
+
+/*! \brief This class allows to iterate through the cells of a lazy set expression, see \a GridSetExpression.
+ *  The expression is traversed in the depth first order with an explicit stack of cursors.
+ */
+template<class E>
+class GridSetExpressionConstIterator : public boost::iterator_facade< GridSetExpressionConstIterator<E>, GridCell const, boost::forward_traversal_tag > {
+  private:
+    typedef typename E::cursor_type cursor_type;
+
+    /*! \brief A position waiting in the stack: the cursor, the depth and the last step of the path to it */
+    struct StackEntry {
+        cursor_type cursor;
+        uint depth;
+        bool isRight;
+    };
+
+    /*! \brief The grid of the expression, NULL for the end iterator */
+    const Grid * _pGrid;
+
+    /*! \brief The height of the primary cell at which the traversal starts */
+    uint _theHeight;
+
+    /*! \brief The positions that still have to be visited */
+    std::vector<StackEntry> _theStack;
+
+    /*! \brief The path from the primary cell to the current cell */
+    BinaryWord _theWord;
+
+    /*! \brief The current cell */
+    GridCell _theCurrentCell;
+
+    friend class boost::iterator_core_access;
+
+    /*! \brief Moves to the next position at which the value of the cursor is true */
+    void find_next_cell();
+
+    void increment();
+
+    /*! \brief Returns true if both iterators are at the end, or at the same cell */
+    bool equal( GridSetExpressionConstIterator<E> const & theOtherIterator ) const;
+
+    GridCell const& dereference() const;
+
+  public:
+    /*! \brief Constructs the end iterator */
+    GridSetExpressionConstIterator();
+
+    /*! \brief The iterator at the first cell of the expression \a theExpression */
+    explicit GridSetExpressionConstIterator( const E& theExpression );
+};
+
+/*! \brief The lazy set expression of the subset \a theSet, see \a GridSetExpression */
+GridSubsetExpression lazy( const GridTreeSubset& theSet );
+
+/*! \brief The lazy union of two set expressions */
+template<class E1, class E2>
+GridBinaryExpression<E1, E2, GridJoinOperation> join( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 );
+
+/*! \brief The lazy intersection of two set expressions */
+template<class E1, class E2>
+GridBinaryExpression<E1, E2, GridIntersectionOperation> intersection( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 );
+
+/*! \brief The lazy difference of two set expressions */
+template<class E1, class E2>
+GridBinaryExpression<E1, E2, GridDifferenceOperation> difference( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 );
+
+/*! \brief The lazy complement of the set expression within the cell \a theCell */
+template<class E>
+GridComplementExpression<E> complement( const GridSetExpression<E>& theExpression, const GridCell& theCell );
+
+/*! \brief Tests if the cells of the first expression are covered by the second one, without evaluating them */
+template<class E1, class E2>
+bool subset( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 );
+
+/*! \brief Tests if the expressions overlap, without evaluating them */
+template<class E1, class E2>
+bool overlap( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 );
+
+/****************************************************************************************************/
+/***************************************Inline functions*********************************************/
+/****************************************************************************************************/
+
+/****************************************BinaryTreeNodePool******************************************/
+
+inline void * BinaryTreeNodePool::allocate(){
+    while( _pFreeList == NULL ) {
+        if( ! _theReleasedTrees.empty() ) {
+            //Reclaim the root of a released subtree, its sub-trees get released in its place
+            BinaryTreeNode * pNode = _theReleasedTrees.back();
+            _theReleasedTrees.pop_back();
+            if( pNode->_pLeftNode != NULL ) { release( pNode->_pLeftNode ); }
+            if( pNode->_pRightNode != NULL ) { release( pNode->_pRightNode ); }
+            return pNode;
+        }
+        //The nodes drained by the other threads are used before a new slab is allocated
+        if( ! take_drained() ) {
+            allocate_slab();
+        }
+    }
+    void * pMemory = _pFreeList;
+    _pFreeList = *static_cast<void**>( pMemory );
+    return pMemory;
+}
+
+inline void BinaryTreeNodePool::deallocate( void * pMemory ){
+    *static_cast<void**>( pMemory ) = _pFreeList;
+    _pFreeList = pMemory;
+}
+
+inline void BinaryTreeNodePool::release( BinaryTreeNode * pNode ){
+    //The shared nodes are still referenced by some other parents
+    uint theReferences;
+#ifdef _OPENMP
+    #pragma omp atomic capture
+#endif
+    theReferences = --( pNode->_theReferences );
+    if( theReferences == 0 ) {
+        _theReleasedTrees.push_back( pNode );
+    }
+}
+
+inline size_t BinaryTreeNodePool::capacity(){
+    return _theCapacity;
+}
+
+/****************************************BinaryTreeNode**********************************************/
+
+inline void BinaryTreeNode::init( tribool isEnabled, BinaryTreeNode* pLeftNode, BinaryTreeNode* pRightNode ){
+    _isEnabled = isEnabled;
+    _pLeftNode = pLeftNode;
+    _pRightNode = pRightNode;
+    _theReferences = 1;
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+    _theEnabledLeafCount = UNKNOWN_LEAF_COUNT;
+    _theHash = UNKNOWN_HASH;
+#endif
+}
+
+inline BinaryTreeNode::BinaryTreeNode(const tribool isEnabled){
+    init( isEnabled, NULL, NULL );
+}
+
+inline BinaryTreeNode::BinaryTreeNode(const BinaryTreeNode& theTreeNode){
+    if( (theTreeNode._pLeftNode) != NULL && ( theTreeNode._pRightNode != NULL ) ){
+        init( theTreeNode._isEnabled, new BinaryTreeNode( *theTreeNode._pLeftNode ), new BinaryTreeNode( *theTreeNode._pRightNode ) );
+    }else{
+        //NOTE: We do not allow for nodes where one leaf is NULL and another is not
+        init( theTreeNode._isEnabled, NULL, NULL );
+    }
+    copy_known_caches( &theTreeNode );
+}
+
+inline BinaryTreeNode::BinaryTreeNode( const BooleanArray& theTree, const BooleanArray& theEnabledCells ) {
+    //Make default initialization
+    init( false, NULL, NULL ) ;
+
+    //If the tree is not empty and there are enabled leafs then do the thing
+    if( ( theTree.size() ) > 0 && ( theEnabledCells.size() > 0 ) ) {
+        uint arr_index = 0, leaf_counter = 0;
+        restore_node( this, arr_index, leaf_counter, theTree, theEnabledCells );
+    } else {
+        //Otherwise settle with one disabled node
+        this->set_disabled();
+    }
+}
+
+inline BinaryTreeNode::~BinaryTreeNode(){
+    //The sub-trees are not traversed here, the pool reclaims their nodes later
+    if( _pLeftNode != NULL ) {
+        BinaryTreeNodePool::release( _pLeftNode );
+    }
+    if( _pRightNode != NULL ) {
+        BinaryTreeNodePool::release( _pRightNode );
+    }
+}
+
+inline void * BinaryTreeNode::operator new( size_t size ){
+    ARIADNE_ASSERT( size == sizeof(BinaryTreeNode) );
+    return BinaryTreeNodePool::allocate();
+}
+
+inline void BinaryTreeNode::operator delete( void * pMemory ){
+    if( pMemory != NULL ) {
+        BinaryTreeNodePool::deallocate( pMemory );
+    }
+}
+
+inline bool BinaryTreeNode::is_enabled() const{
+    return definitely(_isEnabled);
+}
+
+inline bool BinaryTreeNode::is_disabled() const{
+    return ! possibly(_isEnabled) ;
+}
+
+inline bool BinaryTreeNode::is_leaf() const{
+    return (_pLeftNode == NULL) && (_pRightNode == NULL);
+}
+
+inline const BinaryTreeNode * BinaryTreeNode::left_node() const {
+    return _pLeftNode;
+}
+
+inline const BinaryTreeNode * BinaryTreeNode::right_node() const {
+    return _pRightNode;
+}
+
+inline BinaryTreeNode * BinaryTreeNode::left_node() {
+    //The sub-node can be modified, and so can be the count of this node
+    invalidate_enabled_leaf_count();
+    unshare( _pLeftNode );
+    return _pLeftNode;
+}
+
+inline BinaryTreeNode * BinaryTreeNode::right_node() {
+    invalidate_enabled_leaf_count();
+    unshare( _pRightNode );
+    return _pRightNode;
+}
+
+inline void BinaryTreeNode::invalidate_enabled_leaf_count() {
+    //A node that another task has just stopped sharing may still be read by it, see unshare
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+#ifdef _OPENMP
+    #pragma omp atomic write
+#endif
+    _theEnabledLeafCount = UNKNOWN_LEAF_COUNT;
+#ifdef _OPENMP
+    #pragma omp atomic write
+#endif
+    _theHash = UNKNOWN_HASH;
+#endif
+}
+
+inline size_t BinaryTreeNode::known_enabled_leaf_count() const {
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+    size_t theCount;
+#ifdef _OPENMP
+    #pragma omp atomic read
+#endif
+    theCount = _theEnabledLeafCount;
+    return theCount;
+#else
+    return UNKNOWN_LEAF_COUNT;
+#endif
+}
+
+inline boost::uint64_t BinaryTreeNode::known_hash() const {
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+    boost::uint64_t theHash;
+#ifdef _OPENMP
+    #pragma omp atomic read
+#endif
+    theHash = _theHash;
+    return theHash;
+#else
+    return UNKNOWN_HASH;
+#endif
+}
+
+inline void BinaryTreeNode::copy_known_caches( const BinaryTreeNode * pNode ) {
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+    _theEnabledLeafCount = pNode->known_enabled_leaf_count();
+    _theHash = pNode->known_hash();
+#endif
+}
+
+inline bool BinaryTreeNode::is_shared() const {
+    uint theReferences;
+#ifdef _OPENMP
+    #pragma omp atomic read
+#endif
+    theReferences = _theReferences;
+    return theReferences > 1;
+}
+
+inline BinaryTreeNode * BinaryTreeNode::shallow_copy( const BinaryTreeNode * pNode ) {
+    BinaryTreeNode * pCopyNode = new BinaryTreeNode( pNode->_isEnabled );
+    pCopyNode->copy_known_caches( pNode );
+    //The copy shares the sub-nodes, so they get one more reference
+    if( ! pNode->is_leaf() ) {
+        pCopyNode->_pLeftNode = pNode->_pLeftNode;
+        pCopyNode->_pRightNode = pNode->_pRightNode;
+#ifdef _OPENMP
+        #pragma omp atomic
+#endif
+        pCopyNode->_pLeftNode->_theReferences++;
+#ifdef _OPENMP
+        #pragma omp atomic
+#endif
+        pCopyNode->_pRightNode->_theReferences++;
+    }
+    return pCopyNode;
+}
+
+inline void BinaryTreeNode::unshare( BinaryTreeNode *& pNode ) {
+    if( ( pNode != NULL ) && pNode->is_shared() ) {
+        BinaryTreeNode * pCopyNode = shallow_copy( pNode );
+        //Two tasks may unshare the same node at once, then the last of them reclaims it
+        BinaryTreeNodePool::release( pNode );
+        pNode = pCopyNode;
+    }
+}
+
+inline void BinaryTreeNode::set_enabled() {
+    if ( is_leaf() ) {
+        _isEnabled = true;
+        invalidate_enabled_leaf_count();
+    } else {
+        throw NotALeafNodeException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline void BinaryTreeNode::copy_from( const BinaryTreeNode * pOtherNode ){
+    if( pOtherNode != NULL ){
+        //The sub-trees are copied before the old ones are released, because the latter may be shared with pOtherNode
+        BinaryTreeNode * pLeftNode = NULL, * pRightNode = NULL;
+        if( pOtherNode->_pLeftNode != NULL ){ pLeftNode = new BinaryTreeNode( * (pOtherNode->_pLeftNode) ); }
+        if( pOtherNode->_pRightNode != NULL ){ pRightNode = new BinaryTreeNode( * (pOtherNode->_pRightNode) ); }
+        _isEnabled = pOtherNode->_isEnabled;
+        if( _pLeftNode != NULL){ BinaryTreeNodePool::release( _pLeftNode ); }
+        if( _pRightNode != NULL){ BinaryTreeNodePool::release( _pRightNode ); }
+        _pLeftNode = pLeftNode;
+        _pRightNode = pRightNode;
+        copy_known_caches( pOtherNode );
+    }
+}
+
+inline void BinaryTreeNode::set_disabled() {
+    if ( is_leaf() ) {
+        _isEnabled = false;
+        invalidate_enabled_leaf_count();
+    } else {
+        throw NotALeafNodeException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline void BinaryTreeNode::set_unknown() {
+    if ( ! is_leaf() ) {
+        _isEnabled = indeterminate;
+    } else {
+        throw IsALeafNodeException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline void BinaryTreeNode::set_unknown_unchecked() {
+    _isEnabled = indeterminate;
+    _pLeftNode = NULL;
+    _pRightNode = NULL;
+    invalidate_enabled_leaf_count();
+}
+
+inline void BinaryTreeNode::make_leaf(tribool is_enabled ){
+    _isEnabled = is_enabled;
+    invalidate_enabled_leaf_count();
+    //The sub-trees might be shared, so they are released instead of being deleted
+    if( _pLeftNode != NULL ) { BinaryTreeNodePool::release( _pLeftNode ); _pLeftNode= NULL; }
+    if( _pRightNode != NULL ) { BinaryTreeNodePool::release( _pRightNode ); _pRightNode= NULL; }
+}
+
+inline void BinaryTreeNode::split() {
+    if ( is_leaf() ) {
+        _pLeftNode  = new BinaryTreeNode(_isEnabled);
+        _pRightNode = new BinaryTreeNode(_isEnabled);
+        set_unknown();
+        invalidate_enabled_leaf_count();
+    }
+}
+
+inline void BinaryTreeNode::add_enabled( const BinaryWord& path ){
+    add_enabled( this, path, 0 );
+}
+
+inline void BinaryTreeNode::mince(const uint depth) {
+    mince_node(this, depth);
+}
+
+inline void BinaryTreeNode::recombine() {
+    recombine_node(this);
+}
+
+inline string BinaryTreeNode::node_to_string() const {
+    stringstream tmp_stream;
+    tmp_stream << "BinaryTreeNode( isLeaf = " << is_leaf() << ", isEnabled = " << is_enabled() << ", isDisabled = " << is_disabled() << " )";
+    return tmp_stream.str();
+}
+
+inline BinaryTreeNode& BinaryTreeNode::operator=( const BinaryTreeNode & otherNode ) {
+    //Copy the node value and the children trees, if any
+    copy_from( &otherNode );
+
+    return *this;
+}
+
+/****************************************CompactBinaryTree*******************************************/
+
+inline void CompactBinaryTree::set_node( const uint node, const node_type state, const uint firstChild ){
+    _theNodes[node] = ( node_type(firstChild) << STATE_BITS ) | state;
+}
+
+inline bool CompactBinaryTree::is_leaf( const uint node ) const {
+    return ( _theNodes[node] & STATE_MASK ) != NON_LEAF;
+}
+
+inline bool CompactBinaryTree::is_enabled( const uint node ) const {
+    return ( _theNodes[node] & STATE_MASK ) == ENABLED_LEAF;
+}
+
+inline bool CompactBinaryTree::is_disabled( const uint node ) const {
+    return ( _theNodes[node] & STATE_MASK ) == DISABLED_LEAF;
+}
+
+inline uint CompactBinaryTree::left_node( const uint node ) const {
+    return _theNodes[node] >> STATE_BITS;
+}
+
+inline uint CompactBinaryTree::right_node( const uint node ) const {
+    return ( _theNodes[node] >> STATE_BITS ) + 1;
+}
+
+inline size_t CompactBinaryTree::memory() const {
+    return _theNodes.capacity() * sizeof(node_type);
+}
+
+inline void CompactBinaryTree::set_enabled( const uint node ) {
+    if ( is_leaf( node ) ) {
+        set_node( node, ENABLED_LEAF );
+    } else {
+        throw NotALeafNodeException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline void CompactBinaryTree::set_disabled( const uint node ) {
+    if ( is_leaf( node ) ) {
+        set_node( node, DISABLED_LEAF );
+    } else {
+        throw NotALeafNodeException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline void CompactBinaryTree::make_leaf( const uint node, const bool isEnabled ) {
+    release_sub_nodes( node );
+    set_node( node, isEnabled ? ENABLED_LEAF : DISABLED_LEAF );
+}
+
+inline void CompactBinaryTree::split( const uint node ) {
+    if ( is_leaf( node ) ) {
+        //NOTE: allocate_pair() may reallocate the array, so we read the node's state first
+        const node_type state = _theNodes[node] & STATE_MASK;
+        const uint firstChild = allocate_pair();
+        set_node( firstChild, state );
+        set_node( firstChild + 1, state );
+        set_node( node, NON_LEAF, firstChild );
+    }
+}
+
+inline void CompactBinaryTree::restrict( const CompactBinaryTree & otherTree ) {
+    restrict( ROOT, otherTree, ROOT );
+}
+
+inline void CompactBinaryTree::remove( const CompactBinaryTree & otherTree ) {
+    remove( ROOT, otherTree, ROOT );
+}
+
+inline void CompactBinaryTree::add_enabled( const CompactBinaryTree & otherTree ) {
+    add_enabled( ROOT, otherTree, ROOT );
+}
+
+inline void CompactBinaryTree::recombine() {
+    recombine_node( ROOT );
+}
+
+inline bool CompactBinaryTree::overlap( const CompactBinaryTree & treeOne, const CompactBinaryTree & treeTwo ) {
+    return overlap( treeOne, ROOT, treeTwo, ROOT );
+}
+
+inline bool CompactBinaryTree::subset( const CompactBinaryTree & treeOne, const CompactBinaryTree & treeTwo ) {
+    return subset( treeOne, ROOT, treeTwo, ROOT );
+}
+
+inline bool CompactBinaryTree::operator==( const CompactBinaryTree & otherTree ) const {
+    return is_equal_nodes( *this, ROOT, otherTree, ROOT );
+}
+
+inline void CompactBinaryTree::tree_to_binary_words( BinaryWord & tree, BinaryWord & leaves ) const {
+    tree_to_binary_words( ROOT, tree, leaves );
+}
+
+/*****************************************PackedBinaryWord*******************************************/
+
+inline size_t PackedBinaryWord::limbs_for( const size_t numBits ) {
+    return ( numBits + LIMB_BITS - 1 ) / LIMB_BITS;
+}
+
+inline uint PackedBinaryWord::leading_zeros( limb_type limb ) {
+#ifdef __GNUC__
+    return __builtin_clzll( limb );
+#else
+    uint result = 0;
+    while( ( limb & ( limb_type(1) << ( LIMB_BITS - 1 ) ) ) == 0 ) {
+        limb <<= 1;
+        result++;
+    }
+    return result;
+#endif
+}
+
+inline PackedBinaryWord::PackedBinaryWord() :
+    _theSize(0), _theCapacity(INLINE_LIMBS), _pLimbs(_theInlineLimbs) {
+    for( uint i = 0; i < INLINE_LIMBS; i++ ) {
+        _theInlineLimbs[i] = 0;
+    }
+}
+
+inline PackedBinaryWord::~PackedBinaryWord() {
+    if( _pLimbs != _theInlineLimbs ) {
+        delete[] _pLimbs;
+    }
+}
+
+inline size_t PackedBinaryWord::size() const {
+    return _theSize;
+}
+
+inline bool PackedBinaryWord::empty() const {
+    return _theSize == 0;
+}
+
+inline bool PackedBinaryWord::operator[]( const size_t i ) const {
+    return ( ( _pLimbs[ i / LIMB_BITS ] >> ( LIMB_BITS - 1 - i % LIMB_BITS ) ) & 1 ) != 0;
+}
+
+inline void PackedBinaryWord::push_back( const bool bit ) {
+    if( _theSize % LIMB_BITS == 0 ) {
+        reserve_limbs( _theSize / LIMB_BITS + 1 );
+    }
+    if( bit ) {
+        _pLimbs[ _theSize / LIMB_BITS ] |= limb_type(1) << ( LIMB_BITS - 1 - _theSize % LIMB_BITS );
+    }
+    _theSize++;
+}
+
+inline void PackedBinaryWord::pop_back() {
+    ARIADNE_ASSERT( _theSize > 0 );
+    _theSize--;
+    //Keep the unused bits zero
+    _pLimbs[ _theSize / LIMB_BITS ] &= ~( limb_type(1) << ( LIMB_BITS - 1 - _theSize % LIMB_BITS ) );
+}
+
+inline bool PackedBinaryWord::is_prefix( const PackedBinaryWord& otherWord ) const {
+    return ( _theSize <= otherWord._theSize ) && ( common_prefix_length( otherWord ) == _theSize );
+}
+
+inline bool PackedBinaryWord::operator==( const PackedBinaryWord& otherWord ) const {
+    if( _theSize != otherWord._theSize ) {
+        return false;
+    }
+    //The unused bits are zero, so whole limbs can be compared
+    const size_t numLimbs = limbs_for( _theSize );
+    for( size_t i = 0; i < numLimbs; i++ ) {
+        if( _pLimbs[i] != otherWord._pLimbs[i] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool PackedBinaryWord::operator!=( const PackedBinaryWord& otherWord ) const {
+    return ! ( (*this) == otherWord );
+}
+
+inline bool PackedBinaryWord::operator<( const PackedBinaryWord& otherWord ) const {
+    return compare( otherWord ) < 0;
+}
+
+/********************************************GridTreeCursor***************************************/
+
+inline GridTreeCursor::GridTreeCursor(  ) :
+    _currentStackIndex(-1), _pSubPaving(0), _theCurrentGridCell( Grid(), 0, BinaryWord() ) {
+}
+
+inline GridTreeCursor::GridTreeCursor(const GridTreeCursor & otherCursor) :
+    _currentStackIndex(otherCursor._currentStackIndex), _theStack(otherCursor._theStack),
+    _pSubPaving(otherCursor._pSubPaving), _theCurrentGridCell(otherCursor._theCurrentGridCell){
+}
+
+inline GridTreeCursor& GridTreeCursor::operator=(const GridTreeCursor & otherCursor) {
+    _currentStackIndex = otherCursor._currentStackIndex;
+    _theStack = otherCursor._theStack;
+    _pSubPaving = otherCursor._pSubPaving;
+    _theCurrentGridCell = otherCursor._theCurrentGridCell;
+
+    return *this;
+}
+
+inline GridTreeCursor::GridTreeCursor(const GridTreeSubset * pSubPaving) :
+    _currentStackIndex(-1), _pSubPaving(pSubPaving), _theCurrentGridCell( pSubPaving->cell() ) {
+    //Remember that GridTreeSubset contains GridCell
+
+    //Add the current node to the stack, since we are in it
+
+    //IVAN S ZAPREEV:
+    //NOTE: There is no need in allocating _theStack elements,
+    //it is all done in the push method
+    push(pSubPaving->_pRootTreeNode);
+}
+
+inline GridTreeCursor::~GridTreeCursor() {
+    //IVAN S ZAPREEV:
+    //WARNING: The subpaving should not be deallocated here!
+    //There are no other data feels that we need to deallocate
+    _pSubPaving = NULL;
+}
+
+inline void GridTreeCursor::push( const BinaryTreeNode* pLatestNode ){
+    //If we are out of free space, increase the array's capacity
+    if( static_cast<uint>(_currentStackIndex +1) == ( _theStack.size()  ) ){
+        _theStack.resize( _theStack.size() + STACK_SIZE_INCREMENT );
+    }
+
+    //The index for the tree node to be added
+    _currentStackIndex += 1;
+
+    //Put the tree node pointer into the stack
+    _theStack[_currentStackIndex] = pLatestNode;
+
+}
+
+inline const BinaryTreeNode* GridTreeCursor::pop( ){
+    const BinaryTreeNode* pLastNode = NULL;
+
+    //If there are non-root nodes in the stack
+    if( _currentStackIndex > 0 ){
+        //Return the stack element at _currentStackIndex,
+        //then decrement the current element's index.
+        return _theStack[ _currentStackIndex-- ];
+    }
+
+    return pLastNode;
+}
+
+inline bool GridTreeCursor::is_at_the_root() const {
+    //If we are pointing at the zero cell of the array then it
+    //means that we are in the root of the tree
+    return (_currentStackIndex == 0);
+}
+
+inline bool GridTreeCursor::is_enabled() const {
+    return _theStack[ _currentStackIndex ]->is_enabled();
+}
+
+inline bool GridTreeCursor::is_disabled() const {
+    return _theStack[ _currentStackIndex ]->is_disabled();
+}
+
+inline bool GridTreeCursor::is_leaf() const {
+    return _theStack[ _currentStackIndex ]->is_leaf();
+}
+
+inline bool GridTreeCursor::is_root() const {
+    return  is_at_the_root();
+}
+
+inline BinaryTreeNode * GridTreeCursor::current_node_for_update() const {
+    //The last _currentStackIndex bits of the cell's word lead from the root to the current node
+    const BinaryWord & theWord = _theCurrentGridCell._theWord;
+    const uint offset = theWord.size() - _currentStackIndex;
+    BinaryTreeNode * pNode = _pSubPaving->_pRootTreeNode;
+    if( _pSubPaving->_pPavingRootNode != NULL ) {
+        //The cursor modifies the subpaving it was given, so it refreshes the root node the latter points to
+        pNode = GridTreeSubset::follow_path_for_update( _pSubPaving->_pPavingRootNode, _pSubPaving->_theGridCell.word(),
+                                                        _pSubPaving->_theDepthInPaving );
+        _pSubPaving->_pRootTreeNode = pNode;
+    }
+    _theStack[0] = pNode;
+    for( int i = 1; i <= _currentStackIndex; i++ ) {
+        pNode = theWord[ offset + i - 1 ] ? pNode->right_node() : pNode->left_node();
+        _theStack[i] = pNode;
+    }
+    return pNode;
+}
+
+inline void GridTreeCursor::set_enabled() const {
+    return current_node_for_update()->set_enabled();
+}
+
+inline void GridTreeCursor::set_disabled() const {
+    return current_node_for_update()->set_disabled();
+}
+
+inline bool GridTreeCursor::is_left_child() const{
+    //If there is a parent node and the given node is it's left child, the
+    //last bit of the word is used, since both children can be one shared node
+    return ( _currentStackIndex > 0 ) && ! _theCurrentGridCell._theWord[ _theCurrentGridCell._theWord.size() - 1 ];
+}
+
+inline bool GridTreeCursor::is_right_child() const{
+    //If there is a parent node and the given node is it's right child
+    return ( _currentStackIndex > 0 ) && _theCurrentGridCell._theWord[ _theCurrentGridCell._theWord.size() - 1 ];
+}
+
+inline GridTreeCursor& GridTreeCursor::move_up() {
+    if( ! is_root() ){
+        //Remove the current node from the stack
+        pop();
+        //Recompute the PavingGridCell
+        updateTheCurrentGridCell( indeterminate );
+        //Return the object back
+        return ( * this);
+    } else {
+        throw NotAllowedMoveException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline GridTreeCursor& GridTreeCursor::move_left() {
+    return move(false);
+}
+
+inline GridTreeCursor& GridTreeCursor::move_right() {
+    return move(true);
+}
+
+inline void GridTreeCursor::updateTheCurrentGridCell( tribool left_or_right ){
+    if( ! indeterminate(left_or_right) ){
+        //Here left_or_right is either true or false, also true defines moving to the right branch
+        _theCurrentGridCell._theWord.push_back( definitely( left_or_right ) );
+    } else {
+        //If left_or_right is indeterminate, this means that we go "up"
+        //in the tree, so we remove the last bit of the path.
+        _theCurrentGridCell._theWord.pop_back();
+    }
+    _theCurrentGridCell = GridCell( _theCurrentGridCell._theGrid, _theCurrentGridCell._theHeight, _theCurrentGridCell._theWord );
+}
+
+inline GridTreeCursor& GridTreeCursor::move(bool left_or_right) {
+    const BinaryTreeNode* pNextNode;
+    if( ! is_leaf() ){
+        //If we are not in the leaf node then we can go down, the
+        //read-only access is used so that shared nodes stay shared
+        const BinaryTreeNode * pCurrentNode = _theStack[ _currentStackIndex ];
+        if( left_or_right ){ //true moves us to the right
+            pNextNode = pCurrentNode->right_node();
+        } else { //false moves us to the left
+            pNextNode = pCurrentNode->left_node();
+        }
+        //Put the node into the stack
+        push(pNextNode);
+        //Recompute the PavingGridCell
+        updateTheCurrentGridCell( left_or_right );
+        //Return the object back
+        return ( * this);
+    } else {
+        throw NotAllowedMoveException(ARIADNE_PRETTY_FUNCTION);
+    }
+}
+
+inline const GridCell& GridTreeCursor::cell() const {
+    return _theCurrentGridCell;
+}
+
+inline bool GridTreeCursor::operator==(const GridTreeCursor& anotherGridTreeCursor) const {
+    bool areEqual = false;
+    if( (this->_currentStackIndex >=0) && (anotherGridTreeCursor._currentStackIndex >=0 ) ){
+        areEqual = (this->_theStack[this->_currentStackIndex] == anotherGridTreeCursor._theStack[anotherGridTreeCursor._currentStackIndex]) &&
+                   //A shared node can be reached by different paths
+                   (this->_theCurrentGridCell._theWord == anotherGridTreeCursor._theCurrentGridCell._theWord);
+    }
+    return areEqual;
+}
+
+inline GridTreeSubset GridTreeCursor::operator*() {
+    //IVAN S ZAPREEV:
+    //NOTE: The first three parameters define the location of the _theStack[ _currentStackIndex ]
+    //node with respect to the primary cell of the GridTreeSet.
+    //The sub-paving may be modified, so it remembers the path to its root, which may be shared
+    BinaryTreeNode * pPavingRootNode = _pSubPaving->_pPavingRootNode;
+    uint theDepthInPaving = _pSubPaving->_theDepthInPaving + _currentStackIndex;
+    if( pPavingRootNode == NULL ) {
+        pPavingRootNode = _pSubPaving->_pRootTreeNode;
+    }
+    return GridTreeSubset( _theCurrentGridCell._theGrid,
+                           _theCurrentGridCell._theHeight,
+                           _theCurrentGridCell._theWord,
+                           //The node is only read until the path to it is followed again
+                           const_cast<BinaryTreeNode*>( _theStack[ _currentStackIndex ] ),
+                           pPavingRootNode, theDepthInPaving );
+}
+
+inline const GridTreeSubset GridTreeCursor::operator*() const {
+    return (const GridTreeSubset & ) *(* this);
+}
+
+/****************************************GridTreeConstIterator************************************/
+
+inline GridTreeConstIterator::GridTreeConstIterator( const GridTreeConstIterator& theGridPavingIter ) :
+    _is_in_end_state(theGridPavingIter._is_in_end_state), _pGridTreeCursor(theGridPavingIter._pGridTreeCursor) {
+    //Copy everything
+}
+
+inline GridTreeConstIterator& GridTreeConstIterator::operator=( const GridTreeConstIterator& theGridPavingIter ){
+    _is_in_end_state = theGridPavingIter._is_in_end_state;
+    _pGridTreeCursor = theGridPavingIter._pGridTreeCursor;
+
+    return *this;
+}
+
+inline GridTreeConstIterator::GridTreeConstIterator( const GridTreeSubset * pSubPaving, const tribool firstLastNone ):
+    _pGridTreeCursor(pSubPaving) {
+    if( ! indeterminate( firstLastNone ) ){
+        //If the first/last enabled node is not found, it means that there are no elements
+        //to iterate on, then we switch to the "end iterator" state
+        _is_in_end_state = ! navigate_to( definitely( firstLastNone ) );
+    } else {
+        //In this case if we do nothing, the cursor in the iterator will point to the root node
+        //Since this can be the only node in the tree we should add a marker that indicates that
+        //the iterator is at the end state.
+        _is_in_end_state = true;
+    }
+}
+
+inline void GridTreeConstIterator::increment() {
+    //If we are not done iterating
+    if( ! _is_in_end_state){
+        //We are at some enabled-leaf node and we want to find the next one.
+        //The next node is somewhere on the right in the tree.
+        find_next_enabled_leaf();
+    }
+}
+
+inline GridTreeConstIterator::~GridTreeConstIterator() {
+    //IVAN S ZAPREEV:
+    //WARNING: There are no memory allocations in this class that have to be cleaned
+}
+
+inline bool GridTreeConstIterator::equal( GridTreeConstIterator const & theOtherIterator) const {
+    //Check if both iterators are in the "end iterator" state
+    bool result = theOtherIterator._is_in_end_state && this->_is_in_end_state;
+
+    //If not then check if the cursors are equal (i.e. if they point to the same binary-tree node of the same (subpaving)
+    if( ! result ){
+        if( theOtherIterator._is_in_end_state || this->_is_in_end_state ){
+            //If at one is in the end state and the other is not then the answer is FALSE
+            result = false;
+        } else {
+            result = theOtherIterator._pGridTreeCursor == this->_pGridTreeCursor;
+        }
+    }
+
+    return result;
+}
+
+inline GridCell const& GridTreeConstIterator::dereference() const {
+    return _pGridTreeCursor.cell();
+}
+
+inline GridTreeCursor const& GridTreeConstIterator::cursor() const {
+    return _pGridTreeCursor;
+}
+
+/*********************************************LatticeCell********************************************/
 
-inline bool GridTreeCursor::is_enabled() const {
-    return _theStack[ _currentStackIndex ]->is_enabled();
+inline bool LatticeCell::is_representable( const dimension_type dimensions, const uint pathLength ) {
+    if( dimensions == 0 ) {
+        //The cell of the default (zero dimensional) grid
+        return pathLength == 0;
+    }
+    //The first dimension is split most often
+    return ( pathLength + dimensions - 1 ) / dimensions <= MAX_SUBDIVISIONS;
+}
+
+inline bool LatticeCell::has_representable_neighbors( const dimension_type dimensions, const uint pathLength ) {
+    return is_representable( dimensions, pathLength + 2 * dimensions );
+}
+
+inline dimension_type LatticeCell::dimension() const {
+    return _theCoordinates.size();
+}
+
+inline uint LatticeCell::height() const {
+    return _theHeight;
+}
+
+inline uint LatticeCell::path_length() const {
+    return _thePathLength;
+}
+
+inline uint LatticeCell::subdivisions( const dimension_type dim ) const {
+    return ( _thePathLength + dimension() - 1 - dim ) / dimension();
+}
+
+inline LatticeCell::coordinate_type LatticeCell::coordinate( const dimension_type dim ) const {
+    return _theCoordinates[dim];
+}
+
+inline LatticeCell::coordinate_type LatticeCell::last_coordinate( const dimension_type dim ) const {
+    return ( coordinate_type(1) << subdivisions( dim ) ) - 1;
+}
+
+/*****************************************GridAbstractCell*******************************************/
+
+inline GridAbstractCell::GridAbstractCell(const GridAbstractCell& theGridCell):
+    _theGrid(theGridCell._theGrid), _theHeight(theGridCell._theHeight),
+    _theWord(theGridCell._theWord), _theBox(theGridCell._theBox) {
+}
+
+inline GridAbstractCell::GridAbstractCell(const Grid& theGrid, const uint theHeight,
+                                            const BinaryWord& theWord, const Box& theBox):
+    _theGrid(theGrid), _theHeight(theHeight),
+    _theWord(theWord), _theBox(theBox) {
+}
+
+inline void GridAbstractCell::primary_cell_at_height( const uint theHeight, int & leftBottomCorner, int & rightTopCorner ) {
+    if ( theHeight % 2 == 1 ) {
+        leftBottomCorner = 2*leftBottomCorner - rightTopCorner;
+    } else {
+        rightTopCorner   = 2*rightTopCorner - leftBottomCorner;
+    }
+}
+
+inline const Grid& GridAbstractCell::grid() const {
+    return _theGrid;
+}
+
+inline uint GridAbstractCell::height() const {
+    return _theHeight;
+}
+
+inline int GridAbstractCell::depth() const {
+    return _theWord.size() - _theHeight;
+}
+
+inline const BinaryWord& GridAbstractCell::word() const {
+    return _theWord;
+}
+
+inline const Box& GridAbstractCell::box() const {
+    return _theBox;
+}
+
+inline dimension_type GridAbstractCell::dimension() const {
+    return _theGrid.dimension();
+}
+
+inline Interval GridAbstractCell::operator[](dimension_type i) const {
+    return _theBox[i];
+}
+
+/*****************************************GridAbstractCell*******************************************/
+
+inline GridAbstractCell& GridAbstractCell::operator=(const GridAbstractCell & otherCell ) {
+    _theGrid = otherCell._theGrid;
+    _theHeight = otherCell._theHeight;
+    _theWord = otherCell._theWord;
+    _theBox = otherCell._theBox;
+
+    return *this;
+}
+
+/*********************************************GridCell***********************************************/
+
+inline GridCell::GridCell() : GridAbstractCell( Grid(), 0, BinaryWord(), Box() ) {
+}
+
+inline GridCell::GridCell(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord) :
+                    GridAbstractCell( theGrid, theHeight, theWord, compute_box(theGrid, theHeight, theWord) ) {
+}
+
+inline GridCell& GridCell::operator=(const GridCell & otherCell ) {
+    GridAbstractCell::operator=(otherCell);
+    return *this;
+}
+
+inline bool GridCell::operator==( const GridCell& other ) const {
+    return compare_grid_cells( this, other, COMPARE_EQUAL );
+}
+
+inline bool GridCell::operator<(const GridCell& other) const {
+    return compare_grid_cells( this, other, COMPARE_LESS );
+}
+
+inline bool GridCell::compare_grid_cells(const GridCell * pCellLeft, const GridCell &cellRight, const uint comparator ) {
+    return GridAbstractCell::compare_abstract_grid_cells( pCellLeft, cellRight, comparator );
+}
+
+//The box is not related to the Grid, i.e. it is in the original space, whereas the binary tree is related to the Lattice of the grid:
+inline Box GridCell::compute_box(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord) {
+    //Compute the lattice box and then map it to the original space using the grid data
+    return lattice_box_to_space( GridCell::compute_lattice_box( theGrid.dimension(), theHeight, theWord ), theGrid );
+}
+
+/*********************************************GridOpenCell***********************************************/
+
+inline GridOpenCell::GridOpenCell(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord, const Box& theBox) :
+                            GridAbstractCell(theGrid, theHeight, theWord, theBox) {
+}
+
+inline GridOpenCell::GridOpenCell() : GridAbstractCell( Grid(), 0, BinaryWord(), compute_box(Grid(), 0, BinaryWord()) ) {
+}
+
+inline GridOpenCell::GridOpenCell(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord) :
+                    GridAbstractCell( theGrid, theHeight, theWord, compute_box(theGrid, theHeight, theWord) ) {
+}
+
+inline GridOpenCell& GridOpenCell::operator=(const GridOpenCell & otherCell ) {
+    GridAbstractCell::operator=(otherCell);
+    return *this;
+}
+
+inline bool GridOpenCell::operator==( const GridOpenCell& other ) const {
+    return compare_grid_cells( this, other, COMPARE_EQUAL );
+}
+
+inline bool GridOpenCell::operator<(const GridOpenCell& other) const {
+    return compare_grid_cells( this, other, COMPARE_LESS );
+}
+
+inline bool GridOpenCell::compare_grid_cells(const GridOpenCell * pCellLeft, const GridOpenCell &cellRight, const uint comparator ) {
+    return GridAbstractCell::compare_abstract_grid_cells( pCellLeft, cellRight, comparator );
+}
+
+inline bool GridOpenCell::overlap( const GridOpenCell & theLeftOpenCell, const GridOpenCell & theRightOpenCell ) {
+    return definitely( theLeftOpenCell.box().overlaps(  theRightOpenCell.box() ) );
+}
+
+/********************************************GridTreeSubset******************************************/
+
+inline GridTreeSubset::GridTreeSubset( const Grid& theGrid, const uint theHeight,
+                                       const BinaryWord& theWord, BinaryTreeNode * pRootTreeNode ) :
+                                       _pRootTreeNode(pRootTreeNode), _theGridCell(theGrid, theHeight, theWord),
+                                       _pPavingRootNode(NULL), _theDepthInPaving(0) {
+}
+
+inline GridTreeSubset::GridTreeSubset( const Grid& theGrid, const uint theHeight, const BinaryWord& theWord,
+                                       BinaryTreeNode * pRootTreeNode, BinaryTreeNode * pPavingRootNode,
+                                       const uint theDepthInPaving ) :
+                                       _pRootTreeNode(pRootTreeNode), _theGridCell(theGrid, theHeight, theWord),
+                                       _pPavingRootNode( ( theDepthInPaving > 0 ) ? pPavingRootNode : NULL ),
+                                       _theDepthInPaving( ( theDepthInPaving > 0 ) ? theDepthInPaving : 0 ) {
+    ARIADNE_ASSERT( theDepthInPaving <= theWord.size() );
+}
+
+inline GridTreeSubset::GridTreeSubset( const GridTreeSubset &otherSubset ) : _pRootTreeNode(otherSubset._pRootTreeNode),
+                                                                             _theGridCell(otherSubset._theGridCell),
+                                                                             _pPavingRootNode(otherSubset._pPavingRootNode),
+                                                                             _theDepthInPaving(otherSubset._theDepthInPaving) {
+}
+
+inline GridTreeSubset::~GridTreeSubset() {
+    //IVAN S ZAPREEV:
+    //WARNING: This method should have no implementation what so ever
+    //All the dynamically allocated data should be destroyed from the
+    //corresponding Paving object
+}
+
+inline uint GridTreeSubset::compute_number_subdiv( Float theWidth, const Float theMaxWidth) const{
+    //Compute the minimum number of subdivisions N as:
+    //   minimum N : ( theWidth / 2^{N} ) <= theMaxWidth
+    //This is equivalent to (because all values are positive)
+    //   minimum N : theWidth / theMaxWidth <= 2^{N}
+    //log is a continuous-increasing function, thus the latter is
+    //equivalent to (since 0 < theMaxWidth, theWidth < infinite )
+    //   minimum N : log( theWidth / theMaxWidth ) <= N
+    //In computations then we need to take
+    //   N = ceil( log( theWidth / theMaxWidth ) )
+
+    //IVAN S ZAPREEV:
+    //NOTE: We take log_approx, log_approx because if we use _up and _down versions to maximize the answer,
+    //then it might become very inaccurate, and in case require more subdivisions than needed.
+    //NOTE: We need base 2 logarithm, we get it by the rule: log_a(b)/log_a(c) = log_c(a)
+    //PIETER COLLINS:
+    //NOTE: Float now uses approximate operators by default
+    uint result = 0;
+    if ( theWidth > theMaxWidth ){
+        //result = (uint) ceil( div_approx( log_approx( div_approx( theWidth, theMaxWidth ) ) , log_approx( R(2.0) ) ) );
+        result = (uint) ceil( Ariadne::div( Ariadne::log( Ariadne::div( theWidth, theMaxWidth ) ) , Ariadne::log( 2.0 ) ) );
+    }
+    return result;
+}
+
+inline bool GridTreeSubset::empty() const {
+    return BinaryTreeNode::count_enabled_leaf_nodes( this->binary_tree() ) == 0;
+}
+
+inline size_t GridTreeSubset::size() const {
+    return BinaryTreeNode::count_enabled_leaf_nodes( this->binary_tree() );
+}
+
+inline uint GridTreeSubset::dimension( ) const {
+    return grid().dimension();
+}
+
+
+inline const Grid& GridTreeSubset::grid() const {
+    return this->_theGridCell.grid();
+}
+
+inline GridCell GridTreeSubset::cell() const {
+    return _theGridCell;
+}
+
+inline Box GridTreeSubset::bounding_box() const {
+    if(this->empty()) return Box::empty_box(this->dimension());
+
+    GridTreeSet::const_iterator iter=this->begin();
+    Box bbox = iter->box();
+
+    for( ; iter!=this->end(); ++iter) {
+        Box cell = iter->box();
+        for(uint i = 0; i < cell.dimension(); ++i) {
+            if(cell[i].lower() < bbox[i].lower()) bbox[i].set_lower(cell[i].lower());
+            if(cell[i].upper() > bbox[i].upper()) bbox[i].set_upper(cell[i].upper());
+        }
+    }
+
+    return bbox;
+
+}
+
+inline int GridTreeSubset::zero_cell_subdivisions_to_tree_subdivisions( const uint numSubdivInDim, const uint primaryCellHeight,
+                                                                        const uint primaryToRootCellPathLength ) const {
+    //Here we take the height of the primary cell that the subpaving's root cell is rooted to
+    //This height times the number of dimensions is the number of subdivisions to make in
+    //the primary cell to reach the level of the zero cell. This plus the numSubdivInDim 
+    //times the number of dimensions gives us the total number of the primary cell we have
+    //to make. But, the given paving is has the root node different from the primary cell,
+    //thus we have to subtract the length of the path from the primary cell to the root cell
+    //of this subpaving, to get the proper number of subdivisions to make in the binary tree
+    int theNewDepth = ( primaryCellHeight + numSubdivInDim ) * _theGridCell.grid().dimension() - primaryToRootCellPathLength;
+    //If the new depth is not positive then we already have the required number
+    //of subdivisions so then nothing has to be done, so we return zero!
+    return (theNewDepth > 0) ? theNewDepth : 0;
+}
+
+inline void GridTreeSubset::mince( const uint numSubdivInDim ) {
+    mince_to_tree_depth( zero_cell_subdivisions_to_tree_subdivisions( numSubdivInDim, _theGridCell.height(), _theGridCell.word().size() ) );
+}
+
+inline void GridTreeSubset::mince_to_tree_depth( const uint theNewDepth ) {
+    root_node_for_update()->mince( theNewDepth );
+}
+
+inline void GridTreeSubset::recombine() {
+    root_node_for_update()->recombine();
+}
+
+inline void GridTreeSubset::share_equal_subtrees() {
+    root_node_for_update()->share_equal_subtrees();
+}
+
+inline BinaryTreeNode * GridTreeSubset::follow_path_for_update( BinaryTreeNode * pPavingRootNode, const BinaryWord& theWord,
+                                                                const uint theDepthInPaving ) {
+    BinaryTreeNode * pNode = pPavingRootNode;
+    for( uint i = theWord.size() - theDepthInPaving; i < theWord.size(); i++ ) {
+        pNode = theWord[i] ? pNode->right_node() : pNode->left_node();
+    }
+    return pNode;
 }
 
-inline bool GridTreeCursor::is_disabled() const {
-    return _theStack[ _currentStackIndex ]->is_disabled();
+inline BinaryTreeNode * GridTreeSubset::root_node_for_update() {
+    if( _pPavingRootNode != NULL ) {
+        //The last _theDepthInPaving bits of the cell's word lead from the root of the paving to the root of this subpaving
+        _pRootTreeNode = follow_path_for_update( _pPavingRootNode, _theGridCell.word(), _theDepthInPaving );
+    }
+    return _pRootTreeNode;
 }
 
-inline bool GridTreeCursor::is_leaf() const {
-    return _theStack[ _currentStackIndex ]->is_leaf();
+inline uint GridTreeSubset::depth() const {
+    return _pRootTreeNode->depth();
 }
 
-inline bool GridTreeCursor::is_root() const {
-    return  is_at_the_root();
+inline bool GridTreeSubset::operator==(const GridTreeSubset& anotherGridTreeSubset) const {
+    return ( this->_theGridCell == anotherGridTreeSubset._theGridCell ) &&
+        ( ( * this->_pRootTreeNode ) == ( * anotherGridTreeSubset._pRootTreeNode ) );
 }
 
-inline void GridTreeCursor::set_enabled() const {
-    return _theStack[ _currentStackIndex ]->set_enabled();
+inline GridTreeSubset::const_iterator GridTreeSubset::begin() const {
+    return GridTreeSubset::const_iterator(this, true);
 }
 
-inline void GridTreeCursor::set_disabled() const {
-    return _theStack[ _currentStackIndex ]->set_disabled();
+inline GridTreeSubset::const_iterator GridTreeSubset::end() const {
+    return GridTreeSubset::const_iterator(this, indeterminate);
 }
 
-inline bool GridTreeCursor::is_left_child() const{
-    //If there is a parent node and the given node is it's left child
-    return ( _currentStackIndex > 0 ) && ( _theStack[ _currentStackIndex - 1 ]->left_node() == _theStack[ _currentStackIndex ] );
+inline const BinaryTreeNode * GridTreeSubset::binary_tree() const {
+    return _pRootTreeNode;
 }
 
-inline bool GridTreeCursor::is_right_child() const{
-    //If there is a parent node and the given node is it's right child
-    return ( _currentStackIndex > 0 ) && ( _theStack[ _currentStackIndex - 1 ]->right_node() == _theStack[ _currentStackIndex ] );
+inline BinaryTreeNode * GridTreeSubset::binary_tree_for_update() {
+    return root_node_for_update();
 }
 
-inline GridTreeCursor& GridTreeCursor::move_up() {
-    if( ! is_root() ){
-        //Remove the current node from the stack
-        pop();
-        //Recompute the PavingGridCell
-        updateTheCurrentGridCell( indeterminate );
-        //Return the object back
-        return ( * this);
+inline tribool GridTreeSubset::superset( const Box& theBox ) const {
+    //Simply check if theBox is covered by the set and then make sure that
+    //all tree cells that are not disjoint from theBox are enabled
+
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    tribool isASubSet = theBox.subset( cell().box() );
+    if( ! isASubSet ) {
+        //If the box is not covered by the cell corresponding to the root node
+        //of the set, then clearly theBox is not a subset of this set.
+        return false;
     } else {
-        throw NotAllowedMoveException(ARIADNE_PRETTY_FUNCTION);
+        //Otherwise, is theBox is possibly a subset then we try to see further
+        const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( cell().dimension(), cell().height(), cell().word() );
+        return GridTreeSubset::covers( binary_tree(), grid(), cell().word().size(), theLatticeBox, theBox );
     }
 }
 
-inline GridTreeCursor& GridTreeCursor::move_left() {
-    return move(false);
+inline tribool GridTreeSubset::subset( const Box& theBox ) const {
+    //Check that the box corresponding to the root node of the set
+    //is not disjoint from theBox. If it is then the set is not a
+    //subset of theBox otherwise we need to traverse the tree and check
+    //if all it's enabled nodes give boxes that are subsets of theBox.
+
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    //The lattice box of the root cell is computed once and then halved on the way down
+    const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( cell().dimension(), cell().height(), cell().word() );
+
+    return GridTreeSubset::subset( binary_tree(), grid(), cell().word().size(), theLatticeBox, theBox );
 }
 
-inline GridTreeCursor& GridTreeCursor::move_right() {
-    return move(true);
+inline tribool GridTreeSubset::disjoint( const Box& theBox ) const {
+    //Simply check if the box does not intersect with the set
+
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    //The lattice box of the root cell is computed once and then halved on the way down
+    const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( cell().dimension(), cell().height(), cell().word() );
+
+    return GridTreeSubset::disjoint( binary_tree(), grid(), cell().word().size(), theLatticeBox, theBox );
 }
 
-inline void GridTreeCursor::updateTheCurrentGridCell( tribool left_or_right ){
-    if( ! indeterminate(left_or_right) ){
-        //Here left_or_right is either true or false, also true defines moving to the right branch
-        _theCurrentGridCell._theWord.push_back( definitely( left_or_right ) );
-    } else {
-        //If left_or_right is indeterminate, this means that we go "up"
-        //in the tree, so we remove the last bit of the path.
-        _theCurrentGridCell._theWord.pop_back();
+inline tribool GridTreeSubset::overlaps( const Box& theBox ) const {
+    //Check if the box of the root cell overlaps with theBox,
+    //if not then theBox does not intersect with the cell,
+    //otherwise we need to find at least one enabled node
+    //in the binary tree, such that it's box overlaps theBox.
+
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    //The lattice box of the root cell is computed once and then halved on the way down
+    const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( cell().dimension(), cell().height(), cell().word() );
+
+    return GridTreeSubset::overlaps( binary_tree(), grid(), cell().word().size(), theLatticeBox, theBox );
+}
+
+inline GridTreeSubset::overlapping_const_iterator GridTreeSubset::cells_overlapping( const Box& theBox ) const {
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+    return GridTreeSubset::overlapping_const_iterator( *this, theBox );
+}
+
+inline GridTreeSubset::overlapping_const_iterator GridTreeSubset::cells_overlapping_end() const {
+    return GridTreeSubset::overlapping_const_iterator();
+}
+
+template<class CellVisitor>
+inline void GridTreeSubset::cells_overlapping( const Box& theBox, CellVisitor& theVisitor ) const {
+    for( overlapping_const_iterator it = cells_overlapping( theBox ), end = cells_overlapping_end(); it != end; ++it ) {
+        theVisitor( *it );
     }
-    _theCurrentGridCell = GridCell( _theCurrentGridCell._theGrid, _theCurrentGridCell._theHeight, _theCurrentGridCell._theWord );
 }
 
-inline GridTreeCursor& GridTreeCursor::move(bool left_or_right) {
-    BinaryTreeNode* pNextNode;
-    if( ! is_leaf() ){
-        //If we are not in the leaf node then we can go down
-        if( left_or_right ){ //true moves us to the right
-            pNextNode = _theStack[ _currentStackIndex ]->right_node();
-        } else { //false moves us to the left
-            pNextNode = _theStack[ _currentStackIndex ]->left_node();
-        }
-        //Put the node into the stack
-        push(pNextNode);
-        //Recompute the PavingGridCell
-        updateTheCurrentGridCell( left_or_right );
-        //Return the object back
-        return ( * this);
-    } else {
-        throw NotAllowedMoveException(ARIADNE_PRETTY_FUNCTION);
+inline GridTreeSubset& GridTreeSubset::operator=( const GridTreeSubset &otherSubset) {
+    _pRootTreeNode = otherSubset._pRootTreeNode;
+    _theGridCell = otherSubset._theGridCell;
+    _pPavingRootNode = otherSubset._pPavingRootNode;
+    _theDepthInPaving = otherSubset._theDepthInPaving;
+
+    return *this;
+}
+
+/*********************************************GridTreeSet*********************************************/
+
+inline void GridTreeSet::adjoin( const GridCell& theCell ) {
+    ARIADNE_ASSERT( this->grid() == theCell.grid() );
+
+    bool has_stopped = false;
+    //Align the paving and the cell
+    BinaryTreeNode* pBinaryTreeNode = align_with_cell( theCell.height(), true, false, has_stopped );
+
+    //If we are not trying to adjoin something into an enabled sub cell of the paving
+    if( ! has_stopped ){
+        //Add the enabled cell to the binary tree.
+        pBinaryTreeNode->add_enabled( theCell.word() );
     }
 }
 
-inline const GridCell& GridTreeCursor::cell() const {
-    return _theCurrentGridCell;
+template<class CellIterator>
+inline void GridTreeSet::adjoin( CellIterator first, CellIterator last, const bool recombine_leaves ) {
+    const std::vector<GridCell> theCells( first, last );
+    adjoin( theCells, recombine_leaves );
 }
 
-inline bool GridTreeCursor::operator==(const GridTreeCursor& anotherGridTreeCursor) const {
-    bool areEqual = false;
-    if( (this->_currentStackIndex >=0) && (anotherGridTreeCursor._currentStackIndex >=0 ) ){
-        areEqual = (this->_theStack[this->_currentStackIndex] == anotherGridTreeCursor._theStack[anotherGridTreeCursor._currentStackIndex]);
+inline void GridTreeSet::adjoin( const GridTreeSubset& theOtherSubPaving ) {
+    ARIADNE_ASSERT_MSG( this->grid() == theOtherSubPaving.cell().grid(), "Cannot adjoin GridTreeSubset with grid "<<theOtherSubPaving.cell().grid()<<" to GridTreeSet with grid "<<this->grid() );
+
+    bool has_stopped = false;
+    //Align the paving and the cell
+    BinaryTreeNode* pBinaryTreeNode = align_with_cell( theOtherSubPaving.cell().height(), true, false, has_stopped );
+
+    //If we are not trying to adjoin something into an enabled sub cell of the paving
+    if( ! has_stopped ){
+        //Now, the pBinaryTreeNode of this paving corresponds to the primary cell common with theOtherSubPaving.
+        //The theOtherSubPaving's root node is defined the path theOtherSubPaving.word() which starts in the
+        //node corresponding to the common primary cell.
+        pBinaryTreeNode->add_enabled( theOtherSubPaving.binary_tree(), theOtherSubPaving.cell().word() );
     }
-    return areEqual;
 }
 
-inline GridTreeSubset GridTreeCursor::operator*() {
-    //IVAN S ZAPREEV:
-    //NOTE: The first three parameters define the location of the _theStack[ _currentStackIndex ]
-    //node with respect to the primary cell of the GridTreeSet.
-    return GridTreeSubset( _theCurrentGridCell._theGrid,
-                           _theCurrentGridCell._theHeight,
-                           _theCurrentGridCell._theWord,
-                           _theStack[ _currentStackIndex ] );
+
+/*****************************************FrozenGridTreeSet******************************************/
+
+inline uint FrozenGridTreeSet::popcount( word_type theWord ) {
+#ifdef __GNUC__
+    return __builtin_popcountll( theWord );
+#else
+    uint result = 0;
+    while( theWord != 0 ) {
+        //Clear the lowest one
+        theWord &= theWord - 1;
+        result++;
+    }
+    return result;
+#endif
 }
 
-inline const GridTreeSubset GridTreeCursor::operator*() const {
-    return (const GridTreeSubset & ) *(* this);
+inline bool FrozenGridTreeSet::bit( const std::vector<word_type> & theBits, const size_t pos ) {
+    return ( theBits[ pos / WORD_BITS ] >> ( pos % WORD_BITS ) ) & 1;
 }
 
-/****************************************GridTreeConstIterator************************************/
+inline uint FrozenGridTreeSet::byte( const std::vector<word_type> & theBits, const size_t pos ) {
+    return ( theBits[ pos / WORD_BITS ] >> ( pos % WORD_BITS ) ) & 0xFF;
+}
 
-inline GridTreeConstIterator::GridTreeConstIterator( const GridTreeConstIterator& theGridPavingIter ) :
-    _is_in_end_state(theGridPavingIter._is_in_end_state), _pGridTreeCursor(theGridPavingIter._pGridTreeCursor) {
-    //Copy everything
+inline size_t FrozenGridTreeSet::rank( const std::vector<word_type> & theBits, const std::vector<boost::uint32_t> & theRanks, const size_t pos ) {
+    //Take the rank of the block and add the ones of the preceding words in the block
+    const size_t word = pos / WORD_BITS;
+    size_t result = theRanks[ word / BLOCK_WORDS ];
+    for( size_t i = word - word % BLOCK_WORDS; i < word; ++i ) {
+        result += popcount( theBits[ i ] );
+    }
+    //Add the ones in the word itself, note that pos can be right after the last word
+    const uint offset = pos % WORD_BITS;
+    if( offset != 0 ) {
+        result += popcount( theBits[ word ] & ( ( word_type( 1 ) << offset ) - 1 ) );
+    }
+    return result;
 }
 
-inline GridTreeConstIterator& GridTreeConstIterator::operator=( const GridTreeConstIterator& theGridPavingIter ){
-    _is_in_end_state = theGridPavingIter._is_in_end_state;
-    _pGridTreeCursor = theGridPavingIter._pGridTreeCursor;
+inline bool FrozenGridTreeSet::is_leaf( const size_t node ) const {
+    return ! bit( _theTree, node );
+}
 
-    return *this;
+inline bool FrozenGridTreeSet::is_enabled( const size_t node ) const {
+    return is_leaf( node ) && bit( _theLeaves, leaf_index( node ) );
 }
 
-inline GridTreeConstIterator::GridTreeConstIterator( const GridTreeSubset * pSubPaving, const tribool firstLastNone ):
-    _pGridTreeCursor(pSubPaving) {
-    if( ! indeterminate( firstLastNone ) ){
-        //If the first/last enabled node is not found, it means that there are no elements
-        //to iterate on, then we switch to the "end iterator" state
-        _is_in_end_state = ! navigate_to( definitely( firstLastNone ) );
+inline size_t FrozenGridTreeSet::leaf_index( const size_t node ) const {
+    //The nodes in front of node that are not leaves are the ones in the structure bits
+    return node - rank( _theTree, _theTreeRanks, node );
+}
+
+inline size_t FrozenGridTreeSet::left_node( const size_t node ) const {
+    return node + 1;
+}
+
+inline size_t FrozenGridTreeSet::right_node( const size_t node ) const {
+    return subtree_end( node + 1 ) + 1;
+}
+
+inline size_t FrozenGridTreeSet::count_enabled_leaf_nodes( const size_t node ) const {
+    return rank( _theLeaves, _theLeafRanks, leaf_index( subtree_end( node ) + 1 ) ) -
+           rank( _theLeaves, _theLeafRanks, leaf_index( node ) );
+}
+
+inline bool FrozenGridTreeSet::has_enabled( const size_t node ) const {
+    return is_leaf( node ) ? is_enabled( node ) : ( count_enabled_leaf_nodes( node ) > 0 );
+}
+
+inline bool FrozenGridTreeSet::all_enabled( const size_t node ) const {
+    if( is_leaf( node ) ) {
+        return is_enabled( node );
     } else {
-        //In this case if we do nothing, the cursor in the iterator will point to the root node
-        //Since this can be the only node in the tree we should add a marker that indicates that
-        //the iterator is at the end state.
-        _is_in_end_state = true;
+        //All leaves of the subtree are enabled if there are as many enabled leaves as there are leaves
+        const size_t theFirstLeaf = leaf_index( node );
+        const size_t theEndLeaf = leaf_index( subtree_end( node ) + 1 );
+        return rank( _theLeaves, _theLeafRanks, theEndLeaf ) - rank( _theLeaves, _theLeafRanks, theFirstLeaf ) == theEndLeaf - theFirstLeaf;
     }
 }
 
-inline void GridTreeConstIterator::increment() {
-    //If we are not done iterating
-    if( ! _is_in_end_state){
-        //We are at some enabled-leaf node and we want to find the next one.
-        //The next node is somewhere on the right in the tree.
-        find_next_enabled_leaf();
-    }
+inline bool FrozenGridTreeSet::empty() const {
+    return size() == 0;
 }
 
-inline GridTreeConstIterator::~GridTreeConstIterator() {
-    //IVAN S ZAPREEV:
-    //WARNING: There are no memory allocations in this class that have to be cleaned
+inline size_t FrozenGridTreeSet::size() const {
+    //The padding of the leaf bits is zero, so the last rank is the number of enabled leaves
+    return _theLeafRanks.back();
 }
 
-inline bool GridTreeConstIterator::equal( GridTreeConstIterator const & theOtherIterator) const {
-    //Check if both iterators are in the "end iterator" state
-    bool result = theOtherIterator._is_in_end_state && this->_is_in_end_state;
+inline uint FrozenGridTreeSet::dimension() const {
+    return grid().dimension();
+}
 
-    //If not then check if the cursors are equal (i.e. if they point to the same binary-tree node of the same (subpaving)
-    if( ! result ){
-        if( theOtherIterator._is_in_end_state || this->_is_in_end_state ){
-            //If at one is in the end state and the other is not then the answer is FALSE
-            result = false;
-        } else {
-            result = theOtherIterator._pGridTreeCursor == this->_pGridTreeCursor;
-        }
-    }
+inline const Grid& FrozenGridTreeSet::grid() const {
+    return _theGridCell.grid();
+}
 
-    return result;
+inline GridCell FrozenGridTreeSet::cell() const {
+    return _theGridCell;
 }
 
-inline GridCell const& GridTreeConstIterator::dereference() const {
-    return _pGridTreeCursor.cell();
+inline size_t FrozenGridTreeSet::node_count() const {
+    return _theNodeCount;
 }
 
-inline GridTreeCursor const& GridTreeConstIterator::cursor() const {
-    return _pGridTreeCursor;
+inline size_t FrozenGridTreeSet::memory() const {
+    return ( _theTree.size() + _theLeaves.size() ) * sizeof( word_type ) +
+           ( _theTreeRanks.size() + _theLeafRanks.size() ) * sizeof( boost::uint32_t ) +
+           _theRangeMinExcess.size() * sizeof( int );
 }
 
-/*****************************************GridAbstractCell*******************************************/
+inline bool FrozenGridTreeSet::operator==( const FrozenGridTreeSet& anotherFrozenGridTreeSet ) const {
+    //The padding is zero in both sets, so equal trees give equal words
+    return ( this->_theGridCell == anotherFrozenGridTreeSet._theGridCell ) &&
+           ( this->_theNodeCount == anotherFrozenGridTreeSet._theNodeCount ) &&
+           ( this->_theTree == anotherFrozenGridTreeSet._theTree ) &&
+           ( this->_theLeaves == anotherFrozenGridTreeSet._theLeaves );
+}
 
-inline GridAbstractCell::GridAbstractCell(const GridAbstractCell& theGridCell):
-    _theGrid(theGridCell._theGrid), _theHeight(theGridCell._theHeight),
-    _theWord(theGridCell._theWord), _theBox(theGridCell._theBox) {
+inline tribool FrozenGridTreeSet::subset( const FrozenGridTreeSet& other ) const {
+    return Ariadne::subset(*this, other);
 }
 
-inline GridAbstractCell::GridAbstractCell(const Grid& theGrid, const uint theHeight,
-                                            const BinaryWord& theWord, const Box& theBox):
-    _theGrid(theGrid), _theHeight(theHeight),
-    _theWord(theWord), _theBox(theBox) {
+inline tribool FrozenGridTreeSet::superset( const FrozenGridTreeSet& other ) const {
+    return Ariadne::superset(*this, other);
 }
 
-inline void GridAbstractCell::primary_cell_at_height( const uint theHeight, int & leftBottomCorner, int & rightTopCorner ) {
-    if ( theHeight % 2 == 1 ) {
-        leftBottomCorner = 2*leftBottomCorner - rightTopCorner;
-    } else {
-        rightTopCorner   = 2*rightTopCorner - leftBottomCorner;
-    }
+inline tribool FrozenGridTreeSet::disjoint( const FrozenGridTreeSet& other ) const {
+    return Ariadne::disjoint(*this, other);
 }
 
-inline const Grid& GridAbstractCell::grid() const {
-    return _theGrid;
+inline tribool FrozenGridTreeSet::overlaps( const FrozenGridTreeSet& other ) const {
+    return Ariadne::overlap(*this, other);
 }
 
-inline uint GridAbstractCell::height() const {
-    return _theHeight;
+inline FrozenGridTreeSet::const_iterator FrozenGridTreeSet::begin() const {
+    return FrozenGridTreeSet::const_iterator( this, true );
 }
 
-inline int GridAbstractCell::depth() const {
-    return _theWord.size() - _theHeight;
+inline FrozenGridTreeSet::const_iterator FrozenGridTreeSet::end() const {
+    return FrozenGridTreeSet::const_iterator( this, false );
 }
 
-inline const BinaryWord& GridAbstractCell::word() const {
-    return _theWord;
+/*************************************FrozenGridTreeConstIterator************************************/
+
+inline FrozenGridTreeConstIterator::FrozenGridTreeConstIterator( ) : _pSet( NULL ), _theNode( 0 ), _theLeaf( 0 ) {
 }
 
-inline const Box& GridAbstractCell::box() const {
-    return _theBox;
+inline FrozenGridTreeConstIterator::FrozenGridTreeConstIterator( const FrozenGridTreeSet * pSet, const bool isBegin ) :
+    _pSet( pSet ), _theNode( isBegin ? FrozenGridTreeSet::ROOT : pSet->_theNodeCount ), _theLeaf( isBegin ? 0 : pSet->_theLeafCount ) {
+    if( isBegin ) {
+        find_next_enabled_leaf();
+    }
+}
+
+inline void FrozenGridTreeConstIterator::skip_leaf() {
+    _theNode++;
+    _theLeaf++;
+    //The next node is the right sibling of the closest ancestor (or the leaf itself) that
+    //is a left sub-node, so drop the right turns at the end of the path and turn right
+    while( ( _thePath.size() > 0 ) && _thePath[ _thePath.size() - 1 ] ) {
+        _thePath.pop_back();
+    }
+    if( _thePath.size() > 0 ) {
+        _thePath.pop_back();
+        _thePath.push_back( true );
+    }
+}
+
+inline void FrozenGridTreeConstIterator::increment() {
+    //If we are not done iterating
+    if( _theNode < _pSet->_theNodeCount ) {
+        skip_leaf();
+        find_next_enabled_leaf();
+    }
 }
 
-inline dimension_type GridAbstractCell::dimension() const {
-    return _theGrid.dimension();
+inline bool FrozenGridTreeConstIterator::equal( FrozenGridTreeConstIterator const & theOtherIterator) const {
+    const bool isThisAtEnd = ( this->_pSet == NULL ) || ( this->_theNode == this->_pSet->_theNodeCount );
+    const bool isOtherAtEnd = ( theOtherIterator._pSet == NULL ) || ( theOtherIterator._theNode == theOtherIterator._pSet->_theNodeCount );
+    if( isThisAtEnd || isOtherAtEnd ) {
+        return isThisAtEnd && isOtherAtEnd;
+    } else {
+        return ( this->_pSet == theOtherIterator._pSet ) && ( this->_theNode == theOtherIterator._theNode );
+    }
 }
 
-inline Interval GridAbstractCell::operator[](dimension_type i) const {
-    return _theBox[i];
+inline GridCell const& FrozenGridTreeConstIterator::dereference() const {
+    return _theCurrentGridCell;
 }
 
-/*****************************************GridAbstractCell*******************************************/
-
-inline GridAbstractCell& GridAbstractCell::operator=(const GridAbstractCell & otherCell ) {
-    _theGrid = otherCell._theGrid;
-    _theHeight = otherCell._theHeight;
-    _theWord = otherCell._theWord;
-    _theBox = otherCell._theBox;
+/*****************************************MortonGridTreeSet******************************************/
 
-    return *this;
+inline MortonGridTreeSet::code_type MortonGridTreeSet::Key::last() const {
+    return ( depth >= MAX_DEPTH ) ? code : ( code | ( ~code_type(0) >> depth ) );
 }
 
-/*********************************************GridCell***********************************************/
-
-inline GridCell::GridCell() : GridAbstractCell( Grid(), 0, BinaryWord(), Box() ) {
+inline MortonGridTreeSet::Key MortonGridTreeSet::Key::child( const bool isRight ) const {
+    ARIADNE_ASSERT( depth < MAX_DEPTH );
+    Key theChild;
+    theChild.code = isRight ? ( code | ( code_type(1) << ( MAX_DEPTH - 1 - depth ) ) ) : code;
+    theChild.depth = depth + 1;
+    return theChild;
 }
 
-inline GridCell::GridCell(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord) :
-                    GridAbstractCell( theGrid, theHeight, theWord, compute_box(theGrid, theHeight, theWord) ) {
+inline bool MortonGridTreeSet::Key::operator<( const Key& otherKey ) const {
+    return ( code < otherKey.code ) || ( ( code == otherKey.code ) && ( depth < otherKey.depth ) );
 }
 
-inline GridCell& GridCell::operator=(const GridCell & otherCell ) {
-    GridAbstractCell::operator=(otherCell);
-    return *this;
+inline bool MortonGridTreeSet::Key::operator==( const Key& otherKey ) const {
+    return ( code == otherKey.code ) && ( depth == otherKey.depth );
 }
 
-inline bool GridCell::operator==( const GridCell& other ) const {
-    return compare_grid_cells( this, other, COMPARE_EQUAL );
+inline bool MortonGridTreeSet::empty() const {
+    return _theKeys.empty();
 }
 
-inline bool GridCell::operator<(const GridCell& other) const {
-    return compare_grid_cells( this, other, COMPARE_LESS );
+inline size_t MortonGridTreeSet::size() const {
+    return _theKeys.size();
 }
 
-inline bool GridCell::compare_grid_cells(const GridCell * pCellLeft, const GridCell &cellRight, const uint comparator ) {
-    return GridAbstractCell::compare_abstract_grid_cells( pCellLeft, cellRight, comparator );
+inline uint MortonGridTreeSet::dimension() const {
+    return _theGrid.dimension();
 }
 
-//The box is not related to the Grid, i.e. it is in the original space, whereas the binary tree is related to the Lattice of the grid:
-inline Box GridCell::compute_box(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord) {
-    //Compute the lattice box and then map it to the original space using the grid data
-    return lattice_box_to_space( GridCell::compute_lattice_box( theGrid.dimension(), theHeight, theWord ), theGrid );
+inline const Grid& MortonGridTreeSet::grid() const {
+    return _theGrid;
 }
 
-/*********************************************GridOpenCell***********************************************/
-
-inline GridOpenCell::GridOpenCell(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord, const Box& theBox) :
-                            GridAbstractCell(theGrid, theHeight, theWord, theBox) {
+inline uint MortonGridTreeSet::height() const {
+    return _theHeight;
 }
 
-inline GridOpenCell::GridOpenCell() : GridAbstractCell( Grid(), 0, BinaryWord(), compute_box(Grid(), 0, BinaryWord()) ) {
+inline const std::vector<MortonGridTreeSet::Key>& MortonGridTreeSet::keys() const {
+    return _theKeys;
 }
 
-inline GridOpenCell::GridOpenCell(const Grid& theGrid, const uint theHeight, const BinaryWord& theWord) :
-                    GridAbstractCell( theGrid, theHeight, theWord, compute_box(theGrid, theHeight, theWord) ) {
+inline size_t MortonGridTreeSet::memory() const {
+    return _theKeys.capacity() * sizeof( Key );
 }
 
-inline GridOpenCell& GridOpenCell::operator=(const GridOpenCell & otherCell ) {
-    GridAbstractCell::operator=(otherCell);
-    return *this;
+
+/*******************************************GridCellCursor*******************************************/
+
+inline GridCellCursor::GridCellCursor( const GridCell& theCell, const uint theHeight ) :
+    _theDimension( theCell.dimension() ), _theHeight( theHeight ), _theCellHeight( theCell.height() ),
+    _pWord( &theCell.word() ), _thePosition( 0 ), _isOutside( false ) {
+    ARIADNE_ASSERT( theHeight >= theCell.height() );
 }
 
-inline bool GridOpenCell::operator==( const GridOpenCell& other ) const {
-    return compare_grid_cells( this, other, COMPARE_EQUAL );
+inline uint GridCellCursor::path_length() const {
+    return ( _theHeight - _theCellHeight ) * _theDimension + _pWord->size();
 }
 
-inline bool GridOpenCell::operator<(const GridOpenCell& other) const {
-    return compare_grid_cells( this, other, COMPARE_LESS );
+inline bool GridCellCursor::path_step( const uint position ) const {
+    //The path between the primary cells consists of runs of length _theDimension,
+    //the run for an odd height consists of ones, see GridCell::primary_cell_path
+    const uint primaryPathLength = ( _theHeight - _theCellHeight ) * _theDimension;
+    if( position < primaryPathLength ) {
+        return ( ( _theHeight - position / _theDimension ) % 2 ) != 0;
+    }
+    return ( *_pWord )[ position - primaryPathLength ];
 }
 
-inline bool GridOpenCell::compare_grid_cells(const GridOpenCell * pCellLeft, const GridOpenCell &cellRight, const uint comparator ) {
-    return GridAbstractCell::compare_abstract_grid_cells( pCellLeft, cellRight, comparator );
+inline tribool GridCellCursor::value() const {
+    if( _isOutside ) {
+        return false;
+    }
+    if( _thePosition == path_length() ) {
+        return true;
+    }
+    return indeterminate;
 }
 
-inline bool GridOpenCell::overlap( const GridOpenCell & theLeftOpenCell, const GridOpenCell & theRightOpenCell ) {
-    return definitely( theLeftOpenCell.box().overlaps(  theRightOpenCell.box() ) );
+inline GridCellCursor GridCellCursor::child( const bool isRight ) const {
+    GridCellCursor theChild( *this );
+    if( ! _isOutside && ( _thePosition < path_length() ) ) {
+        if( path_step( _thePosition ) == isRight ) {
+            theChild._thePosition++;
+        } else {
+            theChild._isOutside = true;
+        }
+    }
+    return theChild;
 }
 
-/********************************************GridTreeSubset******************************************/
+/******************************************GridSubsetCursor******************************************/
 
-inline GridTreeSubset::GridTreeSubset( const Grid& theGrid, const uint theHeight,
-                                       const BinaryWord& theWord, BinaryTreeNode * pRootTreeNode ) :
-                                       _pRootTreeNode(pRootTreeNode), _theGridCell(theGrid, theHeight, theWord) {
+inline GridSubsetCursor::GridSubsetCursor( const GridCell& theCell, const BinaryTreeNode * pRootTreeNode, const uint theHeight ) :
+    _theRootCursor( theCell, theHeight ), _pNode( pRootTreeNode ) {
 }
 
-inline GridTreeSubset::GridTreeSubset( const GridTreeSubset &otherSubset ) : _pRootTreeNode(otherSubset._pRootTreeNode),
-                                                                             _theGridCell(otherSubset._theGridCell) {
+inline tribool GridSubsetCursor::value() const {
+    const tribool isInRootCell = _theRootCursor.value();
+    if( definitely( isInRootCell ) ) {
+        //Within the root cell the tree decides
+        if( _pNode->is_leaf() ) {
+            return _pNode->is_enabled();
+        }
+        return indeterminate;
+    }
+    if( ! possibly( isInRootCell ) || _pNode->is_disabled() ) {
+        //Outside of the root cell, or on the path to an empty root cell
+        return false;
+    }
+    return indeterminate;
 }
 
-inline GridTreeSubset::~GridTreeSubset() {
-    //IVAN S ZAPREEV:
-    //WARNING: This method should have no implementation what so ever
-    //All the dynamically allocated data should be destroyed from the
-    //corresponding Paving object
+inline GridSubsetCursor GridSubsetCursor::child( const bool isRight ) const {
+    GridSubsetCursor theChild( *this );
+    if( definitely( _theRootCursor.value() ) ) {
+        //The leaves keep their values in the halves of the cell
+        if( ! _pNode->is_leaf() ) {
+            theChild._pNode = isRight ? _pNode->right_node() : _pNode->left_node();
+        }
+    } else {
+        theChild._theRootCursor = _theRootCursor.child( isRight );
+    }
+    return theChild;
 }
 
-inline uint GridTreeSubset::compute_number_subdiv( Float theWidth, const Float theMaxWidth) const{
-    //Compute the minimum number of subdivisions N as:
-    //   minimum N : ( theWidth / 2^{N} ) <= theMaxWidth
-    //This is equivalent to (because all values are positive)
-    //   minimum N : theWidth / theMaxWidth <= 2^{N}
-    //log is a continuous-increasing function, thus the latter is
-    //equivalent to (since 0 < theMaxWidth, theWidth < infinite )
-    //   minimum N : log( theWidth / theMaxWidth ) <= N
-    //In computations then we need to take
-    //   N = ceil( log( theWidth / theMaxWidth ) )
+/******************************************GridBinaryCursor******************************************/
 
-    //IVAN S ZAPREEV:
-    //NOTE: We take log_approx, log_approx because if we use _up and _down versions to maximize the answer,
-    //then it might become very inaccurate, and in case require more subdivisions than needed.
-    //NOTE: We need base 2 logarithm, we get it by the rule: log_a(b)/log_a(c) = log_c(a)
-    //PIETER COLLINS:
-    //NOTE: Float now uses approximate operators by default
-    uint result = 0;
-    if ( theWidth > theMaxWidth ){
-        //result = (uint) ceil( div_approx( log_approx( div_approx( theWidth, theMaxWidth ) ) , log_approx( R(2.0) ) ) );
-        result = (uint) ceil( Ariadne::div( Ariadne::log( Ariadne::div( theWidth, theMaxWidth ) ) , Ariadne::log( 2.0 ) ) );
-    }
-    return result;
+template<class C1, class C2, class OP>
+inline GridBinaryCursor<C1, C2, OP>::GridBinaryCursor( const C1& theCursor1, const C2& theCursor2 ) :
+    _theCursor1( theCursor1 ), _theCursor2( theCursor2 ) {
 }
 
-inline bool GridTreeSubset::empty() const {
-    return BinaryTreeNode::count_enabled_leaf_nodes( this->binary_tree() ) == 0;
+template<class C1, class C2, class OP>
+inline tribool GridBinaryCursor<C1, C2, OP>::value() const {
+    return OP::apply( _theCursor1.value(), _theCursor2.value() );
 }
 
-inline size_t GridTreeSubset::size() const {
-    return BinaryTreeNode::count_enabled_leaf_nodes( this->binary_tree() );
+template<class C1, class C2, class OP>
+inline GridBinaryCursor<C1, C2, OP> GridBinaryCursor<C1, C2, OP>::child( const bool isRight ) const {
+    return GridBinaryCursor<C1, C2, OP>( _theCursor1.child( isRight ), _theCursor2.child( isRight ) );
 }
 
-inline uint GridTreeSubset::dimension( ) const {
-    return grid().dimension();
+inline tribool GridJoinOperation::apply( const tribool value1, const tribool value2 ) {
+    return value1 || value2;
 }
 
-
-inline const Grid& GridTreeSubset::grid() const {
-    return this->_theGridCell.grid();
+inline tribool GridIntersectionOperation::apply( const tribool value1, const tribool value2 ) {
+    return value1 && value2;
 }
 
-inline GridCell GridTreeSubset::cell() const {
-    return _theGridCell;
+inline tribool GridDifferenceOperation::apply( const tribool value1, const tribool value2 ) {
+    return value1 && ! value2;
 }
 
-inline Box GridTreeSubset::bounding_box() const {
-    if(this->empty()) return Box::empty_box(this->dimension());
+/******************************************GridSetExpression*****************************************/
 
-    GridTreeSet::const_iterator iter=this->begin();
-    Box bbox = iter->box();
+template<class E>
+inline const E& GridSetExpression<E>::expression() const {
+    return static_cast<const E&>( *this );
+}
 
-    for( ; iter!=this->end(); ++iter) {
-        Box cell = iter->box();
-        for(uint i = 0; i < cell.dimension(); ++i) {
-            if(cell[i].lower() < bbox[i].lower()) bbox[i].set_lower(cell[i].lower());
-            if(cell[i].upper() > bbox[i].upper()) bbox[i].set_upper(cell[i].upper());
-        }
-    }
+template<class E>
+GridTreeSet GridSetExpression<E>::evaluate() const {
+    const uint theHeight = expression().height();
+    BinaryTreeNode * pRootTreeNode = new BinaryTreeNode( false );
+    evaluate_node( pRootTreeNode, expression().cursor( theHeight ) );
+    return GridTreeSet( expression().grid(), theHeight, pRootTreeNode );
+}
 
-    return bbox;
+template<class E>
+size_t GridSetExpression<E>::size() const {
+    return count_cells( expression().cursor( expression().height() ) );
+}
 
+template<class E>
+bool GridSetExpression<E>::empty() const {
+    return ! has_cells( expression().cursor( expression().height() ) );
 }
 
-inline int GridTreeSubset::zero_cell_subdivisions_to_tree_subdivisions( const uint numSubdivInDim, const uint primaryCellHeight,
-                                                                        const uint primaryToRootCellPathLength ) const {
-    //Here we take the height of the primary cell that the subpaving's root cell is rooted to
-    //This height times the number of dimensions is the number of subdivisions to make in
-    //the primary cell to reach the level of the zero cell. This plus the numSubdivInDim 
-    //times the number of dimensions gives us the total number of the primary cell we have
-    //to make. But, the given paving is has the root node different from the primary cell,
-    //thus we have to subtract the length of the path from the primary cell to the root cell
-    //of this subpaving, to get the proper number of subdivisions to make in the binary tree
-    int theNewDepth = ( primaryCellHeight + numSubdivInDim ) * _theGridCell.grid().dimension() - primaryToRootCellPathLength;
-    //If the new depth is not positive then we already have the required number
-    //of subdivisions so then nothing has to be done, so we return zero!
-    return (theNewDepth > 0) ? theNewDepth : 0;
+template<class E>
+inline typename GridSetExpression<E>::const_iterator GridSetExpression<E>::begin() const {
+    return const_iterator( expression() );
 }
 
-inline void GridTreeSubset::mince( const uint numSubdivInDim ) {
-    mince_to_tree_depth( zero_cell_subdivisions_to_tree_subdivisions( numSubdivInDim, _theGridCell.height(), _theGridCell.word().size() ) );
+template<class E>
+inline typename GridSetExpression<E>::const_iterator GridSetExpression<E>::end() const {
+    return const_iterator();
 }
 
-inline void GridTreeSubset::mince_to_tree_depth( const uint theNewDepth ) {
-    _pRootTreeNode->mince( theNewDepth );
+template<class E> template<class C>
+void GridSetExpression<E>::evaluate_node( BinaryTreeNode * pNode, const C& theCursor ) {
+    const tribool theValue = theCursor.value();
+    if( definitely( theValue ) ) {
+        pNode->set_enabled();
+    } else if( possibly( theValue ) ) {
+        pNode->split();
+        evaluate_node( pNode->left_node(), theCursor.child( false ) );
+        evaluate_node( pNode->right_node(), theCursor.child( true ) );
+        if( pNode->left_node()->is_disabled() && pNode->right_node()->is_disabled() ) {
+            //Nothing was found below, e.g. the operands did not overlap
+            pNode->make_leaf( false );
+        }
+    }
 }
 
-inline void GridTreeSubset::recombine() {
-    _pRootTreeNode->recombine();
+template<class E> template<class C>
+size_t GridSetExpression<E>::count_cells( const C& theCursor ) {
+    const tribool theValue = theCursor.value();
+    if( definitely( theValue ) ) {
+        return 1;
+    } else if( possibly( theValue ) ) {
+        return count_cells( theCursor.child( false ) ) + count_cells( theCursor.child( true ) );
+    }
+    return 0;
 }
 
-inline uint GridTreeSubset::depth() const {
-    return _pRootTreeNode->depth();
+template<class E> template<class C>
+bool GridSetExpression<E>::has_cells( const C& theCursor ) {
+    const tribool theValue = theCursor.value();
+    if( definitely( theValue ) ) {
+        return true;
+    } else if( possibly( theValue ) ) {
+        return has_cells( theCursor.child( false ) ) || has_cells( theCursor.child( true ) );
+    }
+    return false;
 }
 
-inline bool GridTreeSubset::operator==(const GridTreeSubset& anotherGridTreeSubset) const {
-    return ( this->_theGridCell == anotherGridTreeSubset._theGridCell ) &&
-        ( ( * this->_pRootTreeNode ) == ( * anotherGridTreeSubset._pRootTreeNode ) );
+/****************************************GridSubsetExpression****************************************/
+
+inline GridSubsetExpression::GridSubsetExpression( const GridTreeSubset& theSet ) :
+    _pRootTreeNode( theSet.binary_tree() ), _theCell( theSet.cell() ) {
 }
 
-inline GridTreeSubset::const_iterator GridTreeSubset::begin() const {
-    return GridTreeSubset::const_iterator(this, true);
+inline const Grid& GridSubsetExpression::grid() const {
+    return _theCell.grid();
 }
 
-inline GridTreeSubset::const_iterator GridTreeSubset::end() const {
-    return GridTreeSubset::const_iterator(this, indeterminate);
+inline uint GridSubsetExpression::height() const {
+    return _theCell.height();
 }
 
-inline const BinaryTreeNode * GridTreeSubset::binary_tree() const {
-    return _pRootTreeNode;
+inline GridSubsetExpression::cursor_type GridSubsetExpression::cursor( const uint theHeight ) const {
+    return cursor_type( _theCell, _pRootTreeNode, theHeight );
 }
 
-inline tribool GridTreeSubset::superset( const Box& theBox ) const {
-    //Simply check if theBox is covered by the set and then make sure that
-    //all tree cells that are not disjoint from theBox are enabled
+/****************************************GridBinaryExpression****************************************/
 
-    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+template<class E1, class E2, class OP>
+inline GridBinaryExpression<E1, E2, OP>::GridBinaryExpression( const E1& theExpression1, const E2& theExpression2 ) :
+    _theExpression1( theExpression1 ), _theExpression2( theExpression2 ) {
+    ARIADNE_ASSERT( theExpression1.grid() == theExpression2.grid() );
+}
 
-    tribool isASubSet = theBox.subset( cell().box() );
-    if( ! isASubSet ) {
-        //If the box is not covered by the cell corresponding to the root node
-        //of the set, then clearly theBox is not a subset of this set.
-        return false;
-    } else {
-        //Otherwise, is theBox is possibly a subset then we try to see further
-        BinaryWord pathCopy( cell().word() );
-        return GridTreeSubset::covers( binary_tree(), grid(), cell().height(), pathCopy, theBox );
-    }
+template<class E1, class E2, class OP>
+inline const Grid& GridBinaryExpression<E1, E2, OP>::grid() const {
+    return _theExpression1.grid();
 }
 
-inline tribool GridTreeSubset::subset( const Box& theBox ) const {
-    //Check that the box corresponding to the root node of the set
-    //is not disjoint from theBox. If it is then the set is not a
-    //subset of theBox otherwise we need to traverse the tree and check
-    //if all it's enabled nodes give boxes that are subsets of theBox.
+template<class E1, class E2, class OP>
+inline uint GridBinaryExpression<E1, E2, OP>::height() const {
+    return std::max( _theExpression1.height(), _theExpression2.height() );
+}
 
-    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+template<class E1, class E2, class OP>
+inline typename GridBinaryExpression<E1, E2, OP>::cursor_type GridBinaryExpression<E1, E2, OP>::cursor( const uint theHeight ) const {
+    return cursor_type( _theExpression1.cursor( theHeight ), _theExpression2.cursor( theHeight ) );
+}
 
-    BinaryWord pathCopy( cell().word() );
+/**************************************GridComplementExpression**************************************/
 
-    return GridTreeSubset::subset( binary_tree(), grid(), cell().height(), pathCopy, theBox );
+template<class E>
+inline GridComplementExpression<E>::GridComplementExpression( const E& theExpression, const GridCell& theCell ) :
+    _theExpression( theExpression ), _theCell( theCell ) {
+    ARIADNE_ASSERT( theExpression.grid() == theCell.grid() );
 }
 
-inline tribool GridTreeSubset::disjoint( const Box& theBox ) const {
-    //Simply check if the box does not intersect with the set
-
-    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+template<class E>
+inline const Grid& GridComplementExpression<E>::grid() const {
+    return _theCell.grid();
+}
 
-    BinaryWord pathCopy( cell().word() );
+template<class E>
+inline uint GridComplementExpression<E>::height() const {
+    return std::max( _theCell.height(), _theExpression.height() );
+}
 
-    return GridTreeSubset::disjoint( binary_tree(), grid(), cell().height(), pathCopy, theBox );
+template<class E>
+inline typename GridComplementExpression<E>::cursor_type GridComplementExpression<E>::cursor( const uint theHeight ) const {
+    return cursor_type( GridCellCursor( _theCell, theHeight ), _theExpression.cursor( theHeight ) );
 }
 
-inline tribool GridTreeSubset::overlaps( const Box& theBox ) const {
-    //Check if the box of the root cell overlaps with theBox,
-    //if not then theBox does not intersect with the cell,
-    //otherwise we need to find at least one enabled node
-    //in the binary tree, such that it's box overlaps theBox.
+/***********************************GridSetExpressionConstIterator***********************************/
 
-    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+template<class E>
+inline GridSetExpressionConstIterator<E>::GridSetExpressionConstIterator() : _pGrid( NULL ), _theHeight( 0 ) {
+}
 
-    BinaryWord pathCopy( cell().word() );
+template<class E>
+GridSetExpressionConstIterator<E>::GridSetExpressionConstIterator( const E& theExpression ) :
+    _pGrid( &theExpression.grid() ), _theHeight( theExpression.height() ) {
+    StackEntry theRoot = { theExpression.cursor( _theHeight ), 0, false };
+    _theStack.push_back( theRoot );
+    find_next_cell();
+}
 
-    return GridTreeSubset::overlaps( binary_tree(), grid(), cell().height(), pathCopy, theBox );
+template<class E>
+void GridSetExpressionConstIterator<E>::find_next_cell() {
+    while( ! _theStack.empty() ) {
+        const StackEntry theEntry = _theStack.back();
+        _theStack.pop_back();
+        //Go back up to the parent of the position and take the step to it
+        if( theEntry.depth > 0 ) {
+            while( _theWord.size() >= theEntry.depth ) {
+                _theWord.pop_back();
+            }
+            _theWord.push_back( theEntry.isRight );
+        }
+        const tribool theValue = theEntry.cursor.value();
+        if( definitely( theValue ) ) {
+            _theCurrentCell = GridCell( *_pGrid, _theHeight, _theWord );
+            return;
+        } else if( possibly( theValue ) ) {
+            //The left half is visited first
+            StackEntry theRight = { theEntry.cursor.child( true ), theEntry.depth + 1, true };
+            StackEntry theLeft = { theEntry.cursor.child( false ), theEntry.depth + 1, false };
+            _theStack.push_back( theRight );
+            _theStack.push_back( theLeft );
+        }
+    }
+    //There are no more cells, this is the end iterator now
+    _pGrid = NULL;
 }
 
-inline GridTreeSubset& GridTreeSubset::operator=( const GridTreeSubset &otherSubset) {
-    _pRootTreeNode = otherSubset._pRootTreeNode;
-    _theGridCell = otherSubset._theGridCell;
+template<class E>
+inline void GridSetExpressionConstIterator<E>::increment() {
+    find_next_cell();
+}
 
-    return *this;
+template<class E>
+inline bool GridSetExpressionConstIterator<E>::equal( GridSetExpressionConstIterator<E> const & theOtherIterator ) const {
+    if( ( _pGrid == NULL ) || ( theOtherIterator._pGrid == NULL ) ) {
+        return _pGrid == theOtherIterator._pGrid;
+    }
+    return _theCurrentCell == theOtherIterator._theCurrentCell;
 }
 
-/*********************************************GridTreeSet*********************************************/
+template<class E>
+inline GridCell const& GridSetExpressionConstIterator<E>::dereference() const {
+    return _theCurrentCell;
+}
 
-inline void GridTreeSet::adjoin( const GridCell& theCell ) {
-    ARIADNE_ASSERT( this->grid() == theCell.grid() );
+/*************************************FRIENDS OF FrozenGridTreeSet**************************************/
 
-    bool has_stopped = false;
-    //Align the paving and the cell
-    BinaryTreeNode* pBinaryTreeNode = align_with_cell( theCell.height(), true, false, has_stopped );
+inline std::ostream& operator<<(std::ostream& os, const FrozenGridTreeSet& theFrozenGridTreeSet) {
+    return os << "FrozenGridTreeSet( Root cell: " << theFrozenGridTreeSet.cell() << ", Nodes: " << theFrozenGridTreeSet.node_count() <<
+        ", Enabled cells: " << theFrozenGridTreeSet.size() << " )";
+}
 
-    //If we are not trying to adjoin something into an enabled sub cell of the paving
-    if( ! has_stopped ){
-        //Add the enabled cell to the binary tree.
-        pBinaryTreeNode->add_enabled( theCell.word() );
-    }
+inline bool superset( const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2 ) {
+    return subset(theSet2, theSet1);
 }
 
-inline void GridTreeSet::adjoin( const GridTreeSubset& theOtherSubPaving ) {
-    ARIADNE_ASSERT_MSG( this->grid() == theOtherSubPaving.cell().grid(), "Cannot adjoin GridTreeSubset with grid "<<theOtherSubPaving.cell().grid()<<" to GridTreeSet with grid "<<this->grid() );
+inline bool disjoint( const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2 ) {
+    return !overlap(theSet1, theSet2);
+}
 
-    bool has_stopped = false;
-    //Align the paving and the cell
-    BinaryTreeNode* pBinaryTreeNode = align_with_cell( theOtherSubPaving.cell().height(), true, false, has_stopped );
+/*************************************FRIENDS OF MortonGridTreeSet**************************************/
 
-    //If we are not trying to adjoin something into an enabled sub cell of the paving
-    if( ! has_stopped ){
-        //Now, the pBinaryTreeNode of this paving corresponds to the primary cell common with theOtherSubPaving.
-        //The theOtherSubPaving's root node is defined the path theOtherSubPaving.word() which starts in the
-        //node corresponding to the common primary cell.
-        pBinaryTreeNode->add_enabled( theOtherSubPaving.binary_tree(), theOtherSubPaving.cell().word() );
-    }
+inline std::ostream& operator<<(std::ostream& os, const MortonGridTreeSet& theMortonGridTreeSet) {
+    return os << "MortonGridTreeSet( Primary cell height: " << theMortonGridTreeSet.height() <<
+        ", Enabled cells: " << theMortonGridTreeSet.size() << " )";
 }
 
-
 /**************************************FRIENDS OF BinaryTreeNode***************************************/
 
 /*! \brief Stream insertion operator, prints out two binary arrays, one is the tree structure
@@ -2371,6 +5166,18 @@ inline std::ostream& operator<<(std::ostream& output_stream, const BinaryTreeNod
     return output_stream << "BinaryTreeNode( Tree: " << tree << ", Leaves: " << leaves << ")";
 }
 
+inline std::ostream& operator<<(std::ostream& output_stream, const CompactBinaryTree & binary_tree ) {
+    BinaryWord tree, leaves;
+    binary_tree.tree_to_binary_words( tree, leaves );
+    return output_stream << "CompactBinaryTree( Tree: " << tree << ", Leaves: " << leaves << ")";
+}
+
+/**************************************FRIENDS OF PackedBinaryWord*************************************/
+
+inline std::ostream& operator<<(std::ostream& os, const PackedBinaryWord& theWord ) {
+    return os << theWord.to_binary_word();
+}
+
 /****************************************FRIENDS OF GridOpenCell*******************************************/
 
 inline std::ostream& operator<<(std::ostream& os, const GridOpenCell& theGridOpenCell ) {
@@ -2427,6 +5234,10 @@ inline std::ostream& operator<<(std::ostream& os, const GridTreeSet& theGridTree
     return os << "GridTreeSet( " << theGridTreeSubset << " )";
 }
 
+inline void swap( GridTreeSet& theSet1, GridTreeSet& theSet2 ) {
+    theSet1.swap( theSet2 );
+}
+
 inline GridTreeSet outer_approximation( const CompactSetInterface& theSet, const uint numSubdivInDim ) {
     Grid theGrid( theSet.dimension() );
     return outer_approximation( theSet, theGrid, numSubdivInDim );
@@ -2462,6 +5273,43 @@ template<class A> void serialize(A& archive, Ariadne::GridTreeSet& set, const un
 }
 
 
+/*************************************FRIENDS OF GridSetExpression**************************************/
+
+inline GridSubsetExpression lazy( const GridTreeSubset& theSet ) {
+    return GridSubsetExpression( theSet );
+}
+
+template<class E1, class E2>
+inline GridBinaryExpression<E1, E2, GridJoinOperation> join( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 ) {
+    return GridBinaryExpression<E1, E2, GridJoinOperation>( theExpression1.expression(), theExpression2.expression() );
+}
+
+template<class E1, class E2>
+inline GridBinaryExpression<E1, E2, GridIntersectionOperation> intersection( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 ) {
+    return GridBinaryExpression<E1, E2, GridIntersectionOperation>( theExpression1.expression(), theExpression2.expression() );
+}
+
+template<class E1, class E2>
+inline GridBinaryExpression<E1, E2, GridDifferenceOperation> difference( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 ) {
+    return GridBinaryExpression<E1, E2, GridDifferenceOperation>( theExpression1.expression(), theExpression2.expression() );
+}
+
+template<class E>
+inline GridComplementExpression<E> complement( const GridSetExpression<E>& theExpression, const GridCell& theCell ) {
+    return GridComplementExpression<E>( theExpression.expression(), theCell );
+}
+
+template<class E1, class E2>
+inline bool subset( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 ) {
+    return difference( theExpression1, theExpression2 ).empty();
+}
+
+template<class E1, class E2>
+inline bool overlap( const GridSetExpression<E1>& theExpression1, const GridSetExpression<E2>& theExpression2 ) {
+    return ! intersection( theExpression1, theExpression2 ).empty();
+}
+
+
 //! \brief Whether \a cons_set is disjoint from \a grid_set.
 tribool disjoint(const ConstraintSet& cons_set, const GridTreeSet& grid_set);
 //! \brief Whether \a cons_set overlaps with \a grid_set.
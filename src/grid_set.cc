@@ -25,6 +25,13 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "macros.h"
 #include "exceptions.h"
@@ -44,10 +51,193 @@ typedef size_t size_type;
 
 
 
+/****************************************BinaryTreeNodePool******************************************/
+
+void * BinaryTreeNodePool::_pFreeList = NULL;
+
+std::vector<BinaryTreeNode*> BinaryTreeNodePool::_theReleasedTrees;
+
+size_t BinaryTreeNodePool::_theCapacity = 0;
+
+std::vector<char*> BinaryTreeNodePool::_theSlabs;
+
+std::vector<void*> BinaryTreeNodePool::_theDrainedFreeLists;
+
+std::vector<BinaryTreeNode*> BinaryTreeNodePool::_theDrainedTrees;
+
+const size_t BinaryTreeNodePool::SLAB_SIZE;
+
+void BinaryTreeNodePool::allocate_slab() {
+    //1. Get one chunk of memory for SLAB_SIZE nodes, the slabs are only given back to the system by trim()
+    char * pSlab = static_cast<char*>( ::operator new( SLAB_SIZE * sizeof(BinaryTreeNode) ) );
+    //2. Thread the nodes of the slab into the free list, so that they are handed out in the memory order
+    for( size_t i = SLAB_SIZE; i > 0; i-- ) {
+        deallocate( pSlab + ( i - 1 ) * sizeof(BinaryTreeNode) );
+    }
+#ifdef _OPENMP
+    #pragma omp critical( BinaryTreeNodePool )
+#endif
+    {
+        _theSlabs.push_back( pSlab );
+        _theCapacity += SLAB_SIZE;
+    }
+}
+
+void BinaryTreeNodePool::drain() {
+    if( ( _pFreeList == NULL ) && _theReleasedTrees.empty() ) {
+        return;
+    }
+#ifdef _OPENMP
+    #pragma omp critical( BinaryTreeNodePool )
+#endif
+    {
+        if( _pFreeList != NULL ) {
+            _theDrainedFreeLists.push_back( _pFreeList );
+        }
+        _theDrainedTrees.insert( _theDrainedTrees.end(), _theReleasedTrees.begin(), _theReleasedTrees.end() );
+    }
+    _pFreeList = NULL;
+    _theReleasedTrees.clear();
+}
+
+bool BinaryTreeNodePool::take_drained() {
+    bool isTaken = false;
+#ifdef _OPENMP
+    #pragma omp critical( BinaryTreeNodePool )
+#endif
+    {
+        if( ! _theDrainedFreeLists.empty() ) {
+            _pFreeList = _theDrainedFreeLists.back();
+            _theDrainedFreeLists.pop_back();
+            isTaken = true;
+        }
+        if( ! _theDrainedTrees.empty() ) {
+            _theReleasedTrees.insert( _theReleasedTrees.end(), _theDrainedTrees.begin(), _theDrainedTrees.end() );
+            _theDrainedTrees.clear();
+            isTaken = true;
+        }
+    }
+    return isTaken;
+}
+
+size_t BinaryTreeNodePool::slab_index( void * pMemory ) {
+    //The slab is the last one that starts at or before pMemory, the pointers to different slabs are ordered by std::less
+    return std::upper_bound( _theSlabs.begin(), _theSlabs.end(), static_cast<char*>( pMemory ), std::less<char*>() ) - _theSlabs.begin() - 1;
+}
+
+size_t BinaryTreeNodePool::trim() {
+    //1. Take all the drained nodes over, and reclaim all the nodes of the released subtrees, they go to the free list
+#ifdef _OPENMP
+    #pragma omp critical( BinaryTreeNodePool )
+#endif
+    {
+        for( size_t i = 0; i < _theDrainedFreeLists.size(); i++ ) {
+            void * pTail = _theDrainedFreeLists[i];
+            while( *static_cast<void**>( pTail ) != NULL ) {
+                pTail = *static_cast<void**>( pTail );
+            }
+            *static_cast<void**>( pTail ) = _pFreeList;
+            _pFreeList = _theDrainedFreeLists[i];
+        }
+        _theDrainedFreeLists.clear();
+        _theReleasedTrees.insert( _theReleasedTrees.end(), _theDrainedTrees.begin(), _theDrainedTrees.end() );
+        _theDrainedTrees.clear();
+    }
+    while( ! _theReleasedTrees.empty() ) {
+        BinaryTreeNode * pNode = _theReleasedTrees.back();
+        _theReleasedTrees.pop_back();
+        if( pNode->_pLeftNode != NULL ) { release( pNode->_pLeftNode ); }
+        if( pNode->_pRightNode != NULL ) { release( pNode->_pRightNode ); }
+        deallocate( pNode );
+    }
+    size_t theFreedNodes = 0;
+#ifdef _OPENMP
+    #pragma omp critical( BinaryTreeNodePool )
+#endif
+    {
+        //2. Count the free nodes of every slab
+        std::sort( _theSlabs.begin(), _theSlabs.end(), std::less<char*>() );
+        std::vector<size_t> theFreeCounts( _theSlabs.size(), 0 );
+        for( void * pMemory = _pFreeList; pMemory != NULL; pMemory = *static_cast<void**>( pMemory ) ) {
+            theFreeCounts[ slab_index( pMemory ) ]++;
+        }
+        //3. Unlink the nodes of the empty slabs from the free list
+        void ** ppNext = &_pFreeList;
+        while( *ppNext != NULL ) {
+            if( theFreeCounts[ slab_index( *ppNext ) ] == SLAB_SIZE ) {
+                *ppNext = *static_cast<void**>( *ppNext );
+            } else {
+                ppNext = static_cast<void**>( *ppNext );
+            }
+        }
+        //4. Give the empty slabs back to the system
+        size_t theKeptSlabs = 0;
+        for( size_t i = 0; i < _theSlabs.size(); i++ ) {
+            if( theFreeCounts[i] == SLAB_SIZE ) {
+                ::operator delete( _theSlabs[i] );
+                theFreedNodes += SLAB_SIZE;
+            } else {
+                _theSlabs[ theKeptSlabs++ ] = _theSlabs[i];
+            }
+        }
+        _theSlabs.resize( theKeptSlabs );
+        _theCapacity -= theFreedNodes;
+    }
+    return theFreedNodes;
+}
+
 /****************************************BinaryTreeNode**********************************************/
+
+const size_t BinaryTreeNode::PARALLEL_SUBTREE_SIZE;
+
+void BinaryTreeNode::apply_operation( NodeOperation theOperation, BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ) {
+#ifdef _OPENMP
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+    if( ( pThisNode != NULL ) && ( pOtherNode != NULL ) && ! omp_in_parallel() && ( omp_get_max_threads() > 1 ) ) {
+        //Counting caches the sizes of all the other subtrees, the tasks are spawned by them
+        if( count_enabled_leaf_nodes( pOtherNode ) >= PARALLEL_SUBTREE_SIZE ) {
+            #pragma omp parallel
+            {
+                #pragma omp single
+                theOperation( pThisNode, pOtherNode );
+                //After the barrier of single, the workers give the nodes they have freed back to the master
+                if( omp_get_thread_num() != 0 ) {
+                    BinaryTreeNodePool::drain();
+                }
+            }
+            return;
+        }
+    }
+#endif
+#endif
+    theOperation( pThisNode, pOtherNode );
+}
+
+void BinaryTreeNode::apply_to_sub_nodes( NodeOperation theOperation, BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ) {
+    //Unshare both sub-nodes before forking, since both of them modify pThisNode
+    BinaryTreeNode * pThisLeftNode = pThisNode->left_node();
+    BinaryTreeNode * pThisRightNode = pThisNode->right_node();
+#ifdef _OPENMP
+    //The cached count is only read here, an unknown one means the tree is not counted
+    const size_t theOtherSize = pOtherNode->known_enabled_leaf_count();
+    if( ( theOtherSize != UNKNOWN_LEAF_COUNT ) && ( theOtherSize >= PARALLEL_SUBTREE_SIZE ) && omp_in_parallel() ) {
+        #pragma omp task
+        theOperation( pThisLeftNode, pOtherNode->left_node() );
+        theOperation( pThisRightNode, pOtherNode->right_node() );
+        #pragma omp taskwait
+        return;
+    }
+#endif
+    theOperation( pThisLeftNode, pOtherNode->left_node() );
+    theOperation( pThisRightNode, pOtherNode->right_node() );
+}
     
 bool BinaryTreeNode::has_enabled() const {
-    if( is_leaf() ) {
+    //A known count decides at once, but an unknown one is not computed here
+    const size_t theCount = known_enabled_leaf_count();
+    if( theCount != UNKNOWN_LEAF_COUNT ) {
+        return theCount > 0;
+    } else if( is_leaf() ) {
         return is_enabled();
     } else {
         return ( left_node()->has_enabled() || right_node()->has_enabled() );
@@ -111,6 +301,11 @@ bool BinaryTreeNode::is_equal_nodes( const BinaryTreeNode * pFirstNode, const Bi
 }
     
 bool BinaryTreeNode::operator==(const BinaryTreeNode & otherNode ) const {
+    //The hashes are not computed here, but the known different ones decide at once
+    const boost::uint64_t theHash = this->known_hash(), theOtherHash = otherNode.known_hash();
+    if( ( theHash != UNKNOWN_HASH ) && ( theOtherHash != UNKNOWN_HASH ) && ( theHash != theOtherHash ) ) {
+        return false;
+    }
     return ( ( this->_isEnabled == otherNode._isEnabled ) ||
              ( indeterminate( this->_isEnabled     ) &&
                indeterminate( otherNode._isEnabled ) ) )            &&
@@ -118,11 +313,56 @@ bool BinaryTreeNode::operator==(const BinaryTreeNode & otherNode ) const {
         is_equal_nodes( this->_pRightNode , otherNode._pRightNode );
 }
 
+BinaryTreeNode * BinaryTreeNode::share_equal_subtrees( BinaryTreeNode * pNode, UniqueNodeTable & theUniqueNodes ) {
+    //1. Bottom up: substitute the sub-nodes by their unique representatives
+    if( ! pNode->is_leaf() ) {
+        pNode->_pLeftNode = share_equal_subtrees( pNode->_pLeftNode, theUniqueNodes );
+        pNode->_pRightNode = share_equal_subtrees( pNode->_pRightNode, theUniqueNodes );
+    }
+    //2. The sub-nodes are unique now, so equal subtrees have equal keys
+    const int value = indeterminate( pNode->_isEnabled ) ? 2 : ( definitely( pNode->_isEnabled ) ? 1 : 0 );
+    const UniqueNodeTable::key_type key( std::make_pair( pNode->_pLeftNode, pNode->_pRightNode ), value );
+    std::pair< UniqueNodeTable::iterator, bool > entry = theUniqueNodes.insert( std::make_pair( key, pNode ) );
+    if( entry.second ) {
+        //This is the first subtree of its kind, it becomes the representative
+        return pNode;
+    } else {
+        //Pass the reference over to the representative, the duplicate is released
+        BinaryTreeNode * pUniqueNode = entry.first->second;
+        if( pUniqueNode != pNode ) {
+            pUniqueNode->_theReferences++;
+            //The sub-nodes of a dying node are detached eagerly, so that their reference counts stay exact
+            if( ! pNode->is_leaf() && ! pNode->is_shared() ) {
+                BinaryTreeNodePool::release( pNode->_pLeftNode );
+                BinaryTreeNodePool::release( pNode->_pRightNode );
+                pNode->_pLeftNode = NULL;
+                pNode->_pRightNode = NULL;
+            }
+            BinaryTreeNodePool::release( pNode );
+        }
+        return pUniqueNode;
+    }
+}
+
+void BinaryTreeNode::share_equal_subtrees() {
+    UniqueNodeTable theUniqueNodes;
+    //The node itself stays in place, since we do not know who references it
+    if( ! is_leaf() ) {
+        _pLeftNode = share_equal_subtrees( _pLeftNode, theUniqueNodes );
+        _pRightNode = share_equal_subtrees( _pRightNode, theUniqueNodes );
+    }
+}
+
 void BinaryTreeNode::restrict( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ){
+    apply_operation( restrict_node, pThisNode, pOtherNode );
+}
+
+void BinaryTreeNode::restrict_node( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ){
     if( ( pThisNode != NULL ) && ( pOtherNode != NULL ) ){
         if( pThisNode->is_leaf() && pOtherNode->is_leaf() ){
             //Both nodes are leaf nodes: Make a regular AND
             pThisNode->_isEnabled = (pThisNode->_isEnabled && pOtherNode->_isEnabled);
+            pThisNode->invalidate_enabled_leaf_count();
         } else {
             if( !pThisNode->is_leaf() && pOtherNode->is_leaf() ){
                 if( pOtherNode->is_enabled() ){
@@ -143,8 +383,7 @@ void BinaryTreeNode::restrict( BinaryTreeNode * pThisNode, const BinaryTreeNode
                     }
                 } else {
                     //Both nodes are non-leaf nodes: Go recursively left and right
-                    restrict( pThisNode->_pLeftNode, pOtherNode->_pLeftNode );
-                    restrict( pThisNode->_pRightNode, pOtherNode->_pRightNode );
+                    apply_to_sub_nodes( restrict_node, pThisNode, pOtherNode );
                 }
             }
         }
@@ -152,11 +391,16 @@ void BinaryTreeNode::restrict( BinaryTreeNode * pThisNode, const BinaryTreeNode
 }
     
 void BinaryTreeNode::remove( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ) {
+    apply_operation( remove_node, pThisNode, pOtherNode );
+}
+
+void BinaryTreeNode::remove_node( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ) {
     if( ( pThisNode != NULL ) && ( pOtherNode != NULL ) ){
         if( pThisNode->is_leaf() && pOtherNode->is_leaf() ){
             if( pThisNode->is_enabled() && pOtherNode->is_enabled() ){
                 //Both nodes are enabled leaf nodes: Make a regular subtraction, i.e. set the false
                 pThisNode->_isEnabled = false;
+                pThisNode->invalidate_enabled_leaf_count();
             } else {
                 //DO NOTHING: In all other cases there is nothing to be done
             }
@@ -185,8 +429,7 @@ void BinaryTreeNode::remove( BinaryTreeNode * pThisNode, const BinaryTreeNode *
                     //We will have to do the recursion to remove the leaf nodes
                 }
                 //Both nodes are non-leaf nodes now: Go recursively left and right
-                remove( pThisNode->_pLeftNode, pOtherNode->_pLeftNode );
-                remove( pThisNode->_pRightNode, pOtherNode->_pRightNode );
+                apply_to_sub_nodes( remove_node, pThisNode, pOtherNode );
             }
         }
     }
@@ -208,6 +451,7 @@ void BinaryTreeNode::restore_node( BinaryTreeNode * pCurrentNode, uint & arr_ind
         } else {
             //If we are in a leaf node then check if it needs to be enabled/disabled
             pCurrentNode->_isEnabled = theEnabledCells[leaf_counter];
+            pCurrentNode->invalidate_enabled_leaf_count();
                 
             leaf_counter++;
         }
@@ -226,8 +470,8 @@ void BinaryTreeNode::mince_node(BinaryTreeNode * pCurrentNode, const uint depth)
                 
                 const int remaining_depth = depth - 1;
                 
-                mince_node( pCurrentNode->_pLeftNode, remaining_depth );
-                mince_node( pCurrentNode->_pRightNode, remaining_depth );
+                mince_node( pCurrentNode->left_node(), remaining_depth );
+                mince_node( pCurrentNode->right_node(), remaining_depth );
             }
         } else {
             throw std::runtime_error( ARIADNE_PRETTY_FUNCTION );
@@ -240,8 +484,8 @@ void BinaryTreeNode::recombine_node(BinaryTreeNode * pCurrentNode) {
     if( pCurrentNode != NULL ){
         //If it is not a leaf node then it should have both of its subnodes != NULL
         if( ! pCurrentNode->is_leaf() ){
-            BinaryTreeNode * pLeftNode = pCurrentNode->_pLeftNode;
-            BinaryTreeNode * pRightNode = pCurrentNode->_pRightNode;
+            BinaryTreeNode * pLeftNode = pCurrentNode->left_node();
+            BinaryTreeNode * pRightNode = pCurrentNode->right_node();
             
             //This recursive calls ensure that we do recombination from the bottom up
             recombine_node( pLeftNode );
@@ -276,13 +520,64 @@ uint BinaryTreeNode::depth() const {
     return result;
 }
 
+//The cached counts and hashes are filled in outside of the parallel regions only, where
+//no other thread can read them, the parallel tasks compute the values without keeping them
+static inline bool can_fill_caches() {
+#ifdef _OPENMP
+    return ! omp_in_parallel();
+#else
+    return true;
+#endif
+}
+
 size_t BinaryTreeNode::count_enabled_leaf_nodes( const BinaryTreeNode* pNode ) {
-    if(pNode->is_leaf()) { 
-        return pNode->is_enabled() ? 1u : 0u; 
-    } else {
-        return count_enabled_leaf_nodes(pNode->left_node())
-            + count_enabled_leaf_nodes(pNode->right_node());
+    //Only the sub-trees with invalidated counts are traversed
+    size_t theCount = pNode->known_enabled_leaf_count();
+    if( theCount == UNKNOWN_LEAF_COUNT ) {
+        if(pNode->is_leaf()) { 
+            theCount = pNode->is_enabled() ? 1u : 0u; 
+        } else {
+            theCount = count_enabled_leaf_nodes(pNode->left_node())
+                + count_enabled_leaf_nodes(pNode->right_node());
+        }
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+        if( can_fill_caches() ) {
+            pNode->_theEnabledLeafCount = theCount;
+        }
+#endif
+    }
+    return theCount;
+}
+
+/*! \brief The finalizer of the splitmix64 generator, it spreads every bit of \a x over the result. */
+static inline boost::uint64_t mix_hash( boost::uint64_t x ) {
+    x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebULL;
+    return x ^ ( x >> 31 );
+}
+
+boost::uint64_t BinaryTreeNode::hash( const BinaryTreeNode* pNode ) {
+    //Only the sub-trees with invalidated hashes are traversed
+    boost::uint64_t theHash = pNode->known_hash();
+    if( theHash == UNKNOWN_HASH ) {
+        if( pNode->is_leaf() ) {
+            theHash = pNode->is_enabled() ? 0x9e3779b97f4a7c15ULL : 0x632be59bd9b4e019ULL;
+        } else {
+            //The right hash is mixed once more, so that the swapped sub-trees hash differently
+            theHash = mix_hash( hash( pNode->left_node() ) ^
+                                mix_hash( hash( pNode->right_node() ) + 0x2545f4914f6cdd1dULL ) );
+        }
+        //The value UNKNOWN_HASH is reserved for the invalid cache
+        if( theHash == UNKNOWN_HASH ) {
+            theHash = 1u;
+        }
+#ifdef ARIADNE_BINARY_TREE_NODE_CACHES
+        if( can_fill_caches() ) {
+            pNode->_theHash = theHash;
+        }
+#endif
     }
+    return theHash;
 }
 
 void BinaryTreeNode::tree_to_binary_words( BinaryWord & tree, BinaryWord & leaves ) const {
@@ -298,6 +593,9 @@ void BinaryTreeNode::tree_to_binary_words( BinaryWord & tree, BinaryWord & leave
 
 void BinaryTreeNode::add_enabled_from_file(FILE*& file){
 
+	// The subtree is about to change
+	invalidate_enabled_leaf_count();
+
 	// Get the information on the presence of leaves
 	int hasLeaves = fgetc(file);
 
@@ -322,6 +620,9 @@ void BinaryTreeNode::add_enabled_from_file(FILE*& file){
 
 void BinaryTreeNode::remove_to_file(FILE*& file){
 
+	// The node is going to become a leaf
+	invalidate_enabled_leaf_count();
+
 	// Get the boolean value for the presence of leaves (checking the left node suffices)
 	bool hasLeaves = (_pLeftNode != NULL);
 	// Put the information into the file
@@ -338,15 +639,15 @@ void BinaryTreeNode::remove_to_file(FILE*& file){
 	else
 	{
 		// Remove the left subtree
-		_pLeftNode->remove_to_file(file);
+		left_node()->remove_to_file(file);
 		// Deallocate the node
-		delete(_pLeftNode);
+		BinaryTreeNodePool::release(_pLeftNode);
 		// Set the pointer to NULL
 		_pLeftNode = NULL;
 		// Remove the right subtree
-		_pRightNode->remove_to_file(file);
+		right_node()->remove_to_file(file);
 		// Deallocate the node
-		delete(_pRightNode);
+		BinaryTreeNodePool::release(_pRightNode);
 		// Set the pointer to NULL
 		_pRightNode = NULL;
 	}
@@ -360,7 +661,7 @@ void BinaryTreeNode::add_enabled( const BinaryTreeNode * pOtherSubTree, const Bi
         //Split the node, if it is not a leaf it will not be changed
         pCurrentSubTree->split();
         //Follow the path step
-        pCurrentSubTree = ( path[position] ? pCurrentSubTree->_pRightNode : pCurrentSubTree->_pLeftNode );
+        pCurrentSubTree = ( path[position] ? pCurrentSubTree->right_node() : pCurrentSubTree->left_node() );
         //Go to the next path element
         position ++;
     }
@@ -372,6 +673,10 @@ void BinaryTreeNode::add_enabled( const BinaryTreeNode * pOtherSubTree, const Bi
 }
     
 void BinaryTreeNode::add_enabled( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot ){
+    apply_operation( add_enabled_node, pToTreeRoot, pFromTreeRoot );
+}
+
+void BinaryTreeNode::add_enabled_node( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot ){
     if( pToTreeRoot->is_leaf() ){
         //If we are adding something to a leaf node
         if( pToTreeRoot->is_enabled() ){
@@ -392,6 +697,7 @@ void BinaryTreeNode::add_enabled( BinaryTreeNode* pToTreeRoot, const BinaryTreeN
                 pToTreeRoot->_pRightNode = new BinaryTreeNode( *pFromTreeRoot->_pRightNode );
                 //Set the leaf node as unknown, since we do not know what is below
                 pToTreeRoot->set_unknown();
+                pToTreeRoot->invalidate_enabled_leaf_count();
             }
         }
     } else {
@@ -406,8 +712,172 @@ void BinaryTreeNode::add_enabled( BinaryTreeNode* pToTreeRoot, const BinaryTreeN
             }
         } else {
             //Adding a non-leaf node to a non-leaf node, do recursion
-            add_enabled( pToTreeRoot->_pLeftNode, pFromTreeRoot->_pLeftNode );
-            add_enabled( pToTreeRoot->_pRightNode, pFromTreeRoot->_pRightNode );
+            apply_to_sub_nodes( add_enabled_node, pToTreeRoot, pFromTreeRoot );
+        }
+    }
+}
+
+void BinaryTreeNode::move_sub_nodes( BinaryTreeNode * pToNode, BinaryTreeNode * pFromNode ) {
+    //The references of the sub-nodes are passed over, so the shared ones stay shared
+    pToNode->_pLeftNode = pFromNode->_pLeftNode;
+    pToNode->_pRightNode = pFromNode->_pRightNode;
+    pToNode->_isEnabled = indeterminate;
+    pToNode->copy_known_caches( pFromNode );
+    pFromNode->_pLeftNode = NULL;
+    pFromNode->_pRightNode = NULL;
+    pFromNode->_isEnabled = false;
+    pFromNode->invalidate_enabled_leaf_count();
+}
+
+void BinaryTreeNode::complement( BinaryTreeNode * pNode ) {
+    if( pNode->is_leaf() ) {
+        if( pNode->is_enabled() ) {
+            pNode->set_disabled();
+        } else {
+            pNode->set_enabled();
+        }
+    } else {
+        complement( pNode->left_node() );
+        complement( pNode->right_node() );
+    }
+}
+
+void BinaryTreeNode::move_add_enabled( BinaryTreeNode* pToTreeRoot, BinaryTreeNode* pFromTreeRoot ){
+    if( pToTreeRoot->is_leaf() ){
+        if( pToTreeRoot->is_enabled() ){
+            //Do nothing, adding to an enabled leaf node (nothing new can be added)
+        } else {
+            if( pFromTreeRoot->is_leaf() ){
+                if( pFromTreeRoot->is_enabled() ){
+                    pToTreeRoot->set_enabled();
+                }
+            } else {
+                //Adding a subtree to a disabled leaf node: take it over, nothing is copied
+                move_sub_nodes( pToTreeRoot, pFromTreeRoot );
+            }
+        }
+    } else {
+        if( pFromTreeRoot->is_leaf() ){
+            if( pFromTreeRoot->is_enabled() ){
+                pToTreeRoot->make_leaf(true);
+            }
+        } else {
+            //Both nodes are non-leaf nodes, the non-const sub-nodes of the other tree are exclusive
+            move_add_enabled( pToTreeRoot->left_node(), pFromTreeRoot->left_node() );
+            move_add_enabled( pToTreeRoot->right_node(), pFromTreeRoot->right_node() );
+        }
+    }
+}
+
+void BinaryTreeNode::move_restrict( BinaryTreeNode * pThisNode, BinaryTreeNode * pOtherNode ){
+    if( pThisNode->is_leaf() ){
+        if( pThisNode->is_enabled() ){
+            if( pOtherNode->is_leaf() ){
+                if( ! pOtherNode->is_enabled() ){
+                    pThisNode->set_disabled();
+                }
+            } else {
+                //The intersection with an enabled leaf is the other subtree, take it over
+                move_sub_nodes( pThisNode, pOtherNode );
+            }
+        } else {
+            //DO NOTHING: The restriction is empty in this case
+        }
+    } else {
+        if( pOtherNode->is_leaf() ){
+            if( ! pOtherNode->is_enabled() ){
+                pThisNode->make_leaf(false);
+            }
+        } else {
+            move_restrict( pThisNode->left_node(), pOtherNode->left_node() );
+            move_restrict( pThisNode->right_node(), pOtherNode->right_node() );
+        }
+    }
+}
+
+void BinaryTreeNode::move_remove( BinaryTreeNode * pThisNode, BinaryTreeNode * pOtherNode ){
+    if( pThisNode->is_leaf() ){
+        if( pThisNode->is_enabled() ){
+            if( pOtherNode->is_leaf() ){
+                if( pOtherNode->is_enabled() ){
+                    pThisNode->set_disabled();
+                }
+            } else {
+                //What is left of an enabled leaf is the complement of the other subtree, take
+                //it over and complement it in place, instead of splitting this leaf all the way down
+                move_sub_nodes( pThisNode, pOtherNode );
+                complement( pThisNode );
+            }
+        } else {
+            //DO NOTHING: We are trying to remove from a disabled leaf node
+        }
+    } else {
+        if( pOtherNode->is_leaf() ){
+            if( pOtherNode->is_enabled() ){
+                pThisNode->make_leaf(false);
+            }
+        } else {
+            move_remove( pThisNode->left_node(), pOtherNode->left_node() );
+            move_remove( pThisNode->right_node(), pOtherNode->right_node() );
+        }
+    }
+}
+
+void BinaryTreeNode::add_enabled_and_report_new( BinaryTreeNode* pToTreeRoot, const BinaryTreeNode* pFromTreeRoot,
+                                                 BinaryTreeNode* pNewTreeRoot ){
+    if( pToTreeRoot->is_leaf() ){
+        if( pToTreeRoot->is_enabled() ){
+            //Do nothing, adding to an enabled leaf node (nothing new can be added)
+        } else {
+            //Everything that is added to a disabled leaf node is new
+            if( pFromTreeRoot->has_enabled() ){
+                pToTreeRoot->copy_from( pFromTreeRoot );
+                pNewTreeRoot->copy_from( pFromTreeRoot );
+            }
+        }
+    } else {
+        if( pFromTreeRoot->is_leaf() ){
+            if( pFromTreeRoot->is_enabled() ){
+                //The new cells are the ones that were disabled below pToTreeRoot
+                if( ! pToTreeRoot->all_enabled() ){
+                    pNewTreeRoot->copy_from( pToTreeRoot );
+                    complement( pNewTreeRoot );
+                }
+                pToTreeRoot->make_leaf(true);
+            } else {
+                //Do nothing, adding a disabled node to a sub tree (nothing new can be added)
+            }
+        } else {
+            pNewTreeRoot->split();
+            add_enabled_and_report_new( pToTreeRoot->left_node(), pFromTreeRoot->left_node(), pNewTreeRoot->left_node() );
+            add_enabled_and_report_new( pToTreeRoot->right_node(), pFromTreeRoot->right_node(), pNewTreeRoot->right_node() );
+            //Do not keep the nodes without new cells
+            if( pNewTreeRoot->left_node()->is_disabled() && pNewTreeRoot->right_node()->is_disabled() ){
+                pNewTreeRoot->make_leaf(false);
+            }
+        }
+    }
+}
+
+void BinaryTreeNode::toggle( BinaryTreeNode * pThisNode, const BinaryTreeNode * pOtherNode ) {
+    if( pOtherNode->is_leaf() ){
+        if( pOtherNode->is_enabled() ){
+            //Everything below pThisNode is toggled
+            complement( pThisNode );
+        } else {
+            //DO NOTHING: Nothing is toggled by a disabled leaf
+        }
+    } else {
+        if( pThisNode->is_leaf() ){
+            //The leaf becomes the other subtree, complemented if the leaf was enabled
+            const bool isEnabled = pThisNode->is_enabled();
+            pThisNode->copy_from( pOtherNode );
+            if( isEnabled ){
+                complement( pThisNode );
+            }
+        } else {
+            toggle( pThisNode->left_node(), pOtherNode->left_node() );
+            toggle( pThisNode->right_node(), pOtherNode->right_node() );
         }
     }
 }
@@ -425,7 +895,7 @@ void BinaryTreeNode::add_enabled( BinaryTreeNode* pRootTreeNode, const BinaryWor
             }
         }
         //Go left-right depending on the specified path
-        add_enabled( ( path[position] ? pRootTreeNode->_pRightNode : pRootTreeNode->_pLeftNode ), path, position + 1 );
+        add_enabled( ( path[position] ? pRootTreeNode->right_node() : pRootTreeNode->left_node() ), path, position + 1 );
     } else {
         //We are at the destination node
         if( pRootTreeNode->is_leaf() ){
@@ -530,117 +1000,794 @@ bool BinaryTreeNode::subset( const BinaryTreeNode * pRootNodeOne, const BinaryTr
     return result;
 }
 
-/********************************************GridTreeCursor***************************************/
+/****************************************CompactBinaryTree*******************************************/
 
-/****************************************GridTreeConstIterator************************************/
+const uint CompactBinaryTree::ROOT;
 
-GridTreeConstIterator::GridTreeConstIterator(  ) : _pGridTreeCursor()  {  
+CompactBinaryTree::CompactBinaryTree( const bool isEnabled ) : _theNodes( 1 ), _theFreePairs( 0 ) {
+    set_node( ROOT, isEnabled ? ENABLED_LEAF : DISABLED_LEAF );
 }
 
-void GridTreeConstIterator::find_next_enabled_leaf() {
-    if( _pGridTreeCursor.is_left_child() ) {
-        //Move to the parent node
-        _pGridTreeCursor.move_up();
-        //The right node must exist, due to the way we allocate the tree
-        //Also, this node is the root of the branch which we did not investigate.
-        _pGridTreeCursor.move_right();
-        //Find the first enabled leaf on this sub-tree
-        if( ! navigate_to(true) ){
-            //If there are no enabled leafs in the subtree, then
-            //move up and check the remaining branches recursively.
-            find_next_enabled_leaf();
-        }
-    } else {
-        if( _pGridTreeCursor.is_right_child() ) {
-            //Move to the parent node
-            _pGridTreeCursor.move_up();
-            //Move up and check the remaining branches recursively.
-            find_next_enabled_leaf();
-        } else {
-            //Is the root node already and we've seen all the leaf nodes
-            _is_in_end_state = true;
-        }
-    }
+CompactBinaryTree::CompactBinaryTree( const BinaryTreeNode & theTreeNode ) : _theNodes( 1 ), _theFreePairs( 0 ) {
+    copy_node( ROOT, &theTreeNode );
 }
-    
-bool GridTreeConstIterator::navigate_to(bool firstLast){
-    bool isEnabledLeafFound = false;
-    if( _pGridTreeCursor.is_leaf() ){
-        if ( _pGridTreeCursor.is_enabled() ) {
-            //If the leaf is enabled, then the search is over
-            isEnabledLeafFound = true;
-        }
+
+BinaryTreeNode * CompactBinaryTree::to_binary_tree() const {
+    BinaryTreeNode * pRootNode = new BinaryTreeNode();
+    copy_to_node( pRootNode, ROOT );
+    return pRootNode;
+}
+
+uint CompactBinaryTree::allocate_pair() {
+    uint firstChild;
+    if( _theFreePairs != 0 ) {
+        //Reuse the pair of nodes freed last
+        firstChild = _theFreePairs;
+        _theFreePairs = _theNodes[firstChild];
     } else {
-        //If it is not a leaf then we need to keep searching
-        if( firstLast ) {
-            //If we are looking for the first enabled
-            //node, then go to the left sub node
-            _pGridTreeCursor.move_left();
-        } else {
-            //Otherwise we go to the right
-            _pGridTreeCursor.move_right();
-        }
-        //Do recursive check of the newly visited node
-        isEnabledLeafFound = navigate_to( firstLast );
-        //If the leaf node is not found yet
-        if ( ! isEnabledLeafFound ) {
-            if( firstLast ) {
-                _pGridTreeCursor.move_right();
-            } else {
-                _pGridTreeCursor.move_left();
-            }
-            isEnabledLeafFound = navigate_to( firstLast );
-        }
+        //Append a new pair of nodes, the index must fit into the 30 bits of the parent's word
+        firstChild = _theNodes.size();
+        ARIADNE_ASSERT_MSG( firstChild < ( 1u << ( 32 - STATE_BITS ) ) - 1, "The CompactBinaryTree can not have more than 2^30 nodes." );
+        _theNodes.resize( firstChild + 2 );
     }
-        
-    //If the enabled leaf is not found and we are not in the root then we go back
-    if( ! isEnabledLeafFound && ! _pGridTreeCursor.is_root() ){
-        _pGridTreeCursor.move_up();
+    return firstChild;
+}
+
+void CompactBinaryTree::release_sub_nodes( const uint node ) {
+    if( ! is_leaf( node ) ) {
+        const uint firstChild = left_node( node );
+        release_sub_nodes( firstChild );
+        release_sub_nodes( firstChild + 1 );
+        //Put the pair at the head of the free list
+        _theNodes[firstChild] = _theFreePairs;
+        _theFreePairs = firstChild;
     }
-        
-    return isEnabledLeafFound;
 }
 
-/*****************************************GridAbstractCell*******************************************/
+void CompactBinaryTree::copy_node( const uint node, const BinaryTreeNode * pNode ) {
+    if( pNode->is_leaf() ) {
+        set_node( node, pNode->is_enabled() ? ENABLED_LEAF : DISABLED_LEAF );
+    } else {
+        const uint firstChild = allocate_pair();
+        set_node( node, NON_LEAF, firstChild );
+        copy_node( firstChild, pNode->left_node() );
+        copy_node( firstChild + 1, pNode->right_node() );
+    }
+}
 
-Vector<Interval> GridAbstractCell::primary_cell_lattice_box( const uint theHeight, const dimension_type dimensions ) {
-    int leftBottomCorner = 0, rightTopCorner = 1;
-    //The zero level coordinates are known, so we need to iterate only for higher level primary cells
-    for(uint i = 1; i <= theHeight; i++){
-        primary_cell_at_height(i, leftBottomCorner, rightTopCorner);
+void CompactBinaryTree::copy_node( const uint node, const CompactBinaryTree & otherTree, const uint otherNode ) {
+    if( otherTree.is_leaf( otherNode ) ) {
+        set_node( node, otherTree._theNodes[otherNode] & STATE_MASK );
+    } else {
+        const uint firstChild = allocate_pair();
+        set_node( node, NON_LEAF, firstChild );
+        copy_node( firstChild, otherTree, otherTree.left_node( otherNode ) );
+        copy_node( firstChild + 1, otherTree, otherTree.right_node( otherNode ) );
     }
-    // 1.2 Constructing and return the box defining the primary cell (relative to the grid).
-        
-    return Vector< Interval >( dimensions, Interval( leftBottomCorner, rightTopCorner ) );
 }
 
-uint GridAbstractCell::smallest_enclosing_primary_cell_height( const Vector<Interval>& theLatticeBox ) {
-    const dimension_type dimensions = theLatticeBox.size();
-    int leftBottomCorner = 0, rightTopCorner = 1;
-    uint height = 0;
-    //The zero level coordinates are known, so we need to iterate only for higher level primary cells
-    do{
-        //Check if the given box is a subset of a primary cell
-        Vector< Interval > primaryCellBox( dimensions, Interval( leftBottomCorner, rightTopCorner ) );
-        if(  inside(theLatticeBox, primaryCellBox ) ) {
-            //If yes then we are done
-            break;
-        }
-        //Otherwise increase the height and recompute the new borders
-        primary_cell_at_height( ++height, leftBottomCorner, rightTopCorner);
-    }while( true );
-        
-    return height;
+void CompactBinaryTree::copy_to_node( BinaryTreeNode * pNode, const uint node ) const {
+    if( is_leaf( node ) ) {
+        pNode->make_leaf( is_enabled( node ) );
+    } else {
+        pNode->split();
+        copy_to_node( pNode->left_node(), left_node( node ) );
+        copy_to_node( pNode->right_node(), right_node( node ) );
+    }
 }
 
-uint GridAbstractCell::smallest_enclosing_primary_cell_height( const Box& theBox, const Grid& theGrid) {
-    Vector<Interval> theLatticeBox( theBox.size() );
-    //Convert the box to theGrid coordinates
-    for( uint i = 0; i != theBox.size(); ++i ) {
-        theLatticeBox[i] = ( theBox[i] - theGrid.origin()[i] ) / theGrid.lengths()[i];
+void CompactBinaryTree::tree_to_binary_words( const uint node, BinaryWord & tree, BinaryWord & leaves ) const {
+    if( is_leaf( node ) ) {
+        tree.push_back( false );
+        leaves.push_back( is_enabled( node ) );
+    } else {
+        tree.push_back( true );
+        tree_to_binary_words( left_node( node ), tree, leaves );
+        tree_to_binary_words( right_node( node ), tree, leaves );
     }
-    //Compute and return the smallest primary cell, enclosing this box on the grid
-    return smallest_enclosing_primary_cell_height( theLatticeBox );
+}
+
+bool CompactBinaryTree::has_enabled( const uint node ) const {
+    if( is_leaf( node ) ) {
+        return is_enabled( node );
+    } else {
+        return has_enabled( left_node( node ) ) || has_enabled( right_node( node ) );
+    }
+}
+
+bool CompactBinaryTree::all_enabled( const uint node ) const {
+    if( is_leaf( node ) ) {
+        return is_enabled( node );
+    } else {
+        return all_enabled( left_node( node ) ) && all_enabled( right_node( node ) );
+    }
+}
+
+size_t CompactBinaryTree::count_enabled_leaf_nodes( const uint node ) const {
+    if( is_leaf( node ) ) {
+        return is_enabled( node ) ? 1u : 0u;
+    } else {
+        return count_enabled_leaf_nodes( left_node( node ) ) + count_enabled_leaf_nodes( right_node( node ) );
+    }
+}
+
+size_t CompactBinaryTree::node_count() const {
+    //Every free pair removes two nodes from the ones stored in the array
+    size_t result = _theNodes.size();
+    for( uint freePair = _theFreePairs; freePair != 0; freePair = _theNodes[freePair] ) {
+        result -= 2;
+    }
+    return result;
+}
+
+bool CompactBinaryTree::is_equal_nodes( const CompactBinaryTree & treeOne, const uint nodeOne,
+                                        const CompactBinaryTree & treeTwo, const uint nodeTwo ) {
+    const node_type stateOne = treeOne._theNodes[nodeOne] & STATE_MASK;
+    if( stateOne != ( treeTwo._theNodes[nodeTwo] & STATE_MASK ) ) {
+        return false;
+    } else if( stateOne != NON_LEAF ) {
+        return true;
+    } else {
+        return is_equal_nodes( treeOne, treeOne.left_node( nodeOne ), treeTwo, treeTwo.left_node( nodeTwo ) ) &&
+               is_equal_nodes( treeOne, treeOne.right_node( nodeOne ), treeTwo, treeTwo.right_node( nodeTwo ) );
+    }
+}
+
+void CompactBinaryTree::recombine_node( const uint node ) {
+    if( ! is_leaf( node ) ) {
+        const uint leftNode = left_node( node );
+        const uint rightNode = right_node( node );
+        
+        //This recursive calls ensure that we do recombination from the bottom up
+        recombine_node( leftNode );
+        recombine_node( rightNode );
+        
+        //Do the recombination for the leaf nodes rooted to node
+        if( is_leaf( leftNode ) && is_leaf( rightNode ) && ( _theNodes[leftNode] == _theNodes[rightNode] ) ) {
+            make_leaf( node, is_enabled( leftNode ) );
+        }
+    }
+}
+
+void CompactBinaryTree::restrict( const uint node, const CompactBinaryTree & otherTree, const uint otherNode ) {
+    if( otherTree.is_leaf( otherNode ) ) {
+        if( otherTree.is_enabled( otherNode ) ) {
+            //DO NOTHING: The restriction will not affect this node
+        } else {
+            //Turn the node a disabled leaf, since we do AND with false
+            make_leaf( node, false );
+        }
+    } else {
+        if( is_leaf( node ) ) {
+            if( is_enabled( node ) ) {
+                //If this node is enabled then copy in the other node
+                copy_node( node, otherTree, otherNode );
+            } else {
+                //DO NOTHING: The restriction is empty in this case
+            }
+        } else {
+            //Both nodes are non-leaf nodes: Go recursively left and right
+            //NOTE: The indices of the sub-nodes do not change when the array is reallocated
+            const uint firstChild = left_node( node );
+            restrict( firstChild, otherTree, otherTree.left_node( otherNode ) );
+            restrict( firstChild + 1, otherTree, otherTree.right_node( otherNode ) );
+        }
+    }
+}
+
+void CompactBinaryTree::remove( const uint node, const CompactBinaryTree & otherTree, const uint otherNode ) {
+    if( otherTree.is_leaf( otherNode ) ) {
+        if( otherTree.is_enabled( otherNode ) ) {
+            //Turn the node into a disabled leaf, since we subtract all below
+            make_leaf( node, false );
+        } else {
+            //DO NOTHING: We are trying to remove a disabled node
+        }
+    } else {
+        if( is_leaf( node ) ) {
+            if( is_enabled( node ) ) {
+                //We might subtract something from the enabled leaf, so we split it
+                split( node );
+            } else {
+                //DO NOTHING: Removing from a disabled leaf node has no effect
+                return;
+            }
+        }
+        //Both nodes are non-leaf nodes now: Go recursively left and right
+        const uint firstChild = left_node( node );
+        remove( firstChild, otherTree, otherTree.left_node( otherNode ) );
+        remove( firstChild + 1, otherTree, otherTree.right_node( otherNode ) );
+    }
+}
+
+void CompactBinaryTree::add_enabled( const uint node, const CompactBinaryTree & otherTree, const uint otherNode ) {
+    if( is_enabled( node ) ) {
+        //Do nothing, adding to an enabled leaf node (nothing new can be added)
+    } else if( otherTree.is_leaf( otherNode ) ) {
+        if( otherTree.is_enabled( otherNode ) ) {
+            //Adding an enabled leaf: the node becomes an enabled leaf
+            make_leaf( node, true );
+        } else {
+            //Do nothing, adding a disabled leaf node (nothing new can be added)
+        }
+    } else if( is_leaf( node ) ) {
+        //Adding a subtree to a disabled leaf node
+        copy_node( node, otherTree, otherNode );
+    } else {
+        //Adding a non-leaf node to a non-leaf node, do recursion
+        const uint firstChild = left_node( node );
+        add_enabled( firstChild, otherTree, otherTree.left_node( otherNode ) );
+        add_enabled( firstChild + 1, otherTree, otherTree.right_node( otherNode ) );
+    }
+}
+
+bool CompactBinaryTree::overlap( const CompactBinaryTree & treeOne, const uint nodeOne,
+                                 const CompactBinaryTree & treeTwo, const uint nodeTwo ) {
+    if( treeOne.is_leaf( nodeOne ) ) {
+        //If the first node is a leaf then the trees overlap if it is enabled
+        //and the second node has an enabled sub-node
+        return treeOne.is_enabled( nodeOne ) && treeTwo.has_enabled( nodeTwo );
+    } else if( treeTwo.is_leaf( nodeTwo ) ) {
+        return treeTwo.is_enabled( nodeTwo ) && treeOne.has_enabled( nodeOne );
+    } else {
+        //Both nodes are non-leaf nodes, then the trees overlap if
+        //either their left or right branches overlap
+        return overlap( treeOne, treeOne.left_node( nodeOne ), treeTwo, treeTwo.left_node( nodeTwo ) ) ||
+               overlap( treeOne, treeOne.right_node( nodeOne ), treeTwo, treeTwo.right_node( nodeTwo ) );
+    }
+}
+
+bool CompactBinaryTree::subset( const CompactBinaryTree & treeOne, const uint nodeOne,
+                                const CompactBinaryTree & treeTwo, const uint nodeTwo ) {
+    if( treeOne.is_leaf( nodeOne ) ) {
+        //A leaf is a subset if it is disabled or all of the corresponding leaf nodes are enabled
+        return ( ! treeOne.is_enabled( nodeOne ) ) || treeTwo.all_enabled( nodeTwo );
+    } else if( treeTwo.is_leaf( nodeTwo ) ) {
+        //A subtree is a subset of a leaf if the leaf is enabled or the subtree has no enabled nodes
+        return treeTwo.is_enabled( nodeTwo ) || ( ! treeOne.has_enabled( nodeOne ) );
+    } else {
+        return subset( treeOne, treeOne.left_node( nodeOne ), treeTwo, treeTwo.left_node( nodeTwo ) ) &&
+               subset( treeOne, treeOne.right_node( nodeOne ), treeTwo, treeTwo.right_node( nodeTwo ) );
+    }
+}
+
+/*****************************************PackedBinaryWord*******************************************/
+
+PackedBinaryWord::PackedBinaryWord( const BinaryWord& theWord ) :
+    _theSize(0), _theCapacity(INLINE_LIMBS), _pLimbs(_theInlineLimbs) {
+    for( uint i = 0; i < INLINE_LIMBS; i++ ) {
+        _theInlineLimbs[i] = 0;
+    }
+    append( theWord );
+}
+
+PackedBinaryWord::PackedBinaryWord( const PackedBinaryWord& otherWord ) :
+    _theSize(0), _theCapacity(INLINE_LIMBS), _pLimbs(_theInlineLimbs) {
+    for( uint i = 0; i < INLINE_LIMBS; i++ ) {
+        _theInlineLimbs[i] = 0;
+    }
+    append( otherWord );
+}
+
+PackedBinaryWord& PackedBinaryWord::operator=( const PackedBinaryWord& otherWord ) {
+    if( this != &otherWord ) {
+        clear();
+        append( otherWord );
+    }
+    return *this;
+}
+
+void PackedBinaryWord::reserve_limbs( const size_t numLimbs ) {
+    if( numLimbs > _theCapacity ) {
+        const size_t newCapacity = std::max( numLimbs, 2 * _theCapacity );
+        limb_type * pNewLimbs = new limb_type[ newCapacity ];
+        for( size_t i = 0; i < _theCapacity; i++ ) {
+            pNewLimbs[i] = _pLimbs[i];
+        }
+        for( size_t i = _theCapacity; i < newCapacity; i++ ) {
+            pNewLimbs[i] = 0;
+        }
+        if( _pLimbs != _theInlineLimbs ) {
+            delete[] _pLimbs;
+        }
+        _pLimbs = pNewLimbs;
+        _theCapacity = newCapacity;
+    }
+}
+
+void PackedBinaryWord::clear() {
+    const size_t numLimbs = limbs_for( _theSize );
+    for( size_t i = 0; i < numLimbs; i++ ) {
+        _pLimbs[i] = 0;
+    }
+    _theSize = 0;
+}
+
+void PackedBinaryWord::append( const bool bit, const size_t count ) {
+    reserve_limbs( limbs_for( _theSize + count ) );
+    if( bit ) {
+        //Fill the remainder of the current limb and then whole limbs
+        size_t remaining = count;
+        while( remaining > 0 ) {
+            const size_t offset = _theSize % LIMB_BITS;
+            const size_t numBits = std::min( size_t( LIMB_BITS - offset ), remaining );
+            const limb_type ones = ( numBits == LIMB_BITS ) ? ~limb_type(0) : ( ( limb_type(1) << numBits ) - 1 );
+            _pLimbs[ _theSize / LIMB_BITS ] |= ones << ( LIMB_BITS - offset - numBits );
+            _theSize += numBits;
+            remaining -= numBits;
+        }
+    } else {
+        //The unused bits are already zero
+        _theSize += count;
+    }
+}
+
+void PackedBinaryWord::append( const PackedBinaryWord& otherWord ) {
+    if( this == &otherWord ) {
+        //The limbs may be reallocated below, so append a copy
+        const PackedBinaryWord copyWord( otherWord );
+        append( copyWord );
+    } else {
+        const size_t newSize = _theSize + otherWord._theSize;
+        const size_t newLimbs = limbs_for( newSize );
+        reserve_limbs( newLimbs );
+        const size_t first = _theSize / LIMB_BITS;
+        const size_t shift = _theSize % LIMB_BITS;
+        const size_t otherLimbs = limbs_for( otherWord._theSize );
+        for( size_t i = 0; i < otherLimbs; i++ ) {
+            const limb_type limb = otherWord._pLimbs[i];
+            if( shift == 0 ) {
+                _pLimbs[ first + i ] = limb;
+            } else {
+                //Split the limb between two limbs of this word, the
+                //low part only matters if it contains bits of the word
+                _pLimbs[ first + i ] |= limb >> shift;
+                if( first + i + 1 < newLimbs ) {
+                    _pLimbs[ first + i + 1 ] = limb << ( LIMB_BITS - shift );
+                }
+            }
+        }
+        _theSize = newSize;
+    }
+}
+
+void PackedBinaryWord::append( const BinaryWord& theWord ) {
+    reserve_limbs( limbs_for( _theSize + theWord.size() ) );
+    for( size_t i = 0; i < theWord.size(); i++ ) {
+        if( theWord[i] ) {
+            _pLimbs[ _theSize / LIMB_BITS ] |= limb_type(1) << ( LIMB_BITS - 1 - _theSize % LIMB_BITS );
+        }
+        _theSize++;
+    }
+}
+
+size_t PackedBinaryWord::common_prefix_length( const PackedBinaryWord& otherWord ) const {
+    const size_t minSize = std::min( _theSize, otherWord._theSize );
+    const size_t numLimbs = limbs_for( minSize );
+    for( size_t i = 0; i < numLimbs; i++ ) {
+        const limb_type difference = _pLimbs[i] ^ otherWord._pLimbs[i];
+        if( difference != 0 ) {
+            //The first differing bit may lie beyond the shorter word
+            return std::min( i * LIMB_BITS + leading_zeros( difference ), minSize );
+        }
+    }
+    return minSize;
+}
+
+int PackedBinaryWord::compare( const PackedBinaryWord& otherWord ) const {
+    const size_t prefixLength = common_prefix_length( otherWord );
+    if( prefixLength < _theSize && prefixLength < otherWord._theSize ) {
+        //The words differ at the bit prefixLength
+        return (*this)[prefixLength] ? 1 : -1;
+    } else {
+        //One of the words is a prefix of the other
+        if( _theSize == otherWord._theSize ) {
+            return 0;
+        } else {
+            return ( _theSize < otherWord._theSize ) ? -1 : 1;
+        }
+    }
+}
+
+BinaryWord PackedBinaryWord::to_binary_word() const {
+    BinaryWord theWord;
+    for( size_t i = 0; i < _theSize; i++ ) {
+        theWord.push_back( (*this)[i] );
+    }
+    return theWord;
+}
+
+/********************************************GridTreeCursor***************************************/
+
+/****************************************GridTreeConstIterator************************************/
+
+GridTreeConstIterator::GridTreeConstIterator(  ) : _pGridTreeCursor()  {  
+}
+
+void GridTreeConstIterator::find_next_enabled_leaf() {
+    if( _pGridTreeCursor.is_left_child() ) {
+        //Move to the parent node
+        _pGridTreeCursor.move_up();
+        //The right node must exist, due to the way we allocate the tree
+        //Also, this node is the root of the branch which we did not investigate.
+        _pGridTreeCursor.move_right();
+        //Find the first enabled leaf on this sub-tree
+        if( ! navigate_to(true) ){
+            //If there are no enabled leafs in the subtree, then
+            //move up and check the remaining branches recursively.
+            find_next_enabled_leaf();
+        }
+    } else {
+        if( _pGridTreeCursor.is_right_child() ) {
+            //Move to the parent node
+            _pGridTreeCursor.move_up();
+            //Move up and check the remaining branches recursively.
+            find_next_enabled_leaf();
+        } else {
+            //Is the root node already and we've seen all the leaf nodes
+            _is_in_end_state = true;
+        }
+    }
+}
+    
+bool GridTreeConstIterator::navigate_to(bool firstLast){
+    bool isEnabledLeafFound = false;
+    if( _pGridTreeCursor.is_leaf() ){
+        if ( _pGridTreeCursor.is_enabled() ) {
+            //If the leaf is enabled, then the search is over
+            isEnabledLeafFound = true;
+        }
+    } else {
+        //If it is not a leaf then we need to keep searching
+        if( firstLast ) {
+            //If we are looking for the first enabled
+            //node, then go to the left sub node
+            _pGridTreeCursor.move_left();
+        } else {
+            //Otherwise we go to the right
+            _pGridTreeCursor.move_right();
+        }
+        //Do recursive check of the newly visited node
+        isEnabledLeafFound = navigate_to( firstLast );
+        //If the leaf node is not found yet
+        if ( ! isEnabledLeafFound ) {
+            if( firstLast ) {
+                _pGridTreeCursor.move_right();
+            } else {
+                _pGridTreeCursor.move_left();
+            }
+            isEnabledLeafFound = navigate_to( firstLast );
+        }
+    }
+        
+    //If the enabled leaf is not found and we are not in the root then we go back
+    if( ! isEnabledLeafFound && ! _pGridTreeCursor.is_root() ){
+        _pGridTreeCursor.move_up();
+    }
+        
+    return isEnabledLeafFound;
+}
+
+/**********************************GridTreeOverlappingConstIterator*********************************/
+
+GridTreeOverlappingConstIterator::GridTreeOverlappingConstIterator() :
+    _pGrid( NULL ), _theHeight( 0 ), _theRootDepth( 0 ), _theBox( 0 ) {
+}
+
+GridTreeOverlappingConstIterator::GridTreeOverlappingConstIterator( const GridTreeSubset& theSubset, const Box& theBox ) :
+    _pGrid( &theSubset.grid() ), _theHeight( theSubset.cell().height() ), _theRootDepth( theSubset.cell().word().size() ),
+    _theBox( theBox ), _theWord( theSubset.cell().word() ) {
+    _theNodes.push_back( theSubset.binary_tree() );
+    _theLatticeBoxes.push_back( GridCell::compute_lattice_box( _pGrid->dimension(), _theHeight, _theWord ) );
+    find_next_cell();
+}
+
+bool GridTreeOverlappingConstIterator::is_current_node_overlapping() const {
+    if( _theNodes.back()->is_disabled() ) {
+        return false;
+    }
+    const Box theCellsBox = GridAbstractCell::lattice_box_to_space( _theLatticeBoxes[ _theNodes.size() - 1 ], *_pGrid );
+    return possibly( theCellsBox.overlaps( _theBox ) );
+}
+
+bool GridTreeOverlappingConstIterator::skip_current_subtree() {
+    //Go up while the current node is a right sub-node, then move to the right sibling
+    while( _theNodes.size() > 1 ) {
+        const size_t depth = _theNodes.size() - 1;
+        if( ! _theWord.back() ) {
+            const BinaryTreeNode * pParentNode = _theNodes[ depth - 1 ];
+            _theNodes.back() = pParentNode->right_node();
+            _theWord.pop_back();
+            _theWord.push_back( true );
+            //The right half of the parent cell
+            Vector<Interval> theLeftLatticeBox( _theLatticeBoxes[ depth - 1 ] );
+            _theLatticeBoxes[depth] = _theLatticeBoxes[ depth - 1 ];
+            GridAbstractCell::split_lattice_box( _theWord.size() - 1, theLeftLatticeBox, _theLatticeBoxes[depth] );
+            return true;
+        }
+        _theNodes.pop_back();
+        _theWord.pop_back();
+    }
+    //All the nodes have been seen
+    _pGrid = NULL;
+    return false;
+}
+
+void GridTreeOverlappingConstIterator::find_next_cell() {
+    do {
+        if( is_current_node_overlapping() ) {
+            const BinaryTreeNode * pNode = _theNodes.back();
+            if( pNode->is_leaf() ) {
+                //An enabled leaf, NOTE: the disabled ones are not overlapping
+                _theCurrentCell = GridCell( *_pGrid, _theHeight, _theWord );
+                return;
+            }
+            //Go down to the left sub-node, the lattice box of the level is reused if there is one
+            const size_t depth = _theNodes.size();
+            if( _theLatticeBoxes.size() == depth ) {
+                _theLatticeBoxes.push_back( _theLatticeBoxes[ depth - 1 ] );
+            } else {
+                _theLatticeBoxes[depth] = _theLatticeBoxes[ depth - 1 ];
+            }
+            Vector<Interval> theRightLatticeBox( _theLatticeBoxes[ depth - 1 ] );
+            GridAbstractCell::split_lattice_box( _theWord.size(), _theLatticeBoxes[depth], theRightLatticeBox );
+            _theNodes.push_back( pNode->left_node() );
+            _theWord.push_back( false );
+        } else if( ! skip_current_subtree() ) {
+            return;
+        }
+    } while( true );
+}
+
+void GridTreeOverlappingConstIterator::increment() {
+    if( skip_current_subtree() ) {
+        find_next_cell();
+    }
+}
+
+bool GridTreeOverlappingConstIterator::equal( GridTreeOverlappingConstIterator const & theOtherIterator ) const {
+    if( ( _pGrid == NULL ) || ( theOtherIterator._pGrid == NULL ) ) {
+        return _pGrid == theOtherIterator._pGrid;
+    }
+    return _theCurrentCell == theOtherIterator._theCurrentCell;
+}
+
+GridCell const& GridTreeOverlappingConstIterator::dereference() const {
+    return _theCurrentCell;
+}
+
+/*********************************************LatticeCell********************************************/
+
+LatticeCell::LatticeCell( const dimension_type dimensions, const uint theHeight, const BinaryWord& theWord ) :
+    _theHeight( theHeight ), _thePathLength( theWord.size() ), _theCoordinates( dimensions, 0 ) {
+    ARIADNE_ASSERT_MSG( is_representable( dimensions, theWord.size() ),
+                        "The path of length " << theWord.size() << " has too many splits per dimension for a LatticeCell" );
+    //The i'th bit of the word is the next bit of the coordinate in the dimension i % dimensions
+    for( uint i = 0; i < theWord.size(); i++ ) {
+        coordinate_type & theCoordinate = _theCoordinates[ i % dimensions ];
+        theCoordinate = ( theCoordinate << 1 ) | ( theWord[i] ? 1 : 0 );
+    }
+}
+
+BinaryWord LatticeCell::word() const {
+    BinaryWord theWord;
+    const dimension_type dimensions = dimension();
+    for( uint i = 0; i < _thePathLength; i++ ) {
+        //Take the bits of every coordinate, most significant first
+        const dimension_type dim = i % dimensions;
+        const uint bitsLeft = subdivisions( dim ) - i / dimensions - 1;
+        theWord.push_back( ( ( _theCoordinates[dim] >> bitsLeft ) & 1 ) != 0 );
+    }
+    return theWord;
+}
+
+Vector<Interval> LatticeCell::lattice_box() const {
+    Vector<Interval> theLatticeBox( GridAbstractCell::primary_cell_lattice_box( _theHeight, dimension() ) );
+    for( dimension_type dim = 0; dim < dimension(); dim++ ) {
+        //The cell width is 2^(height - n_k), so each bound is one multiply-add. Both bounds are
+        //multiples of the width not exceeding 2^height, so they are exact for n_k <= MAX_SUBDIVISIONS
+        const Float theWidth = std::ldexp( Float(1.0), int(_theHeight) - int( subdivisions( dim ) ) );
+        const Float lower = theLatticeBox[dim].lower() + Float( _theCoordinates[dim] ) * theWidth;
+        theLatticeBox[dim].set( lower, lower + theWidth );
+    }
+    return theLatticeBox;
+}
+
+LatticeCell LatticeCell::rerooted( const uint theHeight ) const {
+    ARIADNE_ASSERT( theHeight >= _theHeight );
+    ARIADNE_ASSERT_MSG( is_representable( dimension(), _thePathLength + ( theHeight - _theHeight ) * dimension() ),
+                        "The cell rerooted to the height " << theHeight << " can not be represented by a LatticeCell" );
+    //The path from the primary cell of height i to the one of height i-1 consists of
+    //dimension() ones, for odd i, or zeroes, see GridAbstractCell::primary_cell_path. So
+    //every coordinate gets the same prefix, which has one bit per height level.
+    coordinate_type thePrefix = 0;
+    for( uint i = theHeight; i > _theHeight; i-- ) {
+        thePrefix = ( thePrefix << 1 ) | ( i % 2 );
+    }
+    LatticeCell theCell( *this );
+    theCell._theHeight = theHeight;
+    theCell._thePathLength = _thePathLength + ( theHeight - _theHeight ) * dimension();
+    for( dimension_type dim = 0; dim < dimension(); dim++ ) {
+        theCell._theCoordinates[dim] |= thePrefix << subdivisions( dim );
+    }
+    return theCell;
+}
+
+bool LatticeCell::subset( const LatticeCell& otherCell ) const {
+    ARIADNE_ASSERT( dimension() == otherCell.dimension() );
+    if( _theHeight != otherCell._theHeight ) {
+        const uint theHeight = std::max( _theHeight, otherCell._theHeight );
+        return rerooted( theHeight ).subset( otherCell.rerooted( theHeight ) );
+    }
+    //This cell is a subset if the path to otherCell is a prefix of the path to it,
+    //i.e. if the coordinates of otherCell are the leading bits of its coordinates
+    if( _thePathLength < otherCell._thePathLength ) {
+        return false;
+    }
+    for( dimension_type dim = 0; dim < dimension(); dim++ ) {
+        const uint extraSplits = subdivisions( dim ) - otherCell.subdivisions( dim );
+        if( ( _theCoordinates[dim] >> extraSplits ) != otherCell._theCoordinates[dim] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LatticeCell::operator==( const LatticeCell& otherCell ) const {
+    ARIADNE_ASSERT( dimension() == otherCell.dimension() );
+    if( _theHeight != otherCell._theHeight ) {
+        const uint theHeight = std::max( _theHeight, otherCell._theHeight );
+        return rerooted( theHeight ) == otherCell.rerooted( theHeight );
+    }
+    return ( _thePathLength == otherCell._thePathLength ) && ( _theCoordinates == otherCell._theCoordinates );
+}
+
+LatticeCell LatticeCell::neighboring_cell( const std::vector<int>& theOffsets ) const {
+    ARIADNE_ASSERT( theOffsets.size() == dimension() );
+    //1. If the neighbor sticks out of the primary cell then root the cell to the next primary
+    //   cell up. The primary cells grow downwards at the odd heights and upwards at the even
+    //   ones, see GridAbstractCell::primary_cell_at_height, so we go up at most two levels.
+    LatticeCell theCell( *this );
+    dimension_type dim = 0;
+    while( dim < dimension() ) {
+        ARIADNE_ASSERT( theOffsets[dim] >= -1 && theOffsets[dim] <= 1 );
+        if( ( theOffsets[dim] < 0 && theCell._theCoordinates[dim] == 0 ) ||
+            ( theOffsets[dim] > 0 && theCell._theCoordinates[dim] == theCell.last_coordinate( dim ) ) ) {
+            theCell = theCell.rerooted( theCell._theHeight + 1 );
+            dim = 0;
+        } else {
+            dim++;
+        }
+    }
+    //2. Now the neighbor is inside the primary cell, so we just shift the coordinates
+    for( dim = 0; dim < dimension(); dim++ ) {
+        if( theOffsets[dim] < 0 ) {
+            theCell._theCoordinates[dim] -= 1;
+        } else if( theOffsets[dim] > 0 ) {
+            theCell._theCoordinates[dim] += 1;
+        }
+    }
+    return theCell;
+}
+
+std::vector<LatticeCell> LatticeCell::neighboring_cells() const {
+    std::vector<LatticeCell> theNeighbors;
+    std::vector<int> theOffsets( dimension(), -1 );
+    //Count through the offsets in base 3, the last dimension changing most often
+    while( true ) {
+        //Skip the zero offset, it is the cell itself
+        if( std::count( theOffsets.begin(), theOffsets.end(), 0 ) != int( dimension() ) ) {
+            theNeighbors.push_back( neighboring_cell( theOffsets ) );
+        }
+        dimension_type dim = dimension();
+        while( dim > 0 && theOffsets[dim - 1] == 1 ) {
+            theOffsets[--dim] = -1;
+        }
+        if( dim == 0 ) {
+            break;
+        }
+        theOffsets[dim - 1] += 1;
+    }
+    return theNeighbors;
+}
+
+/*****************************************GridAbstractCell*******************************************/
+
+/*! \brief The corners of the primary cells of all the heights up to \a GridAbstractCell::MAX_PRIMARY_CELL_HEIGHT,
+ *  computed by the recurrence of \a GridAbstractCell::primary_cell_at_height.
+ */
+struct PrimaryCellTable {
+    int left[ GridAbstractCell::MAX_PRIMARY_CELL_HEIGHT + 1 ];
+    int right[ GridAbstractCell::MAX_PRIMARY_CELL_HEIGHT + 1 ];
+
+    PrimaryCellTable() {
+        left[0] = 0;
+        right[0] = 1;
+        for( uint i = 1; i <= GridAbstractCell::MAX_PRIMARY_CELL_HEIGHT; ++i ) {
+            //The odd heights grow downwards and the even ones upwards
+            left[i] = ( i % 2 == 1 ) ? 2 * left[i-1] - right[i-1] : left[i-1];
+            right[i] = ( i % 2 == 1 ) ? right[i-1] : 2 * right[i-1] - left[i-1];
+        }
+    }
+};
+
+static const PrimaryCellTable thePrimaryCellTable;
+
+const uint GridAbstractCell::MAX_PRIMARY_CELL_HEIGHT;
+
+void GridAbstractCell::primary_cell_corners( const uint theHeight, int & leftBottomCorner, int & rightTopCorner ) {
+    ARIADNE_ASSERT_MSG( theHeight <= MAX_PRIMARY_CELL_HEIGHT,
+                        "The primary cell of height " << theHeight << " does not fit into the lattice coordinates" );
+    leftBottomCorner = thePrimaryCellTable.left[ theHeight ];
+    rightTopCorner = thePrimaryCellTable.right[ theHeight ];
+}
+
+Vector<Interval> GridAbstractCell::primary_cell_lattice_box( const uint theHeight, const dimension_type dimensions ) {
+    int leftBottomCorner, rightTopCorner;
+    primary_cell_corners( theHeight, leftBottomCorner, rightTopCorner );
+    return Vector< Interval >( dimensions, Interval( leftBottomCorner, rightTopCorner ) );
+}
+
+//NOTE: The smallest k with 4^k > x, for x >= 1, is half of the exponent of the smallest power of two above x, rounded up
+static uint smallest_power_of_four_exponent( const Float x ) {
+    int theExponent;
+    std::frexp( x, &theExponent );
+    //Now x = m * 2^theExponent with m in [0.5,1), so 2^theExponent is the smallest power of two above x
+    return ( theExponent + 1 ) / 2;
+}
+
+//NOTE: As before, when the primary cells were computed height by height and checked with
+//      inside(), the interval has to lie in the interior of the primary cell interval.
+uint GridAbstractCell::smallest_enclosing_primary_cell_height( const Float lower, const Float upper ) {
+    //1. Estimate the height from the closed form of the corners: L(2k-1) = -(4^k - 1)/3 < lower
+    //   holds from the height 2k-1 on, and R(2k) = (2*4^k + 1)/3 > upper from the height 2k on.
+    uint height = 0;
+    if( lower <= 0 ) {
+        height = std::max( height, 2 * smallest_power_of_four_exponent( 1 - 3 * lower ) - 1 );
+    }
+    if( upper >= 1 ) {
+        height = std::max( height, 2 * smallest_power_of_four_exponent( ( 3 * upper - 1 ) / 2 ) );
+    }
+    height = std::min( height, MAX_PRIMARY_CELL_HEIGHT );
+
+    //2. The floating-point estimate can be off by one, so check it against the exact corners
+    while( height > 0 && thePrimaryCellTable.left[ height - 1 ] < lower && upper < thePrimaryCellTable.right[ height - 1 ] ) {
+        --height;
+    }
+    while( ! ( thePrimaryCellTable.left[ height ] < lower && upper < thePrimaryCellTable.right[ height ] ) ) {
+        ARIADNE_ASSERT_MSG( height < MAX_PRIMARY_CELL_HEIGHT,
+                            "The interval [" << lower << "," << upper << "] does not fit into any primary cell" );
+        ++height;
+    }
+    return height;
+}
+
+uint GridAbstractCell::smallest_enclosing_primary_cell_height( const Vector<Interval>& theLatticeBox ) {
+    if( theLatticeBox.size() == 0 ) {
+        return 0;
+    }
+    //All the dimensions have the same primary cell interval, so it has to contain the bounds of them all
+    Float lower = theLatticeBox[0].lower(), upper = theLatticeBox[0].upper();
+    for( uint i = 1; i != theLatticeBox.size(); ++i ) {
+        lower = std::min( lower, theLatticeBox[i].lower() );
+        upper = std::max( upper, theLatticeBox[i].upper() );
+    }
+    return smallest_enclosing_primary_cell_height( lower, upper );
+}
+
+uint GridAbstractCell::smallest_enclosing_primary_cell_height( const Box& theBox, const Grid& theGrid) {
+    if( theBox.size() == 0 ) {
+        return 0;
+    }
+    Float lower = 0.0, upper = 0.0;
+    for( uint i = 0; i != theBox.size(); ++i ) {
+        //Convert the box to theGrid coordinates
+        const Interval theLatticeInterval = ( theBox[i] - theGrid.origin()[i] ) / theGrid.lengths()[i];
+        lower = ( i == 0 ) ? theLatticeInterval.lower() : std::min( lower, theLatticeInterval.lower() );
+        upper = ( i == 0 ) ? theLatticeInterval.upper() : std::max( upper, theLatticeInterval.upper() );
+    }
+    //Compute and return the smallest primary cell, enclosing this box on the grid
+    return smallest_enclosing_primary_cell_height( lower, upper );
 }
 
 /*! \brief Apply grid data \a theGrid to \a theLatticeBox in order to compute the box dimensions in the original space*/
@@ -665,6 +1812,14 @@ Box GridAbstractCell::lattice_box_to_space(const Vector<Interval> & theLatticeBo
     return theTmpBox;
 }
 
+void GridAbstractCell::split_lattice_box( const uint theDepth, Vector<Interval>& theLeftLatticeBox, Vector<Interval>& theRightLatticeBox ) {
+    //The cell at depth theDepth is split in the dimension theDepth % dimensions, see compute_lattice_box
+    const uint split_dimension = theDepth % theLeftLatticeBox.size();
+    const Float middlePointInCurrDim = theLeftLatticeBox[split_dimension].midpoint();
+    theLeftLatticeBox[split_dimension].set_upper( middlePointInCurrDim );
+    theRightLatticeBox[split_dimension].set_lower( middlePointInCurrDim );
+}
+
 BinaryWord GridAbstractCell::primary_cell_path( const uint dimensions, const uint topPCellHeight, const uint bottomPCellHeight) {
     BinaryWord theBinaryPath;
         
@@ -689,37 +1844,37 @@ BinaryWord GridAbstractCell::primary_cell_path( const uint dimensions, const uin
 //the minimal primary cell height and then comparing them by height and binary words
 bool GridAbstractCell::compare_abstract_grid_cells(const GridAbstractCell * pCellLeft, const GridAbstractCell &cellRight, const uint comparator ) {
     ARIADNE_ASSERT( pCellLeft->_theGrid == cellRight._theGrid );
-    const BinaryWord * pThisWord, * pOtherWord;
-    //This is the temporary word to be used if heights are not equal
-    BinaryWord rootNodePath;
     
-    if( pCellLeft->_theHeight == cellRight._theHeight ) {
+    if( ( comparator == COMPARE_EQUAL ) && ( pCellLeft->_theHeight == cellRight._theHeight ) ) {
         //if the primary cells are of the same height, then we just compare the original binary words.
-        pThisWord = & (pCellLeft->_theWord);
-        pOtherWord = & (cellRight._theWord);
-    } else {
-        //Otherwise we have to re-root the cell with the lowest primary cell
-        //to the highest primary cell and then compare the words again,
-        if( pCellLeft->_theHeight > cellRight._theHeight ){
-            rootNodePath = primary_cell_path( pCellLeft->_theGrid.dimension() , pCellLeft->_theHeight, cellRight._theHeight );
-            rootNodePath.append( cellRight._theWord );
-            pThisWord = & (pCellLeft->_theWord);
-            pOtherWord = & (rootNodePath);
-        } else {
-            rootNodePath = primary_cell_path( pCellLeft->_theGrid.dimension() , cellRight._theHeight, pCellLeft->_theHeight );
-            rootNodePath.append( pCellLeft->_theWord );
-            pThisWord = & (rootNodePath);
-            pOtherWord = & (cellRight._theWord);
-        }
+        return pCellLeft->_theWord == cellRight._theWord;
     }
+    
+    //Otherwise we re-root both cells to the highest primary cell, the
+    //path to the lowest primary cell is filled in a limb at a time
+    const uint topPCellHeight = max( pCellLeft->_theHeight, cellRight._theHeight );
+    const PackedBinaryWord thisWord = pCellLeft->packed_word( topPCellHeight );
+    const PackedBinaryWord otherWord = cellRight.packed_word( topPCellHeight );
     switch( comparator ){
-        case COMPARE_EQUAL : return (*pThisWord) == (*pOtherWord);
-        case COMPARE_LESS : return (*pThisWord) < (*pOtherWord);
+        case COMPARE_EQUAL : return thisWord == otherWord;
+        case COMPARE_LESS : return thisWord < otherWord;
         default: 
             throw InvalidInput("The method's comparator argument should be either GridAbstractCell::COMPARE_EQUAL or GridAbstractCell::COMPARE_LESS.");
     }
 }
 
+PackedBinaryWord GridAbstractCell::packed_word( const uint topPCellHeight ) const {
+    ARIADNE_ASSERT( topPCellHeight >= _theHeight );
+    PackedBinaryWord theWord;
+    //The path between the primary cells consists of runs of length dimension(),
+    //see primary_cell_path, the run for an odd height consists of ones.
+    for( uint i = topPCellHeight; i > _theHeight; i-- ) {
+        theWord.append( ( i % 2 ) != 0, dimension() );
+    }
+    theWord.append( _theWord );
+    return theWord;
+}
+
 /*********************************************GridCell***********************************************/
 
 GridCell GridCell::split(bool isRight) const {
@@ -733,14 +1888,35 @@ GridCell GridCell::smallest_enclosing_primary_cell( const Box& theBox, const Gri
     return GridCell( theGrid, smallest_enclosing_primary_cell_height(theBox, theGrid), BinaryWord() );
 }
 
+LatticeCell GridCell::lattice_cell() const {
+    return LatticeCell( _theGrid.dimension(), _theHeight, _theWord );
+}
+
+std::vector<GridCell> GridCell::neighboring_cells() const {
+    ARIADNE_ASSERT_MSG( LatticeCell::has_representable_neighbors( _theGrid.dimension(), _theWord.size() ),
+                        "The neighbors of the cell with the path of length " << _theWord.size() << " can not be represented by a LatticeCell" );
+    const std::vector<LatticeCell> theLatticeCells = lattice_cell().neighboring_cells();
+    std::vector<GridCell> theNeighbors;
+    theNeighbors.reserve( theLatticeCells.size() );
+    for( uint i = 0; i < theLatticeCells.size(); i++ ) {
+        theNeighbors.push_back( GridCell( _theGrid, theLatticeCells[i].height(), theLatticeCells[i].word() ) );
+    }
+    return theNeighbors;
+}
+
 //Computes the box corresponding the the cell defined by the primary cell and the binary word.
 //The resulting box is not related to the original space, but is a lattice box.
 // 1. Compute the primary cell located the the height \a theHeight above the zero level,
 // 2. Compute the cell defined by the path \a theWord (from the primary cell).
 Vector<Interval> GridCell::compute_lattice_box( const uint dimensions, const uint theHeight, const BinaryWord& theWord ) {
+    //1. Use the exact integer coordinates of the cell if the path is not too long for them
+    if( LatticeCell::is_representable( dimensions, theWord.size() ) ) {
+        return LatticeCell( dimensions, theHeight, theWord ).lattice_box();
+    }
+
     Vector<Interval> theResultLatticeBox( primary_cell_lattice_box( theHeight , dimensions ) );
 
-    //2. Compute the cell on some grid, corresponding to the binary path from the primary cell.
+    //2. Otherwise compute the cell on some grid, corresponding to the binary path from the primary cell.
     uint current_dimension = 0;
     for(uint i = 0; i < theWord.size(); i++){
         //We move through the dimensions in a linear fashion
@@ -776,18 +1952,26 @@ GridOpenCell GridCell::interior() const {
 //NOTE: Here we work with the lattice boxes that are in the grid
 GridCell GridCell::neighboringCell( const Grid& theGrid, const uint theHeight, const BinaryWord& theWord, const uint dim ) {
     const uint dimensions = theGrid.dimension();
-    //1. Extend the base cell in the given dimension (dim) by its half width. This way
-    //   we are sure that we get a box that overlaps with the required neighboring cell.
-    //NOTE: This box is in the original space, but not on the lattice
+    //If the path is not too long then simply shift the integer coordinates of the cell
+    if( LatticeCell::has_representable_neighbors( dimensions, theWord.size() ) ) {
+        std::vector<int> theOffsets( dimensions, 0 );
+        theOffsets[dim] = 1;
+        const LatticeCell theNeighborCell = LatticeCell( dimensions, theHeight, theWord ).neighboring_cell( theOffsets );
+        return GridCell( theGrid, theNeighborCell.height(), theNeighborCell.word() );
+    }
+
+    //1. Compute the upper border of the base cell in the given dimension (dim). The neighboring
+    //   cell starts at this border, and extending the border by a fraction of the cell width
+    //   could be rounded away for the long paths.
     Vector<Interval> baseCellBoxInLattice =  GridCell::compute_lattice_box( dimensions, theHeight, theWord );
-    const Float upperBorderOverlapping = add_approx( baseCellBoxInLattice[dim].upper(), baseCellBoxInLattice[dim].width() / 2 );
+    const Float upperBorder = baseCellBoxInLattice[dim].upper();
 
     //2. Now check if the neighboring cell can be rooted to the given primary cell. For that
-    //   we simply use the box computed in 1. and get the primary cell that encloses it.
+    //   we get the primary cell whose upper border lies above the one computed in 1.
     //NOTE: In fact, we only need to take about the upper border, because the lower border does not change.
     int leftBottomCorner = 0, rightTopCorner = 1; uint height = 0;
     do{
-        if( upperBorderOverlapping <= rightTopCorner ) {
+        if( upperBorder < rightTopCorner ) {
             //As soon as we fall into the primary cell we are done
             break;
         }
@@ -950,8 +2134,25 @@ GridTreeSet GridOpenCell::closure() const {
     
     //04. The preparations are done, now we need to add the base cell to the
     //    resulting GridTreeSet and to compute and add the other neighboring cells.
-    BinaryWord tmpWord;
-    neighboring_cells( theResultSet.cell().height(), theBaseCellWord, tmpWord, theResultSet );
+    if( LatticeCell::has_representable_neighbors( _theGrid.dimension(), theBaseCellWord.size() ) ) {
+        //Shift the integer coordinates of the base cell in the positive axis directions
+        const LatticeCell theBaseCell( _theGrid.dimension(), theBaseCellHeight, theBaseCellWord );
+        std::vector<int> theOffsets( _theGrid.dimension(), 0 );
+        std::vector<GridCell> theNeighborCells;
+        theNeighborCells.reserve( 1u << _theGrid.dimension() );
+        for( uint position = 0; position < ( 1u << _theGrid.dimension() ); position++ ) {
+            for( uint dim = 0; dim < _theGrid.dimension(); dim++ ) {
+                theOffsets[dim] = ( position >> ( _theGrid.dimension() - 1 - dim ) ) & 1;
+            }
+            const LatticeCell theNeighborCell = theBaseCell.neighboring_cell( theOffsets );
+            theNeighborCells.push_back( GridCell( _theGrid, theNeighborCell.height(), theNeighborCell.word() ) );
+        }
+        //The cells are not recombined, the result is the same as the cells adjoined one by one below
+        theResultSet.adjoin( theNeighborCells, false );
+    } else {
+        BinaryWord tmpWord;
+        neighboring_cells( theResultSet.cell().height(), theBaseCellWord, tmpWord, theResultSet );
+    }
     
     return theResultSet;
 }
@@ -1038,6 +2239,38 @@ GridCell GridOpenCell::neighboring_cell( const Grid& theGrid, const uint theHeig
     return GridCell( theGrid, theHeight, theNeighborCellWord );
 }
 
+void GridOpenCell::cover_cell_and_borders( const GridCell& theCell, const GridTreeSet& theSet,
+                                            std::vector<GridOpenCell>& result ) {
+    const uint num_dimensions = theCell.grid().dimension();
+    if( ! LatticeCell::has_representable_neighbors( num_dimensions, theCell.word().size() ) ) {
+        //Then the neighbors have to be computed by inverting the path suffixes
+        BinaryWord tmpWord;
+        cover_cell_and_borders( theCell, theSet, tmpWord, result );
+        return;
+    }
+    //Enumerate the cell positions relative to theCell in the same order as in the recursive
+    //method, and compute the neighbors by shifting the integer coordinates of theCell
+    const LatticeCell theBaseCell = theCell.lattice_cell();
+    std::vector<int> theOffsets( num_dimensions, 0 );
+    for( uint position = 0; position < ( 1u << num_dimensions ); position++ ) {
+        for( uint dim = 0; dim < num_dimensions; dim++ ) {
+            theOffsets[dim] = ( position >> ( num_dimensions - 1 - dim ) ) & 1;
+        }
+        const LatticeCell theNeighborCell = theBaseCell.neighboring_cell( theOffsets );
+        //If the neighbor needs a higher primary cell then it is outside of theSet
+        if( theNeighborCell.height() == theCell.height() &&
+            theSet.binary_tree()->is_enabled( theNeighborCell.word() ) ) {
+            //Cover the common boundary, the directions are appended starting from the
+            //dimension in which the path of theCell is going to be split next
+            BinaryWord coverCellBaseWord = theCell.word();
+            for( uint i = 0; i < num_dimensions ; i++ ) {
+                coverCellBaseWord.push_back( theOffsets[ coverCellBaseWord.size() % num_dimensions ] != 0 );
+            }
+            result.push_back( GridOpenCell( theCell.grid(), theCell.height(), coverCellBaseWord ) );
+        }
+    }
+}
+
 void GridOpenCell::cover_cell_and_borders( const GridCell& theCell, const GridTreeSet& theSet,
                                   BinaryWord& cellPosition, std::vector<GridOpenCell>& result ) {
     const uint num_dimensions = theCell.grid().dimension();
@@ -1099,8 +2332,7 @@ std::vector<GridOpenCell> GridOpenCell::intersection( const GridOpenCell & theLe
                     //Cover the interior of the cell and the borders with the cells bordered with
                     //the given one in each  positive direction in each dimension. The borders
                     //are covered only if the neighboring cell is also in the intersection set.
-                    BinaryWord tmpWord;
-                    cover_cell_and_borders( (*it), intersectionSet, tmpWord, result );
+                    cover_cell_and_borders( (*it), intersectionSet, result );
                 }
             }
         }
@@ -1111,6 +2343,8 @@ std::vector<GridOpenCell> GridOpenCell::intersection( const GridOpenCell & theLe
 
 /********************************************GridTreeSubset*****************************************/
 
+const size_t GridTreeSubset::NOT_LOCATED;
+
 GridTreeSubset* GridTreeSubset::clone( ) const {
     // Return a GridTreeSet to ensure that memory is copied.
     return new GridTreeSet(this->grid(),this->_pRootTreeNode);
@@ -1176,14 +2410,267 @@ void GridTreeSubset::subdivide( Float theMaxCellWidth ) {
     mince_to_tree_depth(needed_num_tree_subdiv);
 }
 
-double GridTreeSubset::measure() const {
-    double result=0.0;
-    for(const_iterator iter=this->begin(); iter!=this->end(); ++iter) {
-        result+=iter->box().measure();
+double GridTreeSubset::measure() const {
+    double result=0.0;
+    for(const_iterator iter=this->begin(); iter!=this->end(); ++iter) {
+        result+=iter->box().measure();
+    }
+    return result;
+}
+
+size_t GridTreeSubset::rank( const GridCell& theCell ) const {
+    ARIADNE_ASSERT( theCell.grid() == this->grid() );
+
+    //Compute the paths to theCell and to the root of the tree from the common primary cell
+    BinaryWord pathPrefixCell, pathPrefixSet;
+    const bool isInRootCell = Ariadne::subset( theCell, this->cell(), &pathPrefixCell, &pathPrefixSet );
+    ARIADNE_ASSERT_MSG( isInRootCell, "The cell " << theCell << " is not located within the root cell " << this->cell() );
+
+    //Follow the path below the root, adding up the enabled leaves on the left of it
+    const BinaryTreeNode * pCurrentNode = this->binary_tree();
+    size_t result = 0;
+    for( size_t i = pathPrefixSet.size(); ( i < pathPrefixCell.size() ) && ! pCurrentNode->is_leaf(); i++ ) {
+        if( pathPrefixCell[i] ) {
+            result += BinaryTreeNode::count_enabled_leaf_nodes( pCurrentNode->left_node() );
+            pCurrentNode = pCurrentNode->right_node();
+        } else {
+            pCurrentNode = pCurrentNode->left_node();
+        }
+    }
+    return result;
+}
+
+GridCell GridTreeSubset::select( size_t index ) const {
+    ARIADNE_ASSERT_MSG( index < this->size(), "The index " << index << " is out of range, the set has " << this->size() << " cells" );
+
+    //Descend into the subtree that contains the leaf with the given index
+    const BinaryTreeNode * pCurrentNode = this->binary_tree();
+    BinaryWord theWord = this->cell().word();
+    while( ! pCurrentNode->is_leaf() ) {
+        const size_t leftCount = BinaryTreeNode::count_enabled_leaf_nodes( pCurrentNode->left_node() );
+        if( index < leftCount ) {
+            theWord.push_back( false );
+            pCurrentNode = pCurrentNode->left_node();
+        } else {
+            index -= leftCount;
+            theWord.push_back( true );
+            pCurrentNode = pCurrentNode->right_node();
+        }
+    }
+    return GridCell( this->grid(), this->cell().height(), theWord );
+}
+
+//The number of fixed point bits of the lattice coordinates of a point within a root cell
+static const uint LOCATE_COORDINATE_BITS = 63;
+
+//The number of points that are mapped to the lattice at once
+static const uint LOCATE_BATCH_SIZE = 64;
+
+//Computes the affine map from the space to the lattice coordinates within the root cell of theSet:
+//the coordinate of x in the dimension dim is ( x - theOffsets[dim] ) * theScales[dim]
+static void root_cell_lattice_map( const GridTreeSubset& theSet, std::vector<Float>& theOffsets, std::vector<Float>& theScales ) {
+    const Grid& theGrid = theSet.grid();
+    const dimension_type dimensions = theGrid.dimension();
+    const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( dimensions, theSet.cell().height(), theSet.cell().word() );
+    const Float theRange = std::ldexp( Float(1.0), int( LOCATE_COORDINATE_BITS ) );
+    theOffsets.resize( dimensions );
+    theScales.resize( dimensions );
+    for( dimension_type dim = 0; dim < dimensions; dim++ ) {
+        const Float theLength = theGrid.lengths()[dim];
+        theOffsets[dim] = theGrid.origin()[dim] + theLength * theLatticeBox[dim].lower();
+        theScales[dim] = theRange / ( theLength * ( theLatticeBox[dim].upper() - theLatticeBox[dim].lower() ) );
+    }
+}
+
+//Maps count points, starting with the point first, to the lattice coordinates within the root cell, the
+//coordinates of the i'th point are stored at pCoordinates[ i * dimensions ], pIsInside[i] tells if it
+//is within the root cell. The coordinates are gathered per dimension so that the scaling is vectorized.
+static void map_to_root_cell( const std::vector<Float>& theOffsets, const std::vector<Float>& theScales,
+                              const std::vector<Point>& thePoints, const size_t first, const size_t count,
+                              boost::uint64_t * pCoordinates, bool * pIsInside ) {
+    const dimension_type dimensions = theOffsets.size();
+    const Float theRange = std::ldexp( Float(1.0), int( LOCATE_COORDINATE_BITS ) );
+    Float theValues[LOCATE_BATCH_SIZE];
+    for( size_t i = 0; i < count; i++ ) {
+        ARIADNE_ASSERT( thePoints[ first + i ].dimension() == dimensions );
+        pIsInside[i] = true;
+    }
+    for( dimension_type dim = 0; dim < dimensions; dim++ ) {
+        for( size_t i = 0; i < count; i++ ) {
+            theValues[i] = thePoints[ first + i ][dim];
+        }
+        const Float theOffset = theOffsets[dim];
+        const Float theScale = theScales[dim];
+        for( size_t i = 0; i < count; i++ ) {
+            theValues[i] = ( theValues[i] - theOffset ) * theScale;
+        }
+        for( size_t i = 0; i < count; i++ ) {
+            const bool isInside = ( theValues[i] >= 0.0 ) && ( theValues[i] < theRange );
+            pIsInside[i] = pIsInside[i] && isInside;
+            pCoordinates[ i * dimensions + dim ] = isInside ? boost::uint64_t( theValues[i] ) : 0;
+        }
+    }
+}
+
+//The bit of the lattice coordinate of pCoordinates in the dimension dim that decides the half of the split theBit
+static inline bool lattice_coordinate_bit( const boost::uint64_t * pCoordinates, const dimension_type dim, const uint theBit ) {
+    return ( ( pCoordinates[dim] >> ( LOCATE_COORDINATE_BITS - 1 - theBit ) ) & 1 ) != 0;
+}
+
+//Continues the descent of descend_to_point from pNode, which is depth levels below the root of theSet, when the
+//bits of the lattice coordinates are exhausted. The half is chosen by comparing thePoint with the midpoint of the
+//lattice box of the cell, like GridCell splits it, so the deep trees are descended exactly but more slowly.
+static const BinaryTreeNode * descend_to_point_exactly( const GridTreeSubset& theSet, const Point& thePoint, const boost::uint64_t * pCoordinates,
+                                                        const BinaryTreeNode * pNode, const uint depth, BinaryWord * pWord, size_t * pRank ) {
+    const Grid& theGrid = theSet.grid();
+    const dimension_type dimensions = theGrid.dimension();
+    //1. Recover the path from the primary cell to pNode, pWord may not be given
+    BinaryWord theWord = theSet.cell().word();
+    const uint theRootLength = theWord.size();
+    for( uint i = 0; i < depth; i++ ) {
+        theWord.push_back( lattice_coordinate_bit( pCoordinates, ( theRootLength + i ) % dimensions, i / dimensions ) );
+    }
+    //2. Descend comparing the lattice coordinates of the point with the midpoints of the cells
+    Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( dimensions, theSet.cell().height(), theWord );
+    while( ! pNode->is_leaf() ) {
+        const dimension_type dim = theWord.size() % dimensions;
+        const Float theMidpoint = theLatticeBox[dim].midpoint();
+        const bool isRight = ( thePoint[dim] - theGrid.origin()[dim] ) / theGrid.lengths()[dim] >= theMidpoint;
+        theLatticeBox[dim] = isRight ? Interval( theMidpoint, theLatticeBox[dim].upper() ) : Interval( theLatticeBox[dim].lower(), theMidpoint );
+        theWord.push_back( isRight );
+        if( pWord != NULL ) {
+            pWord->push_back( isRight );
+        }
+        if( isRight ) {
+            if( pRank != NULL ) {
+                *pRank += BinaryTreeNode::count_enabled_leaf_nodes( pNode->left_node() );
+            }
+            pNode = pNode->right_node();
+        } else {
+            pNode = pNode->left_node();
+        }
+    }
+    return pNode;
+}
+
+//Descends from the root of theSet to the leaf containing thePoint with the lattice coordinates pCoordinates.
+//The path is appended to pWord and the enabled leaves on the left of the leaf are added to pRank, if not NULL.
+static const BinaryTreeNode * descend_to_point( const GridTreeSubset& theSet, const Point& thePoint, const boost::uint64_t * pCoordinates,
+                                                BinaryWord * pWord, size_t * pRank ) {
+    const dimension_type dimensions = theSet.grid().dimension();
+    const size_t theRootLength = theSet.cell().word().size();
+    const BinaryTreeNode * pNode = theSet.binary_tree();
+    for( uint depth = 0; ! pNode->is_leaf(); depth++ ) {
+        //The dimensions are split in turn, so every dimension has been split depth / dimensions
+        //times below the root, and the next bit of its coordinate decides the half to go to
+        const dimension_type dim = ( theRootLength + depth ) % dimensions;
+        const uint theBit = depth / dimensions;
+        if( theBit >= LOCATE_COORDINATE_BITS ) {
+            //The cell is split more often than the coordinates have bits, the rest of the path is found exactly
+            return descend_to_point_exactly( theSet, thePoint, pCoordinates, pNode, depth, pWord, pRank );
+        }
+        const bool isRight = lattice_coordinate_bit( pCoordinates, dim, theBit );
+        if( pWord != NULL ) {
+            pWord->push_back( isRight );
+        }
+        if( isRight ) {
+            if( pRank != NULL ) {
+                *pRank += BinaryTreeNode::count_enabled_leaf_nodes( pNode->left_node() );
+            }
+            pNode = pNode->right_node();
+        } else {
+            pNode = pNode->left_node();
+        }
+    }
+    return pNode;
+}
+
+//Locates all the points in theSet, see GridTreeSubset::locate, the ranks are only computed if computeRanks is true
+static std::vector<size_t> locate_points( const GridTreeSubset& theSet, const std::vector<Point>& thePoints, const bool computeRanks ) {
+    std::vector<size_t> theIndices( thePoints.size(), GridTreeSubset::NOT_LOCATED );
+    std::vector<Float> theOffsets, theScales;
+    root_cell_lattice_map( theSet, theOffsets, theScales );
+    const dimension_type dimensions = theSet.grid().dimension();
+    std::vector<boost::uint64_t> theCoordinates( LOCATE_BATCH_SIZE * std::max( dimensions, dimension_type(1) ) );
+    bool isInside[LOCATE_BATCH_SIZE];
+    for( size_t first = 0; first < thePoints.size(); first += LOCATE_BATCH_SIZE ) {
+        const size_t count = std::min( size_t( LOCATE_BATCH_SIZE ), thePoints.size() - first );
+        map_to_root_cell( theOffsets, theScales, thePoints, first, count, &theCoordinates[0], isInside );
+        for( size_t i = 0; i < count; i++ ) {
+            if( isInside[i] ) {
+                size_t theRank = 0;
+                const BinaryTreeNode * pLeaf = descend_to_point( theSet, thePoints[ first + i ], &theCoordinates[ i * dimensions ], NULL,
+                                                                 computeRanks ? &theRank : NULL );
+                if( pLeaf->is_enabled() ) {
+                    theIndices[ first + i ] = theRank;
+                }
+            }
+        }
+    }
+    return theIndices;
+}
+
+GridCell GridTreeSubset::locate( const Point& thePoint ) const {
+    std::vector<Float> theOffsets, theScales;
+    root_cell_lattice_map( *this, theOffsets, theScales );
+    const std::vector<Point> thePoints( 1, thePoint );
+    std::vector<boost::uint64_t> theCoordinates( std::max( this->grid().dimension(), 1u ) );
+    bool isInside;
+    map_to_root_cell( theOffsets, theScales, thePoints, 0, 1, &theCoordinates[0], &isInside );
+    ARIADNE_ASSERT_MSG( isInside, "The point " << thePoint << " is not located within the root cell " << this->cell() );
+
+    BinaryWord theWord = this->cell().word();
+    descend_to_point( *this, thePoint, &theCoordinates[0], &theWord, NULL );
+    return GridCell( this->grid(), this->cell().height(), theWord );
+}
+
+std::vector<size_t> GridTreeSubset::locate( const std::vector<Point>& thePoints ) const {
+    return locate_points( *this, thePoints, true );
+}
+
+std::vector<bool> GridTreeSubset::contains( const std::vector<Point>& thePoints ) const {
+    const std::vector<size_t> theIndices = locate_points( *this, thePoints, false );
+    std::vector<bool> result( theIndices.size() );
+    for( size_t i = 0; i < theIndices.size(); i++ ) {
+        result[i] = ( theIndices[i] != NOT_LOCATED );
     }
     return result;
 }
 
+boost::uint64_t GridTreeSubset::hash() const {
+    //1. The equal root cells can be rooted to different primary cells, see GridCell::operator==,
+    //so the cell is rerooted to the lowest primary cell that contains it, by skipping the path
+    //between the primary cells, see GridAbstractCell::primary_cell_path
+    const BinaryWord& theWord = _theGridCell.word();
+    const uint dimensions = _theGridCell.dimension();
+    uint theHeight = _theGridCell.height();
+    size_t start = 0;
+    while( ( theHeight > 0 ) && ( dimensions > 0 ) && ( start + dimensions <= theWord.size() ) ) {
+        bool isPrimaryPath = true;
+        for( uint j = 0; ( j < dimensions ) && isPrimaryPath; j++ ) {
+            isPrimaryPath = ( theWord[start + j] == ( theHeight % 2 != 0 ) );
+        }
+        if( ! isPrimaryPath ) {
+            break;
+        }
+        start += dimensions;
+        theHeight--;
+    }
+    //2. Mix in the height and the remaining path, up to 63 bits at a time
+    boost::uint64_t result = mix_hash( theHeight + 0x9e3779b97f4a7c15ULL );
+    boost::uint64_t theBits = 1;
+    for( size_t i = start; i < theWord.size(); i++ ) {
+        theBits = ( theBits << 1 ) | ( theWord[i] ? 1 : 0 );
+        if( ( i + 1 - start ) % 63 == 0 ) {
+            result = mix_hash( result ^ theBits );
+            theBits = 1;
+        }
+    }
+    result = mix_hash( result ^ theBits );
+    //3. Mix in the hash of the tree
+    return mix_hash( result ^ BinaryTreeNode::hash( this->binary_tree() ) );
+}
+
 
 
 GridTreeSubset::operator ListSet<Box>() const {
@@ -1201,11 +2688,11 @@ GridTreeSubset::operator ListSet<Box>() const {
 }
 
 tribool GridTreeSubset::covers( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                                const uint theHeight, BinaryWord &theWord, const Box& theBox ) {
+                                const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox ) {
     tribool result;
     
     //Check if the current node's cell intersects with theBox
-    Box theCellsBox = GridCell::compute_box( theGrid, theHeight, theWord );
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
     tribool doIntersect = theCellsBox.overlaps( theBox );
     
     if( ! doIntersect ) {
@@ -1230,9 +2717,10 @@ tribool GridTreeSubset::covers( const BinaryTreeNode* pCurrentNode, const Grid&
         } else {
             //The node is not a leaf so we need to go down and see if the cell
             //falls into sub cells for which we can sort things out
-            theWord.push_back(false);
-            const tribool result_left = covers( pCurrentNode->left_node(), theGrid, theHeight, theWord, theBox );
-            theWord.pop_back();
+            //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+            Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+            GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+            const tribool result_left = covers( pCurrentNode->left_node(), theGrid, theDepth + 1, theLeftLatticeBox, theBox );
             
             if( ! result_left) {
                 //If there is definitely no covering property then this is all
@@ -1241,9 +2729,7 @@ tribool GridTreeSubset::covers( const BinaryTreeNode* pCurrentNode, const Grid&
             } else {
                 //If the covering property holds or is possible, then we still
                 //need to check the second branch because it can change the outcome.
-                theWord.push_back(true);
-                const tribool result_right = covers( pCurrentNode->right_node(), theGrid, theHeight, theWord, theBox );
-                theWord.pop_back();
+                const tribool result_right = covers( pCurrentNode->right_node(), theGrid, theDepth + 1, theRightLatticeBox, theBox );
                 
                 if( !result_right ) {
                     //IF: The right sub-node reports false, then the result is false
@@ -1271,49 +2757,364 @@ tribool GridTreeSubset::covers( const BinaryTreeNode* pCurrentNode, const Grid&
 }
 
 tribool GridTreeSubset::subset( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                                const uint theHeight, BinaryWord &theWord, const Box& theBox ) {
+                                const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox ) {
+    tribool result;
+    
+    //Check if the current node overlaps with theBox
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
+    tribool isASubset = theCellsBox.subset( theBox );
+    
+    if( isASubset ){
+        //It does not matter if pCurrentNode has enabled leaves or not we already know that the cell
+        //corresponding to this node is geometrically a subset of theBox.
+        result = true;
+    } else {
+        //If the cell corresponding to pCurrentNode is not a subset, then
+        if( pCurrentNode->is_leaf() && ! isASubset ) {
+            //If pCurrentNode is a leaf node and geometrically the cell (corresponding to the node theCellsBox) is not a
+            //subset of theBox, then: if it is enabled then pCurrentNode is not a subset of theBox but otherwise it is.
+            result = ! pCurrentNode->is_enabled();
+        } else {
+            if( pCurrentNode->is_leaf() && indeterminate( isASubset ) ) {
+                //If we are in a leaf node but we do not know for sure if the given cell
+                //is a subset of theBox then we can only check if it is enabled or not
+                if( pCurrentNode->is_enabled() ){
+                    //For an enabled-leaf node (a filled cell) we do not know if it is a subset of theBox
+                    result = indeterminate;
+                } else {
+                    //The node is disabled, so it represents an empty set, which is a subset of any set
+                    result = true;
+                }
+            } else {
+                //The node is not a leaf, and we either know that the cell of pCurrentNode is not a geometrical subset
+                //of theBox or we are not sure that it is, This means that we can do recursion to sort things out.
+                //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+                Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+                GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+                const tribool result_left = subset( pCurrentNode->left_node(), theGrid, theDepth + 1, theLeftLatticeBox, theBox );
+                
+                if( !result_left ) {
+                    //If the left branch is not a subset, then there is no need to check the right one
+                    result = false;
+                } else {
+                    //if we still do not know the answer, then we check the right branch
+                    const tribool result_right = subset( pCurrentNode->right_node(), theGrid, theDepth + 1, theRightLatticeBox, theBox );
+                    
+                    if( !result_right ) {
+                        //IF: The right sub-node reports false, then the result is false
+                        //NOTE: We already sorted out the case of ( (!result_left) == true) before
+                        result = false;
+                    } else {
+                        if( result_left && result_right ) {
+                            //ELSE: If both sub-nodes report true then it is true
+                            result = true;
+                        } else {
+                            if( indeterminate(result_left) || indeterminate(result_right) ) {
+                                //ELSE: If one of the sub-nodes reports indeterminate then indeterminate,
+                                result = indeterminate;
+                            } else {
+                                //ELSE: An impossible situation
+                                ARIADNE_ASSERT( false );
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    return result;
+}
+
+tribool GridTreeSubset::disjoint( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
+                                  const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox ) {
+    tribool intersect;
+    
+    //Check if the current node overlaps with theBox
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
+    tribool doPossiblyIntersect = !theCellsBox.disjoint( theBox );
+    
+    if( doPossiblyIntersect || indeterminate( doPossiblyIntersect ) ) {
+        //If there is a possible intersection then we do the checking
+        if( pCurrentNode->is_leaf() ) {
+            //If this is a leaf node then
+            if( pCurrentNode->is_enabled() ){
+                //If the node is enabled, then we have a possible intersection
+                intersect = doPossiblyIntersect;
+            } else {
+                //Since the node is disabled, there can be no intersection
+                intersect = false;
+            }
+        } else {
+            //The node is not a leaf and the intersection is possible so check the left sub-node
+            //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+            Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+            GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+            const tribool intersect_left = overlaps( pCurrentNode->left_node(), theGrid, theDepth + 1, theLeftLatticeBox, theBox );
+            
+            //
+            //WARNING: I know how to write a shorter code, like:
+            //          if( ! ( intersect = definitely( intersect_left ) ) ) {
+            //              ...
+            //          }
+            // I DO NOT DO THIS ON PERPOSE, KEEP THE CODE EASILY UNDERSTANDABLE!
+            //
+            if( intersect_left ) {
+                //If we definitely have intersection for the left branch then answer is true
+                intersect = true;
+            } else {
+                //If we still not sure/ or do not know then try to search further, i.e. check the right node
+                const tribool intersect_right = overlaps( pCurrentNode->right_node(), theGrid, theDepth + 1, theRightLatticeBox, theBox );
+                if( intersect_right ) {
+                    //If we definitely have intersection for the right branch then answer is true
+                    intersect = true;
+                } else {
+                    //Now either we have indeterminate answers or we do not know, if one
+                    //if the answers for one of the branches was indeterminate then we
+                    //report indeterminate, otherwise it is definitely false.
+                    if( indeterminate( intersect_left ) || indeterminate( intersect_right )  ) {
+                        intersect = indeterminate;
+                    } else {
+                        intersect = false;
+                    }
+                    //ERROR: Substituting the above if statement with the following conditional assignment DOES NOT WORK:
+                    //    intersect = ( ( indeterminate( intersect_left ) || indeterminate( intersect_right ) ) ? indeterminate : false );
+                    //In this case, if we need to assign false, the proper branch of the conditional statement is executed,
+                    //but somehow the value of the "intersect" variable becomes indeterminate!
+                }
+            }
+        }
+    } else {
+        //If there is no intersection then we just stop with a negative intersect
+        intersect = false;
+    }
+    
+    return !intersect;
+}
+
+tribool GridTreeSubset::overlaps( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
+                                  const uint theDepth, const Vector<Interval>& theLatticeBox, const Box& theBox ) {
+    tribool result;
+    
+    //Check if the current node overlaps with theBox
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
+    tribool doPossiblyIntersect = theCellsBox.overlaps( theBox );
+    
+    if( doPossiblyIntersect || indeterminate( doPossiblyIntersect ) ) {
+        //If there is a possible intersection then we do the checking
+        if( pCurrentNode->is_leaf() ) {
+            //If this is a leaf node then
+            if( pCurrentNode->is_enabled() ){
+                //If the node is enabled, then we have a possible intersection
+                result = doPossiblyIntersect;
+            } else {
+                //Since the node is disabled, there can be no intersection
+                result = false;
+            }
+        } else {
+            //The node is not a leaf and the intersection is possible so check the left sub-node
+            //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+            Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+            GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+            const tribool result_left = overlaps( pCurrentNode->left_node(), theGrid, theDepth + 1, theLeftLatticeBox, theBox );
+            
+            //
+            //WARNING: I know how to write a shorter code, like:
+            //          if( ! ( result = definitely( result_left ) ) ) {
+            //              ...
+            //          }
+            // I DO NOT DO THIS ON PERPOSE, KEEP THE CODE EASILY UNDERSTANDABLE!
+            //
+            if( result_left ) {
+                //If we definitely have intersection for the left branch then answer is true
+                result = true;
+            } else {
+                //If we still not sure/ or do not know then try to search further, i.e. check the right node
+                const tribool result_right = overlaps( pCurrentNode->right_node(), theGrid, theDepth + 1, theRightLatticeBox, theBox );
+                if( result_right ) {
+                    //If we definitely have intersection for the right branch then answer is true
+                    result = true;
+                } else {
+                    //Now either we have indeterminate answers or we do not know, if one
+                    //if the answers for one of the branches was indeterminate then we
+                    //report indeterminate, otherwise it is definitely false.
+                    if( indeterminate( result_left ) || indeterminate( result_right )  ) {
+                        result = indeterminate;
+                    } else {
+                        result = false;
+                    }
+                    //ERROR: Substituting the above if statement with the following conditional assignment DOES NOT WORK:
+                    //    result = ( ( indeterminate( result_left ) || indeterminate( result_right ) ) ? indeterminate : false );
+                    //In this case, if we need to assign false, the proper branch of the conditional statement is executed,
+                    //but somehow the value of the "result" variable becomes indeterminate!
+                }
+            }
+        }
+    } else {
+        //If there is no intersection then we just stop with a negative result
+        result = false;
+    }
+    
+    return result;
+}
+
+/*! \brief Walks through the nodes of a FrozenGridTreeSet in the depth first order, which is
+ *  the order of the nodes in its structure bits, for the predicates on boxes below.
+ */
+class FrozenGridTreeWalker {
+    const FrozenGridTreeSet & _theSet;
+    size_t _theNode;
+  public:
+    explicit FrozenGridTreeWalker( const FrozenGridTreeSet & theSet ) : _theSet( theSet ), _theNode( FrozenGridTreeSet::ROOT ) { }
+
+    bool is_leaf() const { return _theSet.is_leaf( _theNode ); }
+    bool is_enabled() const { return _theSet.is_enabled( _theNode ); }
+
+    //Moves from the current non-leaf node to its left sub-node
+    void go_left() {
+        _theNode = _theSet.left_node( _theNode );
+    }
+
+    //Moves to the node right after the subtree of the current node
+    void skip_subtree() {
+        _theNode = ( _theSet.is_leaf( _theNode ) ? _theNode : _theSet.subtree_end( _theNode ) ) + 1;
+    }
+};
+
+//The predicates on boxes of FrozenGridTreeSet, the recursions of GridTreeSubset::covers, subset, disjoint and
+//overlaps on the nodes visited in the depth first order by a walker, see FrozenGridTreeWalker. On entry theNode
+//is at the node whose cell lies at the depth theDepth below its primary cell and has the lattice box theLatticeBox,
+//on exit theNode is right after the subtree of this node, see FrozenGridTreeWalker::skip_subtree.
+template<class WALKER> static tribool covers_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                  const Vector<Interval>& theLatticeBox, const Box& theBox );
+template<class WALKER> static tribool subset_of_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                     const Vector<Interval>& theLatticeBox, const Box& theBox );
+template<class WALKER> static tribool disjoint_from_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                         const Vector<Interval>& theLatticeBox, const Box& theBox );
+template<class WALKER> static tribool overlaps_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                    const Vector<Interval>& theLatticeBox, const Box& theBox );
+
+template<class WALKER> static tribool covers_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                  const Vector<Interval>& theLatticeBox, const Box& theBox ) {
+    tribool result;
+    
+    //Check if the current node's cell intersects with theBox
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
+    tribool doIntersect = theCellsBox.overlaps( theBox );
+    
+    if( ! doIntersect ) {
+        //If theBox does not intersect with the cell then for the covering relation
+        //is is not important if we add or remove this cell, so we return true
+        result = true;
+        theNode.skip_subtree();
+    } else {
+        //If the cell possibly intersects with theBox then
+        if( theNode.is_leaf() ) {
+            if( theNode.is_enabled() ){
+                //If this is an enabled node that possibly or definitely intersects
+                //with theBox then the covering property is fine, so we return true
+                result = true;
+            } else {
+                //If the node is disabled then if it definitely intersects with theBox
+                //we have to report false, as there is not covering, in case it is only
+                //possible intersecting with theBox then we return possibly. The latter
+                //is because we are not completely sure, if the intersection does not
+                //have place then the covering property is not broken.
+                result = ! doIntersect;
+            }
+            theNode.skip_subtree();
+        } else {
+            //The node is not a leaf so we need to go down and see if the cell
+            //falls into sub cells for which we can sort things out
+            //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+            Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+            GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+            theNode.go_left();
+            const tribool result_left = covers_box( theNode, theGrid, theDepth + 1, theLeftLatticeBox, theBox );
+            
+            if( ! result_left) {
+                //If there is definitely no covering property then this is all
+                //we need to know so there is not need to check the other branch.
+                result = false;
+                theNode.skip_subtree();
+            } else {
+                //If the covering property holds or is possible, then we still
+                //need to check the second branch because it can change the outcome.
+                const tribool result_right = covers_box( theNode, theGrid, theDepth + 1, theRightLatticeBox, theBox );
+                
+                if( !result_right ) {
+                    //IF: The right sub-node reports false, then the result is false
+                    //NOTE: We already sorted out the case of ( (!result_left) == true) before
+                    result = false;
+                } else {
+                    if( result_left && result_right ) {
+                        //ELSE: If both sub-nodes report true then it is true
+                        result = true;
+                    } else {
+                        if( indeterminate(result_left) || indeterminate(result_right) ) {
+                            //ELSE: If one of the sub-nodes reports indeterminate then indeterminate,
+                            result = indeterminate;
+                        } else {
+                            //ELSE: An impossible situation
+                            ARIADNE_ASSERT( false );
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    return result;
+}
+
+template<class WALKER> static tribool subset_of_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                     const Vector<Interval>& theLatticeBox, const Box& theBox ) {
     tribool result;
     
     //Check if the current node overlaps with theBox
-    Box theCellsBox = GridCell::compute_box( theGrid, theHeight, theWord );
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
     tribool isASubset = theCellsBox.subset( theBox );
     
     if( isASubset ){
-        //It does not matter if pCurrentNode has enabled leaves or not we already know that the cell
+        //It does not matter if the node has enabled leaves or not we already know that the cell
         //corresponding to this node is geometrically a subset of theBox.
         result = true;
+        theNode.skip_subtree();
     } else {
-        //If the cell corresponding to pCurrentNode is not a subset, then
-        if( pCurrentNode->is_leaf() && ! isASubset ) {
-            //If pCurrentNode is a leaf node and geometrically the cell (corresponding to the node theCellsBox) is not a
-            //subset of theBox, then: if it is enabled then pCurrentNode is not a subset of theBox but otherwise it is.
-            result = ! pCurrentNode->is_enabled();
+        //If the cell corresponding to the node is not a subset, then
+        if( theNode.is_leaf() && ! isASubset ) {
+            //If the node is a leaf node and geometrically the cell (corresponding to the node theCellsBox) is not a
+            //subset of theBox, then: if it is enabled then the node is not a subset of theBox but otherwise it is.
+            result = ! theNode.is_enabled();
+            theNode.skip_subtree();
         } else {
-            if( pCurrentNode->is_leaf() && indeterminate( isASubset ) ) {
+            if( theNode.is_leaf() && indeterminate( isASubset ) ) {
                 //If we are in a leaf node but we do not know for sure if the given cell
                 //is a subset of theBox then we can only check if it is enabled or not
-                if( pCurrentNode->is_enabled() ){
+                if( theNode.is_enabled() ){
                     //For an enabled-leaf node (a filled cell) we do not know if it is a subset of theBox
                     result = indeterminate;
                 } else {
                     //The node is disabled, so it represents an empty set, which is a subset of any set
                     result = true;
                 }
+                theNode.skip_subtree();
             } else {
-                //The node is not a leaf, and we either know that the cell of pCurrentNode is not a geometrical subset
+                //The node is not a leaf, and we either know that the cell of the node is not a geometrical subset
                 //of theBox or we are not sure that it is, This means that we can do recursion to sort things out.
-                theWord.push_back(false);
-                const tribool result_left = subset( pCurrentNode->left_node(), theGrid, theHeight, theWord, theBox );
-                theWord.pop_back();
+                //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+                Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+                GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+                theNode.go_left();
+                const tribool result_left = subset_of_box( theNode, theGrid, theDepth + 1, theLeftLatticeBox, theBox );
                 
                 if( !result_left ) {
                     //If the left branch is not a subset, then there is no need to check the right one
                     result = false;
+                    theNode.skip_subtree();
                 } else {
                     //if we still do not know the answer, then we check the right branch
-                    theWord.push_back(true);
-                    const tribool result_right = subset( pCurrentNode->right_node(), theGrid, theHeight, theWord, theBox );
-                    theWord.pop_back();
+                    const tribool result_right = subset_of_box( theNode, theGrid, theDepth + 1, theRightLatticeBox, theBox );
                     
                     if( !result_right ) {
                         //IF: The right sub-node reports false, then the result is false
@@ -1341,30 +3142,33 @@ tribool GridTreeSubset::subset( const BinaryTreeNode* pCurrentNode, const Grid&
     return result;
 }
 
-tribool GridTreeSubset::disjoint( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                                  const uint theHeight, BinaryWord &theWord, const Box& theBox ) {
+template<class WALKER> static tribool disjoint_from_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                         const Vector<Interval>& theLatticeBox, const Box& theBox ) {
     tribool intersect;
     
     //Check if the current node overlaps with theBox
-    Box theCellsBox = GridCell::compute_box( theGrid, theHeight, theWord );
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
     tribool doPossiblyIntersect = !theCellsBox.disjoint( theBox );
     
     if( doPossiblyIntersect || indeterminate( doPossiblyIntersect ) ) {
         //If there is a possible intersection then we do the checking
-        if( pCurrentNode->is_leaf() ) {
+        if( theNode.is_leaf() ) {
             //If this is a leaf node then
-            if( pCurrentNode->is_enabled() ){
+            if( theNode.is_enabled() ){
                 //If the node is enabled, then we have a possible intersection
                 intersect = doPossiblyIntersect;
             } else {
                 //Since the node is disabled, there can be no intersection
                 intersect = false;
             }
+            theNode.skip_subtree();
         } else {
             //The node is not a leaf and the intersection is possible so check the left sub-node
-            theWord.push_back(false);
-            const tribool intersect_left = overlaps( pCurrentNode->left_node(), theGrid, theHeight, theWord, theBox );
-            theWord.pop_back();
+            //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+            Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+            GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+            theNode.go_left();
+            const tribool intersect_left = overlaps_box( theNode, theGrid, theDepth + 1, theLeftLatticeBox, theBox );
             
             //
             //WARNING: I know how to write a shorter code, like:
@@ -1376,11 +3180,10 @@ tribool GridTreeSubset::disjoint( const BinaryTreeNode* pCurrentNode, const Grid
             if( intersect_left ) {
                 //If we definitely have intersection for the left branch then answer is true
                 intersect = true;
+                theNode.skip_subtree();
             } else {
                 //If we still not sure/ or do not know then try to search further, i.e. check the right node
-                theWord.push_back(true);
-                const tribool intersect_right = overlaps( pCurrentNode->right_node(), theGrid, theHeight, theWord, theBox );
-                theWord.pop_back();
+                const tribool intersect_right = overlaps_box( theNode, theGrid, theDepth + 1, theRightLatticeBox, theBox );
                 if( intersect_right ) {
                     //If we definitely have intersection for the right branch then answer is true
                     intersect = true;
@@ -1403,35 +3206,39 @@ tribool GridTreeSubset::disjoint( const BinaryTreeNode* pCurrentNode, const Grid
     } else {
         //If there is no intersection then we just stop with a negative intersect
         intersect = false;
+        theNode.skip_subtree();
     }
     
     return !intersect;
 }
 
-tribool GridTreeSubset::overlaps( const BinaryTreeNode* pCurrentNode, const Grid& theGrid,
-                                  const uint theHeight, BinaryWord &theWord, const Box& theBox ) {
+template<class WALKER> static tribool overlaps_box( WALKER & theNode, const Grid& theGrid, const uint theDepth,
+                                                    const Vector<Interval>& theLatticeBox, const Box& theBox ) {
     tribool result;
     
     //Check if the current node overlaps with theBox
-    Box theCellsBox = GridCell::compute_box( theGrid, theHeight, theWord );
+    Box theCellsBox = GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid );
     tribool doPossiblyIntersect = theCellsBox.overlaps( theBox );
     
     if( doPossiblyIntersect || indeterminate( doPossiblyIntersect ) ) {
         //If there is a possible intersection then we do the checking
-        if( pCurrentNode->is_leaf() ) {
+        if( theNode.is_leaf() ) {
             //If this is a leaf node then
-            if( pCurrentNode->is_enabled() ){
+            if( theNode.is_enabled() ){
                 //If the node is enabled, then we have a possible intersection
                 result = doPossiblyIntersect;
             } else {
                 //Since the node is disabled, there can be no intersection
                 result = false;
             }
+            theNode.skip_subtree();
         } else {
             //The node is not a leaf and the intersection is possible so check the left sub-node
-            theWord.push_back(false);
-            const tribool result_left = overlaps( pCurrentNode->left_node(), theGrid, theHeight, theWord, theBox );
-            theWord.pop_back();
+            //Halve the lattice box of the cell to get the lattice boxes of its sub cells
+            Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+            GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+            theNode.go_left();
+            const tribool result_left = overlaps_box( theNode, theGrid, theDepth + 1, theLeftLatticeBox, theBox );
             
             //
             //WARNING: I know how to write a shorter code, like:
@@ -1443,11 +3250,10 @@ tribool GridTreeSubset::overlaps( const BinaryTreeNode* pCurrentNode, const Grid
             if( result_left ) {
                 //If we definitely have intersection for the left branch then answer is true
                 result = true;
+                theNode.skip_subtree();
             } else {
                 //If we still not sure/ or do not know then try to search further, i.e. check the right node
-                theWord.push_back(true);
-                const tribool result_right = overlaps( pCurrentNode->right_node(), theGrid, theHeight, theWord, theBox );
-                theWord.pop_back();
+                const tribool result_right = overlaps_box( theNode, theGrid, theDepth + 1, theRightLatticeBox, theBox );
                 if( result_right ) {
                     //If we definitely have intersection for the right branch then answer is true
                     result = true;
@@ -1470,6 +3276,7 @@ tribool GridTreeSubset::overlaps( const BinaryTreeNode* pCurrentNode, const Grid
     } else {
         //If there is no intersection then we just stop with a negative result
         result = false;
+        theNode.skip_subtree();
     }
     
     return result;
@@ -1545,26 +3352,37 @@ GridTreeSet::GridTreeSet( const Grid& theGrid, uint theHeight, const BooleanArra
     //Use the super class constructor and the binary tree constructed from the arrays: theTree and theEnabledCells
 }
 
+GridTreeSet::GridTreeSet( const Grid& theGrid, const std::vector<GridCell>& theCells ) :
+    GridTreeSubset( theGrid, 0, BinaryWord(), new BinaryTreeNode( false ) ) {
+    this->adjoin( theCells );
+}
+
 GridTreeSet::GridTreeSet( const GridTreeSet & theGridTreeSet ) :
     GridTreeSubset( theGridTreeSet._theGridCell.grid(), theGridTreeSet._theGridCell.height(),
-                    theGridTreeSet._theGridCell.word(), new BinaryTreeNode( *theGridTreeSet._pRootTreeNode )) {
-    //Call the super constructor: Create an exact copy of the tree, copy the bounding box
+                    theGridTreeSet._theGridCell.word(), BinaryTreeNode::shallow_copy( theGridTreeSet._pRootTreeNode ) ) {
+    //Call the super constructor: Create a copy of the tree sharing the sub-nodes, copy the bounding box
 }
 
 GridTreeSet& GridTreeSet::operator=( const GridTreeSet & theGridTreeSet ) {
-    //Delete the old tree and make a new one
+    //Make a new tree sharing the sub-nodes with the other one and delete the old tree
     if(this!=&theGridTreeSet) {
+        BinaryTreeNode * pRootTreeNode = BinaryTreeNode::shallow_copy( theGridTreeSet._pRootTreeNode );
         if( GridTreeSubset::_pRootTreeNode != NULL){
             delete GridTreeSubset::_pRootTreeNode;
             GridTreeSubset::_pRootTreeNode = NULL;
         }
         static_cast<GridTreeSubset&>(*this) = 
             GridTreeSubset( theGridTreeSet._theGridCell.grid(), theGridTreeSet._theGridCell.height(),
-                            theGridTreeSet._theGridCell.word(), new BinaryTreeNode( *theGridTreeSet._pRootTreeNode ));
+                            theGridTreeSet._theGridCell.word(), pRootTreeNode );
     }
     return *this;
 }
 
+void GridTreeSet::swap( GridTreeSet& theOtherSet ) {
+    std::swap( GridTreeSubset::_pRootTreeNode, theOtherSet._pRootTreeNode );
+    std::swap( GridTreeSubset::_theGridCell, theOtherSet._theGridCell );
+}
+
 GridTreeSet* GridTreeSet::clone() const {
     return new GridTreeSet( *this );
 }
@@ -1590,6 +3408,69 @@ void GridTreeSet::up_to_primary_cell( const uint toPCellHeight ){
     this->_theGridCell = GridCell( this->_theGridCell.grid(), toPCellHeight, BinaryWord() );
 }
 
+//Makes the node an enabled leaf if its sub-nodes are both enabled leaves
+static void recombine_enabled_leaves( BinaryTreeNode * pNode ) {
+    const BinaryTreeNode * pConstNode = pNode;
+    if( ! pConstNode->is_leaf() && pConstNode->left_node()->is_enabled() && pConstNode->right_node()->is_enabled() ) {
+        pNode->make_leaf( true );
+    }
+}
+
+void GridTreeSet::adjoin( const std::vector<GridCell>& theCells, const bool recombine_leaves ) {
+    if( theCells.empty() ) {
+        return;
+    }
+    //1. Re-root the set once, to the highest primary cell
+    uint theHeight = this->cell().height();
+    for( std::vector<GridCell>::const_iterator it = theCells.begin(); it != theCells.end(); ++it ) {
+        ARIADNE_ASSERT( this->grid() == it->grid() );
+        theHeight = std::max( theHeight, it->height() );
+    }
+    if( this->cell().height() < theHeight ) {
+        up_to_primary_cell( theHeight );
+    }
+    //2. Sort the paths from this primary cell, a cell comes before the cells it contains
+    std::vector<PackedBinaryWord> thePaths;
+    thePaths.reserve( theCells.size() );
+    for( std::vector<GridCell>::const_iterator it = theCells.begin(); it != theCells.end(); ++it ) {
+        thePaths.push_back( it->packed_word( theHeight ) );
+    }
+    std::sort( thePaths.begin(), thePaths.end() );
+    //3. Add the paths in order, the stack holds the nodes on the path followed last,
+    //   the nodes below the common prefix with the next path are left for good, and
+    //   if asked for, the node being left is recombined when both its halves are enabled
+    std::vector<BinaryTreeNode*> theStack( 1, this->_pRootTreeNode );
+    const PackedBinaryWord * pLastPath = NULL;
+    for( std::vector<PackedBinaryWord>::const_iterator it = thePaths.begin(); it != thePaths.end(); ++it ) {
+        const size_t commonLength = ( pLastPath != NULL ) ? it->common_prefix_length( *pLastPath ) : 0;
+        while( theStack.size() > commonLength + 1 ) {
+            if( recombine_leaves ) {
+                recombine_enabled_leaves( theStack.back() );
+            }
+            theStack.pop_back();
+        }
+        //Follow the path until the cell or an enabled cell that contains it is reached
+        BinaryTreeNode * pNode = theStack.back();
+        while( ! pNode->is_enabled() ) {
+            const size_t depth = theStack.size() - 1;
+            if( depth == it->size() ) {
+                pNode->make_leaf( true );
+            } else {
+                //Split the node, if it is not a leaf it will not be changed
+                pNode->split();
+                pNode = ( *it )[ depth ] ? pNode->right_node() : pNode->left_node();
+                theStack.push_back( pNode );
+            }
+        }
+        pLastPath = &( *it );
+    }
+    //4. Leave the nodes on the last path
+    while( recombine_leaves && ! theStack.empty() ) {
+        recombine_enabled_leaves( theStack.back() );
+        theStack.pop_back();
+    }
+}
+
 BinaryTreeNode* GridTreeSet::align_with_cell( const uint otherPavingPCellHeight, const bool stop_on_enabled,
                                               const bool stop_on_disabled, bool & has_stopped ) {
     const uint thisPavingPCellHeight = this->cell().height();
@@ -2751,6 +4632,76 @@ void GridTreeSet::remove( const GridTreeSubset& theOtherSubPaving ) {
     remove_from_lower( theOtherSubPaving );
 }
     
+GridTreeSet GridTreeSet::adjoin_and_report_new( const GridTreeSubset& theOtherSubPaving ) {
+    ARIADNE_ASSERT( this->grid() == theOtherSubPaving.grid() );
+
+    //1. Root this set to a primary cell that is not lower then the other one
+    if( this->cell().height() < theOtherSubPaving.cell().height() ){
+        up_to_primary_cell( theOtherSubPaving.cell().height() );
+    }
+    GridTreeSet theNewCells( this->grid(), this->cell().height(), new BinaryTreeNode( false ) );
+
+    //2. Follow the path to the root cell of theOtherSubPaving in both trees, as add_enabled does
+    BinaryWord rootNodePath = GridCell::primary_cell_path( this->dimension(), this->cell().height(), theOtherSubPaving.cell().height() );
+    rootNodePath.append( theOtherSubPaving.cell().word() );
+    BinaryTreeNode * pBinaryTreeNode = this->_pRootTreeNode;
+    BinaryTreeNode * pNewTreeNode = theNewCells._pRootTreeNode;
+    for( uint position = 0; position < rootNodePath.size() && ! pBinaryTreeNode->is_enabled(); position++ ){
+        pBinaryTreeNode->split();
+        pNewTreeNode->split();
+        pBinaryTreeNode = rootNodePath[position] ? pBinaryTreeNode->right_node() : pBinaryTreeNode->left_node();
+        pNewTreeNode = rootNodePath[position] ? pNewTreeNode->right_node() : pNewTreeNode->left_node();
+    }
+
+    //3. Merge the trees, collecting the new cells, nothing can be added if we stopped in an enabled cell
+    BinaryTreeNode::add_enabled_and_report_new( pBinaryTreeNode, theOtherSubPaving.binary_tree(), pNewTreeNode );
+    if( pNewTreeNode->is_disabled() ){
+        //Nothing is new, do not keep the path to the root cell of theOtherSubPaving
+        theNewCells._pRootTreeNode->make_leaf( false );
+    }
+    return theNewCells;
+}
+
+void GridTreeSet::move_adjoin( GridTreeSet& theOtherSet ) {
+    ARIADNE_ASSERT( this->grid() == theOtherSet.grid() );
+    if( this != &theOtherSet ) {
+        //Root both trees to the same primary cell, then the trees are aligned
+        align_with( theOtherSet );
+        BinaryTreeNode::move_add_enabled( this->_pRootTreeNode, theOtherSet._pRootTreeNode );
+        theOtherSet.clear();
+    }
+}
+
+void GridTreeSet::move_restrict( GridTreeSet& theOtherSet ) {
+    ARIADNE_ASSERT( this->grid() == theOtherSet.grid() );
+    if( this != &theOtherSet ) {
+        align_with( theOtherSet );
+        BinaryTreeNode::move_restrict( this->_pRootTreeNode, theOtherSet._pRootTreeNode );
+        theOtherSet.clear();
+    }
+}
+
+void GridTreeSet::move_remove( GridTreeSet& theOtherSet ) {
+    ARIADNE_ASSERT( this->grid() == theOtherSet.grid() );
+    if( this != &theOtherSet ) {
+        align_with( theOtherSet );
+        BinaryTreeNode::move_remove( this->_pRootTreeNode, theOtherSet._pRootTreeNode );
+        theOtherSet.clear();
+    } else {
+        clear();
+    }
+}
+
+void GridTreeSet::align_with( GridTreeSet& theOtherSet ) {
+    const uint thisPavingPCellHeight = this->cell().height();
+    const uint otherPavingPCellHeight = theOtherSet.cell().height();
+    if( thisPavingPCellHeight < otherPavingPCellHeight ) {
+        up_to_primary_cell( otherPavingPCellHeight );
+    } else if( otherPavingPCellHeight < thisPavingPCellHeight ) {
+        theOtherSet.up_to_primary_cell( thisPavingPCellHeight );
+    }
+}
+
 void GridTreeSet::restrict_to_height( const uint theHeight ) {
     const uint thisPavingPCellHeight = this->cell().height();
         
@@ -2790,39 +4741,679 @@ void GridTreeSet::restrict_to_height( const uint theHeight ) {
 }
 
 
-void GridTreeSet::import_from_file(const char*& filename)
-{
-	// Open the file in read mode
-	FILE* file = fopen(filename,"r");
-
-	// Add from file, starting from the root
-	_pRootTreeNode->add_enabled_from_file(file);
-
-	// Close the file
-	fclose(file);
-
-	// Destroy the file
-	if (std::remove(filename) != 0 )
-	    ARIADNE_FAIL_MSG("Error deleting file " << filename << ".");
+//The (virtual) child of the node, a leaf node is its own child and the missing node has no children
+static const BinaryTreeNode * virtual_child( const BinaryTreeNode * pNode, const bool isRight ) {
+    if( pNode == NULL || pNode->is_leaf() ) {
+        return pNode;
+    }
+    return isRight ? pNode->right_node() : pNode->left_node();
+}
+
+//Builds in the disabled leaf pResultNode the dilation, by one cell in the dimension dim, of the cell of
+//pNode. The nodes pLowerNode and pUpperNode are the neighbors of pNode in the dimension dim, at the
+//same depth, they are NULL if the neighbor is outside of the primary cell. The cells at theMaxDepth
+//are enabled if they or one of their neighbors have an enabled sub-cell.
+static void dilate_in_dimension( BinaryTreeNode * pResultNode, const BinaryTreeNode * pNode,
+                                 const BinaryTreeNode * pLowerNode, const BinaryTreeNode * pUpperNode,
+                                 const uint theDimension, const uint dim, const uint theDepth, const uint theMaxDepth ) {
+    if( pNode->is_leaf() && pNode->is_enabled() ) {
+        //The neighbors can not add anything to an enabled cell
+        pResultNode->set_enabled();
+    } else if( theDepth >= theMaxDepth ) {
+        if( pNode->has_enabled() || ( pLowerNode != NULL && pLowerNode->has_enabled() ) ||
+            ( pUpperNode != NULL && pUpperNode->has_enabled() ) ) {
+            pResultNode->set_enabled();
+        }
+    } else if( pNode->is_leaf() && ( pLowerNode == NULL || ( pLowerNode->is_leaf() && ! pLowerNode->is_enabled() ) )
+                                && ( pUpperNode == NULL || ( pUpperNode->is_leaf() && ! pUpperNode->is_enabled() ) ) ) {
+        //DO NOTHING: The cell and its neighbors are empty, so is the result
+    } else {
+        pResultNode->split();
+        const BinaryTreeNode * pLeftNode = virtual_child( pNode, false );
+        const BinaryTreeNode * pRightNode = virtual_child( pNode, true );
+        if( theDepth % theDimension == dim ) {
+            //The halves of the cell are neighbors of each other, the other
+            //neighbors are the adjacent halves of the neighboring cells
+            dilate_in_dimension( pResultNode->left_node(), pLeftNode, virtual_child( pLowerNode, true ), pRightNode,
+                                 theDimension, dim, theDepth + 1, theMaxDepth );
+            dilate_in_dimension( pResultNode->right_node(), pRightNode, pLeftNode, virtual_child( pUpperNode, false ),
+                                 theDimension, dim, theDepth + 1, theMaxDepth );
+        } else {
+            //The halves of the neighboring cells are the neighbors of the halves of the cell
+            dilate_in_dimension( pResultNode->left_node(), pLeftNode, virtual_child( pLowerNode, false ),
+                                 virtual_child( pUpperNode, false ), theDimension, dim, theDepth + 1, theMaxDepth );
+            dilate_in_dimension( pResultNode->right_node(), pRightNode, virtual_child( pLowerNode, true ),
+                                 virtual_child( pUpperNode, true ), theDimension, dim, theDepth + 1, theMaxDepth );
+        }
+    }
+}
+
+//The same as dilate_in_dimension, but for the erosion: the cells at theMaxDepth are enabled
+//if they and both of their neighbors are entirely enabled
+static void erode_in_dimension( BinaryTreeNode * pResultNode, const BinaryTreeNode * pNode,
+                                const BinaryTreeNode * pLowerNode, const BinaryTreeNode * pUpperNode,
+                                const uint theDimension, const uint dim, const uint theDepth, const uint theMaxDepth ) {
+    if( pNode->is_leaf() && ! pNode->is_enabled() ) {
+        //DO NOTHING: The neighbors can not add anything to a disabled cell
+    } else if( theDepth >= theMaxDepth ) {
+        if( pNode->all_enabled() && pLowerNode != NULL && pLowerNode->all_enabled() &&
+            pUpperNode != NULL && pUpperNode->all_enabled() ) {
+            pResultNode->set_enabled();
+        }
+    } else if( pNode->is_leaf() && ( pLowerNode != NULL && pLowerNode->is_leaf() && pLowerNode->is_enabled() )
+                                && ( pUpperNode != NULL && pUpperNode->is_leaf() && pUpperNode->is_enabled() ) ) {
+        //The cell and its neighbors are entirely enabled, so is the result
+        pResultNode->set_enabled();
+    } else {
+        pResultNode->split();
+        const BinaryTreeNode * pLeftNode = virtual_child( pNode, false );
+        const BinaryTreeNode * pRightNode = virtual_child( pNode, true );
+        if( theDepth % theDimension == dim ) {
+            erode_in_dimension( pResultNode->left_node(), pLeftNode, virtual_child( pLowerNode, true ), pRightNode,
+                                theDimension, dim, theDepth + 1, theMaxDepth );
+            erode_in_dimension( pResultNode->right_node(), pRightNode, pLeftNode, virtual_child( pUpperNode, false ),
+                                theDimension, dim, theDepth + 1, theMaxDepth );
+        } else {
+            erode_in_dimension( pResultNode->left_node(), pLeftNode, virtual_child( pLowerNode, false ),
+                                virtual_child( pUpperNode, false ), theDimension, dim, theDepth + 1, theMaxDepth );
+            erode_in_dimension( pResultNode->right_node(), pRightNode, virtual_child( pLowerNode, true ),
+                                virtual_child( pUpperNode, true ), theDimension, dim, theDepth + 1, theMaxDepth );
+        }
+    }
+}
+
+//NOTE: The neighborhood of numCells cells in every direction, with the vertex neighbors, is the box
+//      of 2*numCells+1 cells in every dimension. So it is made by numCells dilations by one cell in
+//      every dimension, one after the other. Each dilation is one traversal of the tree, in which
+//      every node is visited together with its neighbors in the given dimension, see dilate_in_dimension.
+void GridTreeSet::dilate( const uint numCells, const uint numSubdivInDim ) {
+    if( numCells == 0 ) {
+        return;
+    }
+    //1. Find the primary cell that contains the current one together with numCells cells around it
+    const Float theMargin = std::ldexp( Float( numCells ), - int( numSubdivInDim ) );
+    Vector<Interval> theLatticeBox = GridCell::primary_cell_lattice_box( this->cell().height(), this->dimension() );
+    for( uint dim = 0; dim < theLatticeBox.size(); dim++ ) {
+        theLatticeBox[dim].set( theLatticeBox[dim].lower() - theMargin, theLatticeBox[dim].upper() + theMargin );
+    }
+    const uint theHeight = GridCell::smallest_enclosing_primary_cell_height( theLatticeBox );
+    if( theHeight > this->cell().height() ) {
+        up_to_primary_cell( theHeight );
+    }
+
+    //2. Dilate by one cell in every dimension in turn, the cells of the required size are at theMaxDepth
+    const uint theDimension = this->dimension();
+    const uint theMaxDepth = ( this->cell().height() + numSubdivInDim ) * theDimension;
+    for( uint i = 0; i < numCells * theDimension; i++ ) {
+        BinaryTreeNode * pResultTreeNode = new BinaryTreeNode( false );
+        dilate_in_dimension( pResultTreeNode, _pRootTreeNode, NULL, NULL, theDimension, i % theDimension, 0, theMaxDepth );
+        pResultTreeNode->recombine();
+        delete _pRootTreeNode;
+        _pRootTreeNode = pResultTreeNode;
+    }
+}
+
+//NOTE: The cells outside of the primary cell are not in the set, so the cells
+//      near the border of the primary cell are removed by the erosion as well.
+void GridTreeSet::erode( const uint numCells, const uint numSubdivInDim ) {
+    if( numCells == 0 ) {
+        return;
+    }
+    const uint theDimension = this->dimension();
+    const uint theMaxDepth = ( this->cell().height() + numSubdivInDim ) * theDimension;
+    for( uint i = 0; i < numCells * theDimension; i++ ) {
+        BinaryTreeNode * pResultTreeNode = new BinaryTreeNode( false );
+        erode_in_dimension( pResultTreeNode, _pRootTreeNode, NULL, NULL, theDimension, i % theDimension, 0, theMaxDepth );
+        pResultTreeNode->recombine();
+        delete _pRootTreeNode;
+        _pRootTreeNode = pResultTreeNode;
+    }
+}
+
+void GridTreeSet::import_from_file(const char*& filename)
+{
+	// Open the file in read mode
+	FILE* file = fopen(filename,"r");
+
+	// Add from file, starting from the root
+	_pRootTreeNode->add_enabled_from_file(file);
+
+	// Close the file
+	fclose(file);
+
+	// Destroy the file
+	if (std::remove(filename) != 0 )
+	    ARIADNE_FAIL_MSG("Error deleting file " << filename << ".");
+}
+
+void GridTreeSet::export_to_file(const char*& filename)
+{
+	// Open the file in write mode
+	FILE* file = fopen(filename,"w");
+
+	// Remove the left and right subtrees
+	_pRootTreeNode->remove_to_file(file);
+
+	// Set the enabledness to unknown and set its left and right nodes to NULL
+	_pRootTreeNode->set_unknown_unchecked();
+
+	// Flush the file
+	fflush(file);
+	// Close the file
+	fclose(file);
+}
+    
+/*****************************************FrozenGridTreeSet******************************************/
+
+/*! \brief The sums of the byte's bits, read from the lowest one, where a one counts as +1
+ *  and a zero as -1: the sum of all eight bits and the lowest sum of the leading bits.
+ */
+struct ByteExcessTable {
+    int excess[256];
+    int min_excess[256];
+
+    ByteExcessTable() {
+        for( uint value = 0; value < 256; ++value ) {
+            int sum = 0;
+            int lowest = 8;
+            for( uint i = 0; i < 8; ++i ) {
+                sum += ( ( value >> i ) & 1 ) ? 1 : -1;
+                lowest = std::min( lowest, sum );
+            }
+            excess[ value ] = sum;
+            min_excess[ value ] = lowest;
+        }
+    }
+};
+
+static const ByteExcessTable theByteExcessTable;
+
+const size_t FrozenGridTreeSet::ROOT;
+
+FrozenGridTreeSet::FrozenGridTreeSet( const GridTreeSubset & theSet ) :
+    _theGridCell( theSet.cell() ), _theNodeCount( 0 ), _theLeafCount( 0 ) {
+    BinaryWord theTree, theLeaves;
+    theSet.binary_tree()->tree_to_binary_words( theTree, theLeaves );
+    build( theTree, theLeaves );
+}
+
+void FrozenGridTreeSet::pack( const BinaryWord & theBits, std::vector<word_type> & theWords, std::vector<boost::uint32_t> & theRanks ) {
+    //Pad the bits with zeroes up to a whole block
+    const size_t theBlockCount = ( theBits.size() + BLOCK_BITS - 1 ) / BLOCK_BITS;
+    theWords.assign( theBlockCount * BLOCK_WORDS, 0 );
+    for( size_t i = 0; i < theBits.size(); ++i ) {
+        if( theBits[ i ] ) {
+            theWords[ i / WORD_BITS ] |= word_type( 1 ) << ( i % WORD_BITS );
+        }
+    }
+
+    //Count the ones in front of every block
+    theRanks.assign( theBlockCount + 1, 0 );
+    for( size_t block = 0; block < theBlockCount; ++block ) {
+        uint theOnes = 0;
+        for( size_t word = block * BLOCK_WORDS; word < ( block + 1 ) * BLOCK_WORDS; ++word ) {
+            theOnes += popcount( theWords[ word ] );
+        }
+        theRanks[ block + 1 ] = theRanks[ block ] + theOnes;
+    }
+}
+
+void FrozenGridTreeSet::build( const BinaryWord & theTree, const BinaryWord & theLeaves ) {
+    //The ranks are stored in 32 bits
+    ARIADNE_ASSERT_MSG( theTree.size() < 0xFFFFFFFFu, "The tree with " << theTree.size() << " nodes is too large to be frozen" );
+
+    _theNodeCount = theTree.size();
+    _theLeafCount = theLeaves.size();
+    pack( theTree, _theTree, _theTreeRanks );
+    pack( theLeaves, _theLeaves, _theLeafRanks );
+
+    //Compute the lowest excess of the leading bits of every block, the padding blocks are never reached
+    const size_t theBlockCount = _theTreeRanks.size() - 1;
+    size_t theLeafOffset = 1;
+    while( theLeafOffset < theBlockCount ) {
+        theLeafOffset *= 2;
+    }
+    _theRangeMinExcess.assign( 2 * theLeafOffset, BLOCK_BITS );
+    for( size_t block = 0; block < theBlockCount; ++block ) {
+        int excess = 0;
+        int lowest = BLOCK_BITS;
+        for( size_t pos = block * BLOCK_BITS; pos < ( block + 1 ) * BLOCK_BITS; pos += 8 ) {
+            const uint theByte = byte( _theTree, pos );
+            lowest = std::min( lowest, excess + theByteExcessTable.min_excess[ theByte ] );
+            excess += theByteExcessTable.excess[ theByte ];
+        }
+        _theRangeMinExcess[ theLeafOffset + block ] = lowest;
+    }
+    //Combine the blocks up to the root, the lowest excess of a node is reached either in its left half
+    //or in its right half after the whole left half
+    size_t width = 1;
+    for( size_t level = theLeafOffset / 2; level > 0; level /= 2 ) {
+        for( size_t index = level; index < 2 * level; ++index ) {
+            const size_t first = ( index - level ) * 2 * width;
+            _theRangeMinExcess[ index ] = ( first + width < theBlockCount ) ?
+                std::min( _theRangeMinExcess[ 2 * index ], range_excess( first, width ) + _theRangeMinExcess[ 2 * index + 1 ] ) :
+                _theRangeMinExcess[ 2 * index ];
+        }
+        width *= 2;
+    }
+}
+
+int FrozenGridTreeSet::range_excess( const size_t first, const size_t width ) const {
+    //The excess is small, but the numbers of the ones and of the bits of many blocks need not fit into an int
+    const size_t last = std::min( first + width, _theTreeRanks.size() - 1 );
+    const boost::int64_t theOnes = _theTreeRanks[ last ] - _theTreeRanks[ first ];
+    return int( 2 * theOnes - boost::int64_t( ( last - first ) * BLOCK_BITS ) );
+}
+
+size_t FrozenGridTreeSet::find_block( size_t block, int & excess ) const {
+    const size_t theLeafOffset = _theRangeMinExcess.size() / 2;
+    size_t index = theLeafOffset + block;
+    if( excess + _theRangeMinExcess[ index ] > -1 ) {
+        //1. Go up until the right sibling of the current node has the block, the blocks of
+        //   the current node and of the skipped siblings are all in front of the found one
+        size_t width = 1;
+        excess += range_excess( block, width );
+        while( true ) {
+            if( index % 2 == 0 ) {
+                if( excess + _theRangeMinExcess[ index + 1 ] <= -1 ) {
+                    index++;
+                    block += width;
+                    break;
+                }
+                excess += range_excess( block + width, width );
+            } else {
+                block -= width;
+            }
+            index /= 2;
+            width *= 2;
+        }
+        //2. Go down to the first block of the found node, the left halves without it are skipped
+        while( index < theLeafOffset ) {
+            index *= 2;
+            width /= 2;
+            if( excess + _theRangeMinExcess[ index ] > -1 ) {
+                excess += range_excess( block, width );
+                index++;
+                block += width;
+            }
+        }
+    }
+    return block;
+}
+
+size_t FrozenGridTreeSet::subtree_end( const size_t node ) const {
+    //The subtree ends at the first position where the excess, i.e. the number of non-leaf
+    //nodes minus the number of leaves counted from node, drops to -1. Note that this position
+    //always exists, so we never look past the end of the tree.
+    int excess = 0;
+    size_t pos = node;
+
+    //1. Go bit by bit up to the byte boundary
+    while( pos % 8 != 0 ) {
+        excess += bit( _theTree, pos ) ? 1 : -1;
+        if( excess == -1 ) {
+            return pos;
+        }
+        pos++;
+    }
+
+    //2. Go byte by byte up to the block boundary, stop at the byte in which the excess drops to -1
+    while( ( pos % BLOCK_BITS != 0 ) && ( excess + theByteExcessTable.min_excess[ byte( _theTree, pos ) ] > -1 ) ) {
+        excess += theByteExcessTable.excess[ byte( _theTree, pos ) ];
+        pos += 8;
+    }
+
+    if( pos % BLOCK_BITS == 0 ) {
+        //3. Skip the blocks in which the excess does not drop to -1
+        pos = find_block( pos / BLOCK_BITS, excess ) * BLOCK_BITS;
+        //4. Go byte by byte within the found block
+        while( excess + theByteExcessTable.min_excess[ byte( _theTree, pos ) ] > -1 ) {
+            excess += theByteExcessTable.excess[ byte( _theTree, pos ) ];
+            pos += 8;
+        }
+    }
+
+    //5. Find the bit within the byte
+    excess += bit( _theTree, pos ) ? 1 : -1;
+    while( excess != -1 ) {
+        pos++;
+        excess += bit( _theTree, pos ) ? 1 : -1;
+    }
+    return pos;
+}
+
+size_t FrozenGridTreeSet::locate_node( const BinaryWord & thePath ) const {
+    size_t node = ROOT;
+    for( uint i = 0; ( i < thePath.size() ) && ! is_leaf( node ); i++ ) {
+        node = ( thePath[i] ? right_node( node ) : left_node( node ) );
+    }
+    return node;
+}
+
+tribool FrozenGridTreeSet::superset( const Box& theBox ) const {
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    tribool isASubSet = theBox.subset( cell().box() );
+    if( ! isASubSet ) {
+        //If the box is not covered by the root cell, then theBox is not a subset of this set.
+        return false;
+    } else {
+        FrozenGridTreeWalker theNode( *this );
+        return covers_box( theNode, grid(), cell().word().size(), GridCell::compute_lattice_box( dimension(), cell().height(), cell().word() ), theBox );
+    }
+}
+
+tribool FrozenGridTreeSet::subset( const Box& theBox ) const {
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    FrozenGridTreeWalker theNode( *this );
+    return subset_of_box( theNode, grid(), cell().word().size(), GridCell::compute_lattice_box( dimension(), cell().height(), cell().word() ), theBox );
+}
+
+tribool FrozenGridTreeSet::disjoint( const Box& theBox ) const {
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    FrozenGridTreeWalker theNode( *this );
+    return disjoint_from_box( theNode, grid(), cell().word().size(), GridCell::compute_lattice_box( dimension(), cell().height(), cell().word() ), theBox );
+}
+
+tribool FrozenGridTreeSet::overlaps( const Box& theBox ) const {
+    ARIADNE_ASSERT( theBox.dimension() == cell().dimension() );
+
+    FrozenGridTreeWalker theNode( *this );
+    return overlaps_box( theNode, grid(), cell().word().size(), GridCell::compute_lattice_box( dimension(), cell().height(), cell().word() ), theBox );
+}
+
+bool FrozenGridTreeSet::subset( const FrozenGridTreeSet & theSetOne, size_t & nodeOne,
+                                const FrozenGridTreeSet & theSetTwo, size_t & nodeTwo ) {
+    bool result = false;
+
+    if( theSetOne.is_leaf( nodeOne ) ) {
+        //A leaf is a subset if it is disabled or all of the corresponding leaf nodes are enabled
+        result = ( ! theSetOne.is_enabled( nodeOne ) ) || theSetTwo.all_enabled( nodeTwo );
+        nodeOne++;
+        nodeTwo = theSetTwo.subtree_end( nodeTwo ) + 1;
+    } else {
+        if( theSetTwo.is_leaf( nodeTwo ) ) {
+            //A subtree is a subset of a leaf if the leaf is enabled or the subtree has no enabled nodes
+            result = theSetTwo.is_enabled( nodeTwo ) || ( ! theSetOne.has_enabled( nodeOne ) );
+            nodeOne = theSetOne.subtree_end( nodeOne ) + 1;
+            nodeTwo++;
+        } else {
+            //Both nodes are non-leaf nodes, the left sub-nodes follow them
+            nodeOne++;
+            nodeTwo++;
+            result = subset( theSetOne, nodeOne, theSetTwo, nodeTwo );
+            if( result ) {
+                result = subset( theSetOne, nodeOne, theSetTwo, nodeTwo );
+            } else {
+                nodeOne = theSetOne.subtree_end( nodeOne ) + 1;
+                nodeTwo = theSetTwo.subtree_end( nodeTwo ) + 1;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool FrozenGridTreeSet::overlap( const FrozenGridTreeSet & theSetOne, size_t & nodeOne,
+                                 const FrozenGridTreeSet & theSetTwo, size_t & nodeTwo ) {
+    bool result = false;
+
+    if( theSetOne.is_leaf( nodeOne ) ) {
+        //If the first node is a leaf then the trees overlap if it is enabled
+        //and the second node has an enabled sub-node
+        result = theSetOne.is_enabled( nodeOne ) && theSetTwo.has_enabled( nodeTwo );
+        nodeOne++;
+        nodeTwo = theSetTwo.subtree_end( nodeTwo ) + 1;
+    } else {
+        if( theSetTwo.is_leaf( nodeTwo ) ) {
+            result = theSetTwo.is_enabled( nodeTwo ) && theSetOne.has_enabled( nodeOne );
+            nodeOne = theSetOne.subtree_end( nodeOne ) + 1;
+            nodeTwo++;
+        } else {
+            //Both nodes are non-leaf nodes, then the trees overlap if
+            //either their left or right branches overlap
+            nodeOne++;
+            nodeTwo++;
+            result = overlap( theSetOne, nodeOne, theSetTwo, nodeTwo );
+            if( result ) {
+                nodeOne = theSetOne.subtree_end( nodeOne ) + 1;
+                nodeTwo = theSetTwo.subtree_end( nodeTwo ) + 1;
+            } else {
+                result = overlap( theSetOne, nodeOne, theSetTwo, nodeTwo );
+            }
+        }
+    }
+
+    return result;
+}
+
+bool FrozenGridTreeSet::overlap( const FrozenGridTreeSet & theSuperSet, const BinaryWord & pathFromSuperToSub,
+                                 const FrozenGridTreeSet & theSubSet ) {
+    bool result = false;
+
+    //Check if both sets are not empty
+    if( ! theSuperSet.empty() && ! theSubSet.empty() ) {
+        //Locate the node in theSuperSet, by following the path pathFromSuperToSub
+        size_t superNode = theSuperSet.locate_node( pathFromSuperToSub );
+
+        if( theSuperSet.is_leaf( superNode ) ) {
+            //The leaf contains the root cell of theSubSet, which is not empty
+            result = theSuperSet.is_enabled( superNode );
+        } else {
+            //The trees are aligned now, so we can compare them node by node
+            size_t subNode = ROOT;
+            result = overlap( theSuperSet, superNode, theSubSet, subNode );
+        }
+    }
+
+    return result;
+}
+
+double FrozenGridTreeSet::measure() const {
+    double result=0.0;
+    for(const_iterator iter=this->begin(); iter!=this->end(); ++iter) {
+        result+=iter->box().measure();
+    }
+    return result;
+}
+
+Box FrozenGridTreeSet::bounding_box() const {
+    if(this->empty()) return Box::empty_box(this->dimension());
+
+    const_iterator iter=this->begin();
+    Box bbox = iter->box();
+
+    for( ; iter!=this->end(); ++iter) {
+        Box cell = iter->box();
+        for(uint i = 0; i < cell.dimension(); ++i) {
+            if(cell[i].lower() < bbox[i].lower()) bbox[i].set_lower(cell[i].lower());
+            if(cell[i].upper() > bbox[i].upper()) bbox[i].set_upper(cell[i].upper());
+        }
+    }
+
+    return bbox;
+}
+
+/*************************************FrozenGridTreeConstIterator************************************/
+
+void FrozenGridTreeConstIterator::find_next_enabled_leaf() {
+    while( _theNode < _pSet->_theNodeCount ) {
+        if( ! _pSet->is_leaf( _theNode ) ) {
+            //Go down to the left sub-node, it follows the current node
+            _thePath.push_back( false );
+            _theNode++;
+        } else {
+            if( FrozenGridTreeSet::bit( _pSet->_theLeaves, _theLeaf ) ) {
+                //The enabled leaf is found, its cell is reached from the root cell by the path
+                BinaryWord theWord( _pSet->_theGridCell.word() );
+                theWord.append( _thePath );
+                _theCurrentGridCell = GridCell( _pSet->grid(), _pSet->_theGridCell.height(), theWord );
+                break;
+            } else {
+                skip_leaf();
+            }
+        }
+    }
+}
+
+/*****************************************MortonGridTreeSet******************************************/
+
+MortonGridTreeSet::MortonGridTreeSet( const Grid& theGrid, const uint theHeight ) :
+    _theGrid( theGrid ), _theHeight( theHeight ) {
+}
+
+MortonGridTreeSet::MortonGridTreeSet( const GridTreeSubset& theSet ) :
+    _theGrid( theSet.grid() ), _theHeight( theSet.cell().height() ) {
+    //The root cell of theSet is reached by its word from the primary cell
+    const BinaryWord theWord = theSet.cell().word();
+    ARIADNE_ASSERT_MSG( theWord.size() <= MAX_DEPTH, "The root cell of the set is too deep for a MortonGridTreeSet" );
+    Key theRootKey;
+    theRootKey.code = 0;
+    theRootKey.depth = 0;
+    for( uint i = 0; i < theWord.size(); i++ ) {
+        theRootKey = theRootKey.child( theWord[i] );
+    }
+    //The depth first traversal visits the left sub-cells first, thus gives the Z-order
+    append_keys( theSet.binary_tree(), theRootKey, _theKeys );
+}
+
+void MortonGridTreeSet::append_keys( const BinaryTreeNode * pNode, const Key& theKey, std::vector<Key>& theKeys ) {
+    if( pNode->is_leaf() ) {
+        if( pNode->is_enabled() ) {
+            theKeys.push_back( theKey );
+        }
+    } else {
+        ARIADNE_ASSERT_MSG( theKey.depth < MAX_DEPTH, "The tree is too deep for a MortonGridTreeSet" );
+        append_keys( pNode->left_node(), theKey.child( false ), theKeys );
+        append_keys( pNode->right_node(), theKey.child( true ), theKeys );
+    }
+}
+
+void MortonGridTreeSet::build_tree( BinaryTreeNode * pNode, const Key& theKey,
+                                    std::vector<Key>::const_iterator first, std::vector<Key>::const_iterator last ) {
+    if( first == last ) {
+        //DO NOTHING: There are no enabled cells here, the node stays a disabled leaf
+    } else if( first->depth == theKey.depth ) {
+        //The cells are disjoint, so this is the only cell and it is the cell of the node
+        pNode->set_enabled();
+    } else {
+        //The cells of the right sub-cell start at the first code of the right sub-cell
+        const Key theRightKey = theKey.child( true );
+        const std::vector<Key>::const_iterator middle = std::lower_bound( first, last, theRightKey );
+        pNode->split();
+        build_tree( pNode->left_node(), theKey.child( false ), first, middle );
+        build_tree( pNode->right_node(), theRightKey, middle, last );
+    }
+}
+
+GridTreeSet MortonGridTreeSet::to_grid_tree_set() const {
+    BinaryTreeNode * pRootTreeNode = new BinaryTreeNode( false );
+    Key theRootKey;
+    theRootKey.code = 0;
+    theRootKey.depth = 0;
+    build_tree( pRootTreeNode, theRootKey, _theKeys.begin(), _theKeys.end() );
+    return GridTreeSet( _theGrid, _theHeight, pRootTreeNode );
 }
 
-void GridTreeSet::export_to_file(const char*& filename)
-{
-	// Open the file in write mode
-	FILE* file = fopen(filename,"w");
+bool MortonGridTreeSet::is_representable( const GridTreeSubset& theSet ) {
+    return theSet.cell().word().size() + theSet.depth() <= MAX_DEPTH;
+}
 
-	// Remove the left and right subtrees
-	_pRootTreeNode->remove_to_file(file);
+bool MortonGridTreeSet::operator==( const MortonGridTreeSet& anotherMortonGridTreeSet ) const {
+    if( ! ( _theGrid == anotherMortonGridTreeSet._theGrid ) ) {
+        return false;
+    }
+    //The same set has one list of cells only when rooted to the same primary cell and recombined
+    MortonGridTreeSet theAlignedSet1( _theGrid ), theAlignedSet2( _theGrid );
+    align( *this, anotherMortonGridTreeSet, theAlignedSet1, theAlignedSet2 );
+    theAlignedSet1.recombine();
+    theAlignedSet2.recombine();
+    return theAlignedSet1._theKeys == theAlignedSet2._theKeys;
+}
+
+GridCell MortonGridTreeSet::cell( const size_t i ) const {
+    const Key& theKey = _theKeys[i];
+    BinaryWord theWord;
+    for( uint b = 0; b < theKey.depth; b++ ) {
+        theWord.push_back( ( ( theKey.code >> ( MAX_DEPTH - 1 - b ) ) & 1 ) != 0 );
+    }
+    return GridCell( _theGrid, _theHeight, theWord );
+}
+
+void MortonGridTreeSet::up_to_primary_cell( const uint toPCellHeight ) {
+    if( toPCellHeight > _theHeight ) {
+        //Every path gets the same prefix: the path between the primary cells
+        const BinaryWord thePrefix = GridCell::primary_cell_path( dimension(), toPCellHeight, _theHeight );
+        const uint thePrefixLength = thePrefix.size();
+        Key thePrefixKey;
+        thePrefixKey.code = 0;
+        thePrefixKey.depth = 0;
+        for( uint i = 0; i < thePrefixLength; i++ ) {
+            thePrefixKey = thePrefixKey.child( thePrefix[i] );
+        }
+        for( std::vector<Key>::iterator pKey = _theKeys.begin(); pKey != _theKeys.end(); ++pKey ) {
+            ARIADNE_ASSERT_MSG( pKey->depth + thePrefixLength <= MAX_DEPTH,
+                                "The cells rooted to the primary cell of height " << toPCellHeight << " are too deep for a MortonGridTreeSet" );
+            //NOTE: The prefix can only take all the bits when the cell is the primary cell
+            pKey->code = thePrefixKey.code | ( ( thePrefixLength < MAX_DEPTH ) ? ( pKey->code >> thePrefixLength ) : 0 );
+            pKey->depth += thePrefixLength;
+        }
+        _theHeight = toPCellHeight;
+    }
+}
 
-	// Set the enabledness to unknown and set its left and right nodes to NULL
-	_pRootTreeNode->set_unknown_unchecked();
+void MortonGridTreeSet::recombine() {
+    //The kept cells form a stack, the sibling of the pushed cell can only be on the top of it
+    size_t theSize = 0;
+    for( size_t i = 0; i < _theKeys.size(); i++ ) {
+        Key theKey = _theKeys[i];
+        while( ( theSize > 0 ) && ( theKey.depth > 0 ) && ( _theKeys[theSize - 1].depth == theKey.depth ) ) {
+            //The right sibling differs from the left one in the last bit of the path only
+            const code_type theLastBit = code_type(1) << ( MAX_DEPTH - theKey.depth );
+            const Key& theLeftKey = _theKeys[theSize - 1];
+            if( ( ( theLeftKey.code & theLastBit ) != 0 ) || ( ( theLeftKey.code | theLastBit ) != theKey.code ) ) {
+                break;
+            }
+            //The parent cell has the path of the left sub-cell without its last bit, which is zero
+            theKey.code = theLeftKey.code;
+            theKey.depth--;
+            theSize--;
+        }
+        _theKeys[theSize++] = theKey;
+    }
+    _theKeys.resize( theSize );
+}
 
-	// Flush the file
-	fflush(file);
-	// Close the file
-	fclose(file);
+void MortonGridTreeSet::align( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2,
+                               MortonGridTreeSet& theAlignedSet1, MortonGridTreeSet& theAlignedSet2 ) {
+    ARIADNE_ASSERT( theSet1.grid() == theSet2.grid() );
+    theAlignedSet1 = theSet1;
+    theAlignedSet2 = theSet2;
+    const uint theHeight = max( theSet1.height(), theSet2.height() );
+    theAlignedSet1.up_to_primary_cell( theHeight );
+    theAlignedSet2.up_to_primary_cell( theHeight );
+}
+
+void MortonGridTreeSet::subtract( const Key& theKey, std::vector<Key>::const_iterator& pOther,
+                                  const std::vector<Key>::const_iterator& otherEnd, std::vector<Key>& theKeys ) {
+    //Skip the cells of the other set that end before this cell
+    while( ( pOther != otherEnd ) && ( pOther->last() < theKey.code ) ) {
+        ++pOther;
+    }
+    if( ( pOther == otherEnd ) || ( pOther->code > theKey.last() ) ) {
+        //No cell of the other set overlaps this cell
+        theKeys.push_back( theKey );
+    } else if( pOther->depth <= theKey.depth ) {
+        //DO NOTHING: The cell is covered by the other cell, which may cover the next cells as well
+    } else {
+        //The other cell is a proper sub-cell of this cell, so split this cell
+        subtract( theKey.child( false ), pOther, otherEnd, theKeys );
+        subtract( theKey.child( true ), pOther, otherEnd, theKeys );
+    }
 }
-    
+
 /*************************************FRIENDS OF BinaryTreeNode*************************************/
 
 /*************************************FRIENDS OF GridCell*****************************************/
@@ -2832,21 +5423,21 @@ bool subset(const GridCell& theCellOne, const GridCell& theCellTwo, BinaryWord *
     ARIADNE_ASSERT( theCellOne.grid() == theCellTwo.grid() );
 
     //Test that the binary words are empty, otherwise the results of computations are undefined
-    bool isDefault = false;
     if( ( pPathPrefixOne == NULL ) && ( pPathPrefixTwo == NULL ) ) {
-        //If both parameters are null, then the user does not
-        //need this data, so we allocate temporary objects
-        pPathPrefixOne = new BinaryWord();
-        pPathPrefixTwo = new BinaryWord();
-        isDefault = true;
+        //If both parameters are null, then the user does not need the
+        //paths, so we only compare the packed paths from the common primary cell
+        const uint primary_cell_height = max( theCellOne.height(), theCellTwo.height() );
+        if( pPrimaryCellHeight != NULL ){
+            *pPrimaryCellHeight = primary_cell_height;
+        }
+        return theCellTwo.packed_word( primary_cell_height ).is_prefix( theCellOne.packed_word( primary_cell_height ) );
     } else {
         if( ( pPathPrefixOne == NULL ) || ( pPathPrefixTwo == NULL ) ) {
             //TODO: Find some better way to notify the user that
             //only one of the required pointers is not NULL.
             ARIADNE_ASSERT( false );
         } else {
-            //DO NOTHING: Both parameters are not NULL, so it
-            //is user data and isDefault should stay false.
+            //DO NOTHING: Both parameters are not NULL, so it is user data
         }
     }
         
@@ -2874,15 +5465,7 @@ bool subset(const GridCell& theCellOne, const GridCell& theCellTwo, BinaryWord *
     pPathPrefixTwo->append( theCellTwo.word() );
         
     //03 theCellOne is a subset of theCellTwo if pathPrefixTwo is a prefix of pathPrefixOne
-    bool result = pPathPrefixTwo->is_prefix( *pPathPrefixOne );
-        
-    //04 If working with default parameters, then release memory
-    if( isDefault ) {
-        delete pPathPrefixOne;
-        delete pPathPrefixTwo;
-    }
-
-    return result;
+    return pPathPrefixTwo->is_prefix( *pPathPrefixOne );
 }
 
 /*************************************FRIENDS OF GridTreeSubset*****************************************/
@@ -2990,16 +5573,13 @@ bool overlap( const GridCell& theCell, const GridTreeSubset& theSet ) {
     return result;
 }
 
-/*! \brief This is a helper method, it receives two GridTreeSubset elements
+/*! \brief This is a helper method, it receives the root cells of two sets
  *  then it computes the primary cell that is common to them in the sense that
  *  these sets can be rooted to it. After that the method updates the paths
  *  with the information about the paths from the found primary cell to the
  *  root binary tree nodes of both sets.
  */
-static void common_primary_cell_path(const GridTreeSubset& theSet1, const GridTreeSubset& theSet2, BinaryWord &pathCommonPCtoRC1, BinaryWord &pathCommonPCtoRC2 ) {
-    //Get the root cells for the subsets
-    GridCell rootCell1 = theSet1.cell();
-    GridCell rootCell2 = theSet2.cell();
+static void common_primary_cell_path(const GridCell& rootCell1, const GridCell& rootCell2, BinaryWord &pathCommonPCtoRC1, BinaryWord &pathCommonPCtoRC2 ) {
     //Get the heights of the primary cells for both subsets
     const int heightPC1 = rootCell1.height();
     const int heightPC2 = rootCell2.height();
@@ -3152,7 +5732,7 @@ bool subset( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 ) {
     BinaryWord pathCommonPCtoRC1;
     BinaryWord pathCommonPCtoRC2;
     //Get the paths from the common primary cell to the root nodes of the set's binary trees
-    common_primary_cell_path( theSet1, theSet2, pathCommonPCtoRC1, pathCommonPCtoRC2 );
+    common_primary_cell_path( theSet1.cell(), theSet2.cell(), pathCommonPCtoRC1, pathCommonPCtoRC2 );
     
     //At this point we know paths from the common primary cell
     //to the root nodes of both subsets. If one of these paths is a prefix of
@@ -3226,7 +5806,7 @@ bool overlap( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 ) {
     BinaryWord pathCommonPCtoRC1;
     BinaryWord pathCommonPCtoRC2;
     //Get the paths from the common primary cell to the root nodes of the set's binary trees
-    common_primary_cell_path( theSet1, theSet2, pathCommonPCtoRC1, pathCommonPCtoRC2 );
+    common_primary_cell_path( theSet1.cell(), theSet2.cell(), pathCommonPCtoRC1, pathCommonPCtoRC2 );
 
     //At this point we know paths from the common primary cell
     //to the root nodes of both subsets. If one of these paths is a prefix of
@@ -3256,6 +5836,209 @@ bool disjoint( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 ) {
 
 
 
+/*************************************FRIENDS OF FrozenGridTreeSet*****************************************/
+
+bool subset( const GridCell& theCell, const FrozenGridTreeSet& theSet ) {
+    bool result = false;
+
+    //Test that the Grids are equal
+    ARIADNE_ASSERT( theCell.grid() == theSet.grid() );
+
+    //Get the paths from the common primary cell to theCell and to the root node of theSet
+    BinaryWord pathCommonPCtoCell, pathCommonPCtoRC;
+    common_primary_cell_path( theCell, theSet.cell(), pathCommonPCtoCell, pathCommonPCtoRC );
+
+    if( pathCommonPCtoRC.is_prefix( pathCommonPCtoCell ) ) {
+        //theCell lies within the root cell of theSet, so it is a subset if
+        //the node corresponding to theCell, or the leaf above it, is enabled
+        pathCommonPCtoCell.erase_prefix( pathCommonPCtoRC.size() );
+        result = theSet.all_enabled( theSet.locate_node( pathCommonPCtoCell ) );
+    } else {
+        //DO NOTHING: the cell is a strict superset of the tree or they do not overlap
+    }
+    return result;
+}
+
+bool overlap( const GridCell& theCell, const FrozenGridTreeSet& theSet ) {
+    bool result = false;
+
+    //Test that the Grids are equal
+    ARIADNE_ASSERT( theCell.grid() == theSet.grid() );
+
+    //Get the paths from the common primary cell to theCell and to the root node of theSet
+    BinaryWord pathCommonPCtoCell, pathCommonPCtoRC;
+    common_primary_cell_path( theCell, theSet.cell(), pathCommonPCtoCell, pathCommonPCtoRC );
+
+    if( pathCommonPCtoCell.is_prefix( pathCommonPCtoRC ) ) {
+        //theCell contains the root cell of theSet
+        result = ! theSet.empty();
+    } else {
+        if( pathCommonPCtoRC.is_prefix( pathCommonPCtoCell ) ) {
+            //theCell lies within the root cell of theSet, find the node corresponding
+            //to it, or the leaf above it, and check if it has enabled leaves
+            pathCommonPCtoCell.erase_prefix( pathCommonPCtoRC.size() );
+            result = theSet.has_enabled( theSet.locate_node( pathCommonPCtoCell ) );
+        } else {
+            //DO NOTHING: The paths diverge, so theCell and theSet do not overlap
+        }
+    }
+    return result;
+}
+
+bool subset( const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2 ) {
+    bool result = false;
+
+    //Test that the Grids are equal
+    ARIADNE_ASSERT( theSet1.grid() == theSet2.grid() );
+
+    //Get the paths from the common primary cell to the root nodes of the set's binary trees
+    BinaryWord pathCommonPCtoRC1, pathCommonPCtoRC2;
+    common_primary_cell_path( theSet1.cell(), theSet2.cell(), pathCommonPCtoRC1, pathCommonPCtoRC2 );
+
+    if( pathCommonPCtoRC1.is_prefix( pathCommonPCtoRC2 ) ) {
+        //theSet2 lies within the root cell of theSet1, so the branches of theSet1 that we
+        //leave following the path to the root cell of theSet2 must have no enabled leaves
+        pathCommonPCtoRC2.erase_prefix( pathCommonPCtoRC1.size() );
+        uint path_element = 0;
+        bool areExtraLeavesDisabled = true;
+        size_t node1 = FrozenGridTreeSet::ROOT;
+        while( ( path_element < pathCommonPCtoRC2.size() ) && areExtraLeavesDisabled && ! theSet1.is_leaf( node1 ) ) {
+            if( pathCommonPCtoRC2[ path_element ] ) {
+                areExtraLeavesDisabled = ! theSet1.has_enabled( theSet1.left_node( node1 ) );
+                node1 = theSet1.right_node( node1 );
+            } else {
+                areExtraLeavesDisabled = ! theSet1.has_enabled( theSet1.right_node( node1 ) );
+                node1 = theSet1.left_node( node1 );
+            }
+            path_element++;
+        }
+
+        if( areExtraLeavesDisabled ) {
+            if( theSet1.is_leaf( node1 ) && ( path_element < pathCommonPCtoRC2.size() ) ) {
+                //The leaf strictly contains the root cell of theSet2, so it has to be disabled
+                result = ! theSet1.is_enabled( node1 );
+            } else {
+                //The trees are aligned now, so we can compare them node by node
+                size_t node2 = FrozenGridTreeSet::ROOT;
+                result = FrozenGridTreeSet::subset( theSet1, node1, theSet2, node2 );
+            }
+        }
+    } else {
+        if( pathCommonPCtoRC2.is_prefix( pathCommonPCtoRC1 ) ) {
+            //theSet1 lies within the root cell of theSet2
+            pathCommonPCtoRC1.erase_prefix( pathCommonPCtoRC2.size() );
+            if( theSet1.empty() ) {
+                //An empty set is a subset of any set
+                result = true;
+            } else {
+                size_t node2 = theSet2.locate_node( pathCommonPCtoRC1 );
+                if( theSet2.is_leaf( node2 ) ) {
+                    //The leaf contains the root cell of theSet1, which is not empty
+                    result = theSet2.is_enabled( node2 );
+                } else {
+                    size_t node1 = FrozenGridTreeSet::ROOT;
+                    result = FrozenGridTreeSet::subset( theSet1, node1, theSet2, node2 );
+                }
+            }
+        } else {
+            //The root cells of the sets are disjoint, as GridTreeSubset does we report false
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+bool overlap( const FrozenGridTreeSet& theSet1, const FrozenGridTreeSet& theSet2 ) {
+    bool result = false;
+
+    //Test that the Grids are equal
+    ARIADNE_ASSERT( theSet1.grid() == theSet2.grid() );
+
+    //Get the paths from the common primary cell to the root nodes of the set's binary trees
+    BinaryWord pathCommonPCtoRC1, pathCommonPCtoRC2;
+    common_primary_cell_path( theSet1.cell(), theSet2.cell(), pathCommonPCtoRC1, pathCommonPCtoRC2 );
+
+    if( pathCommonPCtoRC1.is_prefix( pathCommonPCtoRC2 ) ){
+        //theSet2 is located somewhere within the bounding box of theSet1
+        pathCommonPCtoRC2.erase_prefix( pathCommonPCtoRC1.size() );
+        result = FrozenGridTreeSet::overlap( theSet1, pathCommonPCtoRC2, theSet2 );
+    } else {
+        if( pathCommonPCtoRC2.is_prefix( pathCommonPCtoRC1 ) ){
+            //theSet1 is located somewhere within the bounding box of theSet2
+            pathCommonPCtoRC1.erase_prefix( pathCommonPCtoRC2.size() );
+            result = FrozenGridTreeSet::overlap( theSet2, pathCommonPCtoRC1, theSet1 );
+        } else {
+            //The sets do not overlap
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+/*************************************FRIENDS OF MortonGridTreeSet*****************************************/
+
+MortonGridTreeSet join( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2 ) {
+    MortonGridTreeSet theAlignedSet1( theSet1.grid() ), theAlignedSet2( theSet2.grid() );
+    MortonGridTreeSet::align( theSet1, theSet2, theAlignedSet1, theAlignedSet2 );
+    const std::vector<MortonGridTreeSet::Key>& theKeys1 = theAlignedSet1._theKeys;
+    const std::vector<MortonGridTreeSet::Key>& theKeys2 = theAlignedSet2._theKeys;
+
+    MortonGridTreeSet result( theAlignedSet1.grid(), theAlignedSet1.height() );
+    result._theKeys.reserve( theKeys1.size() + theKeys2.size() );
+    std::vector<MortonGridTreeSet::Key>::const_iterator pKey1 = theKeys1.begin(), pKey2 = theKeys2.begin();
+    while( ( pKey1 != theKeys1.end() ) || ( pKey2 != theKeys2.end() ) ) {
+        //Take the next cell in the Z-order
+        const MortonGridTreeSet::Key& theKey = ( ( pKey2 == theKeys2.end() ) || ( ( pKey1 != theKeys1.end() ) && ( *pKey1 < *pKey2 ) ) ) ? *pKey1++ : *pKey2++;
+        //A cell that starts within the last added cell is its sub-cell
+        if( result._theKeys.empty() || ( theKey.code > result._theKeys.back().last() ) ) {
+            result._theKeys.push_back( theKey );
+        }
+    }
+    return result;
+}
+
+MortonGridTreeSet intersection( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2 ) {
+    MortonGridTreeSet theAlignedSet1( theSet1.grid() ), theAlignedSet2( theSet2.grid() );
+    MortonGridTreeSet::align( theSet1, theSet2, theAlignedSet1, theAlignedSet2 );
+    const std::vector<MortonGridTreeSet::Key>& theKeys1 = theAlignedSet1._theKeys;
+    const std::vector<MortonGridTreeSet::Key>& theKeys2 = theAlignedSet2._theKeys;
+
+    MortonGridTreeSet result( theAlignedSet1.grid(), theAlignedSet1.height() );
+    std::vector<MortonGridTreeSet::Key>::const_iterator pKey1 = theKeys1.begin(), pKey2 = theKeys2.begin();
+    while( ( pKey1 != theKeys1.end() ) && ( pKey2 != theKeys2.end() ) ) {
+        if( pKey1->last() < pKey2->code ) {
+            ++pKey1;
+        } else if( pKey2->last() < pKey1->code ) {
+            ++pKey2;
+        } else {
+            //Overlapping cells are nested, the smaller one is in the intersection,
+            //the larger one may still contain the following cells of the other set
+            if( pKey1->depth >= pKey2->depth ) {
+                result._theKeys.push_back( *pKey1++ );
+            } else {
+                result._theKeys.push_back( *pKey2++ );
+            }
+        }
+    }
+    return result;
+}
+
+MortonGridTreeSet difference( const MortonGridTreeSet& theSet1, const MortonGridTreeSet& theSet2 ) {
+    MortonGridTreeSet theAlignedSet1( theSet1.grid() ), theAlignedSet2( theSet2.grid() );
+    MortonGridTreeSet::align( theSet1, theSet2, theAlignedSet1, theAlignedSet2 );
+    const std::vector<MortonGridTreeSet::Key>& theKeys2 = theAlignedSet2._theKeys;
+
+    MortonGridTreeSet result( theAlignedSet1.grid(), theAlignedSet1.height() );
+    std::vector<MortonGridTreeSet::Key>::const_iterator pKey2 = theKeys2.begin();
+    for( std::vector<MortonGridTreeSet::Key>::const_iterator pKey1 = theAlignedSet1._theKeys.begin();
+         pKey1 != theAlignedSet1._theKeys.end(); ++pKey1 ) {
+        MortonGridTreeSet::subtract( *pKey1, pKey2, theKeys2.end(), result._theKeys );
+    }
+    return result;
+}
+
 /*************************************FRIENDS OF GridTreeSet*****************************************/
 
 GridTreeSet outer_approximation(const Box& theBox, const Grid& theGrid, const uint depth) {
@@ -3286,6 +6069,111 @@ GridTreeSet join( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 )
     return resultSet;
 }
     
+//The root of one of the joined trees, its root cell is reached from the current node
+//of the result by following the path from the position on (it is placed, if at the end)
+struct JoinedTree {
+    const BinaryTreeNode * pNode;
+    const BinaryWord * pPath;
+    uint position;
+};
+
+//Builds in the disabled leaf pResultNode the union of the given trees
+static void join_trees( BinaryTreeNode * pResultNode, const std::vector<JoinedTree>& theTrees ) {
+    //1. Drop the trees without enabled cells here, stop if some tree covers the whole node
+    std::vector<JoinedTree> theActiveTrees;
+    theActiveTrees.reserve( theTrees.size() );
+    for( std::vector<JoinedTree>::const_iterator it = theTrees.begin(); it != theTrees.end(); ++it ) {
+        if( it->pNode->is_disabled() ) {
+            //DO NOTHING: There is nothing to add from a disabled leaf
+        } else if( it->position == it->pPath->size() && it->pNode->is_enabled() ) {
+            pResultNode->set_enabled();
+            return;
+        } else {
+            theActiveTrees.push_back( *it );
+        }
+    }
+    //2. A single placed tree is copied as a whole, nothing is merged into it
+    if( theActiveTrees.empty() ) {
+        return;
+    }
+    if( theActiveTrees.size() == 1 && theActiveTrees[0].position == theActiveTrees[0].pPath->size() ) {
+        pResultNode->copy_from( theActiveTrees[0].pNode );
+        return;
+    }
+    //3. Otherwise distribute the trees over the two halves of the node and go down
+    std::vector<JoinedTree> theLeftTrees, theRightTrees;
+    for( std::vector<JoinedTree>::const_iterator it = theActiveTrees.begin(); it != theActiveTrees.end(); ++it ) {
+        if( it->position < it->pPath->size() ) {
+            //The root cell of the tree is still below, follow its path
+            JoinedTree theTree = *it;
+            theTree.position++;
+            ( ( *it->pPath )[ it->position ] ? theRightTrees : theLeftTrees ).push_back( theTree );
+        } else {
+            JoinedTree theLeftTree = *it, theRightTree = *it;
+            theLeftTree.pNode = it->pNode->left_node();
+            theRightTree.pNode = it->pNode->right_node();
+            theLeftTrees.push_back( theLeftTree );
+            theRightTrees.push_back( theRightTree );
+        }
+    }
+    pResultNode->split();
+    join_trees( pResultNode->left_node(), theLeftTrees );
+    join_trees( pResultNode->right_node(), theRightTrees );
+}
+
+static GridTreeSet join_subsets( const std::vector<const GridTreeSubset*>& theSets ) {
+    if( theSets.empty() ) {
+        return GridTreeSet();
+    }
+    //1. Find the highest primary cell, all the trees are aligned to it at once
+    const Grid& theGrid = theSets[0]->grid();
+    uint theHeight = 0;
+    for( uint i = 0; i < theSets.size(); i++ ) {
+        ARIADNE_ASSERT( theSets[i]->grid() == theGrid );
+        theHeight = std::max( theHeight, theSets[i]->cell().height() );
+    }
+    //2. The path from this primary cell to the root cell of every set
+    std::vector<BinaryWord> thePaths( theSets.size() );
+    std::vector<JoinedTree> theTrees( theSets.size() );
+    for( uint i = 0; i < theSets.size(); i++ ) {
+        thePaths[i] = GridCell::primary_cell_path( theGrid.dimension(), theHeight, theSets[i]->cell().height() );
+        thePaths[i].append( theSets[i]->cell().word() );
+        theTrees[i].pNode = theSets[i]->binary_tree();
+        theTrees[i].pPath = &thePaths[i];
+        theTrees[i].position = 0;
+    }
+    //3. Merge all the trees in one traversal
+    BinaryTreeNode * pRootTreeNode = new BinaryTreeNode( false );
+    join_trees( pRootTreeNode, theTrees );
+    return GridTreeSet( theGrid, theHeight, pRootTreeNode );
+}
+
+GridTreeSet join( const std::vector<GridTreeSet>& theSets ) {
+    std::vector<const GridTreeSubset*> theSubsets;
+    theSubsets.reserve( theSets.size() );
+    for( uint i = 0; i < theSets.size(); i++ ) {
+        theSubsets.push_back( &theSets[i] );
+    }
+    return join_subsets( theSubsets );
+}
+
+GridTreeSet join( const std::vector<GridTreeSubset>& theSets ) {
+    std::vector<const GridTreeSubset*> theSubsets;
+    theSubsets.reserve( theSets.size() );
+    for( uint i = 0; i < theSets.size(); i++ ) {
+        theSubsets.push_back( &theSets[i] );
+    }
+    return join_subsets( theSubsets );
+}
+
+GridTreeSet move_join( GridTreeSet& theSet1, GridTreeSet& theSet2 ) {
+    //Take over the first set as a whole and move the second one into it
+    GridTreeSet resultSet( theSet1.grid() );
+    resultSet.swap( theSet1 );
+    resultSet.move_adjoin( theSet2 );
+    return resultSet;
+}
+    
 GridTreeSet intersection( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 ) {
     //Test that the Grids are equal
     ARIADNE_ASSERT( theSet1.grid() == theSet2.grid() );
@@ -3326,6 +6214,187 @@ GridTreeSet difference( const GridTreeSubset& theSet1, const GridTreeSubset& the
     return resultSet;
 }
 
+GridTreeSet symmetric_difference( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 ) {
+    //Test that the Grids are equal
+    ARIADNE_ASSERT( theSet1.grid() == theSet2.grid() );
+
+    //Compute the highest primary cell 
+    const uint heightSet1 = theSet1.cell().height();
+    const uint heightSet2 = theSet2.cell().height();
+    const uint maxPCHeight = ( heightSet1 <  heightSet2 ) ? heightSet2 : heightSet1;
+
+    //Create the resulting GridTreeSet
+    GridTreeSet resultSet( theSet1.grid(), maxPCHeight, new BinaryTreeNode() );
+
+    //Adjoin the first set
+    resultSet.adjoin( theSet1 );
+    //Follow the path to the root cell of the second set, the cells off this path are not toggled
+    BinaryWord rootNodePath = GridCell::primary_cell_path( theSet2.grid().dimension(), maxPCHeight, heightSet2 );
+    rootNodePath.append( theSet2.cell().word() );
+    BinaryTreeNode * pBinaryTreeNode = resultSet._pRootTreeNode;
+    for( uint position = 0; position < rootNodePath.size(); position++ ){
+        pBinaryTreeNode->split();
+        pBinaryTreeNode = rootNodePath[position] ? pBinaryTreeNode->right_node() : pBinaryTreeNode->left_node();
+    }
+    //Toggle the cells of the second set in the result set
+    BinaryTreeNode::toggle( pBinaryTreeNode, theSet2.binary_tree() );
+
+    return resultSet;
+}
+
+/*! \brief Tells which subtrees of one tree have enabled leaves. The subtrees are counted once, in the preorder
+ *  of their roots, and a traversal that prunes the empty subtrees carries the preorder position of the current
+ *  node along, so that every subtree is tested in O(1), also when the node caches are not compiled in.
+ */
+class EnabledSubtreeIndex {
+  public:
+    /*! \brief Counts the subtrees of the tree rooted to \a pRootNode, the root has the position zero */
+    explicit EnabledSubtreeIndex( const BinaryTreeNode * pRootNode ) {
+        index_subtree( pRootNode );
+    }
+
+    /*! \brief Whether the subtree of the node at the preorder position \a position has enabled leaves */
+    bool has_enabled( const size_t position ) const {
+        return _hasEnabled[position];
+    }
+
+    /*! \brief The preorder positions of the left and the right sub-nodes of the non-leaf node at \a position */
+    size_t left_position( const size_t position ) const {
+        return position + 1;
+    }
+    size_t right_position( const size_t position ) const {
+        return position + 1 + _theSubtreeSizes[ position + 1 ];
+    }
+
+  private:
+    /*! \brief Appends the subtree rooted to \a pNode in the preorder, returns whether it has enabled leaves */
+    bool index_subtree( const BinaryTreeNode * pNode ) {
+        const size_t position = _hasEnabled.size();
+        _hasEnabled.push_back( pNode->is_enabled() );
+        _theSubtreeSizes.push_back( 1 );
+        if( ! pNode->is_leaf() ) {
+            const bool hasLeftEnabled = index_subtree( pNode->left_node() );
+            const bool hasRightEnabled = index_subtree( pNode->right_node() );
+            _hasEnabled[position] = hasLeftEnabled || hasRightEnabled;
+            _theSubtreeSizes[position] = _hasEnabled.size() - position;
+        }
+        return _hasEnabled[position];
+    }
+
+    /*! \brief Whether the subtree has enabled leaves, and the number of its nodes, in the preorder of their roots */
+    std::vector<bool> _hasEnabled;
+    std::vector<size_t> _theSubtreeSizes;
+};
+
+//One factor of a product, a tree placed below the path from the primary cell as in JoinedTree,
+//together with the index of its enabled subtrees and the preorder position of pNode in it
+struct ProductFactor {
+    const BinaryTreeNode * pNode;
+    const BinaryWord * pPath;
+    uint position;
+    const EnabledSubtreeIndex * pIndex;
+    size_t nodePosition;
+};
+
+//A tree placed below the path from the primary cell, see ProductFactor, has no enabled cells
+static bool is_empty_placed_tree( const ProductFactor& theTree ) {
+    return ! theTree.pIndex->has_enabled( theTree.nodePosition );
+}
+
+//A tree placed below the path from the primary cell, see ProductFactor, covers the whole current cell
+static bool is_full_placed_tree( const ProductFactor& theTree ) {
+    return theTree.position == theTree.pPath->size() && theTree.pNode->is_enabled();
+}
+
+//Builds in the disabled leaf pResultNode, at the depth theDepth of the product tree, the product of the given
+//trees. The first firstDimension of the theDimension dimensions of the product are split by theFirstTree.
+static void product_trees( BinaryTreeNode * pResultNode, const uint theDepth, const uint firstDimension, const uint theDimension,
+                           const ProductFactor& theFirstTree, const ProductFactor& theSecondTree ) {
+    //1. The product is empty if one of the trees is, and it is the whole cell if both trees are
+    if( is_empty_placed_tree( theFirstTree ) || is_empty_placed_tree( theSecondTree ) ) {
+        return;
+    }
+    if( is_full_placed_tree( theFirstTree ) && is_full_placed_tree( theSecondTree ) ) {
+        pResultNode->set_enabled();
+        return;
+    }
+    //2. Split the tree of the dimension in which the product cell is split at this depth
+    const bool isFirstSplit = ( theDepth % theDimension ) < firstDimension;
+    const ProductFactor& theSplitTree = isFirstSplit ? theFirstTree : theSecondTree;
+    ProductFactor theLeftTree = theSplitTree, theRightTree = theSplitTree;
+    bool isLeftEmpty = false, isRightEmpty = false;
+    if( is_full_placed_tree( theSplitTree ) ) {
+        //DO NOTHING: Both halves of the cell are covered by the tree
+    } else if( theSplitTree.position < theSplitTree.pPath->size() ) {
+        //The root cell of the tree is still below, the half off its path is empty
+        const bool isRight = ( *theSplitTree.pPath )[ theSplitTree.position ];
+        theLeftTree.position++;
+        theRightTree.position++;
+        isLeftEmpty = isRight;
+        isRightEmpty = ! isRight;
+    } else {
+        theLeftTree.pNode = theSplitTree.pNode->left_node();
+        theLeftTree.nodePosition = theSplitTree.pIndex->left_position( theSplitTree.nodePosition );
+        theRightTree.pNode = theSplitTree.pNode->right_node();
+        theRightTree.nodePosition = theSplitTree.pIndex->right_position( theSplitTree.nodePosition );
+    }
+    //3. Go down, the tree of the other dimensions stays the same in both halves
+    pResultNode->split();
+    if( ! isLeftEmpty ) {
+        product_trees( pResultNode->left_node(), theDepth + 1, firstDimension, theDimension,
+                       isFirstSplit ? theLeftTree : theFirstTree, isFirstSplit ? theSecondTree : theLeftTree );
+    }
+    if( ! isRightEmpty ) {
+        product_trees( pResultNode->right_node(), theDepth + 1, firstDimension, theDimension,
+                       isFirstSplit ? theRightTree : theFirstTree, isFirstSplit ? theSecondTree : theRightTree );
+    }
+    recombine_enabled_leaves( pResultNode );
+}
+
+GridTreeSet product( const GridTreeSubset& theSet1, const GridTreeSubset& theSet2 ) {
+    //1. The product grid has the origins and lengths of both grids
+    const Grid& theGrid1 = theSet1.grid();
+    const Grid& theGrid2 = theSet2.grid();
+    const uint firstDimension = theGrid1.dimension();
+    const uint theDimension = firstDimension + theGrid2.dimension();
+    Vector<Float> theOrigin( theDimension ), theLengths( theDimension );
+    for( uint i = 0; i < firstDimension; i++ ) {
+        theOrigin[i] = theGrid1.origin()[i];
+        theLengths[i] = theGrid1.lengths()[i];
+    }
+    for( uint i = firstDimension; i < theDimension; i++ ) {
+        theOrigin[i] = theGrid2.origin()[ i - firstDimension ];
+        theLengths[i] = theGrid2.lengths()[ i - firstDimension ];
+    }
+    const Grid theGrid( theOrigin, theLengths );
+
+    //2. The primary cells of the same height have the same lattice box in every dimension,
+    //   so the product of the highest primary cells is the primary cell of the product
+    const uint theHeight = std::max( theSet1.cell().height(), theSet2.cell().height() );
+    BinaryWord thePath1 = GridCell::primary_cell_path( firstDimension, theHeight, theSet1.cell().height() );
+    thePath1.append( theSet1.cell().word() );
+    BinaryWord thePath2 = GridCell::primary_cell_path( theGrid2.dimension(), theHeight, theSet2.cell().height() );
+    thePath2.append( theSet2.cell().word() );
+    //   Every factor is counted once, the pairs of its subtrees are visited many times
+    const EnabledSubtreeIndex theIndex1( theSet1.binary_tree() ), theIndex2( theSet2.binary_tree() );
+    ProductFactor theTree1, theTree2;
+    theTree1.pNode = theSet1.binary_tree();
+    theTree1.pPath = &thePath1;
+    theTree1.position = 0;
+    theTree1.pIndex = &theIndex1;
+    theTree1.nodePosition = 0;
+    theTree2.pNode = theSet2.binary_tree();
+    theTree2.pPath = &thePath2;
+    theTree2.position = 0;
+    theTree2.pIndex = &theIndex2;
+    theTree2.nodePosition = 0;
+
+    //3. Interleave the two trees in one traversal
+    BinaryTreeNode * pRootTreeNode = new BinaryTreeNode( false );
+    product_trees( pRootTreeNode, 0, firstDimension, theDimension, theTree1, theTree2 );
+    return GridTreeSet( theGrid, theHeight, pRootTreeNode );
+}
+
 void draw(CanvasInterface& theGraphic, const GridCell& theGridCell) {
     theGridCell.box().draw(theGraphic);
 }
@@ -3343,6 +6412,58 @@ void draw(CanvasInterface& theGraphic, const CompactSetInterface& theSet) {
 }
 
 
+/*! \brief Whether \a cons_set is disjoint from the enabled cells of the tree rooted to \a pNode, whose cell
+ *  has the lattice box \a theLatticeBox at the depth \a theDepth. The cell of every node is tested before its
+ *  sub nodes, so a subtree whose cell is disjoint from \a cons_set costs one constraint evaluation. The empty
+ *  subtrees are skipped by \a theIndex, in which \a pNode has the preorder position \a position.
+ */
+static tribool constraint_disjoint( const ConstraintSet& cons_set, const BinaryTreeNode* pNode,
+                                    const EnabledSubtreeIndex& theIndex, const size_t position, const Grid& theGrid,
+                                    const uint theDepth, const Vector<Interval>& theLatticeBox ) {
+    if( ! theIndex.has_enabled( position ) ) {
+        //There are no cells in the subtree
+        return true;
+    }
+    const tribool isDisjoint = cons_set.disjoint( GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid ) );
+    if( definitely( isDisjoint ) || pNode->is_leaf() ) {
+        //Either the whole subtree is decided, or the enabled leaf is the cell itself
+        return isDisjoint;
+    }
+    Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+    GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+    const tribool isLeftDisjoint = constraint_disjoint( cons_set, pNode->left_node(), theIndex, theIndex.left_position( position ),
+                                                       theGrid, theDepth + 1, theLeftLatticeBox );
+    if( definitely( ! isLeftDisjoint ) ) {
+        return false;
+    }
+    return isLeftDisjoint && constraint_disjoint( cons_set, pNode->right_node(), theIndex, theIndex.right_position( position ),
+                                                  theGrid, theDepth + 1, theRightLatticeBox );
+}
+
+/*! \brief Whether \a cons_set covers the enabled cells of the tree rooted to \a pNode, see \a constraint_disjoint */
+static tribool constraint_covers( const ConstraintSet& cons_set, const BinaryTreeNode* pNode,
+                                  const EnabledSubtreeIndex& theIndex, const size_t position, const Grid& theGrid,
+                                  const uint theDepth, const Vector<Interval>& theLatticeBox ) {
+    if( ! theIndex.has_enabled( position ) ) {
+        //There are no cells in the subtree
+        return true;
+    }
+    const tribool isCovered = cons_set.covers( GridAbstractCell::lattice_box_to_space( theLatticeBox, theGrid ) );
+    if( definitely( isCovered ) || pNode->is_leaf() ) {
+        //Either the whole subtree is decided, or the enabled leaf is the cell itself
+        return isCovered;
+    }
+    Vector<Interval> theLeftLatticeBox( theLatticeBox ), theRightLatticeBox( theLatticeBox );
+    GridAbstractCell::split_lattice_box( theDepth, theLeftLatticeBox, theRightLatticeBox );
+    const tribool isLeftCovered = constraint_covers( cons_set, pNode->left_node(), theIndex, theIndex.left_position( position ),
+                                                     theGrid, theDepth + 1, theLeftLatticeBox );
+    if( definitely( ! isLeftCovered ) ) {
+        return false;
+    }
+    return isLeftCovered && constraint_covers( cons_set, pNode->right_node(), theIndex, theIndex.right_position( position ),
+                                               theGrid, theDepth + 1, theRightLatticeBox );
+}
+
 tribool disjoint(const ConstraintSet& cons_set, const GridTreeSet& grid_set)
 {
     if(cons_set.unconstrained()) return false;
@@ -3350,17 +6471,11 @@ tribool disjoint(const ConstraintSet& cons_set, const GridTreeSet& grid_set)
 	if (cons_set.disjoint(grid_set.bounding_box()))
 		return true;
 
-	tribool result = true;
-
-	for (GridTreeSet::const_iterator cell_it = grid_set.begin(); cell_it != grid_set.end(); ++cell_it) {
-		tribool disjoint_cell = cons_set.disjoint(cell_it->box());
-		if (definitely(!disjoint_cell))
-			return false;
-		else
-			result = result && disjoint_cell;
-	}
-
-	return result;
+	//Descend the tree from the root cell, the subtrees are decided by the boxes of their cells
+	const GridCell theCell = grid_set.cell();
+	const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( theCell.dimension(), theCell.height(), theCell.word() );
+	const EnabledSubtreeIndex theIndex( grid_set.binary_tree() );
+	return constraint_disjoint( cons_set, grid_set.binary_tree(), theIndex, 0, grid_set.grid(), theCell.word().size(), theLatticeBox );
 }
 
 
@@ -3381,17 +6496,11 @@ tribool covers(const ConstraintSet& cons_set, const GridTreeSet& grid_set)
 	if (cons_set.disjoint(grid_set.bounding_box()))
 		return false;
 
-	tribool result = true;
-
-	for (GridTreeSet::const_iterator cell_it = grid_set.begin(); cell_it != grid_set.end(); ++cell_it) {
-		tribool covering_cell = cons_set.covers(cell_it->box());
-		if (definitely(!covering_cell))
-			return false;
-		else
-			result = result || covering_cell;
-	}
-
-	return result;
+	//Descend the tree from the root cell, the subtrees are decided by the boxes of their cells
+	const GridCell theCell = grid_set.cell();
+	const Vector<Interval> theLatticeBox = GridCell::compute_lattice_box( theCell.dimension(), theCell.height(), theCell.word() );
+	const EnabledSubtreeIndex theIndex( grid_set.binary_tree() );
+	return constraint_covers( cons_set, grid_set.binary_tree(), theIndex, 0, grid_set.grid(), theCell.word().size(), theLatticeBox );
 }
 
 GridCell project_down_unchecked(
@@ -3416,19 +6525,61 @@ GridCell project_down_unchecked(
 	return GridCell(projected_grid,cell.height(),new_word);
 }
 
+/*! \brief Adjoins the projection of the tree rooted to \a pSourceNode at the depth \a theDepth of the source
+ *  tree to the tree rooted to \a pTargetNode. The splits in the dimensions \a isKeptDimension split the target
+ *  node as well, the two sub trees of any other split are merged into the same target node. The projection of
+ *  a subtree stops as soon as its target node is an enabled leaf, as nothing can be added to it any more.
+ *  The empty source subtrees are skipped by \a theIndex, in which \a pSourceNode has the position \a position.
+ */
+static void project_down_tree( const BinaryTreeNode * pSourceNode, const EnabledSubtreeIndex& theIndex, const size_t position,
+                               const uint theDepth, const std::vector<bool>& isKeptDimension, BinaryTreeNode * pTargetNode ) {
+    if( pTargetNode->is_enabled() || ! theIndex.has_enabled( position ) ) {
+        return;
+    }
+    if( pSourceNode->is_leaf() ) {
+        //The projection of an enabled cell is the whole projected cell
+        pTargetNode->make_leaf( true );
+    } else if( isKeptDimension[ theDepth % isKeptDimension.size() ] ) {
+        pTargetNode->split();
+        project_down_tree( pSourceNode->left_node(), theIndex, theIndex.left_position( position ), theDepth + 1,
+                           isKeptDimension, pTargetNode->left_node() );
+        project_down_tree( pSourceNode->right_node(), theIndex, theIndex.right_position( position ), theDepth + 1,
+                           isKeptDimension, pTargetNode->right_node() );
+        recombine_enabled_leaves( pTargetNode );
+    } else {
+        //Both halves of the eliminated dimension are projected onto the same cell
+        project_down_tree( pSourceNode->left_node(), theIndex, theIndex.left_position( position ), theDepth + 1,
+                           isKeptDimension, pTargetNode );
+        project_down_tree( pSourceNode->right_node(), theIndex, theIndex.right_position( position ), theDepth + 1,
+                           isKeptDimension, pTargetNode );
+    }
+}
+
 GridTreeSet project_down(
 		const GridTreeSet& original_set,
 		const Vector<uint>& indices)
 {
 	Grid projected_grid = project_down(original_set.grid(),indices);
 
-	GridTreeSet result(projected_grid);
+	//The words of the projected cells keep the bits of the kept dimensions in their order,
+	//which is the round-robin order of the projected grid only for increasing indices
+	std::vector<bool> isKeptDimension( original_set.dimension(), false );
+	for (uint j=0; j < indices.size(); ++j) {
+		ARIADNE_ASSERT_MSG( indices[j] < original_set.dimension() && ( j == 0 || indices[j-1] < indices[j] ),
+		                    "The projection indices " << indices << " must be increasing and less than " << original_set.dimension() );
+		isKeptDimension[indices[j]] = true;
+	}
 
-	for (GridTreeSet::const_iterator cell_it = original_set.begin(); cell_it != original_set.end(); ++cell_it) {
-		result.adjoin(project_down_unchecked(*cell_it,result.grid(),indices));
+	BinaryTreeNode * pRootTreeNode = new BinaryTreeNode( false );
+	if( original_set.dimension() > 0 ) {
+		const EnabledSubtreeIndex theIndex( original_set.binary_tree() );
+		project_down_tree( original_set.binary_tree(), theIndex, 0, original_set.cell().word().size(), isKeptDimension, pRootTreeNode );
+	} else if( original_set.binary_tree()->is_enabled() ) {
+		pRootTreeNode->make_leaf( true );
 	}
 
-	return result;
+	//The primary cells project onto the primary cells of the same height
+	return GridTreeSet(projected_grid, original_set.cell().height(), pRootTreeNode);
 }
 
 GridTreeSet outer_intersection(const GridTreeSet& grid_set, const ConstraintSet& cons_set) {
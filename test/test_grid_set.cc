@@ -27,6 +27,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <set>
 
 #include "config.h"
 
@@ -59,6 +60,16 @@ static const uint heightTwo = 2;
 static const uint heightThree = 3;
 static const uint heightFour = 4;
 
+//The two sets of the set operation tests, they are rooted to different primary cells.
+//The root cell of the first set is [-1, 1]x[-1, 1], the enabled cells are [-1, 0]x[-1, 0] and [0, 1]x[-1, 0]
+GridTreeSet make_first_set( const Grid& theGrid ) {
+    return GridTreeSet( theGrid, heightOne, make_binary_word("1100100"), make_binary_word("1010") );
+}
+
+GridTreeSet make_second_set( const Grid& theGrid ) {
+    return GridTreeSet( theGrid, heightTwo, make_binary_word("11110010000"), make_binary_word("011000") );
+}
+
 void test_grid() {
     // Test copy constructor
     Grid gr1(2, 1.0);
@@ -243,6 +254,502 @@ void test_binary_tree() {
     ARIADNE_TEST_COMPARE( expected_binary_tree2, ==, theNewBinaryTreeRoot );
 }
 
+void test_binary_tree_node_pool() {
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Release a large binary tree and reuse its nodes for a new one");
+
+    BinaryTreeNode * pBinaryTreeRoot = new BinaryTreeNode(true);
+    pBinaryTreeRoot->mince(12);
+    const size_t capacity = BinaryTreeNodePool::capacity();
+    ARIADNE_TEST_COMPARE( capacity, >=, size_t(8191) );
+
+    ARIADNE_PRINT_TEST_COMMENT("Deleting the tree does not give the memory back to the system");
+    delete pBinaryTreeRoot;
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::capacity(), capacity );
+
+    ARIADNE_PRINT_TEST_COMMENT("The nodes of the released tree are reclaimed by the new tree");
+    pBinaryTreeRoot = new BinaryTreeNode(false);
+    pBinaryTreeRoot->split();
+    pBinaryTreeRoot->left_node()->make_leaf(true);
+    pBinaryTreeRoot->left_node()->mince(11);
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::capacity(), capacity );
+    ARIADNE_TEST_EQUAL( BinaryTreeNode::count_enabled_leaf_nodes( pBinaryTreeRoot ), size_t(2048) );
+
+    ARIADNE_PRINT_TEST_COMMENT("Making a leaf out of a subtree releases the subtree");
+    pBinaryTreeRoot->make_leaf(false);
+    ARIADNE_TEST_EQUAL( pBinaryTreeRoot->is_leaf(), true );
+    ARIADNE_TEST_EQUAL( pBinaryTreeRoot->is_disabled(), true );
+    delete pBinaryTreeRoot;
+
+    ARIADNE_PRINT_TEST_COMMENT("Trimming the pool gives the slabs without live nodes back to the system");
+    const size_t theTrimmedNodes = BinaryTreeNodePool::trim();
+    ARIADNE_TEST_COMPARE( theTrimmedNodes, >=, BinaryTreeNodePool::SLAB_SIZE );
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::capacity(), capacity - theTrimmedNodes );
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::trim(), size_t(0) );
+
+    ARIADNE_PRINT_TEST_COMMENT("The remaining free nodes are still handed out");
+    pBinaryTreeRoot = new BinaryTreeNode(true);
+    pBinaryTreeRoot->mince(12);
+    ARIADNE_TEST_EQUAL( BinaryTreeNode::count_enabled_leaf_nodes( pBinaryTreeRoot ), size_t(4096) );
+    delete pBinaryTreeRoot;
+
+    ARIADNE_PRINT_TEST_COMMENT("The drained nodes are taken back before a new slab is allocated, and are trimmed");
+    const size_t theDrainedCapacity = BinaryTreeNodePool::capacity();
+    BinaryTreeNodePool::drain();
+    pBinaryTreeRoot = new BinaryTreeNode(true);
+    pBinaryTreeRoot->mince(12);
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::capacity(), theDrainedCapacity );
+    delete pBinaryTreeRoot;
+    BinaryTreeNodePool::drain();
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::trim(), theDrainedCapacity );
+    ARIADNE_TEST_EQUAL( BinaryTreeNodePool::capacity(), size_t(0) );
+}
+
+void test_compact_binary_tree() {
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Convert a BinaryTreeNode into the CompactBinaryTree and back");
+    
+    BinaryTreeNode * pTwoEnabledNodeTree = new BinaryTreeNode(false);
+    pTwoEnabledNodeTree->split();
+    pTwoEnabledNodeTree->right_node()->split();
+    pTwoEnabledNodeTree->right_node()->left_node()->split();
+    pTwoEnabledNodeTree->right_node()->left_node()->left_node()->set_enabled();
+    pTwoEnabledNodeTree->right_node()->left_node()->right_node()->split();
+    pTwoEnabledNodeTree->right_node()->left_node()->right_node()->left_node()->set_enabled();
+    
+    BinaryTreeNode * pThreeEnabledNodeTree = new BinaryTreeNode( *pTwoEnabledNodeTree );
+    pThreeEnabledNodeTree->left_node()->split();
+    pThreeEnabledNodeTree->left_node()->left_node()->set_enabled();
+    pThreeEnabledNodeTree->right_node()->left_node()->right_node()->right_node()->set_enabled();
+    pThreeEnabledNodeTree->right_node()->left_node()->right_node()->left_node()->set_disabled();
+    
+    CompactBinaryTree theTwoEnabledNodeTree( *pTwoEnabledNodeTree );
+    CompactBinaryTree theThreeEnabledNodeTree( *pThreeEnabledNodeTree );
+    ARIADNE_PRINT_TEST_COMMENT( theTwoEnabledNodeTree );
+    ARIADNE_TEST_EQUAL( theTwoEnabledNodeTree.node_count(), size_t(9) );
+    ARIADNE_TEST_EQUAL( theTwoEnabledNodeTree.count_enabled_leaf_nodes(), size_t(2) );
+    ARIADNE_TEST_COMPARE( theTwoEnabledNodeTree.memory(), <, 9 * sizeof(BinaryTreeNode) );
+    
+    BinaryTreeNode * pConvertedTree = theThreeEnabledNodeTree.to_binary_tree();
+    ARIADNE_TEST_EQUAL( *pConvertedTree, *pThreeEnabledNodeTree );
+    delete pConvertedTree;
+    
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Compare the CompactBinaryTree operations with the BinaryTreeNode ones");
+    ARIADNE_TEST_EQUAL( CompactBinaryTree::overlap( theTwoEnabledNodeTree, theThreeEnabledNodeTree ),
+                        BinaryTreeNode::overlap( pTwoEnabledNodeTree, pThreeEnabledNodeTree ) );
+    ARIADNE_TEST_EQUAL( CompactBinaryTree::subset( theTwoEnabledNodeTree, theThreeEnabledNodeTree ),
+                        BinaryTreeNode::subset( pTwoEnabledNodeTree, pThreeEnabledNodeTree ) );
+    ARIADNE_TEST_EQUAL( CompactBinaryTree::subset( theTwoEnabledNodeTree, theTwoEnabledNodeTree ), true );
+    
+    CompactBinaryTree theCompactTree( *pThreeEnabledNodeTree );
+    BinaryTreeNode theExpectedTree( *pThreeEnabledNodeTree );
+    theCompactTree.restrict( theTwoEnabledNodeTree );
+    BinaryTreeNode::restrict( &theExpectedTree, pTwoEnabledNodeTree );
+    ARIADNE_TEST_EQUAL( theCompactTree, CompactBinaryTree( theExpectedTree ) );
+    
+    theCompactTree = CompactBinaryTree( *pThreeEnabledNodeTree );
+    theExpectedTree = *pThreeEnabledNodeTree;
+    theCompactTree.remove( theTwoEnabledNodeTree );
+    BinaryTreeNode::remove( &theExpectedTree, pTwoEnabledNodeTree );
+    ARIADNE_TEST_EQUAL( theCompactTree, CompactBinaryTree( theExpectedTree ) );
+    
+    theCompactTree = CompactBinaryTree( *pTwoEnabledNodeTree );
+    theExpectedTree = *pTwoEnabledNodeTree;
+    theCompactTree.add_enabled( theThreeEnabledNodeTree );
+    theExpectedTree.add_enabled( &theExpectedTree, pThreeEnabledNodeTree );
+    ARIADNE_TEST_EQUAL( theCompactTree, CompactBinaryTree( theExpectedTree ) );
+    
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Reuse the nodes freed by make_leaf");
+    theCompactTree = CompactBinaryTree( *pThreeEnabledNodeTree );
+    const size_t theMemory = theCompactTree.memory();
+    theCompactTree.make_leaf( theCompactTree.right_node( CompactBinaryTree::ROOT ), false );
+    ARIADNE_TEST_EQUAL( theCompactTree.node_count(), size_t(5) );
+    theCompactTree.split( theCompactTree.right_node( CompactBinaryTree::ROOT ) );
+    theCompactTree.split( theCompactTree.left_node( theCompactTree.right_node( CompactBinaryTree::ROOT ) ) );
+    theCompactTree.recombine();
+    ARIADNE_TEST_EQUAL( theCompactTree.node_count(), size_t(5) );
+    ARIADNE_TEST_EQUAL( theCompactTree.memory(), theMemory );
+    
+    delete pTwoEnabledNodeTree;
+    delete pThreeEnabledNodeTree;
+}
+
+void collect_binary_tree_nodes( const BinaryTreeNode * pNode, std::set<const BinaryTreeNode*> & theNodes ) {
+    theNodes.insert( pNode );
+    if( ! pNode->is_leaf() ) {
+        collect_binary_tree_nodes( pNode->left_node(), theNodes );
+        collect_binary_tree_nodes( pNode->right_node(), theNodes );
+    }
+}
+
+void test_hash_consed_binary_tree() {
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Share the equal subtrees of a binary tree");
+
+    //The left and the right subtrees are equal
+    BinaryTreeNode * pBinaryTreeRoot = new BinaryTreeNode( make_binary_word("1100100"), make_binary_word("1010") );
+    const BinaryTreeNode * pConstRoot = pBinaryTreeRoot;
+    const BinaryTreeNode theExpectedTree( *pBinaryTreeRoot );
+    std::set<const BinaryTreeNode*> theNodes;
+
+    pBinaryTreeRoot->share_equal_subtrees();
+    collect_binary_tree_nodes( pConstRoot, theNodes );
+    ARIADNE_TEST_EQUAL( theNodes.size(), size_t(4) );
+    ARIADNE_TEST_EQUAL( pConstRoot->left_node(), pConstRoot->right_node() );
+    ARIADNE_TEST_EQUAL( pConstRoot->left_node()->is_shared(), true );
+    ARIADNE_TEST_EQUAL( *pBinaryTreeRoot, theExpectedTree );
+    ARIADNE_TEST_EQUAL( BinaryTreeNode::count_enabled_leaf_nodes( pBinaryTreeRoot ), size_t(2) );
+
+    ARIADNE_PRINT_TEST_COMMENT("Modifying one of the subtrees unshares the nodes on the path only");
+    pBinaryTreeRoot->left_node()->right_node()->set_enabled();
+    ARIADNE_TEST_COMPARE( pConstRoot->left_node(), !=, pConstRoot->right_node() );
+    ARIADNE_TEST_EQUAL( pConstRoot->left_node()->left_node(), pConstRoot->right_node()->left_node() );
+    ARIADNE_TEST_EQUAL( pConstRoot->right_node()->right_node()->is_disabled(), true );
+    ARIADNE_TEST_EQUAL( *pBinaryTreeRoot, BinaryTreeNode( make_binary_word("1100100"), make_binary_word("1110") ) );
+    delete pBinaryTreeRoot;
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Share the equal subtrees of a paving and modify it");
+
+    Grid theTrivialGrid(2, 1.0);
+    GridTreeSet theSet( theTrivialGrid, false );
+    theSet.adjoin_over_approximation( make_box("[-1.5,2.5]x[0.5,2.5]"), 4 );
+    GridTreeSet theSharedSet( theSet );
+    theSharedSet.share_equal_subtrees();
+
+    BinaryWord tree, leaves;
+    theSet.binary_tree()->tree_to_binary_words( tree, leaves );
+    theNodes.clear();
+    collect_binary_tree_nodes( theSharedSet.binary_tree(), theNodes );
+    ARIADNE_TEST_COMPARE( theNodes.size(), <, tree.size() );
+    ARIADNE_TEST_EQUAL( theSharedSet, theSet );
+    ARIADNE_TEST_EQUAL( theSharedSet.size(), theSet.size() );
+
+    ARIADNE_PRINT_TEST_COMMENT("Iterating through the shared paving visits the same cells");
+    GridTreeSet::const_iterator shared_iter = theSharedSet.begin();
+    for( GridTreeSet::const_iterator iter = theSet.begin(); iter != theSet.end(); ++iter, ++shared_iter ) {
+        ARIADNE_TEST_EQUAL( *shared_iter, *iter );
+    }
+    ARIADNE_TEST_ASSERT( shared_iter == theSharedSet.end() );
+
+    ARIADNE_PRINT_TEST_COMMENT("The modifications of the shared paving do not leak into the equal subtrees");
+    GridTreeSet theExpectedSet( theSet );
+    const GridCell theCell( theTrivialGrid, theSet.cell().height(), make_binary_word("1100011001") );
+    theSharedSet.mince( 5 );
+    theSharedSet.remove( theCell );
+    theSharedSet.recombine();
+    theExpectedSet.mince( 5 );
+    theExpectedSet.remove( theCell );
+    theExpectedSet.recombine();
+    ARIADNE_TEST_EQUAL( theSharedSet, theExpectedSet );
+    ARIADNE_TEST_EQUAL( theSharedSet.size(), theExpectedSet.size() );
+}
+
+size_t count_cells_by_iteration( const GridTreeSubset& theSet ) {
+    size_t result = 0;
+    for( GridTreeSubset::const_iterator iter = theSet.begin(); iter != theSet.end(); ++iter ) {
+        result++;
+    }
+    return result;
+}
+
+void test_copy_on_write_grid_tree_set() {
+    Grid theTrivialGrid(2, 1.0);
+    GridTreeSet theSet( theTrivialGrid, false );
+    theSet.adjoin_over_approximation( make_box("[-1.5,2.5]x[0.5,2.5]"), 4 );
+    //The reference set does not share any nodes with theSet
+    const GridTreeSet theExpectedSet( theSet.grid(), theSet.cell().height(), new BinaryTreeNode( *theSet.binary_tree() ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Copy a GridTreeSet, the copies share the nodes below the root");
+    GridTreeSet theCopy( theSet );
+    GridTreeSet theAssignedCopy( theTrivialGrid, true );
+    theAssignedCopy = theSet;
+    ARIADNE_TEST_COMPARE( theCopy.binary_tree(), !=, theSet.binary_tree() );
+    ARIADNE_TEST_EQUAL( theCopy.binary_tree()->left_node(), theSet.binary_tree()->left_node() );
+    ARIADNE_TEST_EQUAL( theAssignedCopy.binary_tree()->right_node(), theSet.binary_tree()->right_node() );
+    ARIADNE_TEST_EQUAL( theCopy, theSet );
+    ARIADNE_TEST_EQUAL( theAssignedCopy, theSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Modify the copies, the original set stays intact");
+    GridTreeSet theBoxSet( theTrivialGrid, false );
+    theBoxSet.adjoin_over_approximation( make_box("[-1.0,1.0]x[1.0,2.0]"), 4 );
+    const GridCell theCell( theTrivialGrid, theSet.cell().height(), make_binary_word("0011") );
+    theCopy.adjoin_over_approximation( make_box("[3.0,3.5]x[-2.0,-1.0]"), 4 );
+    theCopy.restrict( theBoxSet );
+    theAssignedCopy.remove( theCell );
+    theAssignedCopy.mince( 5 );
+    ARIADNE_TEST_EQUAL( theSet, theExpectedSet );
+    ARIADNE_TEST_EQUAL( theSet.size(), theExpectedSet.size() );
+
+    GridTreeSet theExpectedCopy( theExpectedSet.grid(), theExpectedSet.cell().height(), new BinaryTreeNode( *theExpectedSet.binary_tree() ) );
+    theExpectedCopy.adjoin_over_approximation( make_box("[3.0,3.5]x[-2.0,-1.0]"), 4 );
+    theExpectedCopy.restrict( theBoxSet );
+    ARIADNE_TEST_EQUAL( theCopy, theExpectedCopy );
+    theExpectedCopy = GridTreeSet( theExpectedSet.grid(), theExpectedSet.cell().height(), new BinaryTreeNode( *theExpectedSet.binary_tree() ) );
+    theExpectedCopy.remove( theCell );
+    theExpectedCopy.mince( 5 );
+    ARIADNE_TEST_EQUAL( theAssignedCopy, theExpectedCopy );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Modify a subpaving of a copy, the original set stays intact");
+    GridTreeSet theSubpavingCopy( theSet );
+    const size_t theCopySize = theSubpavingCopy.size();
+    GridTreeCursor theCursor( &theSubpavingCopy );
+    theCursor.move_left().move_right();
+    GridTreeSubset theSubpaving = *theCursor;
+    theSubpaving.mince( 5 );
+    ARIADNE_TEST_EQUAL( theSet, theExpectedSet );
+    ARIADNE_TEST_EQUAL( theSet.size(), theExpectedSet.size() );
+    ARIADNE_TEST_COMPARE( theSubpavingCopy.size(), >, theCopySize );
+    ARIADNE_TEST_EQUAL( theSubpavingCopy.size(), count_cells_by_iteration( theSubpavingCopy ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Modify the original set, the copy stays intact");
+    GridTreeSet theSecondCopy( theSet );
+    theSet.clear();
+    ARIADNE_TEST_EQUAL( theSet.empty(), true );
+    ARIADNE_TEST_EQUAL( theSecondCopy, theExpectedSet );
+}
+
+void test_enabled_leaf_counts() {
+    Grid theTrivialGrid(2, 1.0);
+    GridTreeSet theSet( theTrivialGrid, false );
+    theSet.adjoin_over_approximation( make_box("[-1.5,2.5]x[0.5,2.5]"), 3 );
+    theSet.adjoin_over_approximation( make_box("[-2.7,-2.1]x[-1.2,0.3]"), 4 );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The cached counts follow the modifications of the set");
+    size_t theCount = count_cells_by_iteration( theSet );
+    ARIADNE_TEST_EQUAL( theSet.size(), theCount );
+    const GridCell theCell = theSet.select( theCount / 2 );
+    theSet.remove( theCell );
+    ARIADNE_TEST_EQUAL( theSet.size(), theCount - 1 );
+    theSet.adjoin( theCell );
+    ARIADNE_TEST_EQUAL( theSet.size(), theCount );
+    theSet.mince( 5 );
+    ARIADNE_TEST_EQUAL( theSet.size(), count_cells_by_iteration( theSet ) );
+    theSet.recombine();
+    theCount = count_cells_by_iteration( theSet );
+    ARIADNE_TEST_EQUAL( theSet.size(), theCount );
+
+    ARIADNE_PRINT_TEST_COMMENT("Enabling a cell through a cursor");
+    GridTreeCursor theCursor( &theSet );
+    while( ! theCursor.is_leaf() ) {
+        theCursor.move_right();
+    }
+    const bool wasEnabled = theCursor.is_enabled();
+    theCursor.set_enabled();
+    ARIADNE_TEST_EQUAL( theSet.size(), wasEnabled ? theCount : theCount + 1 );
+    theCursor.set_disabled();
+    ARIADNE_TEST_EQUAL( theSet.size(), wasEnabled ? theCount - 1 : theCount );
+
+    ARIADNE_PRINT_TEST_COMMENT("Mincing and recombining a subpaving");
+    GridTreeCursor theSubpavingCursor( &theSet );
+    theSubpavingCursor.move_left().move_left();
+    GridTreeSubset theSubpaving = *theSubpavingCursor;
+    const size_t theSubpavingCount = theSubpaving.size();
+    theSubpaving.mince( 6 );
+    ARIADNE_TEST_EQUAL( theSet.size(), count_cells_by_iteration( theSet ) );
+    ARIADNE_TEST_EQUAL( theSet.size() - theSubpaving.size(), theCount - ( wasEnabled ? 1 : 0 ) - theSubpavingCount );
+    theSubpaving.recombine();
+    theCount = count_cells_by_iteration( theSet );
+    ARIADNE_TEST_EQUAL( theSet.size(), theCount );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Rank and select the cells by their index");
+    size_t theIndex = 0;
+    for( GridTreeSet::const_iterator iter = theSet.begin(); iter != theSet.end(); ++iter, ++theIndex ) {
+        ARIADNE_TEST_EQUAL( theSet.select( theIndex ), *iter );
+        ARIADNE_TEST_EQUAL( theSet.rank( *iter ), theIndex );
+    }
+    ARIADNE_TEST_EQUAL( theIndex, theSet.size() );
+    ARIADNE_TEST_THROWS( theSet.select( theSet.size() ), std::exception );
+}
+
+void test_packed_binary_word() {
+    //Words long enough to span several limbs
+    BinaryWord theLongWord, theOtherWord;
+    for( uint i = 0; i < 150; i++ ) {
+        theLongWord.push_back( i % 3 == 0 );
+        theOtherWord.push_back( ( i % 3 == 0 ) != ( i == 130 ) );
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Packing and unpacking the binary words");
+    const PackedBinaryWord thePackedLongWord( theLongWord );
+    ARIADNE_TEST_EQUAL( thePackedLongWord.size(), theLongWord.size() );
+    ARIADNE_TEST_EQUAL( thePackedLongWord.to_binary_word(), theLongWord );
+    ARIADNE_TEST_EQUAL( thePackedLongWord[129], theLongWord[129] );
+    PackedBinaryWord thePackedWord;
+    for( uint i = 0; i < theLongWord.size(); i++ ) {
+        thePackedWord.push_back( theLongWord[i] );
+    }
+    ARIADNE_TEST_EQUAL( thePackedWord, thePackedLongWord );
+    thePackedWord.pop_back();
+    ARIADNE_TEST_ASSERT( thePackedWord != thePackedLongWord );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Appending at an offset within a limb");
+    BinaryWord theHead, theTail;
+    for( uint i = 0; i < theLongWord.size(); i++ ) {
+        if( i < 70 ) {
+            theHead.push_back( theLongWord[i] );
+        } else {
+            theTail.push_back( theLongWord[i] );
+        }
+    }
+    PackedBinaryWord theAppendedWord( theHead );
+    theAppendedWord.append( PackedBinaryWord( theTail ) );
+    ARIADNE_TEST_EQUAL( theAppendedWord, thePackedLongWord );
+    PackedBinaryWord theRunWord( theHead );
+    theRunWord.append( true, 100 );
+    theHead.append( GridCell::primary_cell_path( 100, 1, 0 ) );
+    ARIADNE_TEST_EQUAL( theRunWord.to_binary_word(), theHead );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Prefixes and the lexicographic order");
+    const PackedBinaryWord thePackedOtherWord( theOtherWord );
+    ARIADNE_TEST_EQUAL( thePackedLongWord.common_prefix_length( thePackedOtherWord ), 130u );
+    ARIADNE_TEST_ASSERT( thePackedLongWord < thePackedOtherWord );
+    ARIADNE_TEST_ASSERT( ! ( thePackedOtherWord < thePackedLongWord ) );
+    ARIADNE_TEST_ASSERT( thePackedWord.is_prefix( thePackedLongWord ) );
+    ARIADNE_TEST_ASSERT( ! thePackedLongWord.is_prefix( thePackedWord ) );
+    ARIADNE_TEST_ASSERT( thePackedWord < thePackedLongWord );
+    ARIADNE_TEST_ASSERT( ! thePackedOtherWord.is_prefix( thePackedLongWord ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Comparing cells rooted to different primary cells");
+    Grid theTrivialGrid(2, 1.0);
+    const GridCell theCell( theTrivialGrid, 1, make_binary_word("0110") );
+    BinaryWord theReRootedWord = GridCell::primary_cell_path( 2, 4, 1 );
+    theReRootedWord.append( theCell.word() );
+    const GridCell theReRootedCell( theTrivialGrid, 4, theReRootedWord );
+    ARIADNE_TEST_EQUAL( theCell.packed_word( 4 ), PackedBinaryWord( theReRootedWord ) );
+    ARIADNE_TEST_EQUAL( theCell, theReRootedCell );
+    ARIADNE_TEST_ASSERT( subset( theCell, theReRootedCell.split( false ).split( true ) ) == false );
+    ARIADNE_TEST_ASSERT( subset( theReRootedCell.split( true ), theCell ) );
+    ARIADNE_TEST_ASSERT( theCell < theReRootedCell.split( true ) );
+    ARIADNE_TEST_ASSERT( theReRootedCell < theCell.split( false ) );
+}
+
+void test_lattice_cell() {
+    Grid theGrid( Vector<Float>("[-0.25, 0.25, 1.5]"), Vector<Float>("[0.25, 0.25, 0.25]") );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Integer coordinates of a cell and the conversion back to the word");
+    //The bits of the word are distributed over the dimensions 0,1,2,0,1,2,0
+    const GridCell theCell( theGrid, 2, make_binary_word("1011001") );
+    const LatticeCell theLatticeCell = theCell.lattice_cell();
+    ARIADNE_TEST_EQUAL( theLatticeCell.path_length(), 7u );
+    ARIADNE_TEST_EQUAL( theLatticeCell.subdivisions(0), 3u );
+    ARIADNE_TEST_EQUAL( theLatticeCell.subdivisions(2), 2u );
+    ARIADNE_TEST_EQUAL( theLatticeCell.coordinate(0), LatticeCell::coordinate_type(7) );
+    ARIADNE_TEST_EQUAL( theLatticeCell.coordinate(1), LatticeCell::coordinate_type(0) );
+    ARIADNE_TEST_EQUAL( theLatticeCell.coordinate(2), LatticeCell::coordinate_type(2) );
+    ARIADNE_TEST_EQUAL( theLatticeCell.word(), theCell.word() );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The lattice box from the coordinates");
+    //The primary cell of height 2 is [-1,3]^3, so the lattice box is [2.5,3]x[-1,0]x[1,2]
+    const Box theBox = GridCell::lattice_box_to_space( theLatticeCell.lattice_box(), theGrid );
+    ARIADNE_TEST_EQUAL( theBox, make_box("[0.375,0.5]x[0,0.25]x[1.75,2.0]") );
+    ARIADNE_TEST_EQUAL( theCell.box(), theBox );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Containment and equality on the coordinates");
+    BinaryWord theReRootedWord = GridCell::primary_cell_path( 3, 5, 2 );
+    theReRootedWord.append( theCell.word() );
+    const LatticeCell theReRootedCell( 3, 5, theReRootedWord );
+    ARIADNE_TEST_EQUAL( theLatticeCell.rerooted( 5 ).word(), theReRootedWord );
+    ARIADNE_TEST_ASSERT( theLatticeCell == theReRootedCell );
+    ARIADNE_TEST_ASSERT( theCell.split( true ).lattice_cell().subset( theReRootedCell ) );
+    ARIADNE_TEST_ASSERT( theLatticeCell.subset( LatticeCell( 3, 2, make_binary_word("101") ) ) );
+    ARIADNE_TEST_ASSERT( ! theLatticeCell.subset( LatticeCell( 3, 2, make_binary_word("100") ) ) );
+    ARIADNE_TEST_ASSERT( ! theReRootedCell.subset( theCell.split( false ).lattice_cell() ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The longest path with the exact lattice box from the coordinates");
+    //The 53 splits of [0,1] towards the upper border give [1-2^-53,1], the lower bound needs the whole mantissa
+    ARIADNE_TEST_ASSERT( LatticeCell::is_representable( 1, 53 ) );
+    ARIADNE_TEST_ASSERT( ! LatticeCell::is_representable( 1, 54 ) );
+    ARIADNE_TEST_ASSERT( LatticeCell::is_representable( 3, 159 ) );
+    ARIADNE_TEST_ASSERT( ! LatticeCell::is_representable( 3, 160 ) );
+    BinaryWord theLongWord;
+    for( uint i = 0; i < 53; i++ ) {
+        theLongWord.push_back( true );
+    }
+    const Vector<Interval> theLongLatticeBox = LatticeCell( 1, 0, theLongWord ).lattice_box();
+    ARIADNE_TEST_EQUAL( theLongLatticeBox[0].lower(), Float(1.0) - std::ldexp( Float(1.0), -53 ) );
+    ARIADNE_TEST_EQUAL( theLongLatticeBox[0].upper(), Float(1.0) );
+}
+
+void test_neighboring_cells() {
+    Grid theGrid(2, 1.0);
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("All neighbors of a cell, some of them need a higher primary cell");
+    //The cell [0,0.5]x[0,0.5] in the primary cell [0,1]x[0,1], the left and lower neighbors are in [-1,1]x[-1,1]
+    const GridCell theCell( theGrid, 0, make_binary_word("00") );
+    const std::vector<GridCell> theNeighbors = theCell.neighboring_cells();
+    ARIADNE_TEST_EQUAL( theNeighbors.size(), 8u );
+    ARIADNE_TEST_EQUAL( theNeighbors[0].box(), make_box("[-0.5,0]x[-0.5,0]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[1].box(), make_box("[-0.5,0]x[0,0.5]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[2].box(), make_box("[-0.5,0]x[0.5,1]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[3].box(), make_box("[0,0.5]x[-0.5,0]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[4].box(), make_box("[0,0.5]x[0.5,1]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[5].box(), make_box("[0.5,1]x[-0.5,0]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[6].box(), make_box("[0.5,1]x[0,0.5]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[7].box(), make_box("[0.5,1]x[0.5,1]") );
+    ARIADNE_TEST_EQUAL( theNeighbors[0].height(), 1u );
+    ARIADNE_TEST_EQUAL( theNeighbors[4].height(), 0u );
+    ARIADNE_TEST_EQUAL( theNeighbors[7], GridCell( theGrid, 0, make_binary_word("11") ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The upper neighbor of a cell at the upper border of the primary cell");
+    //The primary cell of height 1 is [-1,1]x[-1,1], so we need to go to [-1,3]x[-1,3] of height 2
+    const GridCell theUpperCell( theGrid, 0, make_binary_word("11") );
+    const GridCell theRightNeighbor = GridCell::neighboringCell( theGrid, 0, theUpperCell.word(), 0 );
+    ARIADNE_TEST_EQUAL( theRightNeighbor.height(), 2u );
+    ARIADNE_TEST_EQUAL( theRightNeighbor.box(), make_box("[1,1.5]x[0.5,1]") );
+    std::vector<int> theOffsets( 2, 1 );
+    const LatticeCell theCornerNeighbor = theUpperCell.lattice_cell().neighboring_cell( theOffsets );
+    ARIADNE_TEST_EQUAL( theCornerNeighbor.height(), 2u );
+    ARIADNE_TEST_EQUAL( GridCell::lattice_box_to_space( theCornerNeighbor.lattice_box(), theGrid ), make_box("[1,1.5]x[1,1.5]") );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The face, edge and vertex neighbors in three dimensions");
+    Grid theThreeDimGrid(3, 1.0);
+    const GridCell theThreeDimCell( theThreeDimGrid, 1, make_binary_word("0110101") );
+    const std::vector<GridCell> theThreeDimNeighbors = theThreeDimCell.neighboring_cells();
+    ARIADNE_TEST_EQUAL( theThreeDimNeighbors.size(), 26u );
+    for( uint i = 0; i < theThreeDimNeighbors.size(); i++ ) {
+        ARIADNE_TEST_ASSERT( ! ( theThreeDimNeighbors[i] == theThreeDimCell ) );
+        for( uint j = 0; j < i; j++ ) {
+            ARIADNE_TEST_ASSERT( ! ( theThreeDimNeighbors[i] == theThreeDimNeighbors[j] ) );
+        }
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The upper neighbor of a long path, it needs more splits than a LatticeCell has");
+    //The cell [1-2^-52,1] is representable, but its neighbor [1,1+2^-52] is rooted two levels higher
+    Grid theLineGrid(1, 1.0);
+    BinaryWord theLongWord;
+    for( uint i = 0; i < 52; i++ ) {
+        theLongWord.push_back( true );
+    }
+    ARIADNE_TEST_ASSERT( LatticeCell::is_representable( 1, theLongWord.size() ) );
+    ARIADNE_TEST_ASSERT( ! LatticeCell::has_representable_neighbors( 1, theLongWord.size() ) );
+    const GridCell theLongNeighbor = GridCell::neighboringCell( theLineGrid, 0, theLongWord, 0 );
+    ARIADNE_TEST_EQUAL( theLongNeighbor.height(), 2u );
+    ARIADNE_TEST_EQUAL( theLongNeighbor.box()[0].lower(), Float(1.0) );
+    ARIADNE_TEST_EQUAL( theLongNeighbor.box()[0].upper(), Float(1.0) + std::ldexp( Float(1.0), -52 ) );
+}
+
 void test_grid_paving_cursor(){
     
     //Allocate the Grid
@@ -852,6 +1359,22 @@ void test_grid_cell(){
     theBinaryPath = GridCell::primary_cell_path( 1, 2, 2 );
     ARIADNE_PRINT_TEST_COMMENT( "Dimension: 1, topCellHeight: 2, bottomCellHeight: 2" );
     ARIADNE_TEST_EQUAL( expected_result , theBinaryPath );
+
+    ARIADNE_PRINT_TEST_COMMENT( "The corners of the primary cells and the smallest primary cell enclosing a box" );
+    int leftBottomCorner, rightTopCorner;
+    GridCell::primary_cell_corners( 4, leftBottomCorner, rightTopCorner );
+    ARIADNE_TEST_EQUAL( leftBottomCorner, -5 );
+    ARIADNE_TEST_EQUAL( rightTopCorner, 11 );
+    GridCell::primary_cell_corners( 7, leftBottomCorner, rightTopCorner );
+    ARIADNE_TEST_EQUAL( leftBottomCorner, -85 );
+    ARIADNE_TEST_EQUAL( rightTopCorner, 43 );
+    ARIADNE_TEST_EQUAL( GridCell::primary_cell_lattice_box( 3, 2 )[1], Interval( -5, 3 ) );
+    //The box has to lie in the interior of the primary cell
+    ARIADNE_TEST_EQUAL( GridCell::smallest_enclosing_primary_cell_height( Vector<Interval>( 2, Interval( 0.25, 0.5 ) ) ), 0u );
+    ARIADNE_TEST_EQUAL( GridCell::smallest_enclosing_primary_cell_height( make_box("[0.0,0.5]x[0.25,0.5]") ), 1u );
+    ARIADNE_TEST_EQUAL( GridCell::smallest_enclosing_primary_cell_height( make_box("[0.25,0.5]x[0.5,1.0]") ), 2u );
+    ARIADNE_TEST_EQUAL( GridCell::smallest_enclosing_primary_cell_height( make_box("[-5.0,0.5]x[0.5,3.0]") ), 5u );
+    ARIADNE_TEST_EQUAL( GridCell::smallest_enclosing_primary_cell_height( make_box("[-4.5,0.5]x[0.5,42.5]") ), 6u );
     
     Grid theGrid( Vector<Float>("[0.0,0.0]"), Vector<Float>("[1.0,1.0]") );
     //pFirstCell_01 == pSecondCell_01
@@ -1970,6 +2493,46 @@ void test_restrict() {
     //    The GridTreeSubset is at level 1 and it's primary cell is at level 2
 }
 
+void test_dilate_erode() {
+    Grid theTrivialGrid(2, 1.0);
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Dilate a cell by one cell, the primary cell has to be extended");
+    //The cell [0,0.25]x[0,0.25], dilated by one cell of the same size, is the 3x3 block of its neighbors
+    const GridCell theCell( theTrivialGrid, 0, make_binary_word("0000") );
+    GridTreeSet theExpectedSet( theCell );
+    const std::vector<GridCell> theNeighbors = theCell.neighboring_cells();
+    for( uint i = 0; i < theNeighbors.size(); i++ ) {
+        theExpectedSet.adjoin( theNeighbors[i] );
+    }
+    GridTreeSet theSet( theCell );
+    theSet.dilate( 1, 2 );
+    ARIADNE_TEST_COMPARE( theSet.cell().height(), >, 0u );
+    ARIADNE_TEST_ASSERT( subset( theSet, theExpectedSet ) );
+    ARIADNE_TEST_ASSERT( subset( theExpectedSet, theSet ) );
+    theSet.mince( 2 );
+    ARIADNE_TEST_EQUAL( theSet.size(), size_t(9) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Erode the dilated cell back");
+    theSet.erode( 1, 2 );
+    ARIADNE_TEST_ASSERT( subset( theSet, GridTreeSet( theCell ) ) );
+    ARIADNE_TEST_ASSERT( subset( GridTreeSet( theCell ), theSet ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The cells smaller than the given size");
+    //A smaller cell is dilated as the whole cell of the given size containing it
+    GridTreeSet theSmallCellSet( GridCell( theTrivialGrid, 0, make_binary_word("000011") ) );
+    theSmallCellSet.dilate( 1, 2 );
+    ARIADNE_TEST_ASSERT( subset( theSmallCellSet, theExpectedSet ) );
+    ARIADNE_TEST_ASSERT( subset( theExpectedSet, theSmallCellSet ) );
+    //A cell of the given size which is only partly in the set is removed by the erosion
+    theSmallCellSet = GridTreeSet( theExpectedSet );
+    theSmallCellSet.remove( GridCell( theTrivialGrid, 0, make_binary_word("000011") ) );
+    theSmallCellSet.erode( 1, 2 );
+    ARIADNE_TEST_ASSERT( theSmallCellSet.empty() );
+}
+
 void test_remove_one() {
     std::vector< GridCell* > expected_result_arr(3);
     
@@ -2195,7 +2758,7 @@ void test_cell_subset_subset() {
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSubset.mince_to_tree_depth(2), left_node()->left_node()->set_disabled() (height=2)");
     theSmallSubPaving.mince_to_tree_depth(2);
-    theSmallSubPaving.binary_tree()->left_node()->left_node()->set_disabled();
+    theSmallSubPaving.binary_tree_for_update()->left_node()->left_node()->set_disabled();
     ARIADNE_PRINT_TEST_COMMENT("theCell");
     cout << theCell << endl;
     ARIADNE_PRINT_TEST_COMMENT("theBigSubPaving");
@@ -2205,8 +2768,8 @@ void test_cell_subset_subset() {
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSubset.mince_to_tree_depth(2), left_node()->left_node()->set_enabled(), right_node()->make_leaf(false) (height=2)");
     theSmallSubPaving.mince_to_tree_depth(2);
-    theSmallSubPaving.binary_tree()->left_node()->left_node()->set_enabled();
-    theSmallSubPaving.binary_tree()->right_node()->make_leaf(false);
+    theSmallSubPaving.binary_tree_for_update()->left_node()->left_node()->set_enabled();
+    theSmallSubPaving.binary_tree_for_update()->right_node()->make_leaf(false);
     ARIADNE_PRINT_TEST_COMMENT("theCell");
     cout << theCell << endl;
     ARIADNE_PRINT_TEST_COMMENT("theBigSubPaving");
@@ -2217,8 +2780,8 @@ void test_cell_subset_subset() {
     //Create the GridTreeSub, will be rooted to the primary cell of height smallHeight
     GridTreeSet theSmallPaving( theTrivialGrid, smallHeight, pBinaryTreeRoot->left_node()->left_node()->right_node()->right_node() );
     //Restore the binary tree
-    theSmallPaving.binary_tree()->right_node()->set_enabled();
-    theSmallPaving.binary_tree()->right_node()->split();
+    theSmallPaving.binary_tree_for_update()->right_node()->set_enabled();
+    theSmallPaving.binary_tree_for_update()->right_node()->split();
     
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSet.mince_to_tree_depth(2) (after restoring the binary tree) (height=2)");
@@ -2241,7 +2804,7 @@ void test_cell_subset_subset() {
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSet.mince_to_tree_depth(2), left_node()->left_node()->set_disabled() (height=2)");
     theSmallPaving.mince_to_tree_depth(2);
-    theSmallPaving.binary_tree()->left_node()->left_node()->set_disabled();
+    theSmallPaving.binary_tree_for_update()->left_node()->left_node()->set_disabled();
     ARIADNE_PRINT_TEST_COMMENT("theCell");
     cout << theCell << endl;
     ARIADNE_PRINT_TEST_COMMENT("theSmallPaving");
@@ -2251,8 +2814,8 @@ void test_cell_subset_subset() {
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSet.mince_to_tree_depth(2), left_node()->left_node()->set_enabled(), ...right_node()->make_leaf(false) (height=2)");
     theSmallPaving.mince_to_tree_depth(2);
-    theSmallPaving.binary_tree()->left_node()->left_node()->set_enabled();
-    theSmallPaving.binary_tree()->right_node()->make_leaf(false);
+    theSmallPaving.binary_tree_for_update()->left_node()->left_node()->set_enabled();
+    theSmallPaving.binary_tree_for_update()->right_node()->make_leaf(false);
     ARIADNE_PRINT_TEST_COMMENT("theCell");
     cout << theCell << endl;
     ARIADNE_PRINT_TEST_COMMENT("theSmallPaving");
@@ -2288,7 +2851,7 @@ void test_cell_subset_subset() {
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSet.mince_to_tree_depth(6), ...left_node()->left_node()->set_disabled() (height=2)");
     theBigPaving.mince_to_tree_depth(6);
-    theBigPaving.binary_tree()->left_node()->left_node()->right_node()->right_node()->left_node()->left_node()->set_disabled();
+    theBigPaving.binary_tree_for_update()->left_node()->left_node()->right_node()->right_node()->left_node()->left_node()->set_disabled();
     ARIADNE_PRINT_TEST_COMMENT("theCell");
     cout << theCell << endl;
     ARIADNE_PRINT_TEST_COMMENT("theBigPaving");
@@ -2298,8 +2861,8 @@ void test_cell_subset_subset() {
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Test subset operation GridCell (height=1), GridTreeSet.mince_to_tree_depth(6), ...left_node()->left_node()->set_enabled(), ...right_node()->make_leaf(false) (height=2)");
     theBigPaving.mince_to_tree_depth(6);
-    theBigPaving.binary_tree()->left_node()->left_node()->right_node()->right_node()->left_node()->left_node()->set_enabled();
-    theBigPaving.binary_tree()->left_node()->left_node()->right_node()->right_node()->right_node()->make_leaf(false);
+    theBigPaving.binary_tree_for_update()->left_node()->left_node()->right_node()->right_node()->left_node()->left_node()->set_enabled();
+    theBigPaving.binary_tree_for_update()->left_node()->left_node()->right_node()->right_node()->right_node()->make_leaf(false);
     ARIADNE_PRINT_TEST_COMMENT("theCell");
     cout << theCell << endl;
     ARIADNE_PRINT_TEST_COMMENT("theBigPaving");
@@ -2401,6 +2964,612 @@ void test_subsets_difference() {
     ARIADNE_TEST_EQUAL( expectedResultSet, resultSet);
 }
 
+//Appends the depth first search lay out of the complete binary tree of the given depth
+static void make_complete_tree( BinaryWord & tree, const uint depth ) {
+    tree.push_back( depth > 0 );
+    if( depth > 0 ) {
+        make_complete_tree( tree, depth - 1 );
+        make_complete_tree( tree, depth - 1 );
+    }
+}
+
+void test_large_subsets_operations() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    //The sets have more than BinaryTreeNode::PARALLEL_SUBTREE_SIZE enabled
+    //leaves, so their subtrees are processed in parallel, if possible
+    const uint depth = 14;
+    const size_t numLeaves = size_t(1) << depth;
+    BinaryWord tree;
+    make_complete_tree( tree, depth );
+    BinaryWord leavesOne, leavesTwo, leavesJoin, leavesIntersection, leavesDifference;
+    for( size_t i = 0; i < numLeaves; i++ ) {
+        leavesOne.push_back( ( i % 3 ) != 0 );
+        leavesTwo.push_back( ( i % 2 ) == 0 );
+        leavesJoin.push_back( leavesOne[i] || leavesTwo[i] );
+        leavesIntersection.push_back( leavesOne[i] && leavesTwo[i] );
+        leavesDifference.push_back( leavesOne[i] && ! leavesTwo[i] );
+    }
+    GridTreeSet theSet1( theTrivialGrid, heightZero, new BinaryTreeNode( tree, leavesOne ) );
+    GridTreeSet theSet2( theTrivialGrid, heightZero, new BinaryTreeNode( tree, leavesTwo ) );
+    ARIADNE_TEST_COMPARE( theSet1.size(), >, BinaryTreeNode::PARALLEL_SUBTREE_SIZE );
+    ARIADNE_TEST_COMPARE( theSet2.size(), >, BinaryTreeNode::PARALLEL_SUBTREE_SIZE );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Join, intersection and difference of two large sets");
+    GridTreeSet expectedResultSet( theTrivialGrid, heightZero, new BinaryTreeNode( tree, leavesJoin ) );
+    expectedResultSet.recombine();
+    GridTreeSet resultSet = join( theSet1, theSet2 );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    expectedResultSet = GridTreeSet( theTrivialGrid, heightZero, new BinaryTreeNode( tree, leavesIntersection ) );
+    expectedResultSet.recombine();
+    resultSet = intersection( theSet1, theSet2 );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    expectedResultSet = GridTreeSet( theTrivialGrid, heightZero, new BinaryTreeNode( tree, leavesDifference ) );
+    expectedResultSet.recombine();
+    resultSet = difference( theSet1, theSet2 );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The operands of the set operations are not changed");
+    GridTreeSet expectedSet1( theTrivialGrid, heightZero, new BinaryTreeNode( tree, leavesOne ) );
+    ARIADNE_TEST_EQUAL( expectedSet1, theSet1 );
+}
+
+void test_move_operations() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    //The sets are rooted to different primary cells
+    const GridTreeSet theSet1 = make_first_set( theTrivialGrid );
+    const GridTreeSet theSet2 = make_second_set( theTrivialGrid );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Move-adjoin a set, its nodes are moved into the result");
+    GridTreeSet expectedResultSet = join( theSet1, theSet2 );
+    expectedResultSet.recombine();
+    GridTreeSet resultSet( theSet1 );
+    GridTreeSet theOtherSet( theSet2 );
+    resultSet.move_adjoin( theOtherSet );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    ARIADNE_TEST_EQUAL( theOtherSet.empty(), true );
+    //The copies, which shared the nodes, are not changed
+    ARIADNE_TEST_EQUAL( make_second_set( theTrivialGrid ), theSet2 );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Move-join two sets");
+    GridTreeSet theSetOne( theSet1 );
+    theOtherSet = theSet2;
+    resultSet = move_join( theSetOne, theOtherSet );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    ARIADNE_TEST_EQUAL( theSetOne.empty(), true );
+    ARIADNE_TEST_EQUAL( theOtherSet.empty(), true );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Move-restrict and move-remove both ways");
+    for( uint i = 0; i < 2; i++ ) {
+        const GridTreeSet& theFirstSet = ( i == 0 ) ? theSet1 : theSet2;
+        const GridTreeSet& theSecondSet = ( i == 0 ) ? theSet2 : theSet1;
+
+        expectedResultSet = intersection( theFirstSet, theSecondSet );
+        expectedResultSet.recombine();
+        resultSet = theFirstSet;
+        theOtherSet = theSecondSet;
+        resultSet.move_restrict( theOtherSet );
+        resultSet.recombine();
+        ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+        ARIADNE_TEST_EQUAL( theOtherSet.empty(), true );
+
+        expectedResultSet = difference( theFirstSet, theSecondSet );
+        expectedResultSet.recombine();
+        resultSet = theFirstSet;
+        theOtherSet = theSecondSet;
+        resultSet.move_remove( theOtherSet );
+        resultSet.recombine();
+        ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+        ARIADNE_TEST_EQUAL( theOtherSet.empty(), true );
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Move-remove a set that shares the subtrees with the result");
+    //The copy shares the tree of theSet1, removing the cell [-1, 0]x[-1, 0] unshares only the nodes on its path
+    const GridCell theRemovedCell( theTrivialGrid, heightOne, make_binary_word("00") );
+    expectedResultSet = GridTreeSet( theTrivialGrid );
+    expectedResultSet.adjoin( theRemovedCell );
+    expectedResultSet.recombine();
+    resultSet = theSet1;
+    theOtherSet = theSet1;
+    theOtherSet.remove( theRemovedCell );
+    resultSet.move_remove( theOtherSet );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    ARIADNE_TEST_EQUAL( theOtherSet.empty(), true );
+    resultSet = theSet1;
+    resultSet.remove( theRemovedCell );
+    theOtherSet = theSet1;
+    resultSet.move_remove( theOtherSet );
+    ARIADNE_TEST_EQUAL( resultSet.empty(), true );
+    ARIADNE_TEST_EQUAL( make_first_set( theTrivialGrid ), theSet1 );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Swap two sets");
+    resultSet = theSet1;
+    theOtherSet = theSet2;
+    swap( resultSet, theOtherSet );
+    ARIADNE_TEST_EQUAL( theSet2, resultSet );
+    ARIADNE_TEST_EQUAL( theSet1, theOtherSet );
+}
+
+void test_multiple_subsets_join() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    //The cells of different sizes, rooted to different primary cells
+    std::vector<GridTreeSet> theSets;
+    GridTreeSet expectedResultSet( theTrivialGrid );
+    for( uint i = 0; i < 16; i++ ) {
+        BinaryWord word;
+        for( uint j = 0; j < i % 5; j++ ) {
+            word.push_back( ( ( i >> j ) & 1 ) != 0 );
+        }
+        const GridCell theCell( theTrivialGrid, i % 3, word );
+        theSets.push_back( GridTreeSet( theCell ) );
+        expectedResultSet.adjoin( theCell );
+    }
+    theSets.push_back( make_second_set( theTrivialGrid ) );
+    expectedResultSet.adjoin( theSets.back() );
+    expectedResultSet.recombine();
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Join many sets at once");
+    GridTreeSet resultSet = join( theSets );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    std::vector<GridTreeSubset> theSubsets( theSets.begin(), theSets.end() );
+    resultSet = join( theSubsets );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Join no sets");
+    ARIADNE_TEST_EQUAL( join( std::vector<GridTreeSet>() ).empty(), true );
+}
+
+void test_adjoin_and_report_new() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    const GridTreeSet theSet1 = make_first_set( theTrivialGrid );
+    const GridTreeSet theSet2 = make_second_set( theTrivialGrid );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Adjoin a set and report the new cells");
+    GridTreeSet expectedResultSet = join( theSet1, theSet2 );
+    expectedResultSet.recombine();
+    GridTreeSet expectedNewCells = difference( theSet2, theSet1 );
+    expectedNewCells.recombine();
+    GridTreeSet resultSet( theSet1 );
+    GridTreeSet theNewCells = resultSet.adjoin_and_report_new( theSet2 );
+    resultSet.recombine();
+    theNewCells.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    ARIADNE_TEST_EQUAL( expectedNewCells, theNewCells );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Adjoining the same set again brings nothing new");
+    theNewCells = resultSet.adjoin_and_report_new( theSet2 );
+    ARIADNE_TEST_EQUAL( theNewCells.empty(), true );
+    ARIADNE_TEST_EQUAL( theNewCells.binary_tree()->is_leaf(), true );
+    theNewCells = resultSet.adjoin_and_report_new( theSet1 );
+    ARIADNE_TEST_EQUAL( theNewCells.empty(), true );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The symmetric difference of two sets");
+    expectedResultSet = join( difference( theSet1, theSet2 ), difference( theSet2, theSet1 ) );
+    expectedResultSet.recombine();
+    resultSet = symmetric_difference( theSet1, theSet2 );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    resultSet = symmetric_difference( theSet2, theSet1 );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    resultSet = symmetric_difference( theSet1, theSet1 );
+    ARIADNE_TEST_EQUAL( resultSet.empty(), true );
+}
+
+void test_hash() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    const GridTreeSet theSet1 = make_first_set( theTrivialGrid );
+    const GridTreeSet theSet2 = make_second_set( theTrivialGrid );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The equal sets have equal hashes");
+    GridTreeSet theCopySet( theSet1 );
+    ARIADNE_TEST_EQUAL( theCopySet.hash(), theSet1.hash() );
+    GridTreeSet theOtherSet = make_first_set( theTrivialGrid );
+    ARIADNE_TEST_EQUAL( theOtherSet.hash(), theSet1.hash() );
+    ARIADNE_TEST_EQUAL( theSet1.hash() == theSet2.hash(), false );
+    ARIADNE_TEST_EQUAL( theSet1 == theSet2, false );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The equal subsets rooted to different primary cells have equal hashes");
+    //The primary cell of height one is reached from the one of height two by the path "00"
+    const GridTreeSet theHigherSet1( theTrivialGrid, heightTwo, make_binary_word("11110010000"), make_binary_word("101000") );
+    GridTreeCursor theCursor1( &theSet1 );
+    theCursor1.move_right();
+    GridTreeCursor theCursor2( &theHigherSet1 );
+    theCursor2.move_left().move_left().move_right();
+    const GridTreeSubset theSubset1 = *theCursor1;
+    const GridTreeSubset theSubset2 = *theCursor2;
+    ARIADNE_TEST_EQUAL( theSubset1.cell(), GridCell( theTrivialGrid, heightOne, make_binary_word("1") ) );
+    ARIADNE_TEST_EQUAL( theSubset2.cell(), GridCell( theTrivialGrid, heightTwo, make_binary_word("001") ) );
+    ARIADNE_TEST_EQUAL( theSubset1 == theSubset2, true );
+    ARIADNE_TEST_EQUAL( theSubset1.hash(), theSubset2.hash() );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Modifying a subpaving rehashes the paving");
+    GridTreeSet theMincedSet( theSet1 );
+    GridTreeCursor theMincedCursor( &theMincedSet );
+    ( *theMincedCursor.move_right() ).mince_to_tree_depth( 2 );
+    GridTreeSet theSetToMince( theSet1 );
+    ARIADNE_TEST_EQUAL( theSetToMince.hash() == theMincedSet.hash(), false );
+    GridTreeCursor theCursorToMince( &theSetToMince );
+    ( *theCursorToMince.move_right() ).mince_to_tree_depth( 2 );
+    ARIADNE_TEST_EQUAL( theSetToMince.hash(), theMincedSet.hash() );
+    ARIADNE_TEST_EQUAL( theSetToMince, theMincedSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The modified set gets a new hash");
+    const boost::uint64_t theOldHash = theCopySet.hash();
+    theCopySet.adjoin( theSet2 );
+    ARIADNE_TEST_EQUAL( theCopySet.hash() == theOldHash, false );
+    ARIADNE_TEST_EQUAL( theCopySet == theSet1, false );
+    ARIADNE_TEST_EQUAL( theSet1.hash(), theOldHash );
+    GridTreeSet expectedResultSet = join( theSet1, theSet2 );
+    ARIADNE_TEST_EQUAL( theCopySet.hash(), expectedResultSet.hash() );
+    ARIADNE_TEST_EQUAL( theCopySet, expectedResultSet );
+    theCopySet.remove( theSet2 );
+    theCopySet.recombine();
+    theOtherSet.remove( theSet2 );
+    theOtherSet.recombine();
+    ARIADNE_TEST_EQUAL( theCopySet.hash(), theOtherSet.hash() );
+    ARIADNE_TEST_EQUAL( theCopySet, theOtherSet );
+}
+
+void test_lazy_set_expressions() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    const GridTreeSet theSet1 = make_first_set( theTrivialGrid );
+    const GridTreeSet theSet2 = make_second_set( theTrivialGrid );
+    const GridTreeSet theSet3( theTrivialGrid, heightOne, make_binary_word("1011000"), make_binary_word("0110") );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Evaluate the nested lazy expressions in one traversal");
+    GridTreeSet expectedResultSet = intersection( join( theSet1, theSet2 ), theSet3 );
+    expectedResultSet.recombine();
+    GridTreeSet resultSet = intersection( join( lazy( theSet1 ), lazy( theSet2 ) ), lazy( theSet3 ) ).evaluate();
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    expectedResultSet = difference( join( theSet1, theSet2 ), intersection( theSet2, theSet3 ) );
+    expectedResultSet.recombine();
+    resultSet = difference( join( lazy( theSet1 ), lazy( theSet2 ) ), intersection( lazy( theSet2 ), lazy( theSet3 ) ) ).evaluate();
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The complement of a lazy expression within a cell");
+    const GridCell theCell( theTrivialGrid, heightTwo, make_binary_word("00") );
+    GridTreeSet theCellSet( theTrivialGrid );
+    theCellSet.adjoin( theCell );
+    expectedResultSet = difference( theCellSet, join( theSet1, theSet3 ) );
+    expectedResultSet.recombine();
+    resultSet = complement( join( lazy( theSet1 ), lazy( theSet3 ) ), theCell ).evaluate();
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Consume a lazy expression without evaluating it");
+    typedef GridBinaryExpression<GridSubsetExpression, GridSubsetExpression, GridDifferenceOperation> DifferenceExpression;
+    const DifferenceExpression theExpression = difference( lazy( theSet2 ), lazy( theSet1 ) );
+    resultSet = theExpression.evaluate();
+    ARIADNE_TEST_EQUAL( theExpression.size(), resultSet.size() );
+    GridTreeSet::const_iterator setIter = resultSet.begin();
+    for( DifferenceExpression::const_iterator exprIter = theExpression.begin(); exprIter != theExpression.end(); ++exprIter, ++setIter ) {
+        ARIADNE_TEST_EQUAL( *exprIter, *setIter );
+    }
+    ARIADNE_TEST_EQUAL( setIter == resultSet.end(), true );
+    ARIADNE_TEST_EQUAL( intersection( lazy( theSet1 ), lazy( theSet1 ) ).empty(), theSet1.empty() );
+    ARIADNE_TEST_EQUAL( difference( lazy( theSet1 ), lazy( theSet1 ) ).empty(), true );
+    ARIADNE_TEST_EQUAL( subset( intersection( lazy( theSet1 ), lazy( theSet3 ) ), lazy( theSet3 ) ), true );
+    ARIADNE_TEST_EQUAL( subset( join( lazy( theSet1 ), lazy( theSet3 ) ), lazy( theSet3 ) ), subset( theSet1, theSet3 ) );
+    ARIADNE_TEST_EQUAL( overlap( join( lazy( theSet1 ), lazy( theSet2 ) ), lazy( theSet3 ) ),
+                        overlap( join( theSet1, theSet2 ), theSet3 ) );
+}
+
+void test_bulk_adjoin() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    std::vector<GridCell> theCells;
+    theCells.push_back( GridCell( theTrivialGrid, heightTwo, make_binary_word("0011") ) );
+    theCells.push_back( GridCell( theTrivialGrid, heightZero, make_binary_word("10") ) );
+    theCells.push_back( GridCell( theTrivialGrid, heightOne, make_binary_word("0001") ) );
+    theCells.push_back( GridCell( theTrivialGrid, heightOne, make_binary_word("0000") ) );
+    theCells.push_back( GridCell( theTrivialGrid, heightTwo, make_binary_word("0011") ) );
+    theCells.push_back( GridCell( theTrivialGrid, heightZero, make_binary_word("101") ) );
+    theCells.push_back( GridCell( theTrivialGrid, heightOne, make_binary_word("1") ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Create the set from a batch of cells");
+    GridTreeSet expectedResultSet( theTrivialGrid );
+    for( uint i = 0; i < theCells.size(); i++ ) {
+        expectedResultSet.adjoin( theCells[i] );
+    }
+    GridTreeSet theOneByOneSet = expectedResultSet;
+    expectedResultSet.recombine();
+    GridTreeSet resultSet( theTrivialGrid, theCells );
+    ARIADNE_TEST_EQUAL( resultSet.cell().height(), expectedResultSet.cell().height() );
+    //The sibling cells are recombined on the fly
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Adjoin a batch of cells without recombining them");
+    resultSet = GridTreeSet( theTrivialGrid );
+    resultSet.adjoin( theCells, false );
+    //The tree is the same as when the cells are adjoined one by one
+    ARIADNE_TEST_EQUAL( theOneByOneSet, resultSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Adjoin a range of cells to a set");
+    const GridTreeSet theSet1 = make_first_set( theTrivialGrid );
+    expectedResultSet = theSet1;
+    for( uint i = 0; i < theCells.size(); i++ ) {
+        expectedResultSet.adjoin( theCells[i] );
+    }
+    expectedResultSet.recombine();
+    resultSet = theSet1;
+    resultSet.adjoin( theCells.begin(), theCells.end() );
+    resultSet.recombine();
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+    resultSet.adjoin( std::vector<GridCell>() );
+    ARIADNE_TEST_EQUAL( expectedResultSet, resultSet );
+}
+
+Point make_point( const Float x, const Float y ) {
+    Point thePoint( 2 );
+    thePoint[0] = x;
+    thePoint[1] = y;
+    return thePoint;
+}
+
+void test_locate_points() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    const GridTreeSet theSet1 = make_first_set( theTrivialGrid );
+
+    std::vector<Point> thePoints;
+    thePoints.push_back( make_point( -0.5, -0.5 ) );
+    thePoints.push_back( make_point( 0.5, -0.25 ) );
+    thePoints.push_back( make_point( 0.5, 0.5 ) );
+    thePoints.push_back( make_point( 2.0, -0.5 ) );
+    thePoints.push_back( make_point( 0.0, -1.0 ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Locate a batch of points in the set");
+    const std::vector<size_t> theIndices = theSet1.locate( thePoints );
+    ARIADNE_TEST_EQUAL( theIndices.size(), thePoints.size() );
+    ARIADNE_TEST_EQUAL( theIndices[0], size_t(0) );
+    ARIADNE_TEST_EQUAL( theIndices[1], size_t(1) );
+    ARIADNE_TEST_EQUAL( theIndices[2], GridTreeSubset::NOT_LOCATED );
+    ARIADNE_TEST_EQUAL( theIndices[3], GridTreeSubset::NOT_LOCATED );
+    //The cells are half-open, so the point on the lower boundaries belongs to the right cell
+    ARIADNE_TEST_EQUAL( theIndices[4], size_t(1) );
+    for( uint i = 0; i < thePoints.size(); i++ ) {
+        if( theIndices[i] != GridTreeSubset::NOT_LOCATED ) {
+            ARIADNE_TEST_EQUAL( theSet1.locate( thePoints[i] ), theSet1.select( theIndices[i] ) );
+        }
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Test the membership of a batch of points");
+    const std::vector<bool> theMembership = theSet1.contains( thePoints );
+    ARIADNE_TEST_EQUAL( theMembership.size(), thePoints.size() );
+    for( uint i = 0; i < thePoints.size(); i++ ) {
+        ARIADNE_TEST_EQUAL( theMembership[i], theIndices[i] != GridTreeSubset::NOT_LOCATED );
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Locate the leaf cell of a point");
+    ARIADNE_TEST_EQUAL( theSet1.locate( make_point( 0.5, 0.5 ) ), GridCell( theTrivialGrid, heightOne, make_binary_word("11") ) );
+    ARIADNE_TEST_EQUAL( theSet1.locate( make_point( -1.0, -1.0 ) ), GridCell( theTrivialGrid, heightOne, make_binary_word("00") ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Locate a point in a cell split more often than the lattice coordinates have bits");
+    //The cell [2^-70,2^-69] of the primary cell [0,1], its sibling on the left is not in the set
+    Grid theOneDimGrid(1, 1.0);
+    BinaryWord theDeepWord;
+    for( uint i = 0; i < 69; i++ ) {
+        theDeepWord.push_back( false );
+    }
+    theDeepWord.push_back( true );
+    const GridCell theDeepCell( theOneDimGrid, 0, theDeepWord );
+    GridTreeSet theDeepSet( theOneDimGrid, false );
+    theDeepSet.adjoin( theDeepCell );
+    Float theDeepWidth = 1.0;
+    for( uint i = 0; i < 70; i++ ) {
+        theDeepWidth /= 2.0;
+    }
+    Point theDeepPoint( 1 );
+    theDeepPoint[0] = 1.5 * theDeepWidth;
+    ARIADNE_TEST_EQUAL( theDeepSet.locate( theDeepPoint ), theDeepCell );
+    const std::vector<size_t> theDeepIndices = theDeepSet.locate( std::vector<Point>( 1, theDeepPoint ) );
+    ARIADNE_TEST_EQUAL( theDeepIndices[0], size_t(0) );
+    theDeepPoint[0] = 0.5 * theDeepWidth;
+    ARIADNE_TEST_EQUAL( theDeepSet.contains( std::vector<Point>( 1, theDeepPoint ) )[0], false );
+}
+
+//Collects the visited cells, the visitor of GridTreeSubset::cells_overlapping
+struct CellCollector {
+    std::vector<GridCell> theCells;
+    void operator()( const GridCell& theCell ) { theCells.push_back( theCell ); }
+};
+
+void test_cells_overlapping() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    GridTreeSet theSet( theTrivialGrid );
+    theSet.adjoin_over_approximation( make_box("[-1.5,2.5]x[0.5,2.5]"), 4 );
+    const Box theBox = make_box("[-0.3,0.7]x[1.2,1.4]");
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Enumerate the cells overlapping a box");
+    std::vector<GridCell> expectedCells;
+    for( GridTreeSet::const_iterator it = theSet.begin(); it != theSet.end(); ++it ) {
+        if( possibly( it->box().overlaps( theBox ) ) ) {
+            expectedCells.push_back( *it );
+        }
+    }
+    ARIADNE_TEST_EQUAL( expectedCells.empty(), false );
+    ARIADNE_TEST_EQUAL( expectedCells.size() < theSet.size(), true );
+    std::vector<GridCell> resultCells;
+    for( GridTreeSet::overlapping_const_iterator it = theSet.cells_overlapping( theBox ); it != theSet.cells_overlapping_end(); ++it ) {
+        resultCells.push_back( *it );
+    }
+    ARIADNE_TEST_EQUAL( resultCells.size(), expectedCells.size() );
+    for( uint i = 0; i < resultCells.size(); i++ ) {
+        ARIADNE_TEST_EQUAL( resultCells[i], expectedCells[i] );
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Visit the cells overlapping a box");
+    CellCollector theCollector;
+    theSet.cells_overlapping( theBox, theCollector );
+    ARIADNE_TEST_EQUAL( theCollector.theCells.size(), expectedCells.size() );
+    for( uint i = 0; i < theCollector.theCells.size(); i++ ) {
+        ARIADNE_TEST_EQUAL( theCollector.theCells[i], expectedCells[i] );
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("No cells overlap a box outside of the set");
+    const Box theOtherBox = make_box("[3.0,3.5]x[-2.0,-1.0]");
+    ARIADNE_TEST_EQUAL( theSet.cells_overlapping( theOtherBox ) == theSet.cells_overlapping_end(), true );
+}
+
+void test_project_down() {
+
+    //Allocate a trivial Grid three dimensional grid
+    Grid theTrivialGrid(3, 1.0);
+
+    GridTreeSet theSet( theTrivialGrid );
+    theSet.adjoin_over_approximation( make_box("[-1.5,2.5]x[0.5,2.5]x[-0.7,0.2]"), 2 );
+    theSet.adjoin_over_approximation( make_box("[3.2,3.6]x[-2.5,-1.5]x[1.2,1.9]"), 3 );
+    Vector<uint> indices(2);
+    indices[0] = 0;
+    indices[1] = 2;
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Project the tree of a set down to two dimensions");
+    GridTreeSet theResultSet = project_down( theSet, indices );
+    GridTreeSet theExpectedSet( project_down( theTrivialGrid, indices ) );
+    for( GridTreeSet::const_iterator it = theSet.begin(); it != theSet.end(); ++it ) {
+        theExpectedSet.adjoin( project_down_unchecked( *it, theExpectedSet.grid(), indices ) );
+    }
+    ARIADNE_TEST_EQUAL( theResultSet.dimension(), 2u );
+    ARIADNE_TEST_ASSERT( subset( theResultSet, theExpectedSet ) && subset( theExpectedSet, theResultSet ) );
+    ARIADNE_TEST_ASSERT( theResultSet.size() < theSet.size() );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Project the tree of a set down to one dimension");
+    indices = Vector<uint>(1);
+    indices[0] = 1;
+    theResultSet = project_down( theSet, indices );
+    theExpectedSet = GridTreeSet( project_down( theTrivialGrid, indices ) );
+    for( GridTreeSet::const_iterator it = theSet.begin(); it != theSet.end(); ++it ) {
+        theExpectedSet.adjoin( project_down_unchecked( *it, theExpectedSet.grid(), indices ) );
+    }
+    ARIADNE_TEST_ASSERT( subset( theResultSet, theExpectedSet ) && subset( theExpectedSet, theResultSet ) );
+}
+
+Float grid_set_measure( const GridTreeSubset& theSet ) {
+    Float theMeasure = 0.0;
+    for( GridTreeSubset::const_iterator it = theSet.begin(); it != theSet.end(); ++it ) {
+        const Box theBox = it->box();
+        Float theVolume = 1.0;
+        for( uint i = 0; i < theBox.dimension(); i++ ) {
+            theVolume *= theBox[i].upper() - theBox[i].lower();
+        }
+        theMeasure += theVolume;
+    }
+    return theMeasure;
+}
+
+void test_product() {
+
+    //Allocate a trivial Grid two dimensional grid and a one dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+    Grid theLineGrid(1, 1.0);
+
+    GridTreeSet theSet1( theTrivialGrid );
+    theSet1.adjoin_over_approximation( make_box("[-1.5,0.7]x[0.2,2.5]"), 2 );
+    GridTreeSet theSet2( theLineGrid );
+    theSet2.adjoin_over_approximation( make_box("[3.3,5.6]"), 3 );
+    theSet2.adjoin_over_approximation( make_box("[-0.4,0.1]"), 1 );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The product of two sets on the product grid");
+    GridTreeSet theResultSet = product( theSet1, theSet2 );
+    ARIADNE_TEST_EQUAL( theResultSet.grid(), Grid(3, 1.0) );
+    ARIADNE_TEST_EQUAL( grid_set_measure( theResultSet ), grid_set_measure( theSet1 ) * grid_set_measure( theSet2 ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The projections of the product are the factors");
+    Vector<uint> indices(2);
+    indices[0] = 0;
+    indices[1] = 1;
+    GridTreeSet theProjectedSet = project_down( theResultSet, indices );
+    ARIADNE_TEST_ASSERT( subset( theProjectedSet, theSet1 ) && subset( theSet1, theProjectedSet ) );
+    indices = Vector<uint>(1);
+    indices[0] = 2;
+    theProjectedSet = project_down( theResultSet, indices );
+    ARIADNE_TEST_ASSERT( subset( theProjectedSet, theSet2 ) && subset( theSet2, theProjectedSet ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The product with a subset rooted below the primary cell");
+    GridTreeSubset theSubset( theLineGrid, theSet2.cell().height(), make_binary_word("0"), theSet2.binary_tree_for_update()->left_node() );
+    theResultSet = product( theSet1, theSubset );
+    ARIADNE_TEST_EQUAL( grid_set_measure( theResultSet ), grid_set_measure( theSet1 ) * grid_set_measure( theSubset ) );
+    theProjectedSet = project_down( theResultSet, indices );
+    ARIADNE_TEST_ASSERT( subset( theProjectedSet, theSubset ) && subset( theSubset, theProjectedSet ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("The product with an empty set is empty");
+    ARIADNE_TEST_ASSERT( product( theSet1, GridTreeSet( theLineGrid ) ).empty() );
+}
+
 void test_cell_overlap_subset() {
     
     //Allocate a trivial Grid two dimensional grid
@@ -2416,7 +3585,7 @@ void test_cell_overlap_subset() {
     GridTreeSet theSet( theTrivialGrid, heightTwo, new BinaryTreeNode( tree, leaves ) );
     //The subset is basically the zero level primary cell
     BinaryWord path = make_binary_word("11");
-    GridTreeSubset theSubset( theTrivialGrid, heightOne, path, theSet.binary_tree()->left_node()->left_node()->right_node()->right_node() );
+    GridTreeSubset theSubset( theTrivialGrid, heightOne, path, theSet.binary_tree_for_update()->left_node()->left_node()->right_node()->right_node() );
 
     GridCell theLowCell( theTrivialGrid, heightZero, make_binary_word("111") );        // does intersect with the set and the subset
     GridCell theMediumCellOne( theTrivialGrid, heightOne, make_binary_word("1000") );    // does not intersect with the set and the subset
@@ -2540,7 +3709,7 @@ void test_subset_overlap_subset() {
     GridTreeSet theSet( theTrivialGrid, heightTwo, new BinaryTreeNode( tree, leaves ) );
     //The subset is basically the zero level primary cell
     BinaryWord path = make_binary_word("11");
-    GridTreeSubset theSubset( theTrivialGrid, heightOne, path, theSet.binary_tree()->left_node()->left_node()->right_node()->right_node() );
+    GridTreeSubset theSubset( theTrivialGrid, heightOne, path, theSet.binary_tree_for_update()->left_node()->left_node()->right_node()->right_node() );
     
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Testing bool overlap( const GridTreeSubset& theSet, const GridTreeSubset& theSubset )");
@@ -2625,7 +3794,7 @@ void test_subset_subset_subset() {
     //theSetOne = [-1,0]x[-1,0] U [0,1]x[0,1] U [1,3]x[1,3]
     GridTreeSet theSetOne( theTrivialGrid, heightTwo, new BinaryTreeNode( make_binary_word("1111001000100"), make_binary_word("1001001") ) );
     //theSubsetOne = [-1,0]x[-1,0] U [0,1]x[0,1]
-    GridTreeSubset theSubsetOne( theTrivialGrid, heightTwo, make_binary_word("0"), theSetOne.binary_tree()->left_node() );
+    GridTreeSubset theSubsetOne( theTrivialGrid, heightTwo, make_binary_word("0"), theSetOne.binary_tree_for_update()->left_node() );
 
     // !!!
     ARIADNE_PRINT_TEST_CASE_TITLE("Testing bool subset( const GridTreeSubset& theSetOne, const GridTreeSubset& theSubsetOne )");
@@ -2961,9 +4130,212 @@ void test_subset_superset_box(){
     //TODO: I do not know how to test indeterminate result of the superset relation here.
     //I need two boxes for which we can not determine if they one is a superset of another.
 
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Testing the box relations of a sub-paving rooted below its primary cell");
+    //The sub-paving is rooted to the cell [-1,1]x[1,3] (the path 01 from the primary
+    //cell [-1,3]x[-1,3]), its enabled cells are [-1,0]x[1,2] and [0,1]x[1,2]
+    BinaryTreeNode * pSubPavingRootNode = new BinaryTreeNode( make_binary_word("1100100"), make_binary_word("1010") );
+    GridTreeSubset theSubPaving( theTrivialGrid, heightTwo, make_binary_word("01"), pSubPavingRootNode );
+    ARIADNE_TEST_EQUAL( theSubPaving.cell().box(), make_box("[-1,1]x[1,3]") );
+    box = make_box("[-0.5,0.5]x[1.2,1.8]");
+    ARIADNE_TEST_EQUAL( theSubPaving.overlaps( box ), true );
+    ARIADNE_TEST_EQUAL( theSubPaving.disjoint( box ), false );
+    ARIADNE_TEST_EQUAL( theSubPaving.subset( box ), false );
+    ARIADNE_TEST_EQUAL( theSubPaving.superset( box ), true );
+    box = make_box("[-0.5,0.5]x[2.2,2.8]");
+    ARIADNE_TEST_EQUAL( theSubPaving.overlaps( box ), false );
+    ARIADNE_TEST_EQUAL( theSubPaving.disjoint( box ), true );
+    ARIADNE_TEST_EQUAL( theSubPaving.superset( box ), false );
+    box = make_box("[-0.5,0.5]x[1.5,2.5]");
+    ARIADNE_TEST_EQUAL( theSubPaving.overlaps( box ), true );
+    ARIADNE_TEST_EQUAL( theSubPaving.superset( box ), false );
+    box = make_box("[-1.5,1.5]x[0.5,2.5]");
+    ARIADNE_TEST_EQUAL( theSubPaving.subset( box ), true );
+    delete pSubPavingRootNode;
 }
 
 
+void test_frozen_grid_tree_set() {
+
+    //Allocate a trivial Grid two dimensional grid
+    Grid theTrivialGrid(2, 1.0);
+
+    const uint heightTwo = 2;
+
+    //theSetOne = [-1,0]x[-1,0] U [0,1]x[0,1] U [1,3]x[1,3]
+    GridTreeSet theSetOne( theTrivialGrid, heightTwo, new BinaryTreeNode( make_binary_word("1111001000100"), make_binary_word("1001001") ) );
+    FrozenGridTreeSet theFrozenSetOne( theSetOne );
+
+    //A set large enough for the structure bits to span several directory blocks
+    GridTreeSet theSetTwo( theTrivialGrid, false );
+    theSetTwo.adjoin_over_approximation( make_box("[-0.3,1.7]x[0.2,2.9]"), 6 );
+    theSetTwo.adjoin_over_approximation( make_box("[-2.9,-1.4]x[-1.2,0.3]"), 3 );
+    FrozenGridTreeSet theFrozenSetTwo( theSetTwo );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Freeze a GridTreeSet");
+    ARIADNE_PRINT_TEST_COMMENT( theFrozenSetOne );
+    ARIADNE_TEST_EQUAL( theFrozenSetOne.node_count(), size_t(13) );
+    ARIADNE_TEST_EQUAL( theFrozenSetOne.size(), theSetOne.size() );
+    ARIADNE_TEST_EQUAL( theFrozenSetOne.cell(), theSetOne.cell() );
+    ARIADNE_TEST_EQUAL( theFrozenSetOne.bounding_box(), theSetOne.bounding_box() );
+    ARIADNE_TEST_EQUAL( theFrozenSetOne, FrozenGridTreeSet( theSetOne ) );
+
+    ARIADNE_PRINT_TEST_COMMENT( theFrozenSetTwo );
+    ARIADNE_TEST_COMPARE( theFrozenSetTwo.node_count(), >, size_t(1024) );
+    ARIADNE_TEST_EQUAL( theFrozenSetTwo.size(), theSetTwo.size() );
+    ARIADNE_TEST_EQUAL( theFrozenSetTwo.measure(), theSetTwo.measure() );
+    ARIADNE_TEST_COMPARE( theFrozenSetTwo.memory(), <, theFrozenSetTwo.node_count() / 2 );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Iterate through the FrozenGridTreeSet");
+    FrozenGridTreeSet::const_iterator frozen_iter = theFrozenSetTwo.begin();
+    for( GridTreeSet::const_iterator iter = theSetTwo.begin(); iter != theSetTwo.end(); ++iter, ++frozen_iter ) {
+        if( frozen_iter == theFrozenSetTwo.end() || !( *frozen_iter == *iter ) ) {
+            ARIADNE_TEST_EQUAL( *frozen_iter, *iter );
+            break;
+        }
+    }
+    ARIADNE_TEST_ASSERT( frozen_iter == theFrozenSetTwo.end() );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Skip the subtrees spanning many directory blocks");
+    //The ends of the large subtrees are found through several levels of the range-min tree
+    GridTreeSet theSetThree( theTrivialGrid, false );
+    theSetThree.adjoin_over_approximation( make_box("[-2.9,-1.4]x[-1.2,0.3]"), 8 );
+    theSetThree.adjoin_over_approximation( make_box("[0.15,0.35]x[-2.6,2.9]"), 9 );
+    theSetThree.adjoin_over_approximation( make_box("[1.1,2.7]x[2.3,2.6]"), 7 );
+    const FrozenGridTreeSet theFrozenSetThree( theSetThree );
+    ARIADNE_TEST_COMPARE( theFrozenSetThree.node_count(), >, size_t(16 * 512) );
+    ARIADNE_TEST_EQUAL( theFrozenSetThree.size(), theSetThree.size() );
+    ARIADNE_TEST_EQUAL( theFrozenSetThree.measure(), theSetThree.measure() );
+    frozen_iter = theFrozenSetThree.begin();
+    for( GridTreeSet::const_iterator iter = theSetThree.begin(); iter != theSetThree.end(); ++iter, ++frozen_iter ) {
+        if( frozen_iter == theFrozenSetThree.end() || !( *frozen_iter == *iter ) ) {
+            ARIADNE_TEST_EQUAL( *frozen_iter, *iter );
+            break;
+        }
+    }
+    ARIADNE_TEST_ASSERT( frozen_iter == theFrozenSetThree.end() );
+    const char * theSkippingBoxes[] = { "[2.0,2.1]x[2.4,2.5]", "[2.0,2.1]x[2.0,2.1]", "[0.2,0.3]x[-2.0,2.0]", "[-2.0,2.0]x[0.5,0.6]" };
+    for( uint i = 0; i < 4; i++ ) {
+        Box box = make_box( theSkippingBoxes[i] );
+        ARIADNE_TEST_EQUAL( theFrozenSetThree.overlaps( box ), theSetThree.overlaps( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetThree.subset( box ), theSetThree.subset( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetThree.superset( box ), theSetThree.superset( box ) );
+    }
+    ARIADNE_TEST_EQUAL( subset( theFrozenSetTwo, theFrozenSetThree ), subset( theSetTwo, theSetThree ) );
+    ARIADNE_TEST_EQUAL( overlap( theFrozenSetTwo, theFrozenSetThree ), overlap( theSetTwo, theSetThree ) );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Compare the box predicates with the ones of GridTreeSet");
+    const char * theBoxes[] = { "[-2.0,-1.5]x[10,20]", "[-2.0,4.0]x[-2.0,4.0]", "[-1.0,0.0]x[-1.0,0.0]", "[1.5,2.5]x[1.5,2.5]",
+                                "[0.3,1.7]x[0.6,1.2]", "[-0.6,-0.3]x[1.5,3.0]", "[-1.0,1.0]x[1.0,3.0]", "[1.5,1.8]x[1.3,1.9]" };
+    for( uint i = 0; i < 8; i++ ) {
+        Box box = make_box( theBoxes[i] );
+        ARIADNE_PRINT_TEST_COMMENT( box );
+        ARIADNE_TEST_EQUAL( theFrozenSetOne.overlaps( box ), theSetOne.overlaps( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetOne.disjoint( box ), theSetOne.disjoint( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetOne.subset( box ), theSetOne.subset( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetOne.superset( box ), theSetOne.superset( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetTwo.overlaps( box ), theSetTwo.overlaps( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetTwo.disjoint( box ), theSetTwo.disjoint( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetTwo.subset( box ), theSetTwo.subset( box ) );
+        ARIADNE_TEST_EQUAL( theFrozenSetTwo.superset( box ), theSetTwo.superset( box ) );
+    }
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Compare the set predicates with the ones of GridTreeSet");
+    ARIADNE_TEST_EQUAL( subset( theFrozenSetOne, theFrozenSetTwo ), subset( theSetOne, theSetTwo ) );
+    ARIADNE_TEST_EQUAL( subset( theFrozenSetTwo, theFrozenSetOne ), subset( theSetTwo, theSetOne ) );
+    ARIADNE_TEST_EQUAL( subset( theFrozenSetTwo, theFrozenSetTwo ), true );
+    ARIADNE_TEST_EQUAL( overlap( theFrozenSetOne, theFrozenSetTwo ), overlap( theSetOne, theSetTwo ) );
+
+    GridTreeSet theSubsetOfTwo( theSetTwo );
+    theSubsetOfTwo.restrict( theSetOne );
+    FrozenGridTreeSet theFrozenSubsetOfTwo( theSubsetOfTwo );
+    ARIADNE_TEST_EQUAL( subset( theFrozenSubsetOfTwo, theFrozenSetTwo ), true );
+    ARIADNE_TEST_EQUAL( subset( theFrozenSubsetOfTwo, theFrozenSetOne ), true );
+    ARIADNE_TEST_EQUAL( overlap( theFrozenSubsetOfTwo, theFrozenSetOne ), ! theSubsetOfTwo.empty() );
+
+    for( GridTreeSet::const_iterator iter = theSetOne.begin(); iter != theSetOne.end(); ++iter ) {
+        ARIADNE_TEST_EQUAL( subset( *iter, theFrozenSetOne ), true );
+        ARIADNE_TEST_EQUAL( subset( *iter, theFrozenSetTwo ), subset( *iter, theSetTwo ) );
+        ARIADNE_TEST_EQUAL( overlap( *iter, theFrozenSetTwo ), overlap( *iter, theSetTwo ) );
+    }
+}
+
+void test_morton_grid_tree_set() {
+    Grid theTrivialGrid(2, 1.0);
+
+    GridTreeSet theSetOne( theTrivialGrid, false );
+    theSetOne.adjoin_over_approximation( make_box("[-0.3,1.7]x[0.2,2.9]"), 4 );
+    theSetOne.adjoin_over_approximation( make_box("[-2.9,-1.4]x[-1.2,0.3]"), 2 );
+    GridTreeSet theSetTwo( theTrivialGrid, false );
+    theSetTwo.adjoin_over_approximation( make_box("[0.6,2.2]x[-0.7,1.1]"), 3 );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Convert a GridTreeSet into the Morton codes and back");
+    const MortonGridTreeSet theMortonSetOne( theSetOne );
+    const MortonGridTreeSet theMortonSetTwo( theSetTwo );
+    ARIADNE_PRINT_TEST_COMMENT( theMortonSetOne );
+    ARIADNE_TEST_EQUAL( theMortonSetOne.size(), theSetOne.size() );
+    ARIADNE_TEST_EQUAL( theMortonSetOne.height(), theSetOne.cell().height() );
+    ARIADNE_TEST_COMPARE( theMortonSetOne.memory(), <=, 2 * sizeof( MortonGridTreeSet::Key ) * theMortonSetOne.size() );
+    //The cells are in the order of the depth first traversal
+    size_t theIndex = 0;
+    for( GridTreeSet::const_iterator iter = theSetOne.begin(); iter != theSetOne.end(); ++iter, ++theIndex ) {
+        ARIADNE_TEST_EQUAL( theMortonSetOne.cell( theIndex ), *iter );
+    }
+    GridTreeSet theConvertedSet = theMortonSetOne.to_grid_tree_set();
+    ARIADNE_TEST_EQUAL( theConvertedSet.size(), theSetOne.size() );
+    ARIADNE_TEST_EQUAL( MortonGridTreeSet( theConvertedSet ), theMortonSetOne );
+    GridTreeSet theRecombinedSet( theSetOne );
+    theRecombinedSet.recombine();
+    theConvertedSet.recombine();
+    ARIADNE_TEST_EQUAL( theConvertedSet, theRecombinedSet );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Set operations as merges of the Morton codes");
+    GridTreeSet theExpectedSet = join( theSetOne, theSetTwo );
+    GridTreeSet theResultSet = join( theMortonSetOne, theMortonSetTwo ).to_grid_tree_set();
+    ARIADNE_TEST_ASSERT( subset( theResultSet, theExpectedSet ) && subset( theExpectedSet, theResultSet ) );
+    theExpectedSet = intersection( theSetOne, theSetTwo );
+    theResultSet = intersection( theMortonSetOne, theMortonSetTwo ).to_grid_tree_set();
+    ARIADNE_TEST_ASSERT( subset( theResultSet, theExpectedSet ) && subset( theExpectedSet, theResultSet ) );
+    theExpectedSet = difference( theSetOne, theSetTwo );
+    theResultSet = difference( theMortonSetOne, theMortonSetTwo ).to_grid_tree_set();
+    ARIADNE_TEST_ASSERT( subset( theResultSet, theExpectedSet ) && subset( theExpectedSet, theResultSet ) );
+    ARIADNE_TEST_ASSERT( difference( theMortonSetOne, theMortonSetOne ).empty() );
+    ARIADNE_TEST_EQUAL( join( theMortonSetOne, theMortonSetOne ), theMortonSetOne );
+
+    // !!!
+    ARIADNE_PRINT_TEST_CASE_TITLE("Recombine the Morton codes and compare the sets canonically");
+    MortonGridTreeSet theRecombinedMortonSet( theMortonSetOne );
+    theRecombinedMortonSet.recombine();
+    ARIADNE_TEST_EQUAL( theRecombinedMortonSet.size(), theRecombinedSet.size() );
+    ARIADNE_TEST_EQUAL( theRecombinedMortonSet.to_grid_tree_set(), theRecombinedSet );
+    ARIADNE_TEST_EQUAL( theRecombinedMortonSet, theMortonSetOne );
+    GridTreeSet theMincedSet( theSetOne );
+    theMincedSet.mince( 6 );
+    ARIADNE_TEST_COMPARE( MortonGridTreeSet( theMincedSet ).size(), >, theMortonSetOne.size() );
+    ARIADNE_TEST_EQUAL( MortonGridTreeSet( theMincedSet ), theMortonSetOne );
+    MortonGridTreeSet theHigherMortonSet( theMortonSetOne );
+    theHigherMortonSet.up_to_primary_cell( theMortonSetOne.height() + 2 );
+    ARIADNE_TEST_EQUAL( theHigherMortonSet, theMortonSetOne );
+    ARIADNE_TEST_ASSERT( ! ( theMortonSetTwo == theMortonSetOne ) );
+
+    ARIADNE_PRINT_TEST_COMMENT("The paths longer than MAX_DEPTH bits are not representable");
+    ARIADNE_TEST_ASSERT( MortonGridTreeSet::is_representable( theSetOne ) );
+    BinaryWord theDeepWord;
+    for( uint i = 0; i < MortonGridTreeSet::MAX_DEPTH + 1; i++ ) {
+        theDeepWord.push_back( ( i % 3 ) == 0 );
+    }
+    GridTreeSet theDeepSet( theTrivialGrid, false );
+    theDeepSet.adjoin( GridCell( theTrivialGrid, 0, theDeepWord ) );
+    ARIADNE_TEST_ASSERT( ! MortonGridTreeSet::is_representable( theDeepSet ) );
+}
+
 void test_constraintset_vs_gridtreeset_checks()
 {
 	RealVariable x("x");
@@ -3028,6 +4400,30 @@ void test_constraintset_vs_gridtreeset_checks()
 	ARIADNE_TEST_ASSERT(overlaps(cons,gts4));
 	ARIADNE_TEST_ASSERT(covers(cons,gts4));
 
+	GridTreeSet gts5(gr);
+	Box bx5a(1,0.3,0.7);
+	Box bx5b(1,2.6,3.4);
+	gts5.adjoin_outer_approximation(bx5a,4);
+	gts5.adjoin_outer_approximation(bx5b,4);
+
+	ARIADNE_PRINT_TEST_COMMENT("Testing " << bx5a << " and " << bx5b << " (inside and disjoint)\n");
+	ARIADNE_PRINT_TEST_COMMENT("Grid tree set size: " << gts5.size() << "\n");
+
+	ARIADNE_TEST_ASSERT(!disjoint(cons,gts5));
+	ARIADNE_TEST_ASSERT(overlaps(cons,gts5));
+	ARIADNE_TEST_ASSERT(!covers(cons,gts5));
+
+	GridTreeSet gts6(gr);
+	Box bx6(1,2.6,3.4);
+	gts6.adjoin_outer_approximation(bx6,4);
+
+	ARIADNE_PRINT_TEST_COMMENT("Testing " << bx6 << " (disjoint, many cells)\n");
+	ARIADNE_PRINT_TEST_COMMENT("Grid tree set size: " << gts6.size() << "\n");
+
+	ARIADNE_TEST_ASSERT(disjoint(cons,gts6));
+	ARIADNE_TEST_ASSERT(!overlaps(cons,gts6));
+	ARIADNE_TEST_ASSERT(!covers(cons,gts6));
+
 }
 
 void test_constraintset_vs_gridtreeset_operations()
@@ -3231,6 +4627,21 @@ int main() {
 
     test_binary_tree();
 
+    test_binary_tree_node_pool();
+
+    test_compact_binary_tree();
+
+    test_hash_consed_binary_tree();
+
+    test_copy_on_write_grid_tree_set();
+
+    test_enabled_leaf_counts();
+
+    test_packed_binary_word();
+
+    test_lattice_cell();
+    test_neighboring_cells();
+
     test_grid_paving_cursor();
 
     test_grid_paving_const_iterator();
@@ -3261,6 +4672,8 @@ int main() {
 
     test_restrict();
 
+    test_dilate_erode();
+
     test_remove_one();
     test_remove_two();
 
@@ -3269,12 +4682,25 @@ int main() {
     test_subsets_join();
     test_subsets_intersection();
     test_subsets_difference();
+    test_large_subsets_operations();
+    test_move_operations();
+    test_multiple_subsets_join();
+    test_adjoin_and_report_new();
+    test_hash();
+    test_lazy_set_expressions();
+    test_bulk_adjoin();
+    test_locate_points();
+    test_cells_overlapping();
+    test_project_down();
+    test_product();
     test_cell_overlap_subset();
     test_subset_overlap_subset();
     test_subset_subset_subset();
     test_subset_overlaps_box();
     test_subset_subset_box();
     test_subset_superset_box();
+    test_frozen_grid_tree_set();
+    test_morton_grid_tree_set();
 
     test_constraintset_vs_gridtreeset_checks();
     test_constraintset_vs_gridtreeset_operations();